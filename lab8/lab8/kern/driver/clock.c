@@ -3,43 +3,148 @@
 #include <sbi.h>
 #include <stdio.h>
 #include <riscv.h>
+#include <sync.h>
+#include <smp.h>
+#include <sched.h>
+#include <dev.h>
+
+/* *
+ * Ticks are read off the time CSR, so they keep counting while no hart
+ * takes timer interrupts. A hart takes one every tick only while the
+ * scheduler needs it to share the hart out (see sched_need_tick), or, on
+ * the boot hart, while a process waits for the console, which is polled.
+ * Otherwise it stops its tick: the next interrupt comes when the earliest
+ * timer on the wheel expires, or CLOCK_NOHZ_MAX_TICKS later at most. Either
+ * way, it comes earlier if a high-resolution timer of the hart expires first.
+ * */
 
 volatile size_t ticks;
 
-static inline uint64_t get_cycles(void)
+uint64_t timebase = TIMEBASE_FREQ / TICK_HZ;
+uint64_t clock_start;           // cycles at tick 0
+
+#define COUNTEREN_TM 0x2        // scounteren: user mode may read the time CSR
+
+#define CLOCK_NOHZ_MAX_TICKS 100 // longest stretch without a tick, 1s
+
+static inline uint64_t
+tick_to_cycles(size_t tick)
 {
-#if __riscv_xlen == 64
-    uint64_t n;
-    __asm__ __volatile__("rdtime %0" : "=r"(n));
-    return n;
-#else
-    uint32_t lo, hi, tmp;
-    __asm__ __volatile__(
-        "1:\n"
-        "rdtimeh %0\n"
-        "rdtime %1\n"
-        "rdtimeh %2\n"
-        "bne %0, %2, 1b"
-        : "=&r"(hi), "=&r"(lo), "=&r"(tmp));
-    return ((uint64_t)hi << 32) | lo;
-#endif
+    return clock_start + tick * timebase;
 }
 
-static uint64_t timebase = 100000;
-
 /* *
  * clock_init - initialize 8253 clock to interrupt 100 times per second,
  * and then enable IRQ_TIMER.
  * */
 void clock_init(void)
 {
-    set_csr(sie, MIP_STIP);
-
-    clock_set_next_event();
     // initialize time counter 'ticks' to zero
+    clock_start = get_cycles();
     ticks = 0;
 
+    // the vdso page lets processes read the time themselves
+    set_csr(scounteren, COUNTEREN_TM);
+    set_csr(sie, MIP_STIP);
+    clock_set_next_event();
+
     cprintf("++ setup timer interrupts\n");
 }
 
-void clock_set_next_event(void) { sbi_set_timer(get_cycles() + timebase); }
+// clock_init_secondary - timer interrupts for a secondary hart; ticks is the boot hart's
+void clock_init_secondary(void)
+{
+    set_csr(scounteren, COUNTEREN_TM);
+    set_csr(sie, MIP_STIP);
+    clock_set_next_event();
+}
+
+// clock_program - program the timer interrupt of CPU, this hart, for WHEN or its first hrtimer
+static void
+clock_program(struct cpu *cpu, uint64_t when)
+{
+    uint64_t expires;
+    if (hrtimer_next_expiry(cpu, &expires) && expires < when)
+    {
+        when = expires;
+    }
+    cpu->next_event = when;
+    sbi_set_timer(when);
+}
+
+// clock_gettime_ns - nanoseconds since the clock was set up, read off the time CSR
+uint64_t clock_gettime_ns(void)
+{
+    return CYCLES_TO_NS(get_cycles() - clock_start);
+}
+
+// clock_user_readable - whether user mode may read the time CSR; scounteren bits may be hardwired to 0
+bool clock_user_readable(void)
+{
+    return (read_csr(scounteren) & COUNTEREN_TM) != 0;
+}
+
+// clock_update_ticks - bring ticks up to date with the time CSR, and return it
+size_t clock_update_ticks(void)
+{
+    size_t now = (get_cycles() - clock_start) / timebase, old;
+    while ((old = ticks) < now && !__sync_bool_compare_and_swap(&ticks, old, now))
+        ;
+    return ticks;
+}
+
+/* *
+ * clock_set_next_event - program the next timer interrupt of this hart: the
+ * next tick if it needs the periodic tick, otherwise the tick the earliest
+ * timer expires at. Called with interrupts disabled.
+ * */
+void clock_set_next_event(void)
+{
+    struct cpu *cpu = mycpu();
+    size_t now = clock_update_ticks(), next = now + 1;
+    unsigned int expires;
+    if (!sched_need_tick(cpu) && !(cpu == boot_cpu && dev_stdin_waiting()))
+    {
+        next = now + CLOCK_NOHZ_MAX_TICKS;
+        if (timer_next_expiry(&expires) && (int)(expires - (unsigned int)next) < 0)
+        {
+            int delta = (int)(expires - (unsigned int)now);
+            next = now + ((delta > 0) ? delta : 1);
+        }
+    }
+    if (next > now + 1 && !cpu->tickless)
+    {
+        cpu->nr_tickless++;
+    }
+    cpu->tickless = (next > now + 1);
+    clock_program(cpu, tick_to_cycles(next));
+}
+
+// clock_tick_passed - has a tick begun on this hart since it last charged one to the scheduler?
+bool clock_tick_passed(void)
+{
+    struct cpu *cpu = mycpu();
+    size_t now = clock_update_ticks();
+    if (now == cpu->last_tick)
+    {
+        return 0;
+    }
+    cpu->last_tick = now;
+    return 1;
+}
+
+// clock_start_tick - this hart stopped its tick, but needs it again now
+void clock_start_tick(void)
+{
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        struct cpu *cpu = mycpu();
+        if (cpu->tickless)
+        {
+            cpu->tickless = 0;
+            clock_program(cpu, tick_to_cycles(clock_update_ticks() + 1));
+        }
+    }
+    local_intr_restore(intr_flag);
+}
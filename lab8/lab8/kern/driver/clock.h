@@ -3,9 +3,47 @@
 
 #include <defs.h>
 
+// the time CSR of qemu virt counts at 10MHz
+#define TIMEBASE_FREQ 10000000
+#define TICK_HZ 100
+
+#define NSEC_PER_SEC 1000000000ULL
+
+#define USEC_TO_CYCLES(us) ((uint64_t)(us) * (TIMEBASE_FREQ / 1000000))
+#define CYCLES_TO_USEC(c) ((uint64_t)(c) / (TIMEBASE_FREQ / 1000000))
+#define CYCLES_TO_NS(c) ((uint64_t)(c) * (NSEC_PER_SEC / TIMEBASE_FREQ))
+#define NS_TO_CYCLES(ns) (((uint64_t)(ns) + NSEC_PER_SEC / TIMEBASE_FREQ - 1) / (NSEC_PER_SEC / TIMEBASE_FREQ))
+
 extern volatile size_t ticks;
+extern uint64_t timebase;    // cycles per tick
+extern uint64_t clock_start; // cycles at tick 0, time 0 of clock_gettime_ns
+
+static inline uint64_t get_cycles(void)
+{
+#if __riscv_xlen == 64
+    uint64_t n;
+    __asm__ __volatile__("rdtime %0" : "=r"(n));
+    return n;
+#else
+    uint32_t lo, hi, tmp;
+    __asm__ __volatile__(
+        "1:\n"
+        "rdtimeh %0\n"
+        "rdtime %1\n"
+        "rdtimeh %2\n"
+        "bne %0, %2, 1b"
+        : "=&r"(hi), "=&r"(lo), "=&r"(tmp));
+    return ((uint64_t)hi << 32) | lo;
+#endif
+}
 
 void clock_init(void);
+void clock_init_secondary(void);
 void clock_set_next_event(void);
+void clock_start_tick(void);
+size_t clock_update_ticks(void);
+bool clock_tick_passed(void);
+uint64_t clock_gettime_ns(void);
+bool clock_user_readable(void);
 
 #endif /* !__KERN_DRIVER_CLOCK_H__ */
@@ -25,6 +25,8 @@ struct device {
 #define dop_ioctl(dev, op, data)            ((dev)->d_ioctl(dev, op, data))
 
 void dev_init(void);
+void dev_stdin_write(char c);
+bool dev_stdin_waiting(void);
 struct inode *dev_create_inode(void);
 
 #endif /* !__KERN_FS_DEVS_DEV_H__ */
@@ -11,6 +11,7 @@
 #include <unistd.h>
 #include <error.h>
 #include <assert.h>
+#include <smp.h>
 
 #define STDIN_BUFSIZE               4096
 
@@ -36,6 +37,12 @@ dev_stdin_write(char c) {
     }
 }
 
+// dev_stdin_waiting - is a process waiting for input? Then the boot hart polls the console every tick
+bool
+dev_stdin_waiting(void) {
+    return !wait_queue_empty(wait_queue);
+}
+
 static int
 dev_stdin_read(char *buf, size_t len) {
     int ret = 0;
@@ -51,6 +58,10 @@ dev_stdin_read(char *buf, size_t len) {
                 wait_t __wait, *wait = &__wait;
                 wait_current_set(wait_queue, wait, WT_KBD);
                 local_intr_restore(intr_flag);
+                // the console is polled on the tick of the boot hart
+                if (boot_cpu->tickless) {
+                    smp_send_tick(boot_cpu);
+                }
 
                 schedule();
 
@@ -1,68 +1,102 @@
 #include <defs.h>
 #include <string.h>
+#include <kmalloc.h>
 #include <vfs.h>
 #include <proc.h>
 #include <file.h>
 #include <unistd.h>
 #include <iobuf.h>
 #include <inode.h>
+#include <pipe.h>
 #include <stat.h>
 #include <dirent.h>
 #include <error.h>
 #include <assert.h>
 
-#define testfd(fd)                          ((fd) >= 0 && (fd) < FILES_STRUCT_NENTRY)
+#define testfd(fd)                          ((fd) >= 0 && (fd) < FILES_NR_OPEN_MAX)
 
-// get_fd_array - get current process's open files table
-static struct file *
-get_fd_array(void) {
+/* readahead window of a sequential reader */
+#define RA_MIN_WINDOW                       (2 * PGSIZE)
+#define RA_MAX_WINDOW                       (32 * PGSIZE)
+
+// get_files - get current process's open files table
+static struct files_struct *
+get_files(void) {
     struct files_struct *filesp = current->filesp;
     assert(filesp != NULL && files_count(filesp) > 0);
-    return filesp->fd_array;
+    return filesp;
 }
 
-// fd_array_init - initialize the open files table
-void
-fd_array_init(struct file *fd_array) {
-    int fd;
-    struct file *file = fd_array;
-    for (fd = 0; fd < FILES_STRUCT_NENTRY; fd ++, file ++) {
-        file->open_count = 0;
-        file->status = FD_NONE, file->fd = fd;
-    }
-}
+#define fd_word(filesp, fd)                 ((filesp)->open_fds[(fd) / FILES_FDS_PER_WORD])
+#define fd_bit(fd)                          (1U << ((fd) % FILES_FDS_PER_WORD))
 
-// fs_array_alloc - allocate a free file item (with FD_NONE status) in open files table
+// fd_reserve - take the fd fd, or the lowest free fd if fd is NO_FD, growing the table if needed
 static int
-fd_array_alloc(int fd, struct file **file_store) {
-//    panic("debug");
-    struct file *file = get_fd_array();
+fd_reserve(struct files_struct *filesp, int fd) {
+    int ret;
     if (fd == NO_FD) {
-        for (fd = 0; fd < FILES_STRUCT_NENTRY; fd ++, file ++) {
-            if (file->status == FD_NONE) {
-                goto found;
+        // skip the full words, then find the first zero bit of the next one
+        int i = filesp->next_fd / FILES_FDS_PER_WORD, nwords = filesp->max_fds / FILES_FDS_PER_WORD;
+        while (i < nwords && filesp->open_fds[i] == ~0U) {
+            i ++;
+        }
+        fd = i * FILES_FDS_PER_WORD;
+        if (i < nwords) {
+            uint32_t word = filesp->open_fds[i];
+            for (; word & 1; word >>= 1) {
+                fd ++;
             }
         }
-        return -E_MAX_OPEN;
+        if ((ret = files_expand(filesp, fd + 1)) != 0) {
+            return ret;
+        }
+        filesp->next_fd = fd + 1;
     }
     else {
-        if (testfd(fd)) {
-            file += fd;
-            if (file->status == FD_NONE) {
-                goto found;
-            }
+        if (!testfd(fd)) {
+            return -E_INVAL;
+        }
+        if ((ret = files_expand(filesp, fd + 1)) != 0) {
+            return ret;
+        }
+        if (fd_word(filesp, fd) & fd_bit(fd)) {
             return -E_BUSY;
         }
-        return -E_INVAL;
     }
-found:
-    assert(fopen_count(file) == 0);
-    file->status = FD_INIT, file->node = NULL;
+    fd_word(filesp, fd) |= fd_bit(fd);
+    return fd;
+}
+
+// fd_unreserve - give back the fd fd
+static void
+fd_unreserve(struct files_struct *filesp, int fd) {
+    assert(fd_word(filesp, fd) & fd_bit(fd));
+    fd_word(filesp, fd) &= ~fd_bit(fd);
+    filesp->fd_array[fd] = NULL;
+    if (fd < filesp->next_fd) {
+        filesp->next_fd = fd;
+    }
+}
+
+// fd_array_alloc - allocate a new open file (with FD_INIT status) and take a free fd for it
+static int
+fd_array_alloc(int fd, struct file **file_store) {
+    struct file *file;
+    if ((file = kmalloc(sizeof(struct file))) == NULL) {
+        return -E_NO_MEM;
+    }
+    if ((fd = fd_reserve(get_files(), fd)) < 0) {
+        kfree(file);
+        return fd;
+    }
+    file->status = FD_INIT, file->fd = fd;
+    file->node = NULL, file->open_count = 0, file->append = 0;
+    memset(&(file->ra), 0, sizeof(struct file_ra));
     *file_store = file;
     return 0;
 }
 
-// fd_array_free - free a file item in open files table
+// fd_array_free - free an open file that is not opened yet, or that nothing refers to any more
 static void
 fd_array_free(struct file *file) {
     assert(file->status == FD_INIT || file->status == FD_CLOSED);
@@ -70,7 +104,10 @@ fd_array_free(struct file *file) {
     if (file->status == FD_CLOSED) {
         vfs_close(file->node);
     }
-    file->status = FD_NONE;
+    else {
+        fd_unreserve(get_files(), file->fd);
+    }
+    kfree(file);
 }
 
 static void
@@ -82,52 +119,48 @@ fd_array_acquire(struct file *file) {
 // fd_array_release - file's open_count--; if file's open_count-- == 0 , then call fd_array_free to free this file item
 static void
 fd_array_release(struct file *file) {
-    assert(file->status == FD_OPENED || file->status == FD_CLOSED);
+    assert(file->status == FD_OPENED);
     assert(fopen_count(file) > 0);
     if (fopen_count_dec(file) == 0) {
+        file->status = FD_CLOSED;
         fd_array_free(file);
     }
 }
 
-// fd_array_open - file's open_count++, set status to FD_OPENED
+// fd_array_open - file's open_count++, set status to FD_OPENED, and install it at its fd
 void
 fd_array_open(struct file *file) {
     assert(file->status == FD_INIT && file->node != NULL);
     file->status = FD_OPENED;
     fopen_count_inc(file);
+    get_files()->fd_array[file->fd] = file;
 }
 
-// fd_array_close - file's open_count--; if file's open_count-- == 0 , then call fd_array_free to free this file item
+// fd_array_close - free the fd fd of filesp and drop its reference to the open file
 void
-fd_array_close(struct file *file) {
-    assert(file->status == FD_OPENED);
-    assert(fopen_count(file) > 0);
-    file->status = FD_CLOSED;
-    if (fopen_count_dec(file) == 0) {
-        fd_array_free(file);
-    }
+fd_array_close(struct files_struct *filesp, int fd) {
+    struct file *file = filesp->fd_array[fd];
+    assert(file != NULL);
+    fd_unreserve(filesp, fd);
+    fd_array_release(file);
 }
 
-//fs_array_dup - duplicate file 'from'  to file 'to'
+// fd_array_share - make the fd fd of filesp refer to the open file too (dup, fork)
 void
-fd_array_dup(struct file *to, struct file *from) {
-    //cprintf("[fd_array_dup]from fd=%d, to fd=%d\n",from->fd, to->fd);
-    assert(to->status == FD_INIT && from->status == FD_OPENED);
-    to->pos = from->pos;
-    to->readable = from->readable;
-    to->writable = from->writable;
-    struct inode *node = from->node;
-    vop_ref_inc(node), vop_open_inc(node);
-    to->node = node;
-    fd_array_open(to);
+fd_array_share(struct files_struct *filesp, int fd, struct file *file) {
+    assert(file->status == FD_OPENED && filesp->fd_array[fd] == NULL);
+    fopen_count_inc(file);
+    fd_word(filesp, fd) |= fd_bit(fd);
+    filesp->fd_array[fd] = file;
 }
 
 // fd2file - use fd as index of fd_array, return the array item (file)
 static inline int
 fd2file(int fd, struct file **file_store) {
-    if (testfd(fd)) {
-        struct file *file = get_fd_array() + fd;
-        if (file->status == FD_OPENED && file->fd == fd) {
+    struct files_struct *filesp = get_files();
+    if (fd >= 0 && fd < filesp->max_fds) {
+        struct file *file = filesp->fd_array[fd];
+        if (file != NULL && file->status == FD_OPENED) {
             *file_store = file;
             return 0;
         }
@@ -188,6 +221,7 @@ file_open(char *path, uint32_t open_flags) {
     file->node = node;
     file->readable = readable;
     file->writable = writable;
+    file->append = (open_flags & O_APPEND) != 0;
     fd_array_open(file);
     return file->fd;
 }
@@ -200,62 +234,140 @@ file_close(int fd) {
     if ((ret = fd2file(fd, &file)) != 0) {
         return ret;
     }
-    fd_array_close(file);
+    fd_array_close(get_files(), fd);
     return 0;
 }
 
-// read file
-int
-file_read(int fd, void *base, size_t len, size_t *copied_store) {
+/*
+ * file_readahead - account a read of len bytes at pos of file, cached of them found by the file
+ *                  system in its readahead cache. A read that starts where the last one ended
+ *                  is sequential and opens the window at RA_MIN_WINDOW; any other read closes it. Once less than half a window is left read ahead of
+ *                  the reader, the next stretch is started in the background, and the window
+ *                  doubles (up to RA_MAX_WINDOW) if the reader got into the last one.
+ */
+static void
+file_readahead(struct file *file, off_t pos, size_t len, size_t cached) {
+    struct file_ra *ra = &(file->ra);
+    struct rastat *stat = &(ra->stat);
+    if (!vop_has_op(file->node, readahead) || len == 0) {
+        return;
+    }
+    stat->ra_reads ++, stat->ra_bytes += len, stat->ra_hits += cached;
+    if (pos != ra->next) {
+        stat->ra_window = 0, ra->ahead = 0;
+    }
+    else {
+        stat->ra_seqreads ++;
+        if (stat->ra_window == 0) {
+            stat->ra_window = RA_MIN_WINDOW;
+        }
+    }
+    ra->next = pos + len;
+    if (stat->ra_window != 0 && ra->ahead < ra->next + stat->ra_window / 2) {
+        if (ra->ahead > pos && stat->ra_window < RA_MAX_WINDOW) {
+            stat->ra_window *= 2;
+        }
+        off_t start = (ra->ahead > ra->next) ? ra->ahead : ra->next;
+        ra->ahead = ra->next + stat->ra_window;
+        vop_readahead(file->node, start, ra->ahead - start);
+    }
+}
+
+/*
+ * file_append_pos - move file->pos of an O_APPEND writer to the end of the file
+ */
+static int
+file_append_pos(struct file *file) {
+    int ret;
+    struct stat __stat, *stat = &__stat;
+    if (file->append && !check_inode_type(file->node, pipe_inode)) {
+        if ((ret = vop_fstat(file->node, stat)) != 0) {
+            return ret;
+        }
+        file->pos = stat->st_size;
+    }
+    return 0;
+}
+
+/*
+ * file_rw - read or write len bytes at base on an acquired file, at *posp (advanced by the
+ *           amount transferred) if posp is not NULL, otherwise at file->pos. Reads are
+ *           accounted for readahead. Shared by read/write and the sendfile bounce buffer.
+ */
+static int
+file_rw(struct file *file, void *base, size_t len, off_t *posp, bool write, size_t *copied_store) {
     int ret;
-    struct file *file;
     *copied_store = 0;
-    if ((ret = fd2file(fd, &file)) != 0) {
+    if (write && posp == NULL && (ret = file_append_pos(file)) != 0) {
         return ret;
     }
-    if (!file->readable) {
-        return -E_INVAL;
-    }
-    fd_array_acquire(file);
-
-    struct iobuf __iob, *iob = iobuf_init(&__iob, base, len, file->pos);
-    ret = vop_read(file->node, iob);
+    off_t pos = (posp != NULL) ? *posp : file->pos;
+    struct iobuf __iob, *iob = iobuf_init(&__iob, base, len, pos);
+    ret = write ? vop_write(file->node, iob) : vop_read(file->node, iob);
 
     size_t copied = iobuf_used(iob);
-    if (file->status == FD_OPENED) {
+    if (!write) {
+        file_readahead(file, pos, copied, iob->io_cached);
+    }
+    if (posp != NULL) {
+        *posp += copied;
+    }
+    else if (file->status == FD_OPENED) {
         file->pos += copied;
     }
     *copied_store = copied;
-    fd_array_release(file);
     return ret;
 }
 
-// write file
-int
-file_write(int fd, void *base, size_t len, size_t *copied_store) {
+/*
+ * file_io - read or write len bytes at base. at *posp (advanced by the amount transferred) if
+ *           posp is not NULL, otherwise at file->pos.
+ */
+static int
+file_io(int fd, void *base, size_t len, off_t *posp, bool write, size_t *copied_store) {
     int ret;
     struct file *file;
     *copied_store = 0;
     if ((ret = fd2file(fd, &file)) != 0) {
         return ret;
     }
-    if (!file->writable) {
+    if (write ? !file->writable : !file->readable) {
         return -E_INVAL;
     }
-    fd_array_acquire(file);
-
-    struct iobuf __iob, *iob = iobuf_init(&__iob, base, len, file->pos);
-    ret = vop_write(file->node, iob);
-
-    size_t copied = iobuf_used(iob);
-    if (file->status == FD_OPENED) {
-        file->pos += copied;
+    // a pipe has no position to read or write at
+    if (posp != NULL && check_inode_type(file->node, pipe_inode)) {
+        return -E_INVAL;
     }
-    *copied_store = copied;
+    fd_array_acquire(file);
+    ret = file_rw(file, base, len, posp, write, copied_store);
     fd_array_release(file);
     return ret;
 }
 
+// read file
+int
+file_read(int fd, void *base, size_t len, size_t *copied_store) {
+    return file_io(fd, base, len, NULL, 0, copied_store);
+}
+
+// write file
+int
+file_write(int fd, void *base, size_t len, size_t *copied_store) {
+    return file_io(fd, base, len, NULL, 1, copied_store);
+}
+
+// read file at pos, file->pos is left alone
+int
+file_pread(int fd, void *base, size_t len, off_t pos, size_t *copied_store) {
+    return file_io(fd, base, len, &pos, 0, copied_store);
+}
+
+// write file at pos, file->pos is left alone
+int
+file_pwrite(int fd, void *base, size_t len, off_t pos, size_t *copied_store) {
+    return file_io(fd, base, len, &pos, 1, copied_store);
+}
+
 // seek file
 int
 file_seek(int fd, off_t pos, int whence) {
@@ -328,25 +440,217 @@ file_getdirentry(int fd, struct dirent *direntp) {
 
     struct iobuf __iob, *iob = iobuf_init(&__iob, direntp->name, sizeof(direntp->name), direntp->offset);
     if ((ret = vop_getdirentry(file->node, iob)) == 0) {
-        direntp->offset += iobuf_used(iob);
+        // the fs leaves the position of the next entry in io_offset
+        direntp->offset = iob->io_offset;
+    }
+    fd_array_release(file);
+    return ret;
+}
+
+/*
+ * file_getdents - read as many packed entries of the DIR fd as fit in len bytes of buf,
+ *                 starting at the file position, and move the position past them
+ */
+int
+file_getdents(int fd, void *buf, size_t len, size_t *copied_store) {
+    int ret;
+    struct file *file;
+    *copied_store = 0;
+    if ((ret = fd2file(fd, &file)) != 0) {
+        return ret;
+    }
+    if (!file->readable) {
+        return -E_INVAL;
+    }
+    fd_array_acquire(file);
+
+    if (!vop_has_op(file->node, getdents)) {
+        ret = -E_NOTDIR;
+    }
+    else {
+        struct iobuf __iob, *iob = iobuf_init(&__iob, buf, len, file->pos);
+        ret = vop_getdents(file->node, iob);
+        file->pos = iob->io_offset;
+        *copied_store = len - iob->io_resid;
     }
     fd_array_release(file);
     return ret;
 }
 
-// duplicate file
+// duplicate file: fd2 (or the lowest free fd if fd2 is NO_FD) refers to the open file of fd1
 int
 file_dup(int fd1, int fd2) {
     int ret;
-    struct file *file1, *file2;
-    if ((ret = fd2file(fd1, &file1)) != 0) {
+    struct file *file;
+    struct files_struct *filesp = get_files();
+    if ((ret = fd2file(fd1, &file)) != 0) {
+        return ret;
+    }
+    if ((fd2 = fd_reserve(filesp, fd2)) < 0) {
+        return fd2;
+    }
+    // both fds share one open file, and so its position
+    fd_array_share(filesp, fd2, file);
+    return fd2;
+}
+
+// pipe - create a pipe, fd[0] is its read end and fd[1] its write end
+int
+file_pipe(int fd[]) {
+    int ret;
+    struct file *rfile = NULL, *wfile = NULL;
+    if ((ret = fd_array_alloc(NO_FD, &rfile)) != 0) {
+        goto failed_cleanup;
+    }
+    if ((ret = fd_array_alloc(NO_FD, &wfile)) != 0) {
+        goto failed_cleanup;
+    }
+    struct inode *rnode, *wnode;
+    if ((ret = pipe_open(&rnode, &wnode)) != 0) {
+        goto failed_cleanup;
+    }
+    rfile->pos = wfile->pos = 0;
+    rfile->node = rnode, rfile->readable = 1, rfile->writable = 0;
+    wfile->node = wnode, wfile->readable = 0, wfile->writable = 1;
+    fd_array_open(rfile);
+    fd_array_open(wfile);
+    fd[0] = rfile->fd, fd[1] = wfile->fd;
+    return 0;
+
+failed_cleanup:
+    if (rfile != NULL) {
+        fd_array_free(rfile);
+    }
+    if (wfile != NULL) {
+        fd_array_free(wfile);
+    }
+    return ret;
+}
+
+// open one end of the fifo called name, O_RDONLY for the read end or O_WRONLY for the write end
+int
+file_mkfifo(const char *name, uint32_t open_flags) {
+    bool reader;
+    switch (open_flags & O_ACCMODE) {
+    case O_RDONLY: reader = 1; break;
+    case O_WRONLY: reader = 0; break;
+    default:
+        return -E_INVAL;
+    }
+    int ret;
+    struct file *file;
+    if ((ret = fd_array_alloc(NO_FD, &file)) != 0) {
+        return ret;
+    }
+    struct inode *node;
+    if ((ret = pipe_fifo_open(name, reader, &node)) != 0) {
+        fd_array_free(file);
+        return ret;
+    }
+    file->pos = 0;
+    file->node = node;
+    file->readable = reader;
+    file->writable = !reader;
+    fd_array_open(file);
+    return file->fd;
+}
+
+#define SENDFILE_BUFSIZE                    4096
+
+/*
+ * file_transfer - move up to len bytes from in to out inside the kernel, at their file
+ *                 positions, the way read and write would. With a pipe at either end the
+ *                 data goes between the ring buffer and the other file directly; otherwise
+ *                 through one kernel buffer.
+ */
+static int
+file_transfer(struct file *out, struct file *in, size_t len, size_t *copied_store) {
+    size_t copied = 0, alen;
+    int ret = 0;
+    if (check_inode_type(in->node, pipe_inode)) {
+        if ((ret = file_append_pos(out)) == 0) {
+            ret = pipe_splice(in->node, out->node, &(out->pos), len, &copied);
+        }
+    }
+    else if (check_inode_type(out->node, pipe_inode)) {
+        off_t pos = in->pos;
+        ret = pipe_splice(out->node, in->node, &(in->pos), len, &copied);
+        file_readahead(in, pos, copied, 0);
+    }
+    else {
+        void *buffer;
+        if ((buffer = kmalloc(SENDFILE_BUFSIZE)) == NULL) {
+            return -E_NO_MEM;
+        }
+        while (len != 0) {
+            if ((alen = SENDFILE_BUFSIZE) > len) {
+                alen = len;
+            }
+            size_t rlen, wlen;
+            ret = file_rw(in, buffer, alen, NULL, 0, &rlen);
+            if (rlen == 0) {
+                break;
+            }
+            int ret2 = file_rw(out, buffer, rlen, NULL, 1, &wlen);
+            copied += wlen, len -= wlen;
+            if (ret == 0) {
+                ret = ret2;
+            }
+            // a short read is the end of in; the bytes read but not written are lost, like write(2)
+            if (ret != 0 || wlen < rlen || rlen < alen) {
+                break;
+            }
+        }
+        kfree(buffer);
+    }
+    *copied_store = copied;
+    return ret;
+}
+
+// sendfile - copy len bytes from in_fd to out_fd without going through user space
+int
+file_sendfile(int out_fd, int in_fd, size_t len, size_t *copied_store) {
+    int ret;
+    struct file *in, *out;
+    *copied_store = 0;
+    if ((ret = fd2file(in_fd, &in)) != 0 || (ret = fd2file(out_fd, &out)) != 0) {
         return ret;
     }
-    if ((ret = fd_array_alloc(fd2, &file2)) != 0) {
+    if (!in->readable || !out->writable) {
+        return -E_INVAL;
+    }
+    fd_array_acquire(in);
+    fd_array_acquire(out);
+    ret = file_transfer(out, in, len, copied_store);
+    fd_array_release(out);
+    fd_array_release(in);
+    return ret;
+}
+
+// splice - like sendfile, but one of in_fd and out_fd must be a pipe
+int
+file_splice(int in_fd, int out_fd, size_t len, size_t *copied_store) {
+    int ret;
+    struct file *in, *out;
+    *copied_store = 0;
+    if ((ret = fd2file(in_fd, &in)) != 0 || (ret = fd2file(out_fd, &out)) != 0) {
         return ret;
     }
-    fd_array_dup(file2, file1);
-    return file2->fd;
+    if (!check_inode_type(in->node, pipe_inode) && !check_inode_type(out->node, pipe_inode)) {
+        return -E_INVAL;
+    }
+    return file_sendfile(out_fd, in_fd, len, copied_store);
 }
 
+// file_rastat - get the readahead counters of fd
+int
+file_rastat(int fd, struct rastat *stat) {
+    int ret;
+    struct file *file;
+    if ((ret = fd2file(fd, &file)) != 0) {
+        return ret;
+    }
+    *stat = file->ra.stat;
+    return 0;
+}
 
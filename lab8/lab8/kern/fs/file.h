@@ -6,40 +6,59 @@
 #include <proc.h>
 #include <atomic.h>
 #include <assert.h>
+#include <stat.h>
 
 struct inode;
 struct stat;
 struct dirent;
 
+/* readahead state of an open file, see file_readahead */
+struct file_ra {
+    off_t next;                                     // where the next read is, if sequential
+    off_t ahead;                                    // readahead was started up to here
+    struct rastat stat;                             // window and counters
+};
+
+/*
+ * an open file: fds of one or more processes refer to it, and open_count counts
+ * those fds plus the operations in progress on it
+ */
 struct file {
     enum {
         FD_NONE, FD_INIT, FD_OPENED, FD_CLOSED,
     } status;
     bool readable;
     bool writable;
-    int fd;
+    bool append;                                    // O_APPEND: every write goes to the end
+    int fd;                                         // the fd taken for it by fd_array_alloc
     off_t pos;
     struct inode *node;
     int open_count;
+    struct file_ra ra;
 };
 
-void fd_array_init(struct file *fd_array);
 void fd_array_open(struct file *file);
-void fd_array_close(struct file *file);
-void fd_array_dup(struct file *to, struct file *from);
+void fd_array_close(struct files_struct *filesp, int fd);
+void fd_array_share(struct files_struct *filesp, int fd, struct file *file);
 bool file_testfd(int fd, bool readable, bool writable);
 
 int file_open(char *path, uint32_t open_flags);
 int file_close(int fd);
 int file_read(int fd, void *base, size_t len, size_t *copied_store);
 int file_write(int fd, void *base, size_t len, size_t *copied_store);
+int file_pread(int fd, void *base, size_t len, off_t pos, size_t *copied_store);
+int file_pwrite(int fd, void *base, size_t len, off_t pos, size_t *copied_store);
 int file_seek(int fd, off_t pos, int whence);
 int file_fstat(int fd, struct stat *stat);
 int file_fsync(int fd);
 int file_getdirentry(int fd, struct dirent *dirent);
+int file_getdents(int fd, void *buf, size_t len, size_t *copied_store);
 int file_dup(int fd1, int fd2);
 int file_pipe(int fd[]);
 int file_mkfifo(const char *name, uint32_t open_flags);
+int file_sendfile(int out_fd, int in_fd, size_t len, size_t *copied_store);
+int file_splice(int in_fd, int out_fd, size_t len, size_t *copied_store);
+int file_rastat(int fd, struct rastat *stat);
 
 static inline int
 fopen_count(struct file *file) {
@@ -48,14 +67,12 @@ fopen_count(struct file *file) {
 
 static inline int
 fopen_count_inc(struct file *file) {
-    file->open_count += 1;
-    return file->open_count;
+    return atomic_add_return(&(file->open_count), 1);
 }
 
 static inline int
 fopen_count_dec(struct file *file) {
-    file->open_count -= 1;
-    return file->open_count;
+    return atomic_sub_return(&(file->open_count), 1);
 }
 
 #endif /* !__KERN_FS_FILE_H__ */
@@ -1,4 +1,5 @@
 #include <defs.h>
+#include <string.h>
 #include <kmalloc.h>
 #include <sem.h>
 #include <vfs.h>
@@ -6,13 +7,24 @@
 #include <file.h>
 #include <sfs.h>
 #include <inode.h>
+#include <pipe.h>
+#include <tmpfs.h>
+#include <error.h>
 #include <assert.h>
 //called when init_main proc start
 void
 fs_init(void) {
     vfs_init();
     dev_init();
+    pipe_init();
     sfs_init();
+    tmpfs_init();
+}
+
+// fs_start_writeback - start the writeback threads of the file systems, called by init_main
+void
+fs_start_writeback(void) {
+    sfs_start_flusher();
 }
 
 void
@@ -33,17 +45,60 @@ unlock_files(struct files_struct *filesp) {
 struct files_struct *
 files_create(void) {
     //cprintf("[files_create]\n");
-    //static_assert((int)FILES_STRUCT_NENTRY > 128);
     struct files_struct *filesp;
-    if ((filesp = kmalloc(sizeof(struct files_struct) + FILES_STRUCT_BUFSIZE)) != NULL) {
+    if ((filesp = kmalloc(sizeof(struct files_struct))) != NULL) {
         filesp->pwd = NULL;
-        filesp->fd_array = (void *)(filesp + 1);
+        filesp->fd_array = NULL, filesp->open_fds = NULL;
+        filesp->max_fds = filesp->next_fd = 0;
         filesp->files_count = 0;
         sem_init(&(filesp->files_sem), 1);
-        fd_array_init(filesp->fd_array);
+        if (files_expand(filesp, FILES_NR_OPEN_MIN) != 0) {
+            kfree(filesp);
+            return NULL;
+        }
     }
     return filesp;
 }
+
+/*
+ * files_expand - grow fd_array and open_fds to hold at least nr fds, doubling the size.
+ *                The open files do not move, only the table of pointers to them.
+ */
+int
+files_expand(struct files_struct *filesp, int nr) {
+    if (nr <= filesp->max_fds) {
+        return 0;
+    }
+    if (nr > FILES_NR_OPEN_MAX) {
+        return -E_MAX_OPEN;
+    }
+    int max_fds = (filesp->max_fds != 0) ? filesp->max_fds : FILES_NR_OPEN_MIN;
+    while (max_fds < nr) {
+        max_fds *= 2;
+    }
+    struct file **fd_array;
+    uint32_t *open_fds;
+    if ((fd_array = kmalloc(max_fds * sizeof(struct file *))) == NULL) {
+        return -E_NO_MEM;
+    }
+    if ((open_fds = kmalloc(max_fds / FILES_FDS_PER_WORD * sizeof(uint32_t))) == NULL) {
+        kfree(fd_array);
+        return -E_NO_MEM;
+    }
+    int old = filesp->max_fds;
+    memset(fd_array + old, 0, (max_fds - old) * sizeof(struct file *));
+    memset(open_fds + old / FILES_FDS_PER_WORD, 0, (max_fds - old) / FILES_FDS_PER_WORD * sizeof(uint32_t));
+    if (old != 0) {
+        memcpy(fd_array, filesp->fd_array, old * sizeof(struct file *));
+        memcpy(open_fds, filesp->open_fds, old / FILES_FDS_PER_WORD * sizeof(uint32_t));
+        kfree(filesp->fd_array);
+        kfree(filesp->open_fds);
+    }
+    filesp->fd_array = fd_array, filesp->open_fds = open_fds;
+    filesp->max_fds = max_fds;
+    return 0;
+}
+
 //Called when a proc exit
 void
 files_destroy(struct files_struct *filesp) {
@@ -52,14 +107,14 @@ files_destroy(struct files_struct *filesp) {
     if (filesp->pwd != NULL) {
         vop_ref_dec(filesp->pwd);
     }
-    int i;
-    struct file *file = filesp->fd_array;
-    for (i = 0; i < FILES_STRUCT_NENTRY; i ++, file ++) {
-        if (file->status == FD_OPENED) {
-            fd_array_close(file);
+    int fd;
+    for (fd = 0; fd < filesp->max_fds; fd ++) {
+        if (filesp->fd_array[fd] != NULL) {
+            fd_array_close(filesp, fd);
         }
-        assert(file->status == FD_NONE);
     }
+    kfree(filesp->fd_array);
+    kfree(filesp->open_fds);
     kfree(filesp);
 }
 
@@ -67,33 +122,40 @@ void
 files_closeall(struct files_struct *filesp) {
 //    cprintf("[files_closeall]\n");
     assert(filesp != NULL && files_count(filesp) > 0);
-    int i;
-    struct file *file = filesp->fd_array;
+    int fd;
     //skip the stdin & stdout
-    for (i = 2, file += 2; i < FILES_STRUCT_NENTRY; i ++, file ++) {
-        if (file->status == FD_OPENED) {
-            fd_array_close(file);
+    for (fd = 2; fd < filesp->max_fds; fd ++) {
+        if (filesp->fd_array[fd] != NULL) {
+            fd_array_close(filesp, fd);
         }
     }
 }
 
+/*
+ * dup_files - give the new process to the fds of from: only the used range of the table
+ *             is copied, and each open file is shared, not duplicated
+ */
 int
 dup_files(struct files_struct *to, struct files_struct *from) {
 //    cprintf("[dup_fs]\n");
     assert(to != NULL && from != NULL);
     assert(files_count(to) == 0 && files_count(from) > 0);
+    int ret, fd, nr = from->max_fds;
+    while (nr > 0 && from->fd_array[nr - 1] == NULL) {
+        nr --;
+    }
+    if ((ret = files_expand(to, nr)) != 0) {
+        return ret;
+    }
     if ((to->pwd = from->pwd) != NULL) {
         vop_ref_inc(to->pwd);
     }
-    int i;
-    struct file *to_file = to->fd_array, *from_file = from->fd_array;
-    for (i = 0; i < FILES_STRUCT_NENTRY; i ++, to_file ++, from_file ++) {
-        if (from_file->status == FD_OPENED) {
-            /* alloc_fd first */
-            to_file->status = FD_INIT;
-            fd_array_dup(to_file, from_file);
+    for (fd = 0; fd < nr; fd ++) {
+        if (from->fd_array[fd] != NULL) {
+            fd_array_share(to, fd, from->fd_array[fd]);
         }
     }
+    to->next_fd = 0;
     return 0;
 }
 
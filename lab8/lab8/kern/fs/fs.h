@@ -14,23 +14,30 @@
 #define DISK1_DEV_NO        3
 
 void fs_init(void);
+void fs_start_writeback(void);
 void fs_cleanup(void);
 
 struct inode;
 struct file;
 
 /*
- * process's file related informaction
+ * process's file related informaction. fd_array maps each fd to its open file, which
+ * several fds (dup) and processes (fork) may share; bit fd of open_fds is set while
+ * fd is taken, so the lowest free fd is found a word at a time.
  */
 struct files_struct {
     struct inode *pwd;      // inode of present working directory
-    struct file *fd_array;  // opened files array
+    struct file **fd_array; // opened files array, indexed by fd, NULL if free
+    uint32_t *open_fds;     // bitmap of the fds taken
+    int max_fds;            // # of entries in fd_array
+    int next_fd;            // no fd below this is free
     int files_count;        // the number of opened files
     semaphore_t files_sem;  // lock protect sem
 };
 
-#define FILES_STRUCT_BUFSIZE                       (PGSIZE - sizeof(struct files_struct))
-#define FILES_STRUCT_NENTRY                        (FILES_STRUCT_BUFSIZE / sizeof(struct file))
+#define FILES_FDS_PER_WORD                         32
+#define FILES_NR_OPEN_MIN                          64          // initial size of fd_array
+#define FILES_NR_OPEN_MAX                          4096        // fd_array never grows past this
 
 void lock_files(struct files_struct *filesp);
 void unlock_files(struct files_struct *filesp);
@@ -39,6 +46,7 @@ struct files_struct *files_create(void);
 void files_destroy(struct files_struct *filesp);
 void files_closeall(struct files_struct *filesp);
 int dup_files(struct files_struct *to, struct files_struct *from);
+int files_expand(struct files_struct *filesp, int nr);
 
 static inline int
 files_count(struct files_struct *filesp) {
@@ -47,14 +55,12 @@ files_count(struct files_struct *filesp) {
 
 static inline int
 files_count_inc(struct files_struct *filesp) {
-    filesp->files_count += 1;
-    return filesp->files_count;
+    return atomic_add_return(&(filesp->files_count), 1);
 }
 
 static inline int
 files_count_dec(struct files_struct *filesp) {
-    filesp->files_count -= 1;
-    return filesp->files_count;
+    return atomic_sub_return(&(filesp->files_count), 1);
 }
 
 #endif /* !__KERN_FS_FS_H__ */
@@ -14,7 +14,37 @@ struct iobuf *
 iobuf_init(struct iobuf *iob, void *base, size_t len, off_t offset) {
     iob->io_base = base;
     iob->io_offset = offset;
-    iob->io_len = iob->io_resid = len;
+    iob->io_len = iob->io_resid = iob->io_seg = len;
+    iob->io_iov = NULL, iob->io_iovcnt = 0;
+    iob->io_cached = 0;
+    return iob;
+}
+
+/* iobuf_next_seg - step to the next non-empty segment once the current one is used up */
+static void
+iobuf_next_seg(struct iobuf *iob) {
+    while (iob->io_seg == 0 && iob->io_iovcnt > 0) {
+        iob->io_base = iob->io_iov->iov_base;
+        iob->io_seg = iob->io_iov->iov_len;
+        iob->io_iov ++, iob->io_iovcnt --;
+    }
+}
+
+/*
+ * iobuf_init_iov - init io buffer struct over iovcnt segments, transferred in order as one
+ *                  buffer of their total length. the caller checks the segments and keeps
+ *                  the iovec array alive while the iobuf is in use.
+ */
+struct iobuf *
+iobuf_init_iov(struct iobuf *iob, const struct iovec *iov, int iovcnt, off_t offset) {
+    size_t len = 0;
+    int i;
+    for (i = 0; i < iovcnt; i ++) {
+        len += iov[i].iov_len;
+    }
+    iobuf_init(iob, NULL, len, offset);
+    iob->io_seg = 0, iob->io_iov = iov, iob->io_iovcnt = iovcnt;
+    iobuf_next_seg(iob);
     return iob;
 }
 
@@ -27,11 +57,11 @@ iobuf_init(struct iobuf *iob, void *base, size_t len, off_t offset) {
  */
 int
 iobuf_move(struct iobuf *iob, void *data, size_t len, bool m2b, size_t *copiedp) {
-    size_t alen;
-    if ((alen = iob->io_resid) > len) {
-        alen = len;
-    }
-    if (alen > 0) {
+    size_t alen, copied = 0;
+    while (len > 0 && iob->io_resid > 0) {
+        if ((alen = iob->io_seg) > len) {
+            alen = len;
+        }
         void *src = iob->io_base, *dst = data;
         if (m2b) {
             void *tmp = src;
@@ -39,9 +69,10 @@ iobuf_move(struct iobuf *iob, void *data, size_t len, bool m2b, size_t *copiedp)
         }
         memmove(dst, src, alen);
         iobuf_skip(iob, alen), len -= alen;
+        data += alen, copied += alen;
     }
     if (copiedp != NULL) {
-        *copiedp = alen;
+        *copiedp = copied;
     }
     return (len == 0) ? 0 : -E_NO_MEM;
 }
@@ -52,16 +83,17 @@ iobuf_move(struct iobuf *iob, void *data, size_t len, bool m2b, size_t *copiedp)
  */
 int
 iobuf_move_zeros(struct iobuf *iob, size_t len, size_t *copiedp) {
-    size_t alen;
-    if ((alen = iob->io_resid) > len) {
-        alen = len;
-    }
-    if (alen > 0) {
+    size_t alen, copied = 0;
+    while (len > 0 && iob->io_resid > 0) {
+        if ((alen = iob->io_seg) > len) {
+            alen = len;
+        }
         memset(iob->io_base, 0, alen);
         iobuf_skip(iob, alen), len -= alen;
+        copied += alen;
     }
     if (copiedp != NULL) {
-        *copiedp = alen;
+        *copiedp = copied;
     }
     return (len == 0) ? 0 : -E_NO_MEM;
 }
@@ -72,6 +104,12 @@ iobuf_move_zeros(struct iobuf *iob, size_t len, size_t *copiedp) {
 void
 iobuf_skip(struct iobuf *iob, size_t n) {
     assert(iob->io_resid >= n);
-    iob->io_base += n, iob->io_offset += n, iob->io_resid -= n;
+    while (n > 0) {
+        size_t alen = (iob->io_seg < n) ? iob->io_seg : n;
+        assert(alen > 0);
+        iob->io_base += alen, iob->io_offset += alen, iob->io_resid -= alen;
+        iob->io_seg -= alen, n -= alen;
+        iobuf_next_seg(iob);
+    }
 }
 
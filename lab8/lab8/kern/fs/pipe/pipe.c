@@ -0,0 +1,533 @@
+#include <defs.h>
+#include <string.h>
+#include <list.h>
+#include <kmalloc.h>
+#include <pmm.h>
+#include <sem.h>
+#include <wait.h>
+#include <sync.h>
+#include <proc.h>
+#include <sched.h>
+#include <vfs.h>
+#include <inode.h>
+#include <iobuf.h>
+#include <stat.h>
+#include <unistd.h>
+#include <pipe.h>
+#include <error.h>
+#include <assert.h>
+
+/*
+ * Pipes and fifos. Both ends of a pipe are inodes of their own sharing one
+ * pipe_state: a page-sized ring buffer plus a wait queue for readers (data to
+ * arrive) and one for writers (room to appear). A reader sees EOF once every
+ * write end is closed, and a writer gets E_PIPE once every read end is closed.
+ *
+ * A fifo is a pipe_state with a name, kept on fifo_list while any end of it
+ * exists. Opening one end of a fifo waits until the other end is opened.
+ *
+ * The positions are only touched with interrupts disabled, like the stdin
+ * buffer. rsem/wsem serialize the readers and the writers, so pipe_splice can
+ * let a file read into or write from the ring buffer itself, with interrupts
+ * enabled, while the other side keeps going.
+ */
+
+struct pipe_state {
+    char *buf;                                  // PIPE_BUFSIZE bytes ring buffer
+    off_t p_rpos, p_wpos;                       // bytes read/written so far, p_wpos - p_rpos are buffered
+    int readers, writers;                       // # of opened read/write ends
+    int ref;                                    // # of end inodes
+    wait_queue_t rwait;                         // readers waiting for data
+    wait_queue_t wwait;                         // writers waiting for room
+    wait_queue_t owait;                         // fifo ends waiting for the other end to open
+    semaphore_t rsem;                           // held by the reader consuming the buffer
+    semaphore_t wsem;                           // held by the writer filling the buffer
+    char *name;                                 // name of a fifo, NULL for a pipe
+    list_entry_t fifo_link;                     // entry in fifo_list
+};
+
+#define le2pipe(le, member)                         \
+    to_struct((le), struct pipe_state, member)
+
+static list_entry_t fifo_list;
+static semaphore_t fifo_sem;
+
+static const struct inode_ops pipe_node_ops;
+
+// pipe_init - called by fs_init
+void
+pipe_init(void) {
+    list_init(&fifo_list);
+    sem_init(&fifo_sem, 1);
+}
+
+static struct pipe_state *
+pipe_state_create(const char *name) {
+    struct pipe_state *state;
+    struct Page *page;
+    if ((state = kmalloc(sizeof(struct pipe_state))) == NULL) {
+        return NULL;
+    }
+    if ((page = alloc_page()) == NULL) {
+        goto failed_cleanup_state;
+    }
+    state->name = NULL;
+    if (name != NULL) {
+        size_t len = strlen(name);
+        if ((state->name = kmalloc(len + 1)) == NULL) {
+            goto failed_cleanup_page;
+        }
+        memcpy(state->name, name, len + 1);
+    }
+    state->buf = page2kva(page);
+    state->p_rpos = state->p_wpos = 0;
+    state->readers = state->writers = state->ref = 0;
+    wait_queue_init(&(state->rwait));
+    wait_queue_init(&(state->wwait));
+    wait_queue_init(&(state->owait));
+    sem_init(&(state->rsem), 1);
+    sem_init(&(state->wsem), 1);
+    list_init(&(state->fifo_link));
+    return state;
+
+failed_cleanup_page:
+    free_page(page);
+failed_cleanup_state:
+    kfree(state);
+    return NULL;
+}
+
+static void
+pipe_state_destroy(struct pipe_state *state) {
+    assert(state->ref == 0 && state->readers == 0 && state->writers == 0);
+    free_page(kva2page(state->buf));
+    if (state->name != NULL) {
+        kfree(state->name);
+    }
+    kfree(state);
+}
+
+/*
+ * pipe_create_inode - create an opened end of state. The caller holds fifo_sem for a fifo,
+ *                     so the end can't race with the last close of the other one.
+ */
+static int
+pipe_create_inode(struct pipe_state *state, bool reader, struct inode **node_store) {
+    struct inode *node;
+    if ((node = alloc_inode(pipe_inode)) == NULL) {
+        return -E_NO_MEM;
+    }
+    vop_init(node, &pipe_node_ops, NULL);
+    struct pipe_inode *pin = vop_info(node, pipe_inode);
+    pin->state = state, pin->reader = reader;
+
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        state->ref ++;
+        if (reader) {
+            state->readers ++;
+        }
+        else {
+            state->writers ++;
+        }
+        if (!wait_queue_empty(&(state->owait))) {
+            wakeup_queue(&(state->owait), WT_PIPE, 1);
+        }
+    }
+    local_intr_restore(intr_flag);
+    vop_open_inc(node);
+    *node_store = node;
+    return 0;
+}
+
+/*
+ * pipe_wait - sleep on queue until woken up by the other end. Called and returns with
+ *             interrupts disabled. Returns -E_KILLED if the wait was interrupted.
+ */
+static int
+pipe_wait(wait_queue_t *queue, bool *intr_flag) {
+    wait_t __wait, *wait = &__wait;
+    wait_current_set(queue, wait, WT_PIPE);
+    local_intr_restore(*intr_flag);
+
+    schedule();
+
+    local_intr_save(*intr_flag);
+    wait_current_del(queue, wait);
+    if (wait->wakeup_flags != WT_PIPE) {
+        return -E_KILLED;
+    }
+    return 0;
+}
+
+/*
+ * pipe_open - create an anonymous pipe, both ends are returned opened
+ */
+int
+pipe_open(struct inode **read_store, struct inode **write_store) {
+    struct pipe_state *state;
+    struct inode *rnode, *wnode;
+    int ret;
+    if ((state = pipe_state_create(NULL)) == NULL) {
+        return -E_NO_MEM;
+    }
+    if ((ret = pipe_create_inode(state, 1, &rnode)) != 0) {
+        pipe_state_destroy(state);
+        return ret;
+    }
+    if ((ret = pipe_create_inode(state, 0, &wnode)) != 0) {
+        vfs_close(rnode);
+        return ret;
+    }
+    *read_store = rnode, *write_store = wnode;
+    return 0;
+}
+
+/*
+ * pipe_fifo_open - open one end of the fifo called name, creating the fifo if needed.
+ *                  Waits until the other end is opened too.
+ */
+int
+pipe_fifo_open(const char *name, bool reader, struct inode **node_store) {
+    if (*name == '\0' || strlen(name) > FS_MAX_FNAME_LEN) {
+        return -E_INVAL;
+    }
+    struct pipe_state *state = NULL;
+    struct inode *node;
+    int ret;
+    down(&fifo_sem);
+    {
+        list_entry_t *le = &fifo_list;
+        while ((le = list_next(le)) != &fifo_list) {
+            if (strcmp(le2pipe(le, fifo_link)->name, name) == 0) {
+                state = le2pipe(le, fifo_link);
+                break;
+            }
+        }
+        if (state == NULL) {
+            if ((state = pipe_state_create(name)) == NULL) {
+                up(&fifo_sem);
+                return -E_NO_MEM;
+            }
+            list_add(&fifo_list, &(state->fifo_link));
+        }
+        if ((ret = pipe_create_inode(state, reader, &node)) != 0) {
+            if (state->ref == 0) {
+                list_del(&(state->fifo_link));
+                pipe_state_destroy(state);
+            }
+            up(&fifo_sem);
+            return ret;
+        }
+    }
+    up(&fifo_sem);
+
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    while ((reader ? state->writers : state->readers) == 0) {
+        if ((ret = pipe_wait(&(state->owait), &intr_flag)) != 0) {
+            break;
+        }
+    }
+    local_intr_restore(intr_flag);
+    if (ret != 0) {
+        vfs_close(node);
+        return ret;
+    }
+    *node_store = node;
+    return 0;
+}
+
+static int
+pipe_open_op(struct inode *node, uint32_t open_flags) {
+    return 0;
+}
+
+// pipe_close - last close of one end: wake up the other end so it sees EOF or E_PIPE
+static int
+pipe_close(struct inode *node) {
+    struct pipe_inode *pin = vop_info(node, pipe_inode);
+    struct pipe_state *state = pin->state;
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        if (pin->reader) {
+            state->readers --;
+        }
+        else {
+            state->writers --;
+        }
+        wakeup_queue(&(state->rwait), WT_PIPE, 1);
+        wakeup_queue(&(state->wwait), WT_PIPE, 1);
+    }
+    local_intr_restore(intr_flag);
+    return 0;
+}
+
+/*
+ * pipe_read - read what is buffered, at most iob->io_resid bytes. Waits while the pipe is
+ *             empty and some write end is open; returns with nothing read at EOF.
+ */
+static int
+pipe_read(struct inode *node, struct iobuf *iob) {
+    struct pipe_inode *pin = vop_info(node, pipe_inode);
+    struct pipe_state *state = pin->state;
+    if (!pin->reader) {
+        return -E_INVAL;
+    }
+    int ret = 0;
+    bool intr_flag;
+    down(&(state->rsem));
+    local_intr_save(intr_flag);
+    {
+        while (state->p_rpos == state->p_wpos && state->writers != 0) {
+            if ((ret = pipe_wait(&(state->rwait), &intr_flag)) != 0) {
+                goto out;
+            }
+        }
+        size_t n = state->p_wpos - state->p_rpos, off, len;
+        if (n > iob->io_resid) {
+            n = iob->io_resid;
+        }
+        while (n != 0) {
+            off = state->p_rpos % PIPE_BUFSIZE;
+            len = (n < PIPE_BUFSIZE - off) ? n : PIPE_BUFSIZE - off;
+            iobuf_move(iob, state->buf + off, len, 1, NULL);
+            state->p_rpos += len, n -= len;
+        }
+        if (!wait_queue_empty(&(state->wwait))) {
+            wakeup_queue(&(state->wwait), WT_PIPE, 1);
+        }
+    }
+out:
+    local_intr_restore(intr_flag);
+    up(&(state->rsem));
+    return ret;
+}
+
+/*
+ * pipe_write - write all of iob, waiting for room as needed. A write of at most PIPE_BUF
+ *              bytes waits until it fits as a whole, so it isn't interleaved with others.
+ */
+static int
+pipe_write(struct inode *node, struct iobuf *iob) {
+    struct pipe_inode *pin = vop_info(node, pipe_inode);
+    struct pipe_state *state = pin->state;
+    if (pin->reader) {
+        return -E_INVAL;
+    }
+    size_t need = (iob->io_resid <= PIPE_BUF) ? iob->io_resid : 1;
+    int ret = 0;
+    bool intr_flag;
+    down(&(state->wsem));
+    local_intr_save(intr_flag);
+    while (iob->io_resid != 0) {
+        if (state->readers == 0) {
+            ret = -E_PIPE;
+            break;
+        }
+        size_t room = PIPE_BUFSIZE - (state->p_wpos - state->p_rpos), off, len;
+        if (room < need) {
+            if ((ret = pipe_wait(&(state->wwait), &intr_flag)) != 0) {
+                break;
+            }
+            continue;
+        }
+        if (room > iob->io_resid) {
+            room = iob->io_resid;
+        }
+        while (room != 0) {
+            off = state->p_wpos % PIPE_BUFSIZE;
+            len = (room < PIPE_BUFSIZE - off) ? room : PIPE_BUFSIZE - off;
+            iobuf_move(iob, state->buf + off, len, 0, NULL);
+            state->p_wpos += len, room -= len;
+        }
+        if (!wait_queue_empty(&(state->rwait))) {
+            wakeup_queue(&(state->rwait), WT_PIPE, 1);
+        }
+    }
+    local_intr_restore(intr_flag);
+    up(&(state->wsem));
+    return ret;
+}
+
+/*
+ * pipe_splice_out - move up to len bytes from the read end pipe into node at *posp, writing
+ *                   straight from the ring buffer. Waits like pipe_read until there is data.
+ */
+static int
+pipe_splice_out(struct pipe_state *state, struct inode *node, off_t *posp, size_t len, size_t *copied_store) {
+    size_t copied = 0;
+    int ret = 0;
+    bool intr_flag;
+    down(&(state->rsem));
+    local_intr_save(intr_flag);
+    while (len != 0) {
+        if (state->p_rpos == state->p_wpos) {
+            if (copied != 0 || state->writers == 0) {
+                break;
+            }
+            if ((ret = pipe_wait(&(state->rwait), &intr_flag)) != 0) {
+                break;
+            }
+            continue;
+        }
+        // the buffered bytes are stable while we hold rsem: writers only fill the free part
+        size_t off = state->p_rpos % PIPE_BUFSIZE, n = state->p_wpos - state->p_rpos;
+        if (n > PIPE_BUFSIZE - off) {
+            n = PIPE_BUFSIZE - off;
+        }
+        if (n > len) {
+            n = len;
+        }
+        local_intr_restore(intr_flag);
+        struct iobuf __iob, *iob = iobuf_init(&__iob, state->buf + off, n, *posp);
+        ret = vop_write(node, iob);
+        n = iobuf_used(iob);
+        local_intr_save(intr_flag);
+
+        state->p_rpos += n, *posp += n, copied += n, len -= n;
+        if (n != 0 && !wait_queue_empty(&(state->wwait))) {
+            wakeup_queue(&(state->wwait), WT_PIPE, 1);
+        }
+        if (ret != 0 || n == 0) {
+            break;
+        }
+    }
+    local_intr_restore(intr_flag);
+    up(&(state->rsem));
+    *copied_store = copied;
+    return ret;
+}
+
+/*
+ * pipe_splice_in - move up to len bytes from node at *posp into the write end pipe, reading
+ *                  straight into the ring buffer. Stops at the end of node.
+ */
+static int
+pipe_splice_in(struct pipe_state *state, struct inode *node, off_t *posp, size_t len, size_t *copied_store) {
+    size_t copied = 0;
+    int ret = 0;
+    bool intr_flag;
+    down(&(state->wsem));
+    local_intr_save(intr_flag);
+    while (len != 0) {
+        if (state->readers == 0) {
+            ret = -E_PIPE;
+            break;
+        }
+        if (state->p_wpos - state->p_rpos == PIPE_BUFSIZE) {
+            if ((ret = pipe_wait(&(state->wwait), &intr_flag)) != 0) {
+                break;
+            }
+            continue;
+        }
+        // the free part is ours while we hold wsem: readers only consume the buffered part
+        size_t off = state->p_wpos % PIPE_BUFSIZE, n = PIPE_BUFSIZE - (state->p_wpos - state->p_rpos);
+        if (n > PIPE_BUFSIZE - off) {
+            n = PIPE_BUFSIZE - off;
+        }
+        if (n > len) {
+            n = len;
+        }
+        local_intr_restore(intr_flag);
+        struct iobuf __iob, *iob = iobuf_init(&__iob, state->buf + off, n, *posp);
+        ret = vop_read(node, iob);
+        size_t got = iobuf_used(iob);
+        local_intr_save(intr_flag);
+
+        state->p_wpos += got, *posp += got, copied += got, len -= got;
+        if (got != 0 && !wait_queue_empty(&(state->rwait))) {
+            wakeup_queue(&(state->rwait), WT_PIPE, 1);
+        }
+        if (ret != 0 || got < n) {
+            break;
+        }
+    }
+    local_intr_restore(intr_flag);
+    up(&(state->wsem));
+    *copied_store = copied;
+    return ret;
+}
+
+/*
+ * pipe_splice - move up to len bytes between the pipe end pipe and node (at offset *posp of
+ *               node, which is advanced) without a bounce buffer: out of the pipe if pipe
+ *               is a read end, into the pipe if it is a write end.
+ */
+int
+pipe_splice(struct inode *pipe, struct inode *node, off_t *posp, size_t len, size_t *copied_store) {
+    struct pipe_inode *pin = vop_info(pipe, pipe_inode);
+    if (pin->reader) {
+        return pipe_splice_out(pin->state, node, posp, len, copied_store);
+    }
+    return pipe_splice_in(pin->state, node, posp, len, copied_store);
+}
+
+static int
+pipe_fstat(struct inode *node, struct stat *stat) {
+    struct pipe_state *state = vop_info(node, pipe_inode)->state;
+    memset(stat, 0, sizeof(struct stat));
+    stat->st_mode = S_IFIFO;
+    stat->st_nlinks = 1;
+    stat->st_size = state->p_wpos - state->p_rpos;
+    return 0;
+}
+
+static int
+pipe_ioctl(struct inode *node, int op, void *data) {
+    return -E_INVAL;
+}
+
+static int
+pipe_gettype(struct inode *node, uint32_t *type_store) {
+    *type_store = S_IFIFO;
+    return 0;
+}
+
+static int
+pipe_tryseek(struct inode *node, off_t pos) {
+    return -E_SEEK;
+}
+
+// pipe_reclaim - free the end, and the pipe with its last end
+static int
+pipe_reclaim(struct inode *node) {
+    struct pipe_state *state = vop_info(node, pipe_inode)->state;
+    bool is_fifo = (state->name != NULL), last;
+    if (is_fifo) {
+        down(&fifo_sem);
+    }
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        last = (-- state->ref == 0);
+    }
+    local_intr_restore(intr_flag);
+    if (last && is_fifo) {
+        list_del(&(state->fifo_link));
+    }
+    if (is_fifo) {
+        up(&fifo_sem);
+    }
+    if (last) {
+        pipe_state_destroy(state);
+    }
+    vop_kill(node);
+    return 0;
+}
+
+static const struct inode_ops pipe_node_ops = {
+    .vop_magic                      = VOP_MAGIC,
+    .vop_open                       = pipe_open_op,
+    .vop_close                      = pipe_close,
+    .vop_read                       = pipe_read,
+    .vop_write                      = pipe_write,
+    .vop_fstat                      = pipe_fstat,
+    .vop_ioctl                      = pipe_ioctl,
+    .vop_reclaim                    = pipe_reclaim,
+    .vop_gettype                    = pipe_gettype,
+    .vop_tryseek                    = pipe_tryseek,
+};
+
@@ -0,0 +1,26 @@
+#ifndef __KERN_FS_PIPE_PIPE_H__
+#define __KERN_FS_PIPE_PIPE_H__
+
+#include <defs.h>
+#include <mmu.h>
+
+/* a pipe buffers one page; a write of at most PIPE_BUF bytes is never interleaved with other writes */
+#define PIPE_BUFSIZE                                PGSIZE
+#define PIPE_BUF                                    PIPE_BUFSIZE
+
+struct inode;
+struct pipe_state;
+
+/* inode for one end of a pipe or fifo (in memory, no fs) */
+struct pipe_inode {
+    struct pipe_state *state;                       /* ring buffer shared by both ends */
+    bool reader;                                    /* read end or write end */
+};
+
+void pipe_init(void);
+int pipe_open(struct inode **read_store, struct inode **write_store);
+int pipe_fifo_open(const char *name, bool reader, struct inode **node_store);
+int pipe_splice(struct inode *pipe, struct inode *node, off_t *posp, size_t len, size_t *copied_store);
+
+#endif /* !__KERN_FS_PIPE_PIPE_H__ */
+
@@ -5,6 +5,7 @@
 #include <mmu.h>
 #include <list.h>
 #include <sem.h>
+#include <rwlock.h>
 #include <unistd.h>
 
 /*
@@ -12,7 +13,7 @@
  * and is used by tools that work on SFS volumes, such as mksfs.
  */
 
-#define SFS_MAGIC                                   0x2f8dbe2a              /* magic number for sfs */
+#define SFS_MAGIC                                   0x2f8dbe2b              /* magic number for sfs (packed dirs) */
 #define SFS_BLKSIZE                                 PGSIZE                  /* size of block */
 #define SFS_NDIRECT                                 12                      /* # of direct blocks in inode */
 #define SFS_MAX_INFO_LEN                            31                      /* max length of infomation */
@@ -42,6 +43,8 @@ struct sfs_super {
     uint32_t blocks;                                /* # of blocks in fs */
     uint32_t unused_blocks;                         /* # of unused blocks in fs */
     char info[SFS_MAX_INFO_LEN + 1];                /* infomation for sfs  */
+    uint32_t journal_start;                         /* first block of the journal, 0 if none */
+    uint32_t journal_blocks;                        /* # of blocks in the journal */
 };
 
 /* inode (on disk) */
@@ -49,14 +52,91 @@ struct sfs_disk_inode {
     uint32_t size;                                  /* size of the file (in bytes) */
     uint16_t type;                                  /* one of SYS_TYPE_* above */
     uint16_t nlinks;                                /* # of hard links to this file */
-    uint32_t blocks;                                /* # of blocks */
+    uint32_t blocks;                                /* # of logical blocks, holes included */
     uint32_t direct[SFS_NDIRECT];                   /* direct blocks */
     uint32_t indirect;                              /* indirect blocks */
 //    uint32_t db_indirect;                           /* double indirect blocks */
 //   unused
 };
 
-/* file entry (on disk) */
+/*
+ * Directory blocks (on disk). Every block of a directory starts with a
+ * sfs_dirblk_head. Leaf blocks pack variable-length sfs_dirent_rec records
+ * back to back; a record with rec_len == 0 ends the block. A directory whose
+ * entries do not fit in one leaf is indexed: logical block 0 is an index
+ * block holding sfs_dirindex entries sorted by hash, and every other block
+ * is a leaf holding the names whose hash lies in [index[i].hash, index[i+1].hash).
+ */
+#define SFS_DIRBLK_LEAF                             0x6c656166              /* 'leaf' */
+#define SFS_DIRBLK_INDEX                            0x696e6478              /* 'indx' */
+
+struct sfs_dirblk_head {
+    uint32_t magic;                                 /* SFS_DIRBLK_LEAF or SFS_DIRBLK_INDEX */
+    uint32_t count;                                 /* # of records (leaf) or index entries (index) */
+};
+
+struct sfs_dirent_rec {
+    uint32_t ino;                                   /* inode number, 0 if the record is unused */
+    uint16_t rec_len;                               /* bytes from this record to the next one */
+    uint16_t name_len;                              /* length of name, not '\0' terminated */
+    char name[0];                                   /* file name */
+};
+
+struct sfs_dirindex {
+    uint32_t hash;                                  /* lowest name hash stored in the leaf */
+    uint32_t block;                                 /* logical block # of the leaf */
+};
+
+/* size of a record holding a name of namelen bytes */
+#define SFS_DIRREC_LEN(namelen)                     \
+    ((sizeof(struct sfs_dirent_rec) + (namelen) + 3) & ~3)
+
+/* # of index entries in an index block */
+#define SFS_DIRINDEX_NENTRY                         \
+    ((SFS_BLKSIZE - sizeof(struct sfs_dirblk_head)) / sizeof(struct sfs_dirindex))
+
+/*
+ * sfs_name_hash - FNV-1a hash of a file name, used to place names in leaves.
+ * tools/mksfs.c carries a copy and both must stay identical.
+ */
+static inline uint32_t
+sfs_name_hash(const char *name, size_t len) {
+    uint32_t hash = 2166136261U;
+    while (len -- > 0) {
+        hash ^= (uint8_t)(*name ++);
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+/*
+ * Metadata journal (on disk). journal_start holds a descriptor naming the home
+ * block of each image that follows it; a commit record after the images makes
+ * the transaction valid. A descriptor with nblocks == 0 means the journal is
+ * clean. Only the last transaction can be in the journal, since each commit
+ * is checkpointed before the next one starts.
+ */
+#define SFS_JDESC_MAGIC                             0x6a726e6c              /* 'jrnl' */
+#define SFS_JCOMMIT_MAGIC                           0x636d6974              /* 'cmit' */
+
+struct sfs_journal_desc {
+    uint32_t magic;                                 /* SFS_JDESC_MAGIC */
+    uint32_t tid;                                   /* transaction id */
+    uint32_t nblocks;                               /* # of block images following, 0 if clean */
+    uint32_t blkno[0];                              /* home block of each image */
+};
+
+struct sfs_journal_commit {
+    uint32_t magic;                                 /* SFS_JCOMMIT_MAGIC */
+    uint32_t tid;                                   /* same as the descriptor */
+    uint32_t checksum;                              /* checksum of the images */
+};
+
+/* # of images a descriptor can name */
+#define SFS_JDESC_NBLKS                             \
+    ((SFS_BLKSIZE - sizeof(struct sfs_journal_desc)) / sizeof(uint32_t))
+
+/* file entry (in memory), filled from a sfs_dirent_rec */
 struct sfs_disk_entry {
     uint32_t ino;                                   /* inode number */
     char name[SFS_MAX_FNAME_LEN + 1];               /* file name */
@@ -71,9 +151,14 @@ struct sfs_inode {
     uint32_t ino;                                   /* inode number */
     bool dirty;                                     /* true if inode modified */
     int reclaim_count;                              /* kill inode if it hits zero */
-    semaphore_t sem;                                /* semaphore for din */
+    rwlock_t rwlock;                                /* shared for reads of din and data, exclusive for changes */
     list_entry_t inode_link;                        /* entry for linked-list in sfs_fs */
     list_entry_t hash_link;                         /* entry for hash linked-list in sfs_fs */
+    list_entry_t inactive_link;                     /* entry for inactive LRU in sfs_fs, if unreferenced */
+    list_entry_t dirty_link;                        /* entry for dirty inode list in sfs_fs, if dirty */
+    size_t dirty_time;                              /* ticks when the inode became dirty */
+    uint32_t log_tid;                               /* last transaction the inode was logged in */
+    int nalloc;                                     /* disk blocks allocated, indirect included; -1 until counted */
 };
 
 #define le2sin(le, member)                          \
@@ -85,19 +170,54 @@ struct sfs_fs {
     struct device *dev;                             /* device mounted on */
     struct bitmap *freemap;                         /* blocks in use are mared 0 */
     bool super_dirty;                               /* true if super/freemap modified */
+    size_t super_dirty_time;                        /* ticks when super_dirty was set */
+    uint8_t *freemap_dirty;                         /* one flag per freemap block, set if modified */
     void *sfs_buffer;                               /* buffer for non-block aligned io */
-    semaphore_t fs_sem;                             /* semaphore for fs */
-    semaphore_t io_sem;                             /* semaphore for io */
+    semaphore_t fs_sem;                             /* semaphore for inode load/reclaim and inode_list */
+    semaphore_t io_sem;                             /* semaphore for sfs_buffer */
+    semaphore_t freemap_sem;                        /* semaphore for freemap, freemap_dirty and unused_blocks */
     semaphore_t mutex_sem;                          /* semaphore for link/unlink and rename */
     list_entry_t inode_list;                        /* inode linked-list */
     list_entry_t *hash_list;                        /* inode hash linked-list */
+    list_entry_t inactive_list;                     /* unreferenced inodes, least recently used first */
+    int inactive_count;                             /* # of inodes in inactive_list */
+    list_entry_t dirty_list;                        /* dirty inodes, oldest first */
+    int dirty_count;                                /* # of inodes in dirty_list */
+    list_entry_t mount_link;                        /* entry in the list of mounted sfs, for the flusher */
+    struct sfs_journal *journal;                    /* metadata journal, NULL if the volume has none */
+    struct sfs_racache *racache;                    /* file data read ahead for sequential readers */
 };
 
+/*
+ * # of journal blocks one operation may touch: its inode, its indirect block,
+ * the superblock and every freemap block
+ */
+#define SFS_TRANS_CREDITS(sfs)                      (3 + sfs_freemap_blocks(&((sfs)->super)))
+
 /* hash for sfs */
 #define SFS_HLIST_SHIFT                             10
 #define SFS_HLIST_SIZE                              (1 << SFS_HLIST_SHIFT)
 #define sin_hashfn(x)                               (hash32(x, SFS_HLIST_SHIFT))
 
+/* inactive inode LRU: at most SFS_INACTIVE_MAX inodes, none kept below SFS_INACTIVE_LOWMEM free pages */
+#define SFS_INACTIVE_MAX                            64
+#define SFS_INACTIVE_LOWMEM                         32
+
+/*
+ * writeback: the flusher wakes every SFS_FLUSH_INTERVAL ticks and writes back what has
+ * been dirty for SFS_DIRTY_EXPIRE ticks, or every dirty inode once SFS_DIRTY_HIWAT are dirty
+ */
+#define SFS_FLUSH_INTERVAL                          50
+#define SFS_DIRTY_EXPIRE                            300
+#define SFS_DIRTY_HIWAT                             32
+
+/*
+ * readahead: sequential readers ask for the blocks past the ones they read; the flusher
+ * reads them into a cache of SFS_RA_NBLKS blocks, queued at most SFS_RA_NREQS requests deep
+ */
+#define SFS_RA_NBLKS                                32
+#define SFS_RA_NREQS                                8
+
 /* size of freemap (in bits) */
 #define sfs_freemap_bits(super)                     ROUNDUP((super)->blocks, SFS_BLKBITS)
 
@@ -106,14 +226,21 @@ struct sfs_fs {
 
 struct fs;
 struct inode;
+struct device;
+struct sfs_journal;
+struct sfs_racache;
 
 void sfs_init(void);
 int sfs_mount(const char *devname);
+void sfs_start_flusher(void);
+void sfs_kick_flusher(void);
 
 void lock_sfs_fs(struct sfs_fs *sfs);
 void lock_sfs_io(struct sfs_fs *sfs);
 void unlock_sfs_fs(struct sfs_fs *sfs);
 void unlock_sfs_io(struct sfs_fs *sfs);
+void lock_sfs_freemap(struct sfs_fs *sfs);
+void unlock_sfs_freemap(struct sfs_fs *sfs);
 
 int sfs_rblock(struct sfs_fs *sfs, void *buf, uint32_t blkno, uint32_t nblks);
 int sfs_wblock(struct sfs_fs *sfs, void *buf, uint32_t blkno, uint32_t nblks);
@@ -121,9 +248,34 @@ int sfs_rbuf(struct sfs_fs *sfs, void *buf, size_t len, uint32_t blkno, off_t of
 int sfs_wbuf(struct sfs_fs *sfs, void *buf, size_t len, uint32_t blkno, off_t offset);
 int sfs_sync_super(struct sfs_fs *sfs);
 int sfs_sync_freemap(struct sfs_fs *sfs);
+int sfs_sync_super_freemap(struct sfs_fs *sfs);
 int sfs_clear_block(struct sfs_fs *sfs, uint32_t blkno, uint32_t nblks);
+int sfs_clear_buf(struct sfs_fs *sfs, size_t len, uint32_t blkno, off_t offset);
 
 int sfs_load_inode(struct sfs_fs *sfs, struct inode **node_store, uint32_t ino);
+void sfs_evict_inactive(struct sfs_fs *sfs);
+int sfs_sync_inode(struct sfs_fs *sfs, struct sfs_inode *sin);
+int sfs_readahead_load(struct sfs_fs *sfs, struct inode *node, uint32_t index, uint32_t nblks);
+
+int sfs_journal_replay(struct device *dev, struct sfs_super *super, uint32_t *tid_store);
+int sfs_journal_init(struct sfs_fs *sfs, uint32_t tid);
+void sfs_journal_destroy(struct sfs_fs *sfs);
+int sfs_journal_start(struct sfs_fs *sfs, int credits);
+uint32_t sfs_journal_stop(struct sfs_fs *sfs);
+int sfs_journal_commit(struct sfs_fs *sfs, uint32_t tid);
+int sfs_journal_flush(struct sfs_fs *sfs);
+void sfs_journal_revoke(struct sfs_fs *sfs, uint32_t blkno);
+int sfs_meta_rbuf(struct sfs_fs *sfs, void *buf, size_t len, uint32_t blkno, off_t offset);
+int sfs_meta_wbuf(struct sfs_fs *sfs, void *buf, size_t len, uint32_t blkno, off_t offset);
+
+int sfs_ra_init(struct sfs_fs *sfs);
+void sfs_ra_destroy(struct sfs_fs *sfs);
+void sfs_ra_queue(struct sfs_fs *sfs, struct inode *node, uint32_t index, uint32_t nblks);
+void sfs_ra_run(struct sfs_fs *sfs);
+int sfs_ra_fill(struct sfs_fs *sfs, uint32_t blkno);
+void sfs_ra_drop(struct sfs_fs *sfs, uint32_t blkno);
+int sfs_ra_rbuf(struct sfs_fs *sfs, void *buf, size_t len, uint32_t blkno, off_t offset, size_t *cachedp);
+int sfs_ra_rblock(struct sfs_fs *sfs, void *buf, uint32_t blkno, uint32_t nblks, size_t *cachedp);
 
 #endif /* !__KERN_FS_SFS_SFS_H__ */
 
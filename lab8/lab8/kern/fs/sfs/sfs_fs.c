@@ -13,37 +13,141 @@
 #include <error.h>
 #include <assert.h>
 #include <proc.h>
+#include <sync.h>
+#include <clock.h>
+#include <sched.h>
+
+static list_entry_t sfs_mount_list;     // mounted sfs, walked by the flusher
+static semaphore_t sfs_mount_sem;
+static struct proc_struct *sfs_flusher_proc;
+
 /*
- * sfs_sync - sync sfs's superblock and freemap in memroy into disk
+ * sfs_writeback - write back the inodes on sfs->dirty_list that have been dirty for
+ *                 SFS_DIRTY_EXPIRE ticks (or all of them if @all is set or too many are dirty),
+ *                 then the superblock and the modified freemap blocks. On a journaled sfs
+ *                 they are logged, and the running transaction is committed at the end.
  */
 static int
-sfs_sync(struct fs *fs) {
-    struct sfs_fs *sfs = fsop_info(fs, sfs);
+sfs_writeback(struct sfs_fs *sfs, bool all) {
+    int ret = 0, n;
+    bool intr_flag;
     lock_sfs_fs(sfs);
     {
-        list_entry_t *list = &(sfs->inode_list), *le = list;
-        while ((le = list_next(le)) != list) {
-            struct sfs_inode *sin = le2sin(le, inode_link);
-            vop_fsync(info2node(sin, sfs_inode));
+        all = all || sfs->dirty_count >= SFS_DIRTY_HIWAT;
+        // the list is kept in dirtying order, and a failed fsync requeues at the tail
+        for (n = sfs->dirty_count; n > 0; n --) {
+            struct sfs_inode *sin = NULL;
+            local_intr_save(intr_flag);
+            {
+                if (!list_empty(&(sfs->dirty_list))) {
+                    sin = le2sin(list_next(&(sfs->dirty_list)), dirty_link);
+                }
+            }
+            local_intr_restore(intr_flag);
+            if (sin == NULL || (!all && ticks - sin->dirty_time < SFS_DIRTY_EXPIRE)) {
+                break;
+            }
+            if ((ret = sfs_sync_inode(sfs, sin)) != 0) {
+                break;
+            }
         }
     }
     unlock_sfs_fs(sfs);
+    if (ret != 0) {
+        return ret;
+    }
 
-    int ret;
-    if (sfs->super_dirty) {
-        sfs->super_dirty = 0;
-        if ((ret = sfs_sync_super(sfs)) != 0) {
-            sfs->super_dirty = 1;
+    if (sfs->super_dirty && (all || ticks - sfs->super_dirty_time >= SFS_DIRTY_EXPIRE)) {
+        if ((ret = sfs_journal_start(sfs, SFS_TRANS_CREDITS(sfs))) != 0) {
             return ret;
         }
-        if ((ret = sfs_sync_freemap(sfs)) != 0) {
-            sfs->super_dirty = 1;
+        ret = sfs_sync_super_freemap(sfs);
+        sfs_journal_stop(sfs);
+        if (ret != 0) {
             return ret;
         }
     }
+    return sfs_journal_flush(sfs);
+}
+
+/*
+ * sfs_sync - sync sfs's dirty inodes, superblock and freemap in memroy into disk
+ */
+static int
+sfs_sync(struct fs *fs) {
+    return sfs_writeback(fsop_info(fs, sfs), 1);
+}
+
+/*
+ * sfs_flusher_alone - true once every other child of init has exited, i.e. the system is going down
+ */
+static bool
+sfs_flusher_alone(void) {
+    return current->parent->cptr == current && current->optr == NULL;
+}
+
+/*
+ * sfs_flusher - kernel thread which periodically writes back aged dirty metadata of every
+ *               mounted sfs, so writers don't pay for synchronous metadata writes. It also
+ *               runs the readahead requests, woken early by sfs_kick_flusher when one is queued.
+ */
+static int
+sfs_flusher(void *arg) {
+    size_t last_writeback = ticks;
+    while (!sfs_flusher_alone()) {
+        do_sleep(SFS_FLUSH_INTERVAL);
+        bool writeback = (ticks - last_writeback >= SFS_FLUSH_INTERVAL);
+        down(&sfs_mount_sem);
+        {
+            list_entry_t *list = &sfs_mount_list, *le = list;
+            while ((le = list_next(le)) != list) {
+                struct sfs_fs *sfs = to_struct(le, struct sfs_fs, mount_link);
+                int ret;
+                sfs_ra_run(sfs);
+                if (writeback && (ret = sfs_writeback(sfs, 0)) != 0) {
+                    warn("sfs: writeback failed: %e.\n", ret);
+                }
+            }
+        }
+        up(&sfs_mount_sem);
+        if (writeback) {
+            last_writeback = ticks;
+        }
+    }
+    sfs_flusher_proc = NULL;
     return 0;
 }
 
+/*
+ * sfs_kick_flusher - wake the flusher before its interval is up, if it is sleeping
+ */
+void
+sfs_kick_flusher(void) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        struct proc_struct *proc = sfs_flusher_proc;
+        if (proc != NULL && proc->state == PROC_SLEEPING && proc->wait_state == WT_TIMER) {
+            wakeup_proc(proc);
+        }
+    }
+    local_intr_restore(intr_flag);
+}
+
+/*
+ * sfs_start_flusher - create the flusher thread. Called by init_main, so the flusher
+ *                     is a child of init and exits when init has no other children.
+ */
+void
+sfs_start_flusher(void) {
+    int pid;
+    if ((pid = kernel_thread(sfs_flusher, NULL, 0)) <= 0) {
+        panic("create sfs_flusher failed.\n");
+    }
+    sfs_flusher_proc = find_proc(pid);
+    set_proc_name(sfs_flusher_proc, "sfs_flusher");
+}
+
 /*
  * sfs_get_root - get the root directory inode  from disk (SFS_BLKN_ROOT,1)
  */
@@ -63,10 +167,19 @@ sfs_get_root(struct fs *fs) {
 static int
 sfs_unmount(struct fs *fs) {
     struct sfs_fs *sfs = fsop_info(fs, sfs);
+    // pending readahead holds inodes
+    sfs_ra_run(sfs);
+    sfs_evict_inactive(sfs);
     if (!list_empty(&(sfs->inode_list))) {
         return -E_BUSY;
     }
-    assert(!sfs->super_dirty);
+    assert(!sfs->super_dirty && sfs->dirty_count == 0);
+    down(&sfs_mount_sem);
+    list_del(&(sfs->mount_link));
+    up(&sfs_mount_sem);
+    sfs_journal_destroy(sfs);
+    sfs_ra_destroy(sfs);
+    kfree(sfs->freemap_dirty);
     bitmap_destroy(sfs->freemap);
     kfree(sfs->sfs_buffer);
     kfree(sfs->hash_list);
@@ -150,6 +263,7 @@ sfs_do_mount(struct device *dev, struct fs **fs_store) {
     static_assert(SFS_BLKSIZE >= sizeof(struct sfs_super));
     static_assert(SFS_BLKSIZE >= sizeof(struct sfs_disk_inode));
     static_assert(SFS_BLKSIZE >= sizeof(struct sfs_disk_entry));
+    static_assert(SFS_BLKSIZE >= sizeof(struct sfs_dirblk_head) + SFS_DIRREC_LEN(SFS_MAX_FNAME_LEN));
 
     if (dev->d_blocksize != SFS_BLKSIZE) {
         return -E_NA_DEV;
@@ -188,6 +302,14 @@ sfs_do_mount(struct device *dev, struct fs **fs_store) {
                 super->blocks, dev->d_blocks);
         goto failed_cleanup_sfs_buffer;
     }
+    /* a committed transaction left in the journal may include the superblock: replay, then reload */
+    uint32_t tid;
+    if ((ret = sfs_journal_replay(dev, super, &tid)) != 0) {
+        goto failed_cleanup_sfs_buffer;
+    }
+    if (super->journal_blocks != 0 && (ret = sfs_init_read(dev, SFS_BLKN_SUPER, sfs_buffer)) != 0) {
+        goto failed_cleanup_sfs_buffer;
+    }
     super->info[SFS_MAX_INFO_LEN] = '\0';
     sfs->super = *super;
 
@@ -214,6 +336,18 @@ sfs_do_mount(struct device *dev, struct fs **fs_store) {
     if ((ret = sfs_init_freemap(dev, freemap, SFS_BLKN_FREEMAP, freemap_size_nblks, sfs_buffer)) != 0) {
         goto failed_cleanup_freemap;
     }
+    ret = -E_NO_MEM;
+    if ((sfs->freemap_dirty = kmalloc(freemap_size_nblks)) == NULL) {
+        goto failed_cleanup_freemap;
+    }
+    memset(sfs->freemap_dirty, 0, freemap_size_nblks);
+
+    if ((ret = sfs_journal_init(sfs, tid)) != 0) {
+        goto failed_cleanup_freemap_dirty;
+    }
+    if ((ret = sfs_ra_init(sfs)) != 0) {
+        goto failed_cleanup_journal;
+    }
 
     uint32_t blocks = sfs->super.blocks, unused_blocks = 0;
     for (i = 0; i < freemap_size_nbits; i ++) {
@@ -227,8 +361,13 @@ sfs_do_mount(struct device *dev, struct fs **fs_store) {
     sfs->super_dirty = 0;
     sem_init(&(sfs->fs_sem), 1);
     sem_init(&(sfs->io_sem), 1);
+    sem_init(&(sfs->freemap_sem), 1);
     sem_init(&(sfs->mutex_sem), 1);
     list_init(&(sfs->inode_list));
+    list_init(&(sfs->inactive_list));
+    sfs->inactive_count = 0;
+    list_init(&(sfs->dirty_list));
+    sfs->dirty_count = 0;
     cprintf("sfs: mount: '%s' (%d/%d/%d)\n", sfs->super.info,
             blocks - unused_blocks, unused_blocks, blocks);
 
@@ -237,9 +376,16 @@ sfs_do_mount(struct device *dev, struct fs **fs_store) {
     fs->fs_get_root = sfs_get_root;
     fs->fs_unmount = sfs_unmount;
     fs->fs_cleanup = sfs_cleanup;
+    down(&sfs_mount_sem);
+    list_add(&sfs_mount_list, &(sfs->mount_link));
+    up(&sfs_mount_sem);
     *fs_store = fs;
     return 0;
 
+failed_cleanup_journal:
+    sfs_journal_destroy(sfs);
+failed_cleanup_freemap_dirty:
+    kfree(sfs->freemap_dirty);
 failed_cleanup_freemap:
     bitmap_destroy(freemap);
 failed_cleanup_hash_list:
@@ -253,6 +399,12 @@ failed_cleanup_fs:
 
 int
 sfs_mount(const char *devname) {
+    static bool mount_list_ready = 0;
+    if (!mount_list_ready) {
+        list_init(&sfs_mount_list);
+        sem_init(&sfs_mount_sem, 1);
+        mount_list_ready = 1;
+    }
     return vfs_mount(devname, sfs_do_mount);
 }
 
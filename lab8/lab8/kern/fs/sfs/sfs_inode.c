@@ -4,11 +4,15 @@
 #include <list.h>
 #include <stat.h>
 #include <kmalloc.h>
+#include <pmm.h>
+#include <sync.h>
+#include <clock.h>
 #include <vfs.h>
 #include <dev.h>
 #include <sfs.h>
 #include <inode.h>
 #include <iobuf.h>
+#include <dirent.h>
 #include <bitmap.h>
 #include <error.h>
 #include <assert.h>
@@ -17,11 +21,11 @@ static const struct inode_ops sfs_node_dirops;  // dir operations
 static const struct inode_ops sfs_node_fileops; // file operations
 
 /*
- * lock_sin - lock the process of inode Rd/Wr
+ * lock_sin - lock the process of inode Rd/Wr, exclusively
  */
 static void
 lock_sin(struct sfs_inode *sin) {
-    down(&(sin->sem));
+    down_write(&(sin->rwlock));
 }
 
 /*
@@ -29,7 +33,23 @@ lock_sin(struct sfs_inode *sin) {
  */
 static void
 unlock_sin(struct sfs_inode *sin) {
-    up(&(sin->sem));
+    up_write(&(sin->rwlock));
+}
+
+/*
+ * lock_sin_shared - lock the inode for reading only: readers of one inode run in parallel
+ */
+static void
+lock_sin_shared(struct sfs_inode *sin) {
+    down_read(&(sin->rwlock));
+}
+
+/*
+ * unlock_sin_shared - unlock the inode locked by lock_sin_shared
+ */
+static void
+unlock_sin_shared(struct sfs_inode *sin) {
+    up_read(&(sin->rwlock));
 }
 
 /*
@@ -55,12 +75,18 @@ sfs_hash_list(struct sfs_fs *sfs, uint32_t ino) {
 }
 
 /*
- * sfs_set_links - link inode sin in sfs->linked-list AND sfs->hash_link
+ * sfs_set_links - link inode sin in sfs->linked-list AND sfs->hash_link.
+ *                 hash_list changes with interrupts off, for lookup_sfs_active
  */
 static void
 sfs_set_links(struct sfs_fs *sfs, struct sfs_inode *sin) {
+    bool intr_flag;
     list_add(&(sfs->inode_list), &(sin->inode_link));
-    list_add(sfs_hash_list(sfs, sin->ino), &(sin->hash_link));
+    local_intr_save(intr_flag);
+    {
+        list_add(sfs_hash_list(sfs, sin->ino), &(sin->hash_link));
+    }
+    local_intr_restore(intr_flag);
 }
 
 /*
@@ -68,8 +94,110 @@ sfs_set_links(struct sfs_fs *sfs, struct sfs_inode *sin) {
  */
 static void
 sfs_remove_links(struct sfs_inode *sin) {
+    bool intr_flag;
     list_del(&(sin->inode_link));
-    list_del(&(sin->hash_link));
+    local_intr_save(intr_flag);
+    {
+        list_del(&(sin->hash_link));
+    }
+    local_intr_restore(intr_flag);
+}
+
+/*
+ * sfs_dirty_inode - mark sin dirty and queue it on sfs->dirty_list for writeback
+ */
+static void
+sfs_dirty_inode(struct sfs_fs *sfs, struct sfs_inode *sin) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        if (!sin->dirty) {
+            sin->dirty = 1, sin->dirty_time = ticks;
+            list_add_before(&(sfs->dirty_list), &(sin->dirty_link));
+            sfs->dirty_count ++;
+        }
+    }
+    local_intr_restore(intr_flag);
+}
+
+/*
+ * sfs_clean_inode - mark sin clean and take it off sfs->dirty_list
+ */
+static void
+sfs_clean_inode(struct sfs_fs *sfs, struct sfs_inode *sin) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        if (sin->dirty) {
+            sin->dirty = 0;
+            list_del(&(sin->dirty_link));
+            sfs->dirty_count --;
+        }
+    }
+    local_intr_restore(intr_flag);
+}
+
+/*
+ * sfs_freemap_dirty - remember that the freemap block holding the bit of blkno changed
+ */
+static void
+sfs_freemap_dirty(struct sfs_fs *sfs, uint32_t blkno) {
+    sfs->freemap_dirty[blkno / SFS_BLKBITS] = 1;
+    if (!sfs->super_dirty) {
+        sfs->super_dirty = 1, sfs->super_dirty_time = ticks;
+    }
+}
+
+/*
+ * sfs_inactive_evict_nolock - free up to n inodes from the least recently used end of the inactive LRU
+ */
+static void
+sfs_inactive_evict_nolock(struct sfs_fs *sfs, int n) {
+    list_entry_t *list = &(sfs->inactive_list), *le = list_next(list);
+    while (n -- > 0 && le != list) {
+        struct sfs_inode *sin = le2sin(le, inactive_link);
+        le = list_next(le);
+        assert(sin->reclaim_count == 0 && sin->din->nlinks != 0);
+        // a parked inode the flusher hasn't written back yet goes into the running transaction
+        if (sin->dirty && sfs_sync_inode(sfs, sin) != 0) {
+            continue;
+        }
+        list_del(&(sin->inactive_link));
+        sfs->inactive_count --;
+        sfs_remove_links(sin);
+        kfree(sin->din);
+        vop_kill(info2node(sin, sfs_inode));
+    }
+}
+
+/*
+ * sfs_inactive_park_nolock - keep an unreferenced inode on the inactive LRU instead of freeing it,
+ *                            so a later sfs_load_inode finds it in hash_list without disk I/O.
+ *                            A dirty inode stays on dirty_list for the flusher to write back and
+ *                            commit with everything else. Nothing is kept when memory is short.
+ */
+static bool
+sfs_inactive_park_nolock(struct sfs_fs *sfs, struct sfs_inode *sin) {
+    if (nr_free_pages() < SFS_INACTIVE_LOWMEM) {
+        sfs_inactive_evict_nolock(sfs, sfs->inactive_count);
+        return 0;
+    }
+    if (sfs->inactive_count >= SFS_INACTIVE_MAX) {
+        sfs_inactive_evict_nolock(sfs, 1);
+    }
+    list_add_before(&(sfs->inactive_list), &(sin->inactive_link));
+    sfs->inactive_count ++;
+    return 1;
+}
+
+/*
+ * sfs_evict_inactive - free every inode on the inactive LRU (e.g. before unmount)
+ */
+void
+sfs_evict_inactive(struct sfs_fs *sfs) {
+    lock_sfs_fs(sfs);
+    sfs_inactive_evict_nolock(sfs, sfs->inactive_count);
+    unlock_sfs_fs(sfs);
 }
 
 /*
@@ -89,23 +217,34 @@ sfs_block_inuse(struct sfs_fs *sfs, uint32_t ino) {
 static int
 sfs_block_alloc(struct sfs_fs *sfs, uint32_t *ino_store) {
     int ret;
+    lock_sfs_freemap(sfs);
     if ((ret = bitmap_alloc(sfs->freemap, ino_store)) != 0) {
+        unlock_sfs_freemap(sfs);
         return ret;
     }
     assert(sfs->super.unused_blocks > 0);
-    sfs->super.unused_blocks --, sfs->super_dirty = 1;
+    sfs->super.unused_blocks --;
+    sfs_freemap_dirty(sfs, *ino_store);
     assert(sfs_block_inuse(sfs, *ino_store));
+    unlock_sfs_freemap(sfs);
     return sfs_clear_block(sfs, *ino_store, 1);
 }
 
 /*
- * sfs_block_free - set related bits for ino block to 1(means free) in bitmap, add sfs->super.unused_blocks, set superblock dirty *
+ * sfs_block_free - set related bits for ino block to 1(means free) in bitmap, add sfs->super.unused_blocks, set freemap block dirty *
  */
 static void
 sfs_block_free(struct sfs_fs *sfs, uint32_t ino) {
-    assert(sfs_block_inuse(sfs, ino));
-    bitmap_free(sfs->freemap, ino);
-    sfs->super.unused_blocks ++, sfs->super_dirty = 1;
+    lock_sfs_freemap(sfs);
+    {
+        assert(sfs_block_inuse(sfs, ino));
+        bitmap_free(sfs->freemap, ino);
+        sfs->super.unused_blocks ++;
+        sfs_freemap_dirty(sfs, ino);
+    }
+    unlock_sfs_freemap(sfs);
+    sfs_journal_revoke(sfs, ino);
+    sfs_ra_drop(sfs, ino);
 }
 
 /*
@@ -118,7 +257,8 @@ sfs_create_inode(struct sfs_fs *sfs, struct sfs_disk_inode *din, uint32_t ino, s
         vop_init(node, sfs_get_ops(din->type), info2fs(sfs, sfs));
         struct sfs_inode *sin = vop_info(node, sfs_inode);
         sin->din = din, sin->ino = ino, sin->dirty = 0, sin->reclaim_count = 1;
-        sem_init(&(sin->sem), 1);
+        sin->log_tid = 0, sin->nalloc = -1;
+        rwlock_init(&(sin->rwlock));
         *node_store = node;
         return 0;
     }
@@ -139,7 +279,11 @@ lookup_sfs_nolock(struct sfs_fs *sfs, uint32_t ino) {
         if (sin->ino == ino) {
             node = info2node(sin, sfs_inode);
             if (vop_ref_inc(node) == 1) {
-                sin->reclaim_count ++;
+                if (sin->reclaim_count ++ == 0) {
+                    // revive an inode from the inactive LRU
+                    list_del(&(sin->inactive_link));
+                    sfs->inactive_count --;
+                }
             }
             return node;
         }
@@ -147,14 +291,46 @@ lookup_sfs_nolock(struct sfs_fs *sfs, uint32_t ino) {
     return NULL;
 }
 
+/*
+ * lookup_sfs_active - find the inode ino if it is referenced, without fs_sem.
+ *                     hash_list only changes with interrupts off, and an inode with a reference
+ *                     is never reclaimed, so the walk needs no lock. An unreferenced inode may be
+ *                     in the middle of sfs_reclaim: leave it to lookup_sfs_nolock.
+ */
+static struct inode *
+lookup_sfs_active(struct sfs_fs *sfs, uint32_t ino) {
+    struct inode *node = NULL;
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        list_entry_t *list = sfs_hash_list(sfs, ino), *le = list;
+        while ((le = list_next(le)) != list) {
+            struct sfs_inode *sin = le2sin(le, hash_link);
+            if (sin->ino == ino) {
+                if (inode_ref_count(info2node(sin, sfs_inode)) != 0) {
+                    node = info2node(sin, sfs_inode);
+                    vop_ref_inc(node);
+                }
+                break;
+            }
+        }
+    }
+    local_intr_restore(intr_flag);
+    return node;
+}
+
 /*
  * sfs_load_inode - If the inode isn't existed, load inode related ino disk block data into a new created inode.
  *                  If the inode is in memory alreadily, then do nothing
  */
 int
 sfs_load_inode(struct sfs_fs *sfs, struct inode **node_store, uint32_t ino) {
-    lock_sfs_fs(sfs);
     struct inode *node;
+    if ((node = lookup_sfs_active(sfs, ino)) != NULL) {
+        *node_store = node;
+        return 0;
+    }
+    lock_sfs_fs(sfs);
     if ((node = lookup_sfs_nolock(sfs, ino)) != NULL) {
         goto out_unlock;
     }
@@ -162,11 +338,15 @@ sfs_load_inode(struct sfs_fs *sfs, struct inode **node_store, uint32_t ino) {
     int ret = -E_NO_MEM;
     struct sfs_disk_inode *din;
     if ((din = kmalloc(sizeof(struct sfs_disk_inode))) == NULL) {
-        goto failed_unlock;
+        // memory is short, give back the inactive inodes and try again
+        sfs_inactive_evict_nolock(sfs, sfs->inactive_count);
+        if ((din = kmalloc(sizeof(struct sfs_disk_inode))) == NULL) {
+            goto failed_unlock;
+        }
     }
 
     assert(sfs_block_inuse(sfs, ino));
-    if ((ret = sfs_rbuf(sfs, din, sizeof(struct sfs_disk_inode), ino, 0)) != 0) {
+    if ((ret = sfs_meta_rbuf(sfs, din, sizeof(struct sfs_disk_inode), ino, 0)) != 0) {
         goto failed_cleanup_din;
     }
 
@@ -188,24 +368,92 @@ failed_unlock:
     return ret;
 }
 
+/*
+ * sfs_sync_inode_nolock - write the dinode of sin back if it is dirty; on a journaled sfs it goes
+ *                         into the running transaction, so the caller holds a handle
+ */
+static int
+sfs_sync_inode_nolock(struct sfs_fs *sfs, struct sfs_inode *sin) {
+    int ret = 0;
+    if (sin->dirty) {
+        sfs_clean_inode(sfs, sin);
+        if ((ret = sfs_meta_wbuf(sfs, sin->din, sizeof(struct sfs_disk_inode), sin->ino, 0)) != 0) {
+            sfs_dirty_inode(sfs, sin);
+        }
+    }
+    return ret;
+}
+
+/*
+ * sfs_sync_inode - write the dinode of sin back without waiting for the transaction to commit
+ */
+int
+sfs_sync_inode(struct sfs_fs *sfs, struct sfs_inode *sin) {
+    int ret;
+    if (!sin->dirty) {
+        return 0;
+    }
+    if ((ret = sfs_journal_start(sfs, 1)) != 0) {
+        return ret;
+    }
+    lock_sin(sin);
+    {
+        ret = sfs_sync_inode_nolock(sfs, sin);
+        sin->log_tid = sfs_journal_stop(sfs);
+    }
+    unlock_sin(sin);
+    return ret;
+}
+
+/*
+ * sfs_trans_stop_nolock - finish an operation on sin: on a journaled sfs, log the inode, the
+ *                         superblock and the freemap it changed into the running transaction,
+ *                         so they commit together; then close the handle.
+ *                         Unjournaled metadata is left to the flusher.
+ */
+static int
+sfs_trans_stop_nolock(struct sfs_fs *sfs, struct sfs_inode *sin) {
+    int ret = 0;
+    if (sfs->journal != NULL) {
+        if ((ret = sfs_sync_inode_nolock(sfs, sin)) == 0) {
+            ret = sfs_sync_super_freemap(sfs);
+        }
+        sin->log_tid = sfs_journal_stop(sfs);
+    }
+    return ret;
+}
+
+/*
+ * sfs_bmap_account - a block was allocated to (delta 1) or freed from (delta -1) the file,
+ *                    keep sin->nalloc in step once it has been counted
+ */
+static inline void
+sfs_bmap_account(struct sfs_inode *sin, int delta) {
+    if (sin->nalloc >= 0) {
+        sin->nalloc += delta;
+        assert(sin->nalloc >= 0);
+    }
+}
+
 /*
  * sfs_bmap_get_sub_nolock - according entry pointer entp and index, find the index of indrect disk block
  *                           return the index of indrect disk block to ino_store. no lock protect
  * @sfs:      sfs file system
+ * @sin:      sfs inode in memory, the owner of the entry block
  * @entp:     the pointer of index of entry disk block
  * @index:    the index of block in indrect block
  * @create:   BOOL, if the block isn't allocated, if create = 1 the alloc a block,  otherwise just do nothing
  * @ino_store: 0 OR the index of already inused block or new allocated block.
  */
 static int
-sfs_bmap_get_sub_nolock(struct sfs_fs *sfs, uint32_t *entp, uint32_t index, bool create, uint32_t *ino_store) {
+sfs_bmap_get_sub_nolock(struct sfs_fs *sfs, struct sfs_inode *sin, uint32_t *entp, uint32_t index, bool create, uint32_t *ino_store) {
     assert(index < SFS_BLK_NENTRY);
     int ret;
     uint32_t ent, ino = 0;
     off_t offset = index * sizeof(uint32_t);  // the offset of entry in entry block
 	// if entry block is existd, read the content of entry block into  sfs->sfs_buffer
     if ((ent = *entp) != 0) {
-        if ((ret = sfs_rbuf(sfs, &ino, sizeof(uint32_t), ent, offset)) != 0) {
+        if ((ret = sfs_meta_rbuf(sfs, &ino, sizeof(uint32_t), ent, offset)) != 0) {
             return ret;
         }
         if (ino != 0 || !create) {
@@ -225,14 +473,16 @@ sfs_bmap_get_sub_nolock(struct sfs_fs *sfs, uint32_t *entp, uint32_t index, bool
     if ((ret = sfs_block_alloc(sfs, &ino)) != 0) {
         goto failed_cleanup;
     }
-    if ((ret = sfs_wbuf(sfs, &ino, sizeof(uint32_t), ent, offset)) != 0) {
+    if ((ret = sfs_meta_wbuf(sfs, &ino, sizeof(uint32_t), ent, offset)) != 0) {
         sfs_block_free(sfs, ino);
         goto failed_cleanup;
     }
+    sfs_bmap_account(sin, 1);
 
 out:
     if (ent != *entp) {
         *entp = ent;
+        sfs_bmap_account(sin, 1);
     }
     *ino_store = ino;
     return 0;
@@ -265,7 +515,8 @@ sfs_bmap_get_nolock(struct sfs_fs *sfs, struct sfs_inode *sin, uint32_t index, b
                 return ret;
             }
             din->direct[index] = ino;
-            sin->dirty = 1;
+            sfs_bmap_account(sin, 1);
+            sfs_dirty_inode(sfs, sin);
         }
         goto out;
     }
@@ -273,13 +524,13 @@ sfs_bmap_get_nolock(struct sfs_fs *sfs, struct sfs_inode *sin, uint32_t index, b
     index -= SFS_NDIRECT;
     if (index < SFS_BLK_NENTRY) {
         ent = din->indirect;
-        if ((ret = sfs_bmap_get_sub_nolock(sfs, &ent, index, create, &ino)) != 0) {
+        if ((ret = sfs_bmap_get_sub_nolock(sfs, sin, &ent, index, create, &ino)) != 0) {
             return ret;
         }
         if (ent != din->indirect) {
             assert(din->indirect == 0);
             din->indirect = ent;
-            sin->dirty = 1;
+            sfs_dirty_inode(sfs, sin);
         }
         goto out;
     } else {
@@ -295,19 +546,20 @@ out:
  * sfs_bmap_free_sub_nolock - set the entry item to 0 (free) in the indirect block
  */
 static int
-sfs_bmap_free_sub_nolock(struct sfs_fs *sfs, uint32_t ent, uint32_t index) {
+sfs_bmap_free_sub_nolock(struct sfs_fs *sfs, struct sfs_inode *sin, uint32_t ent, uint32_t index) {
     assert(sfs_block_inuse(sfs, ent) && index < SFS_BLK_NENTRY);
     int ret;
     uint32_t ino, zero = 0;
     off_t offset = index * sizeof(uint32_t);
-    if ((ret = sfs_rbuf(sfs, &ino, sizeof(uint32_t), ent, offset)) != 0) {
+    if ((ret = sfs_meta_rbuf(sfs, &ino, sizeof(uint32_t), ent, offset)) != 0) {
         return ret;
     }
     if (ino != 0) {
-        if ((ret = sfs_wbuf(sfs, &zero, sizeof(uint32_t), ent, offset)) != 0) {
+        if ((ret = sfs_meta_wbuf(sfs, &zero, sizeof(uint32_t), ent, offset)) != 0) {
             return ret;
         }
         sfs_block_free(sfs, ino);
+        sfs_bmap_account(sin, -1);
     }
     return 0;
 }
@@ -324,8 +576,9 @@ sfs_bmap_free_nolock(struct sfs_fs *sfs, struct sfs_inode *sin, uint32_t index)
         if ((ino = din->direct[index]) != 0) {
 			// free the block
             sfs_block_free(sfs, ino);
+            sfs_bmap_account(sin, -1);
             din->direct[index] = 0;
-            sin->dirty = 1;
+            sfs_dirty_inode(sfs, sin);
         }
         return 0;
     }
@@ -334,7 +587,7 @@ sfs_bmap_free_nolock(struct sfs_fs *sfs, struct sfs_inode *sin, uint32_t index)
     if (index < SFS_BLK_NENTRY) {
         if ((ent = din->indirect) != 0) {
 			// set the entry item to 0 in the indirect block
-            if ((ret = sfs_bmap_free_sub_nolock(sfs, ent, index)) != 0) {
+            if ((ret = sfs_bmap_free_sub_nolock(sfs, sin, ent, index)) != 0) {
                 return ret;
             }
         }
@@ -345,28 +598,79 @@ sfs_bmap_free_nolock(struct sfs_fs *sfs, struct sfs_inode *sin, uint32_t index)
 
 /*
  * sfs_bmap_load_nolock - according to the DIR's inode and the logical index of block in inode, find the NO. of disk block.
+ *                        A block that was never written is a hole: it is allocated only if create,
+ *                        otherwise *ino_store is 0 and the block reads as zeros.
  * @sfs:      sfs file system
  * @sin:      sfs inode in memory
  * @index:    the logical index of disk block in inode
- * @ino_store:the NO. of disk block
+ * @create:   BOOL, allocate the block if it is a hole
+ * @ino_store:the NO. of disk block, or 0 for a hole
  */
 static int
-sfs_bmap_load_nolock(struct sfs_fs *sfs, struct sfs_inode *sin, uint32_t index, uint32_t *ino_store) {
+sfs_bmap_load_nolock(struct sfs_fs *sfs, struct sfs_inode *sin, uint32_t index, bool create, uint32_t *ino_store) {
     struct sfs_disk_inode *din = sin->din;
-    assert(index <= din->blocks);
     int ret;
-    uint32_t ino;
-    bool create = (index == din->blocks);
+    uint32_t ino = 0;
+    if (index >= SFS_NDIRECT + SFS_BLK_NENTRY) {
+        if (create) {
+            return -E_TOO_BIG;
+        }
+        goto out;
+    }
+    if (!create && index >= din->blocks) {
+        goto out;
+    }
     if ((ret = sfs_bmap_get_nolock(sfs, sin, index, create, &ino)) != 0) {
         return ret;
     }
-    assert(sfs_block_inuse(sfs, ino));
-    if (create) {
-        din->blocks ++;
+    assert(!create || sfs_block_inuse(sfs, ino));
+    if (index >= din->blocks) {
+        din->blocks = index + 1;
+        sfs_dirty_inode(sfs, sin);
+    }
+out:
+    *ino_store = ino;
+    return 0;
+}
+
+/*
+ * sfs_bmap_count_nolock - count the disk blocks really allocated to the file, holes excluded.
+ *                         The indirect block is read only the first time, later the
+ *                         count is kept up to date by the bmap functions.
+ */
+static int
+sfs_bmap_count_nolock(struct sfs_fs *sfs, struct sfs_inode *sin, size_t *count_store) {
+    struct sfs_disk_inode *din = sin->din;
+    uint32_t index, ino, *ents;
+    int count = 0;
+    if (sin->nalloc >= 0) {
+        goto out;
+    }
+    for (index = 0; index < din->blocks && index < SFS_NDIRECT; index ++) {
+        if (din->direct[index] != 0) {
+            count ++;
+        }
     }
-    if (ino_store != NULL) {
-        *ino_store = ino;
+    if (din->indirect != 0) {
+        if ((ents = kmalloc(SFS_BLKSIZE)) == NULL) {
+            return -E_NO_MEM;
+        }
+        int ret;
+        if ((ret = sfs_meta_rbuf(sfs, ents, SFS_BLKSIZE, din->indirect, 0)) != 0) {
+            kfree(ents);
+            return ret;
+        }
+        count ++;
+        for (index = 0; index < SFS_BLK_NENTRY; index ++) {
+            if ((ino = ents[index]) != 0) {
+                count ++;
+            }
+        }
+        kfree(ents);
     }
+    sin->nalloc = count;
+out:
+    *count_store = sin->nalloc;
     return 0;
 }
 
@@ -382,109 +686,178 @@ sfs_bmap_truncate_nolock(struct sfs_fs *sfs, struct sfs_inode *sin) {
         return ret;
     }
     din->blocks --;
-    sin->dirty = 1;
+    sfs_dirty_inode(sfs, sin);
     return 0;
 }
 
 /*
- * sfs_dirent_read_nolock - read the file entry from disk block which contains this entry
+ * sfs_dirblk_read_nolock - read the logical block blkno of the DIR into buf (SFS_BLKSIZE bytes)
  * @sfs:      sfs file system
- * @sin:      sfs inode in memory
- * @slot:     the index of file entry
- * @entry:    file entry
+ * @sin:      DIR sfs inode in memory
+ * @blkno:    the logical index of the block in the DIR
+ * @buf:      buffer of one block
  */
 static int
-sfs_dirent_read_nolock(struct sfs_fs *sfs, struct sfs_inode *sin, int slot, struct sfs_disk_entry *entry) {
-    assert(sin->din->type == SFS_TYPE_DIR && (slot >= 0 && slot < sin->din->blocks));
+sfs_dirblk_read_nolock(struct sfs_fs *sfs, struct sfs_inode *sin, uint32_t blkno, void *buf) {
+    assert(sin->din->type == SFS_TYPE_DIR && blkno < sin->din->blocks);
     int ret;
     uint32_t ino;
-	// according to the DIR's inode and the slot of file entry, find the index of disk block which contains this file entry
-    if ((ret = sfs_bmap_load_nolock(sfs, sin, slot, &ino)) != 0) {
+    if ((ret = sfs_bmap_load_nolock(sfs, sin, blkno, 0, &ino)) != 0) {
         return ret;
     }
     assert(sfs_block_inuse(sfs, ino));
-	// read the content of file entry in the disk block 
-    if ((ret = sfs_rbuf(sfs, entry, sizeof(struct sfs_disk_entry), ino, 0)) != 0) {
-        return ret;
+    return sfs_rblock(sfs, buf, ino, 1);
+}
+
+#define sfs_dirblk_first                    sizeof(struct sfs_dirblk_head)
+
+/*
+ * sfs_dirblk_rec - return the record at byte offset off of a leaf block,
+ *                  NULL at the end of the block or if the record is malformed
+ */
+static struct sfs_dirent_rec *
+sfs_dirblk_rec(void *blk, uint32_t off) {
+    struct sfs_dirent_rec *rec = blk + off;
+    if (off + sizeof(struct sfs_dirent_rec) > SFS_BLKSIZE || rec->rec_len == 0) {
+        return NULL;
+    }
+    if (off + rec->rec_len > SFS_BLKSIZE || rec->name_len > SFS_MAX_FNAME_LEN
+            || SFS_DIRREC_LEN(rec->name_len) > rec->rec_len) {
+        warn("sfs: bad dirent record at offset %u.\n", off);
+        return NULL;
+    }
+    return rec;
+}
+
+/*
+ * sfs_dirblk_search - find the used record named name in the leaf block blk
+ */
+static struct sfs_dirent_rec *
+sfs_dirblk_search(void *blk, const char *name, size_t len) {
+    struct sfs_dirent_rec *rec;
+    uint32_t off = sfs_dirblk_first;
+    while ((rec = sfs_dirblk_rec(blk, off)) != NULL) {
+        if (rec->ino != 0 && rec->name_len == len && memcmp(rec->name, name, len) == 0) {
+            return rec;
+        }
+        off += rec->rec_len;
     }
-    entry->name[SFS_MAX_FNAME_LEN] = '\0';
-    return 0;
+    return NULL;
 }
 
-#define sfs_dirent_link_nolock_check(sfs, sin, slot, lnksin, name)                  \
-    do {                                                                            \
-        int err;                                                                    \
-        if ((err = sfs_dirent_link_nolock(sfs, sin, slot, lnksin, name)) != 0) {    \
-            warn("sfs_dirent_link error: %e.\n", err);                              \
-        }                                                                           \
-    } while (0)
-
-#define sfs_dirent_unlink_nolock_check(sfs, sin, slot, lnksin)                      \
-    do {                                                                            \
-        int err;                                                                    \
-        if ((err = sfs_dirent_unlink_nolock(sfs, sin, slot, lnksin)) != 0) {        \
-            warn("sfs_dirent_unlink error: %e.\n", err);                            \
-        }                                                                           \
-    } while (0)
+/*
+ * sfs_dirindex_leaf - binary search the index block for the leaf covering hash
+ */
+static uint32_t
+sfs_dirindex_leaf(struct sfs_dirblk_head *head, uint32_t hash) {
+    assert(head->count > 0 && head->count <= SFS_DIRINDEX_NENTRY);
+    struct sfs_dirindex *index = (struct sfs_dirindex *)(head + 1);
+    // invariant: index[lo].hash <= hash, and hash < index[hi].hash if hi < count
+    uint32_t lo = 0, hi = head->count;
+    while (hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (index[mid].hash <= hash) {
+            lo = mid;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return index[lo].block;
+}
+
+/*
+ * sfs_dirent_copy - copy a record into the in-memory file entry
+ */
+static void
+sfs_dirent_copy(struct sfs_disk_entry *entry, struct sfs_dirent_rec *rec) {
+    entry->ino = rec->ino;
+    memcpy(entry->name, rec->name, rec->name_len);
+    entry->name[rec->name_len] = '\0';
+}
 
 /*
- * sfs_dirent_search_nolock - read every file entry in the DIR, compare file name with each entry->name
- *                            If equal, then return slot and NO. of disk of this file's inode
+ * sfs_dirent_search_nolock - find the file entry named name in the DIR and return the NO. of disk block
+ *                            of its inode. An indexed DIR costs two block reads (index and leaf),
+ *                            a small DIR fits in a single leaf.
  * @sfs:        sfs file system
  * @sin:        sfs inode in memory
  * @name:       the filename
  * @ino_store:  NO. of disk of this file (with the filename)'s inode
- * @slot:       logical index of file entry (NOTICE: each file entry ocupied one  disk block)
- * @empty_slot: the empty logical index of file entry.
  */
 static int
-sfs_dirent_search_nolock(struct sfs_fs *sfs, struct sfs_inode *sin, const char *name, uint32_t *ino_store, int *slot, int *empty_slot) {
-    assert(strlen(name) <= SFS_MAX_FNAME_LEN);
-    struct sfs_disk_entry *entry;
-    if ((entry = kmalloc(sizeof(struct sfs_disk_entry))) == NULL) {
+sfs_dirent_search_nolock(struct sfs_fs *sfs, struct sfs_inode *sin, const char *name, uint32_t *ino_store) {
+    size_t len = strlen(name);
+    assert(len <= SFS_MAX_FNAME_LEN);
+    void *blk;
+    if ((blk = kmalloc(SFS_BLKSIZE)) == NULL) {
         return -E_NO_MEM;
     }
 
-#define set_pvalue(x, v)            do { if ((x) != NULL) { *(x) = (v); } } while (0)
-    int ret, i, nslots = sin->din->blocks;
-    set_pvalue(empty_slot, nslots);
-    for (i = 0; i < nslots; i ++) {
-        if ((ret = sfs_dirent_read_nolock(sfs, sin, i, entry)) != 0) {
+    int ret;
+    struct sfs_dirblk_head *head = blk;
+    struct sfs_dirent_rec *rec;
+    uint32_t blkno = 0, nblks = sin->din->blocks;
+    if ((ret = sfs_dirblk_read_nolock(sfs, sin, 0, blk)) != 0) {
+        goto out;
+    }
+    if (head->magic == SFS_DIRBLK_INDEX) {
+        // only the leaf covering the hash of name can hold it
+        blkno = sfs_dirindex_leaf(head, sfs_name_hash(name, len));
+        if ((ret = sfs_dirblk_read_nolock(sfs, sin, blkno, blk)) != 0) {
             goto out;
         }
-        if (entry->ino == 0) {
-            set_pvalue(empty_slot, i);
-            continue ;
+        nblks = blkno + 1;
+    }
+    while (1) {
+        if ((rec = sfs_dirblk_search(blk, name, len)) != NULL) {
+            *ino_store = rec->ino;
+            goto out;
+        }
+        if (++ blkno >= nblks) {
+            break;
         }
-        if (strcmp(name, entry->name) == 0) {
-            set_pvalue(slot, i);
-            set_pvalue(ino_store, entry->ino);
+        if ((ret = sfs_dirblk_read_nolock(sfs, sin, blkno, blk)) != 0) {
             goto out;
         }
     }
-#undef set_pvalue
     ret = -E_NOENT;
 out:
-    kfree(entry);
+    kfree(blk);
     return ret;
 }
 
 /*
- * sfs_dirent_findino_nolock - read all file entries in DIR's inode and find a entry->ino == ino
+ * sfs_dirent_findino_nolock - read all leaf blocks in DIR's inode and find a entry->ino == ino
  */
-
 static int
 sfs_dirent_findino_nolock(struct sfs_fs *sfs, struct sfs_inode *sin, uint32_t ino, struct sfs_disk_entry *entry) {
-    int ret, i, nslots = sin->din->blocks;
-    for (i = 0; i < nslots; i ++) {
-        if ((ret = sfs_dirent_read_nolock(sfs, sin, i, entry)) != 0) {
-            return ret;
+    void *blk;
+    if ((blk = kmalloc(SFS_BLKSIZE)) == NULL) {
+        return -E_NO_MEM;
+    }
+
+    int ret;
+    struct sfs_dirent_rec *rec;
+    uint32_t blkno, off;
+    for (blkno = 0; blkno < sin->din->blocks; blkno ++) {
+        if ((ret = sfs_dirblk_read_nolock(sfs, sin, blkno, blk)) != 0) {
+            goto out;
         }
-        if (entry->ino == ino) {
-            return 0;
+        if (((struct sfs_dirblk_head *)blk)->magic != SFS_DIRBLK_LEAF) {
+            continue;
+        }
+        for (off = sfs_dirblk_first; (rec = sfs_dirblk_rec(blk, off)) != NULL; off += rec->rec_len) {
+            if (rec->ino == ino) {
+                sfs_dirent_copy(entry, rec);
+                goto out;
+            }
         }
     }
-    return -E_NOENT;
+    ret = -E_NOENT;
+out:
+    kfree(blk);
+    return ret;
 }
 
 /*
@@ -493,17 +866,16 @@ sfs_dirent_findino_nolock(struct sfs_fs *sfs, struct sfs_inode *sin, uint32_t in
  * @sin:        DIR sfs inode in memory
  * @name:       the file name in DIR
  * @node_store: the inode corresponding the file name in DIR
- * @slot:       the logical index of file entry
  */
 static int
-sfs_lookup_once(struct sfs_fs *sfs, struct sfs_inode *sin, const char *name, struct inode **node_store, int *slot) {
+sfs_lookup_once(struct sfs_fs *sfs, struct sfs_inode *sin, const char *name, struct inode **node_store) {
     int ret;
     uint32_t ino;
-    lock_sin(sin);
-    {   // find the NO. of disk block and logical index of file entry
-        ret = sfs_dirent_search_nolock(sfs, sin, name, &ino, slot, NULL);
+    lock_sin_shared(sin);
+    {   // find the NO. of disk block of the file's inode
+        ret = sfs_dirent_search_nolock(sfs, sin, name, &ino);
     }
-    unlock_sin(sin);
+    unlock_sin_shared(sin);
     if (ret == 0) {
 		// load the content of inode with the the NO. of disk block
         ret = sfs_load_inode(sfs, node_store, ino);
@@ -534,10 +906,22 @@ sfs_openfile(struct inode *node, uint32_t open_flags) {
     return 0;
 }
 
-// sfs_close - close file
+// sfs_close - close file; a dirty inode is left to the flusher, fsync is what waits for the disk
 static int
 sfs_close(struct inode *node) {
-    return vop_fsync(node);
+    return 0;
+}
+
+/* sfs_buf_op - write part of a file block, or read it through the readahead cache */
+static inline int
+sfs_buf_op(struct sfs_fs *sfs, void *buf, size_t len, uint32_t blkno, off_t offset, bool write, size_t *cachedp) {
+    return write ? sfs_wbuf(sfs, buf, len, blkno, offset) : sfs_ra_rbuf(sfs, buf, len, blkno, offset, cachedp);
+}
+
+/* sfs_block_op - write whole file blocks, or read them through the readahead cache */
+static inline int
+sfs_block_op(struct sfs_fs *sfs, void *buf, uint32_t blkno, uint32_t nblks, bool write, size_t *cachedp) {
+    return write ? sfs_wblock(sfs, buf, blkno, nblks) : sfs_ra_rblock(sfs, buf, blkno, nblks, cachedp);
 }
 
 /*  
@@ -548,9 +932,11 @@ sfs_close(struct inode *node) {
  * @offset:   the offset of file
  * @alenp:    the length need to read (is a pointer). and will RETURN the really Rd/Wr lenght
  * @write:    BOOL, 0 read, 1 write
+ * @cachedp:  a read adds the bytes it found in the readahead cache here
  */
 static int
-sfs_io_nolock(struct sfs_fs *sfs, struct sfs_inode *sin, void *buf, off_t offset, size_t *alenp, bool write) {
+sfs_io_nolock(struct sfs_fs *sfs, struct sfs_inode *sin, void *buf, off_t offset, size_t *alenp, bool write,
+              size_t *cachedp) {
     struct sfs_disk_inode *din = sin->din;
     assert(din->type != SFS_TYPE_DIR);
     off_t endpos = offset + *alenp, blkoff;
@@ -574,14 +960,6 @@ sfs_io_nolock(struct sfs_fs *sfs, struct sfs_inode *sin, void *buf, off_t offset
         }
     }
 
-    int (*sfs_buf_op)(struct sfs_fs *sfs, void *buf, size_t len, uint32_t blkno, off_t offset);
-    int (*sfs_block_op)(struct sfs_fs *sfs, void *buf, uint32_t blkno, uint32_t nblks);
-    if (write) {
-        sfs_buf_op = sfs_wbuf, sfs_block_op = sfs_wblock;
-    }
-    else {
-        sfs_buf_op = sfs_rbuf, sfs_block_op = sfs_rblock;
-    }
 
     int ret = 0;
     size_t size, alen = 0;
@@ -604,10 +982,13 @@ sfs_io_nolock(struct sfs_fs *sfs, struct sfs_inode *sin, void *buf, off_t offset
     blkoff = offset % SFS_BLKSIZE;
     if (blkoff != 0) {
         size = (nblks != 0) ? (SFS_BLKSIZE - blkoff) : (endpos - offset);
-        if ((ret = sfs_bmap_load_nolock(sfs, sin, blkno, &ino)) != 0) {
+        if ((ret = sfs_bmap_load_nolock(sfs, sin, blkno, write, &ino)) != 0) {
             goto out;
         }
-        if ((ret = sfs_buf_op(sfs, buf, size, ino, blkoff)) != 0) {
+        if (ino == 0) {
+            memset(buf, 0, size);
+        }
+        else if ((ret = sfs_buf_op(sfs, buf, size, ino, blkoff, write, cachedp)) != 0) {
             goto out;
         }
         alen += size;
@@ -620,10 +1001,13 @@ sfs_io_nolock(struct sfs_fs *sfs, struct sfs_inode *sin, void *buf, off_t offset
 
     // (2) 读写中间的完整块
     while (nblks > 0) {
-        if ((ret = sfs_bmap_load_nolock(sfs, sin, blkno, &ino)) != 0) {
+        if ((ret = sfs_bmap_load_nolock(sfs, sin, blkno, write, &ino)) != 0) {
             goto out;
         }
-        if ((ret = sfs_block_op(sfs, buf, ino, 1)) != 0) {
+        if (ino == 0) {
+            memset(buf, 0, SFS_BLKSIZE);
+        }
+        else if ((ret = sfs_block_op(sfs, buf, ino, 1, write, cachedp)) != 0) {
             goto out;
         }
         alen += SFS_BLKSIZE;
@@ -636,10 +1020,13 @@ sfs_io_nolock(struct sfs_fs *sfs, struct sfs_inode *sin, void *buf, off_t offset
     // 检查 blkno 是否为 endpos 所在块，如果步骤(1)已处理完则 blkno 会超过该块
     size = endpos % SFS_BLKSIZE;
     if (size != 0 && blkno == endpos / SFS_BLKSIZE) {
-        if ((ret = sfs_bmap_load_nolock(sfs, sin, blkno, &ino)) != 0) {
+        if ((ret = sfs_bmap_load_nolock(sfs, sin, blkno, write, &ino)) != 0) {
             goto out;
         }
-        if ((ret = sfs_buf_op(sfs, buf, size, ino, 0)) != 0) {
+        if (ino == 0) {
+            memset(buf, 0, size);
+        }
+        else if ((ret = sfs_buf_op(sfs, buf, size, ino, 0, write, cachedp)) != 0) {
             goto out;
         }
         alen += size;
@@ -651,11 +1038,28 @@ out:
     *alenp = alen;
     if (offset + alen > sin->din->size) {
         sin->din->size = offset + alen;
-        sin->dirty = 1;
+        sfs_dirty_inode(sfs, sin);
     }
     return ret;
 }
 
+/*
+ * sfs_write_credits - # of journal blocks a write of len bytes at offset may touch: the inode,
+ *                     the superblock, and for each block it may allocate (the indirect block
+ *                     included) a freemap block, plus the indirect block itself
+ */
+static int
+sfs_write_credits(struct sfs_fs *sfs, off_t offset, size_t len) {
+    uint32_t nblks = 0, fmblks = sfs_freemap_blocks(&(sfs->super));
+    bool indirect = 0;
+    if (len != 0) {
+        uint32_t first = offset / SFS_BLKSIZE, last = (offset + len - 1) / SFS_BLKSIZE;
+        indirect = (last >= SFS_NDIRECT);
+        nblks = last - first + 1 + indirect;
+    }
+    return 2 + indirect + ((nblks < fmblks) ? nblks : fmblks);
+}
+
 /*
  * sfs_io - Rd/Wr file. the wrapper of sfs_io_nolock
             with lock protect
@@ -665,15 +1069,35 @@ sfs_io(struct inode *node, struct iobuf *iob, bool write) {
     struct sfs_fs *sfs = fsop_info(vop_fs(node), sfs);
     struct sfs_inode *sin = vop_info(node, sfs_inode);
     int ret;
-    lock_sin(sin);
+    // a write may fill holes or extend the file: its block allocations are one transaction,
+    // sized to the blocks it covers so small writes share a transaction (group commit)
+    if (write && (ret = sfs_journal_start(sfs, sfs_write_credits(sfs, iob->io_offset, iob->io_resid))) != 0) {
+        return ret;
+    }
+    // readers of one file share its lock; a writer may allocate blocks and change din
+    if (write) {
+        lock_sin(sin);
+    }
+    else {
+        lock_sin_shared(sin);
+    }
     {
         size_t alen = iob->io_resid;
-        ret = sfs_io_nolock(sfs, sin, iob->io_base, iob->io_offset, &alen, write);
+        ret = sfs_io_nolock(sfs, sin, iob->io_base, iob->io_offset, &alen, write, &(iob->io_cached));
         if (alen != 0) {
             iobuf_skip(iob, alen);
         }
+        if (write) {
+            int ret2 = sfs_trans_stop_nolock(sfs, sin);
+            ret = (ret != 0) ? ret : ret2;
+        }
+    }
+    if (write) {
+        unlock_sin(sin);
+    }
+    else {
+        unlock_sin_shared(sin);
     }
-    unlock_sin(sin);
     return ret;
 }
 
@@ -689,6 +1113,48 @@ sfs_write(struct inode *node, struct iobuf *iob) {
     return sfs_io(node, iob, 1);
 }
 
+/*
+ * sfs_readahead - start reading bytes [pos, pos + len) of the file into the readahead
+ *                 cache in the background
+ */
+static int
+sfs_readahead(struct inode *node, off_t pos, size_t len) {
+    struct sfs_fs *sfs = fsop_info(vop_fs(node), sfs);
+    if (pos < 0 || pos >= SFS_MAX_FILE_SIZE || len == 0) {
+        return -E_INVAL;
+    }
+    uint32_t index = pos / SFS_BLKSIZE;
+    sfs_ra_queue(sfs, node, index, ROUNDUP_DIV(pos + len, SFS_BLKSIZE) - index);
+    return 0;
+}
+
+/*
+ * sfs_readahead_load - read file blocks [index, index + nblks) of node into the readahead
+ *                      cache, as far as the file goes. Called by the flusher.
+ */
+int
+sfs_readahead_load(struct sfs_fs *sfs, struct inode *node, uint32_t index, uint32_t nblks) {
+    struct sfs_inode *sin = vop_info(node, sfs_inode);
+    int ret = 0;
+    lock_sin_shared(sin);
+    {
+        uint32_t blocks = ROUNDUP_DIV(sin->din->size, SFS_BLKSIZE), ino;
+        if (blocks > sin->din->blocks) {
+            blocks = sin->din->blocks;
+        }
+        for (; nblks != 0 && index < blocks; index ++, nblks --) {
+            if ((ret = sfs_bmap_load_nolock(sfs, sin, index, 0, &ino)) != 0) {
+                break;
+            }
+            if (ino != 0 && (ret = sfs_ra_fill(sfs, ino)) != 0) {
+                break;
+            }
+        }
+    }
+    unlock_sin_shared(sin);
+    return ret;
+}
+
 /*
  * sfs_fstat - Return nlinks/block/size, etc. info about a file. The pointer is a pointer to struct stat;
  */
@@ -699,34 +1165,31 @@ sfs_fstat(struct inode *node, struct stat *stat) {
     if ((ret = vop_gettype(node, &(stat->st_mode))) != 0) {
         return ret;
     }
-    struct sfs_disk_inode *din = vop_info(node, sfs_inode)->din;
-    stat->st_nlinks = din->nlinks;
-    stat->st_blocks = din->blocks;
-    stat->st_size = din->size;
-    return 0;
+    struct sfs_fs *sfs = fsop_info(vop_fs(node), sfs);
+    struct sfs_inode *sin = vop_info(node, sfs_inode);
+    lock_sin_shared(sin);
+    {
+        ret = sfs_bmap_count_nolock(sfs, sin, &(stat->st_blocks));
+        stat->st_nlinks = sin->din->nlinks;
+        stat->st_size = sin->din->size;
+    }
+    unlock_sin_shared(sin);
+    return ret;
 }
 
 /*
  * sfs_fsync - Force any dirty inode info associated with this file to stable storage.
+ *             On a journaled sfs, wait for the transaction holding the inode to commit.
  */
 static int
 sfs_fsync(struct inode *node) {
     struct sfs_fs *sfs = fsop_info(vop_fs(node), sfs);
     struct sfs_inode *sin = vop_info(node, sfs_inode);
-    int ret = 0;
-    if (sin->dirty) {
-        lock_sin(sin);
-        {
-            if (sin->dirty) {
-                sin->dirty = 0;
-                if ((ret = sfs_wbuf(sfs, sin->din, sizeof(struct sfs_disk_inode), sin->ino, 0)) != 0) {
-                    sin->dirty = 1;
-                }
-            }
-        }
-        unlock_sin(sin);
+    int ret;
+    if ((ret = sfs_sync_inode(sfs, sin)) != 0) {
+        return ret;
     }
-    return ret;
+    return sfs_journal_commit(sfs, sin->log_tid);
 }
 
 /*
@@ -749,7 +1212,7 @@ sfs_namefile(struct inode *node, struct iobuf *iob) {
     vop_ref_inc(node);
     while (1) {
         struct inode *parent;
-        if ((ret = sfs_lookup_once(sfs, sin, "..", &parent, NULL)) != 0) {
+        if ((ret = sfs_lookup_once(sfs, sin, "..", &parent)) != 0) {
             goto failed;
         }
 
@@ -763,11 +1226,11 @@ sfs_namefile(struct inode *node, struct iobuf *iob) {
         node = parent, sin = vop_info(node, sfs_inode);
         assert(ino != sin->ino && sin->din->type == SFS_TYPE_DIR);
 
-        lock_sin(sin);
+        lock_sin_shared(sin);
         {
             ret = sfs_dirent_findino_nolock(sfs, sin, ino, entry);
         }
-        unlock_sin(sin);
+        unlock_sin_shared(sin);
 
         if (ret != 0) {
             goto failed;
@@ -796,28 +1259,44 @@ failed:
 }
 
 /*
- * sfs_getdirentry_sub_noblock - get the content of file entry in DIR
+ * sfs_getdirentry_sub_nolock - get the first used file entry at or after the DIR position *posp
+ *                              and move *posp past it. A position is blkno * SFS_BLKSIZE plus
+ *                              the offset of a record in that leaf block.
  */
 static int
-sfs_getdirentry_sub_nolock(struct sfs_fs *sfs, struct sfs_inode *sin, int slot, struct sfs_disk_entry *entry) {
-    int ret, i, nslots = sin->din->blocks;
-    for (i = 0; i < nslots; i ++) {
-        if ((ret = sfs_dirent_read_nolock(sfs, sin, i, entry)) != 0) {
-            return ret;
+sfs_getdirentry_sub_nolock(struct sfs_fs *sfs, struct sfs_inode *sin, off_t *posp, struct sfs_disk_entry *entry) {
+    void *blk;
+    if ((blk = kmalloc(SFS_BLKSIZE)) == NULL) {
+        return -E_NO_MEM;
+    }
+
+    int ret;
+    struct sfs_dirent_rec *rec;
+    uint32_t blkno = *posp / SFS_BLKSIZE, pos = *posp % SFS_BLKSIZE, off;
+    for (; blkno < sin->din->blocks; blkno ++, pos = 0) {
+        if ((ret = sfs_dirblk_read_nolock(sfs, sin, blkno, blk)) != 0) {
+            goto out;
+        }
+        if (((struct sfs_dirblk_head *)blk)->magic != SFS_DIRBLK_LEAF) {
+            continue;
         }
-        if (entry->ino != 0) {
-            if (slot == 0) {
-                return 0;
+        for (off = sfs_dirblk_first; (rec = sfs_dirblk_rec(blk, off)) != NULL; off += rec->rec_len) {
+            if (off >= pos && rec->ino != 0) {
+                sfs_dirent_copy(entry, rec);
+                *posp = (off_t)blkno * SFS_BLKSIZE + off + rec->rec_len;
+                goto out;
             }
-            slot --;
         }
     }
-    return -E_NOENT;
+    ret = -E_NOENT;
+out:
+    kfree(blk);
+    return ret;
 }
 
 /*
- * sfs_getdirentry - according to the iob->io_offset, calculate the dir entry's slot in disk block,
-                     get dir entry content from the disk 
+ * sfs_getdirentry - get the dir entry at the position iob->io_offset, and leave the position
+ *                   of the next entry in iob->io_offset, so each call reads one block at most
  */
 static int
 sfs_getdirentry(struct inode *node, struct iobuf *iob) {
@@ -829,30 +1308,90 @@ sfs_getdirentry(struct inode *node, struct iobuf *iob) {
     struct sfs_fs *sfs = fsop_info(vop_fs(node), sfs);
     struct sfs_inode *sin = vop_info(node, sfs_inode);
 
-    int ret, slot;
-    off_t offset = iob->io_offset;
-    if (offset < 0 || offset % sfs_dentry_size != 0) {
+    int ret;
+    off_t pos = iob->io_offset;
+    if (pos < 0) {
         kfree(entry);
         return -E_INVAL;
     }
-    if ((slot = offset / sfs_dentry_size) > sin->din->blocks) {
-        kfree(entry);
-        return -E_NOENT;
-    }
-    lock_sin(sin);
-    if ((ret = sfs_getdirentry_sub_nolock(sfs, sin, slot, entry)) != 0) {
-        unlock_sin(sin);
+    lock_sin_shared(sin);
+    if ((ret = sfs_getdirentry_sub_nolock(sfs, sin, &pos, entry)) != 0) {
+        unlock_sin_shared(sin);
         goto out;
     }
-    unlock_sin(sin);
-    ret = iobuf_move(iob, entry->name, sfs_dentry_size, 1, NULL);
+    unlock_sin_shared(sin);
+    if ((ret = iobuf_move(iob, entry->name, sfs_dentry_size, 1, NULL)) == 0) {
+        iob->io_offset = pos;
+    }
 out:
     kfree(entry);
     return ret;
 }
 
 /*
- * sfs_reclaim - Free all resources inode occupied . Called when inode is no longer in use. 
+ * sfs_getdents - fill iob with a dirent_rec for each used entry at or after the DIR position
+ *                iob->io_offset, reading every block once, until iob is full; leave the
+ *                position after the last entry copied in iob->io_offset
+ */
+static int
+sfs_getdents(struct inode *node, struct iobuf *iob) {
+    struct sfs_fs *sfs = fsop_info(vop_fs(node), sfs);
+    struct sfs_inode *sin = vop_info(node, sfs_inode);
+    off_t pos = iob->io_offset;
+    if (pos < 0) {
+        return -E_INVAL;
+    }
+    void *blk;
+    struct dirent_rec *drec;
+    if ((blk = kmalloc(SFS_BLKSIZE)) == NULL) {
+        return -E_NO_MEM;
+    }
+    if ((drec = kmalloc(DIRENT_RECLEN(SFS_MAX_FNAME_LEN))) == NULL) {
+        kfree(blk);
+        return -E_NO_MEM;
+    }
+
+    int ret = 0, count = 0;
+    struct sfs_dirent_rec *rec;
+    uint32_t blkno = pos / SFS_BLKSIZE, boff = pos % SFS_BLKSIZE, off;
+    lock_sin_shared(sin);
+    for (; blkno < sin->din->blocks; blkno ++, boff = 0) {
+        if ((ret = sfs_dirblk_read_nolock(sfs, sin, blkno, blk)) != 0) {
+            goto out;
+        }
+        if (((struct sfs_dirblk_head *)blk)->magic != SFS_DIRBLK_LEAF) {
+            continue;
+        }
+        for (off = sfs_dirblk_first; (rec = sfs_dirblk_rec(blk, off)) != NULL; off += rec->rec_len) {
+            if (off < boff || rec->ino == 0) {
+                continue;
+            }
+            size_t reclen = DIRENT_RECLEN(rec->name_len);
+            if (reclen > iob->io_resid) {
+                // full: the next call starts from this entry
+                ret = (count == 0) ? -E_INVAL : 0;
+                goto out;
+            }
+            memset(drec, 0, reclen);
+            drec->d_off = (off_t)blkno * SFS_BLKSIZE + off + rec->rec_len;
+            drec->d_reclen = reclen, drec->d_namlen = rec->name_len;
+            memcpy(drec->d_name, rec->name, rec->name_len);
+            iobuf_move(iob, drec, reclen, 1, NULL);
+            pos = drec->d_off, count ++;
+        }
+    }
+    pos = (off_t)blkno * SFS_BLKSIZE;
+out:
+    unlock_sin_shared(sin);
+    iob->io_offset = pos;
+    kfree(drec);
+    kfree(blk);
+    return ret;
+}
+
+/*
+ * sfs_reclaim - Called when inode is no longer in use. A linked inode is kept on the
+ *               inactive LRU if possible; otherwise free all resources it occupied.
  */
 static int
 sfs_reclaim(struct inode *node) {
@@ -866,13 +1405,18 @@ sfs_reclaim(struct inode *node) {
     if ((-- sin->reclaim_count) != 0 || inode_ref_count(node) != 0) {
         goto failed_unlock;
     }
+    if (sin->din->nlinks != 0 && sfs_inactive_park_nolock(sfs, sin)) {
+        unlock_sfs_fs(sfs);
+        return 0;
+    }
     if (sin->din->nlinks == 0) {
         if ((ret = vop_truncate(node, 0)) != 0) {
             goto failed_unlock;
         }
     }
+    // log the inode before its din goes; the flusher commits the transaction
     if (sin->dirty) {
-        if ((ret = vop_fsync(node)) != 0) {
+        if ((ret = sfs_sync_inode(sfs, sin)) != 0) {
             goto failed_unlock;
         }
     }
@@ -949,17 +1493,15 @@ sfs_truncfile(struct inode *node, off_t len) {
         return 0;
     }
 
+    if ((ret = sfs_journal_start(sfs, SFS_TRANS_CREDITS(sfs))) != 0) {
+        return ret;
+    }
     lock_sin(sin);
 	// old number of disk blocks of file
     nblks = din->blocks;
     if (nblks < tblks) {
-		// try to enlarge the file size by add new disk block at the end of file
-        while (nblks != tblks) {
-            if ((ret = sfs_bmap_load_nolock(sfs, sin, nblks, NULL)) != 0) {
-                goto out_unlock;
-            }
-            nblks ++;
-        }
+		// enlarging the file only moves its end: the new blocks are holes until written
+        din->blocks = tblks;
     }
     else if (tblks < nblks) {
 		// try to reduce the file size 
@@ -971,10 +1513,24 @@ sfs_truncfile(struct inode *node, off_t len) {
         }
     }
     assert(din->blocks == tblks);
+    if (len < din->size && (len % SFS_BLKSIZE) != 0) {
+        // the tail of the new last block must read as zeros if the file grows again
+        uint32_t ino, blkoff = len % SFS_BLKSIZE;
+        if ((ret = sfs_bmap_load_nolock(sfs, sin, tblks - 1, 0, &ino)) != 0) {
+            goto out_unlock;
+        }
+        if (ino != 0 && (ret = sfs_clear_buf(sfs, SFS_BLKSIZE - blkoff, ino, blkoff)) != 0) {
+            goto out_unlock;
+        }
+    }
     din->size = len;
-    sin->dirty = 1;
+    sfs_dirty_inode(sfs, sin);
 
 out_unlock:
+    {
+        int ret2 = sfs_trans_stop_nolock(sfs, sin);
+        ret = (ret != 0) ? ret : ret2;
+    }
     unlock_sin(sin);
     return ret;
 }
@@ -995,7 +1551,7 @@ sfs_lookup(struct inode *node, char *path, struct inode **node_store) {
         return -E_NOTDIR;
     }
     struct inode *subnode;
-    int ret = sfs_lookup_once(sfs, sin, path, &subnode, NULL);
+    int ret = sfs_lookup_once(sfs, sin, path, &subnode);
 
     vop_ref_dec(node);
     if (ret != 0) {
@@ -1014,6 +1570,7 @@ static const struct inode_ops sfs_node_dirops = {
     .vop_fsync                      = sfs_fsync,
     .vop_namefile                   = sfs_namefile,
     .vop_getdirentry                = sfs_getdirentry,
+    .vop_getdents                   = sfs_getdents,
     .vop_reclaim                    = sfs_reclaim,
     .vop_gettype                    = sfs_gettype,
     .vop_lookup                     = sfs_lookup,
@@ -1031,5 +1588,6 @@ static const struct inode_ops sfs_node_fileops = {
     .vop_gettype                    = sfs_gettype,
     .vop_tryseek                    = sfs_tryseek,
     .vop_truncate                   = sfs_truncfile,
+    .vop_readahead                  = sfs_readahead,
 };
 
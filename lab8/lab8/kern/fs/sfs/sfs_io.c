@@ -23,8 +23,7 @@ sfs_rwblock_nolock(struct sfs_fs *sfs, void *buf, uint32_t blkno, bool write, bo
     return dop_io(sfs->dev, iob, write);
 }
 
-/* sfs_rwblock - Basic block-level I/O routine for Rd/Wr N disk blocks ,
- *               with lock protect for mutex process on Rd/Wr disk block
+/* sfs_rwblock - Basic block-level I/O routine for Rd/Wr N disk blocks from/into buf
  * @sfs:   sfs_fs which will be process
  * @buf:   the buffer uesed for Rd/Wr
  * @blkno: the NO. of disk block
@@ -34,17 +33,14 @@ sfs_rwblock_nolock(struct sfs_fs *sfs, void *buf, uint32_t blkno, bool write, bo
 static int
 sfs_rwblock(struct sfs_fs *sfs, void *buf, uint32_t blkno, uint32_t nblks, bool write) {
     int ret = 0;
-    lock_sfs_io(sfs);
-    {
-        while (nblks != 0) {
-            if ((ret = sfs_rwblock_nolock(sfs, buf, blkno, write, 1)) != 0) {
-                break;
-            }
-            blkno ++, nblks --;
-            buf += SFS_BLKSIZE;
+    // the device serializes its own transfers; io_sem only guards sfs_buffer
+    while (nblks != 0) {
+        if ((ret = sfs_rwblock_nolock(sfs, buf, blkno, write, 1)) != 0) {
+            break;
         }
+        blkno ++, nblks --;
+        buf += SFS_BLKSIZE;
     }
-    unlock_sfs_io(sfs);
     return ret;
 }
 
@@ -69,7 +65,12 @@ sfs_rblock(struct sfs_fs *sfs, void *buf, uint32_t blkno, uint32_t nblks) {
  */
 int
 sfs_wblock(struct sfs_fs *sfs, void *buf, uint32_t blkno, uint32_t nblks) {
-    return sfs_rwblock(sfs, buf, blkno, nblks, 1);
+    int ret = sfs_rwblock(sfs, buf, blkno, nblks, 1);
+    // may hold file data, now stale in the readahead cache
+    for (; nblks != 0; blkno ++, nblks --) {
+        sfs_ra_drop(sfs, blkno);
+    }
+    return ret;
 }
 
 /* sfs_rbuf - The Basic block-level I/O routine for  Rd( non-block & non-aligned io) one disk block(using sfs->sfs_buffer)
@@ -114,15 +115,20 @@ sfs_wbuf(struct sfs_fs *sfs, void *buf, size_t len, uint32_t blkno, off_t offset
         }
     }
     unlock_sfs_io(sfs);
+    sfs_ra_drop(sfs, blkno);
     return ret;
 }
 
 /*
  * sfs_sync_super - write sfs->super (in memory) into disk (SFS_BLKN_SUPER, 1) with lock protect.
+ *                  On a journaled sfs it goes into the running transaction instead.
  */
 int
 sfs_sync_super(struct sfs_fs *sfs) {
     int ret;
+    if (sfs->journal != NULL) {
+        return sfs_meta_wbuf(sfs, &(sfs->super), sizeof(sfs->super), SFS_BLKN_SUPER, 0);
+    }
     lock_sfs_io(sfs);
     {
         memset(sfs->sfs_buffer, 0, SFS_BLKSIZE);
@@ -134,12 +140,48 @@ sfs_sync_super(struct sfs_fs *sfs) {
 }
 
 /*
- * sfs_sync_freemap - write sfs bitmap into disk (SFS_BLKN_FREEMAP, nblks)  without lock protect.
+ * sfs_sync_freemap - write the modified blocks of sfs bitmap into disk (SFS_BLKN_FREEMAP, nblks) with lock protect.
+ *                    On a journaled sfs they go into the running transaction instead.
  */
 int
 sfs_sync_freemap(struct sfs_fs *sfs) {
-    uint32_t nblks = sfs_freemap_blocks(&(sfs->super));
-    return sfs_wblock(sfs, bitmap_getdata(sfs->freemap, NULL), SFS_BLKN_FREEMAP, nblks);
+    uint32_t i, nblks = sfs_freemap_blocks(&(sfs->super));
+    void *data = bitmap_getdata(sfs->freemap, NULL);
+    int ret = 0;
+    lock_sfs_freemap(sfs);
+    for (i = 0; i < nblks; i ++) {
+        if (sfs->freemap_dirty[i]) {
+            sfs->freemap_dirty[i] = 0;
+            if (sfs->journal != NULL) {
+                ret = sfs_meta_wbuf(sfs, data + i * SFS_BLKSIZE, SFS_BLKSIZE, SFS_BLKN_FREEMAP + i, 0);
+            }
+            else {
+                ret = sfs_wblock(sfs, data + i * SFS_BLKSIZE, SFS_BLKN_FREEMAP + i, 1);
+            }
+            if (ret != 0) {
+                sfs->freemap_dirty[i] = 1;
+                break;
+            }
+        }
+    }
+    unlock_sfs_freemap(sfs);
+    return ret;
+}
+
+/*
+ * sfs_sync_super_freemap - write the superblock and the modified freemap blocks if super_dirty is set
+ */
+int
+sfs_sync_super_freemap(struct sfs_fs *sfs) {
+    int ret;
+    if (sfs->super_dirty) {
+        sfs->super_dirty = 0;
+        if ((ret = sfs_sync_super(sfs)) != 0 || (ret = sfs_sync_freemap(sfs)) != 0) {
+            sfs->super_dirty = 1;
+            return ret;
+        }
+    }
+    return 0;
 }
 
 /*
@@ -165,3 +207,23 @@ sfs_clear_block(struct sfs_fs *sfs, uint32_t blkno, uint32_t nblks) {
     return ret;
 }
 
+/*
+ * sfs_clear_buf - write zeros into bytes [offset, offset + len) of disk block blkno
+ *                 with lock protect.
+ */
+int
+sfs_clear_buf(struct sfs_fs *sfs, size_t len, uint32_t blkno, off_t offset) {
+    assert(offset >= 0 && offset < SFS_BLKSIZE && offset + len <= SFS_BLKSIZE);
+    int ret;
+    lock_sfs_io(sfs);
+    {
+        if ((ret = sfs_rwblock_nolock(sfs, sfs->sfs_buffer, blkno, 0, 1)) == 0) {
+            memset(sfs->sfs_buffer + offset, 0, len);
+            ret = sfs_rwblock_nolock(sfs, sfs->sfs_buffer, blkno, 1, 1);
+        }
+    }
+    unlock_sfs_io(sfs);
+    sfs_ra_drop(sfs, blkno);
+    return ret;
+}
+
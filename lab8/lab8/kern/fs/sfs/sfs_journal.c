@@ -0,0 +1,496 @@
+#include <defs.h>
+#include <stdio.h>
+#include <string.h>
+#include <list.h>
+#include <kmalloc.h>
+#include <sem.h>
+#include <dev.h>
+#include <iobuf.h>
+#include <sfs.h>
+#include <error.h>
+#include <assert.h>
+
+/*
+ * SFS metadata journal. Metadata writes made through sfs_meta_wbuf don't go
+ * to their home blocks: they patch a copy of the block kept in the running
+ * transaction. An operation brackets its metadata updates with
+ * sfs_journal_start/sfs_journal_stop (a handle), so a transaction always holds
+ * whole operations.
+ *
+ * sfs_journal_commit writes every image of the running transaction into the
+ * journal region followed by a commit record, then checkpoints the images to
+ * their home blocks and marks the journal clean. All operations that joined
+ * the transaction, from any process, become durable with that one sequential
+ * journal write (group commit): a process whose transaction was committed by
+ * someone else while it waited on commit_sem returns at once.
+ *
+ * File data is not journaled; it is written in place before the transaction
+ * that makes it reachable commits.
+ */
+
+struct sfs_jblock {
+    uint32_t blkno;                     // home block of the image
+    void *data;                         // SFS_BLKSIZE bytes, the newest content of the block
+    list_entry_t link;                  // entry in sfs_journal.blocks
+};
+
+#define le2jblock(le, member)                       \
+    to_struct((le), struct sfs_jblock, member)
+
+struct sfs_journal {
+    uint32_t start;                     // descriptor block of the journal region
+    uint32_t maxblks;                   // max # of images in a transaction
+    uint32_t tid;                       // id of the running transaction
+    uint32_t commit_tid;                // id of the last committed transaction
+    uint32_t nblocks;                   // # of images in the running transaction
+    uint32_t credits;                   // # of images reserved by the handles of the running transaction
+    int handles;                        // # of handles not stopped yet
+    bool committing;                    // a commit is waiting for handles or writing the journal
+    list_entry_t blocks;                // images of the running transaction
+    semaphore_t j_sem;                  // protects the fields above and the images
+    semaphore_t commit_sem;             // serializes committers
+    semaphore_t drain_sem;              // upped by the last handle to stop while committing
+};
+
+static void
+lock_journal(struct sfs_journal *j) {
+    down(&(j->j_sem));
+}
+
+static void
+unlock_journal(struct sfs_journal *j) {
+    up(&(j->j_sem));
+}
+
+// sfs_journal_csum - fold len bytes of data into the checksum csum
+static uint32_t
+sfs_journal_csum(uint32_t csum, const void *data, size_t len) {
+    const uint32_t *p = data;
+    size_t i;
+    for (i = 0; i < len / sizeof(uint32_t); i ++) {
+        csum = ((csum << 5) | (csum >> 27)) ^ p[i];
+    }
+    return csum;
+}
+
+// sfs_journal_rwblock - read/write one block of dev directly, used at mount time before sfs_fs is set up
+static int
+sfs_journal_rwblock(struct device *dev, void *buf, uint32_t blkno, bool write) {
+    struct iobuf __iob, *iob = iobuf_init(&__iob, buf, SFS_BLKSIZE, blkno * SFS_BLKSIZE);
+    return dop_io(dev, iob, write);
+}
+
+// sfs_journal_maxblks - # of images a transaction in the journal of super may hold
+static uint32_t
+sfs_journal_maxblks(struct sfs_super *super) {
+    uint32_t n = super->journal_blocks - 2;
+    return (n < SFS_JDESC_NBLKS) ? n : SFS_JDESC_NBLKS;
+}
+
+/*
+ * sfs_journal_replay - called by sfs_do_mount before anything else is read: if the journal
+ *                      holds a committed transaction, copy its images to their home blocks,
+ *                      then mark the journal clean. The id of the last transaction is
+ *                      returned in *tid_store.
+ */
+int
+sfs_journal_replay(struct device *dev, struct sfs_super *super, uint32_t *tid_store) {
+    *tid_store = 0;
+    if (super->journal_blocks == 0) {
+        return 0;
+    }
+    if (super->journal_blocks < 3 || super->journal_start <= SFS_BLKN_FREEMAP
+        || super->journal_start + super->journal_blocks > super->blocks) {
+        cprintf("sfs: journal: bad region %u+%u.\n", super->journal_start, super->journal_blocks);
+        return -E_INVAL;
+    }
+
+    int ret = -E_NO_MEM;
+    struct sfs_journal_desc *desc;
+    void *buf;
+    if ((desc = kmalloc(SFS_BLKSIZE)) == NULL) {
+        goto out;
+    }
+    if ((buf = kmalloc(SFS_BLKSIZE)) == NULL) {
+        goto out_free_desc;
+    }
+
+    uint32_t start = super->journal_start, i;
+    if ((ret = sfs_journal_rwblock(dev, desc, start, 0)) != 0) {
+        goto out_free_buf;
+    }
+    if (desc->magic != SFS_JDESC_MAGIC || desc->nblocks == 0) {
+        *tid_store = (desc->magic == SFS_JDESC_MAGIC) ? desc->tid : 0;
+        ret = 0;
+        goto out_free_buf;
+    }
+    *tid_store = desc->tid;
+    if (desc->nblocks > sfs_journal_maxblks(super)) {
+        goto out_clean;
+    }
+
+    // the transaction counts only if its commit record made it to disk
+    struct sfs_journal_commit *commit = buf;
+    if ((ret = sfs_journal_rwblock(dev, buf, start + 1 + desc->nblocks, 0)) != 0) {
+        goto out_free_buf;
+    }
+    if (commit->magic != SFS_JCOMMIT_MAGIC || commit->tid != desc->tid) {
+        goto out_clean;
+    }
+    uint32_t checksum = commit->checksum, csum = 0;
+    for (i = 0; i < desc->nblocks; i ++) {
+        if ((ret = sfs_journal_rwblock(dev, buf, start + 1 + i, 0)) != 0) {
+            goto out_free_buf;
+        }
+        csum = sfs_journal_csum(csum, buf, SFS_BLKSIZE);
+    }
+    if (csum != checksum) {
+        goto out_clean;
+    }
+
+    for (i = 0; i < desc->nblocks; i ++) {
+        uint32_t blkno = desc->blkno[i];
+        if (blkno == 0 || blkno >= super->blocks) {
+            continue;
+        }
+        if ((ret = sfs_journal_rwblock(dev, buf, start + 1 + i, 0)) != 0
+            || (ret = sfs_journal_rwblock(dev, buf, blkno, 1)) != 0) {
+            goto out_free_buf;
+        }
+    }
+    cprintf("sfs: journal: replayed transaction %u (%u blocks).\n", desc->tid, desc->nblocks);
+
+out_clean:
+    desc->nblocks = 0;
+    ret = sfs_journal_rwblock(dev, desc, start, 1);
+out_free_buf:
+    kfree(buf);
+out_free_desc:
+    kfree(desc);
+out:
+    return ret;
+}
+
+/*
+ * sfs_journal_init - set up the in-memory journal of sfs, the next transaction gets tid + 1.
+ *                    A volume without journal region runs unjournaled.
+ */
+int
+sfs_journal_init(struct sfs_fs *sfs, uint32_t tid) {
+    struct sfs_journal *j;
+    sfs->journal = NULL;
+    if (sfs->super.journal_blocks == 0) {
+        return 0;
+    }
+    if (sfs_journal_maxblks(&(sfs->super)) < SFS_TRANS_CREDITS(sfs)) {
+        cprintf("sfs: journal: %u blocks is too small.\n", sfs->super.journal_blocks);
+        return -E_INVAL;
+    }
+    if ((j = kmalloc(sizeof(struct sfs_journal))) == NULL) {
+        return -E_NO_MEM;
+    }
+    j->start = sfs->super.journal_start;
+    j->maxblks = sfs_journal_maxblks(&(sfs->super));
+    j->commit_tid = tid, j->tid = tid + 1;
+    j->nblocks = j->credits = 0, j->handles = 0;
+    j->committing = 0;
+    list_init(&(j->blocks));
+    sem_init(&(j->j_sem), 1);
+    sem_init(&(j->commit_sem), 1);
+    sem_init(&(j->drain_sem), 0);
+    sfs->journal = j;
+    return 0;
+}
+
+// sfs_journal_free_nolock - drop the images of the running transaction
+static void
+sfs_journal_free_nolock(struct sfs_journal *j) {
+    list_entry_t *le;
+    while ((le = list_next(&(j->blocks))) != &(j->blocks)) {
+        struct sfs_jblock *jb = le2jblock(le, link);
+        list_del(le);
+        kfree(jb->data);
+        kfree(jb);
+    }
+    j->nblocks = 0;
+}
+
+/*
+ * sfs_journal_destroy - free the journal of sfs at unmount, after the last sync committed it
+ */
+void
+sfs_journal_destroy(struct sfs_fs *sfs) {
+    struct sfs_journal *j;
+    if ((j = sfs->journal) != NULL) {
+        assert(j->handles == 0 && j->nblocks == 0);
+        sfs_journal_free_nolock(j);
+        kfree(j);
+        sfs->journal = NULL;
+    }
+}
+
+/*
+ * sfs_journal_start - open a handle on the running transaction, reserving credits images in it.
+ *                     Commits first if the transaction is full. Never called with a handle
+ *                     open or with an inode locked, since it may wait for a commit.
+ */
+int
+sfs_journal_start(struct sfs_fs *sfs, int credits) {
+    struct sfs_journal *j;
+    if ((j = sfs->journal) == NULL) {
+        return 0;
+    }
+    assert(credits >= 0 && credits <= j->maxblks);
+    int ret;
+    lock_journal(j);
+    while (j->committing || j->credits + credits > j->maxblks) {
+        uint32_t tid = j->tid;
+        bool wait = j->committing;
+        unlock_journal(j);
+        if (wait) {
+            // let the commit in flight finish
+            down(&(j->commit_sem));
+            up(&(j->commit_sem));
+        }
+        else if ((ret = sfs_journal_commit(sfs, tid)) != 0) {
+            return ret;
+        }
+        lock_journal(j);
+    }
+    j->credits += credits, j->handles ++;
+    unlock_journal(j);
+    return 0;
+}
+
+/*
+ * sfs_journal_stop - close a handle, return the id of the transaction it joined (0 if unjournaled)
+ */
+uint32_t
+sfs_journal_stop(struct sfs_fs *sfs) {
+    struct sfs_journal *j;
+    if ((j = sfs->journal) == NULL) {
+        return 0;
+    }
+    uint32_t tid;
+    lock_journal(j);
+    {
+        assert(j->handles > 0);
+        tid = j->tid;
+        if (-- j->handles == 0 && j->committing) {
+            up(&(j->drain_sem));
+        }
+    }
+    unlock_journal(j);
+    return tid;
+}
+
+/*
+ * sfs_journal_write_nolock - write the running transaction into the journal, then checkpoint it
+ *                            to the home blocks and mark the journal clean
+ */
+static int
+sfs_journal_write_nolock(struct sfs_fs *sfs, struct sfs_journal *j) {
+    struct sfs_journal_desc *desc;
+    if ((desc = kmalloc(SFS_BLKSIZE)) == NULL) {
+        return -E_NO_MEM;
+    }
+    memset(desc, 0, SFS_BLKSIZE);
+    desc->magic = SFS_JDESC_MAGIC, desc->tid = j->tid, desc->nblocks = j->nblocks;
+
+    list_entry_t *list = &(j->blocks), *le = list;
+    uint32_t i = 0, csum = 0;
+    int ret;
+    while ((le = list_next(le)) != list) {
+        struct sfs_jblock *jb = le2jblock(le, link);
+        desc->blkno[i] = jb->blkno;
+        csum = sfs_journal_csum(csum, jb->data, SFS_BLKSIZE);
+        if ((ret = sfs_wblock(sfs, jb->data, j->start + 1 + i, 1)) != 0) {
+            goto out;
+        }
+        i ++;
+    }
+    assert(i == j->nblocks);
+
+    // the commit record follows the images; the descriptor goes last and validates both
+    struct sfs_journal_commit commit = {SFS_JCOMMIT_MAGIC, j->tid, csum};
+    if ((ret = sfs_wbuf(sfs, &commit, sizeof(commit), j->start + 1 + i, 0)) != 0) {
+        goto out;
+    }
+    if ((ret = sfs_wblock(sfs, desc, j->start, 1)) != 0) {
+        goto out;
+    }
+
+    // checkpoint; a crash from here on is repaired by replay at mount
+    le = list;
+    while ((le = list_next(le)) != list) {
+        struct sfs_jblock *jb = le2jblock(le, link);
+        if ((ret = sfs_wblock(sfs, jb->data, jb->blkno, 1)) != 0) {
+            goto out;
+        }
+    }
+    desc->nblocks = 0;
+    ret = sfs_wblock(sfs, desc, j->start, 1);
+out:
+    kfree(desc);
+    return ret;
+}
+
+/*
+ * sfs_journal_commit - make transaction tid durable. Returns at once if it has committed
+ *                      already, e.g. as part of a commit started by another process.
+ */
+int
+sfs_journal_commit(struct sfs_fs *sfs, uint32_t tid) {
+    struct sfs_journal *j;
+    if ((j = sfs->journal) == NULL) {
+        return 0;
+    }
+    int ret = 0;
+    down(&(j->commit_sem));
+    lock_journal(j);
+    if ((int32_t)(tid - j->commit_tid) <= 0) {
+        goto out_unlock;
+    }
+    assert(tid == j->tid);
+
+    // no new handle joins, wait for the open ones to finish their operations
+    j->committing = 1;
+    while (j->handles > 0) {
+        unlock_journal(j);
+        down(&(j->drain_sem));
+        lock_journal(j);
+    }
+    if (j->nblocks != 0 && (ret = sfs_journal_write_nolock(sfs, j)) != 0) {
+        warn("sfs: journal: commit %u failed: %e.\n", j->tid, ret);
+    }
+    else {
+        sfs_journal_free_nolock(j);
+        j->credits = 0;
+        j->commit_tid = j->tid ++;
+    }
+    j->committing = 0;
+
+out_unlock:
+    unlock_journal(j);
+    up(&(j->commit_sem));
+    return ret;
+}
+
+/*
+ * sfs_journal_flush - commit the running transaction
+ */
+int
+sfs_journal_flush(struct sfs_fs *sfs) {
+    struct sfs_journal *j;
+    if ((j = sfs->journal) == NULL) {
+        return 0;
+    }
+    uint32_t tid;
+    lock_journal(j);
+    tid = j->tid;
+    unlock_journal(j);
+    return sfs_journal_commit(sfs, tid);
+}
+
+// sfs_journal_find_nolock - find the image of blkno in the running transaction
+static struct sfs_jblock *
+sfs_journal_find_nolock(struct sfs_journal *j, uint32_t blkno) {
+    list_entry_t *list = &(j->blocks), *le = list;
+    while ((le = list_next(le)) != list) {
+        struct sfs_jblock *jb = le2jblock(le, link);
+        if (jb->blkno == blkno) {
+            return jb;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * sfs_journal_revoke - blkno was freed: drop its image so the checkpoint can't overwrite
+ *                      whatever the block is reused for
+ */
+void
+sfs_journal_revoke(struct sfs_fs *sfs, uint32_t blkno) {
+    struct sfs_journal *j;
+    struct sfs_jblock *jb;
+    if ((j = sfs->journal) == NULL) {
+        return;
+    }
+    lock_journal(j);
+    if ((jb = sfs_journal_find_nolock(j, blkno)) != NULL) {
+        list_del(&(jb->link));
+        j->nblocks --;
+    }
+    unlock_journal(j);
+    if (jb != NULL) {
+        kfree(jb->data);
+        kfree(jb);
+    }
+}
+
+/*
+ * sfs_meta_rbuf - read metadata: like sfs_rbuf, but sees the updates of the running transaction
+ */
+int
+sfs_meta_rbuf(struct sfs_fs *sfs, void *buf, size_t len, uint32_t blkno, off_t offset) {
+    struct sfs_journal *j;
+    struct sfs_jblock *jb;
+    if ((j = sfs->journal) == NULL) {
+        return sfs_rbuf(sfs, buf, len, blkno, offset);
+    }
+    assert(offset >= 0 && offset < SFS_BLKSIZE && offset + len <= SFS_BLKSIZE);
+    int ret = 0;
+    lock_journal(j);
+    if ((jb = sfs_journal_find_nolock(j, blkno)) != NULL) {
+        memcpy(buf, jb->data + offset, len);
+    }
+    else {
+        ret = sfs_rbuf(sfs, buf, len, blkno, offset);
+    }
+    unlock_journal(j);
+    return ret;
+}
+
+/*
+ * sfs_meta_wbuf - write metadata: like sfs_wbuf, but into the image of blkno in the running
+ *                 transaction. Must be called with a handle open.
+ */
+int
+sfs_meta_wbuf(struct sfs_fs *sfs, void *buf, size_t len, uint32_t blkno, off_t offset) {
+    struct sfs_journal *j;
+    struct sfs_jblock *jb;
+    if ((j = sfs->journal) == NULL) {
+        return sfs_wbuf(sfs, buf, len, blkno, offset);
+    }
+    assert(offset >= 0 && offset < SFS_BLKSIZE && offset + len <= SFS_BLKSIZE);
+    int ret = -E_NO_MEM;
+    lock_journal(j);
+    assert(j->handles > 0);
+    if ((jb = sfs_journal_find_nolock(j, blkno)) == NULL) {
+        assert(j->nblocks < j->maxblks);
+        if ((jb = kmalloc(sizeof(struct sfs_jblock))) == NULL) {
+            goto out_unlock;
+        }
+        if ((jb->data = kmalloc(SFS_BLKSIZE)) == NULL) {
+            goto failed_cleanup_jb;
+        }
+        if (len != SFS_BLKSIZE && (ret = sfs_rblock(sfs, jb->data, blkno, 1)) != 0) {
+            goto failed_cleanup_data;
+        }
+        jb->blkno = blkno;
+        list_add_before(&(j->blocks), &(jb->link));
+        j->nblocks ++;
+    }
+    memcpy(jb->data + offset, buf, len);
+    ret = 0;
+
+out_unlock:
+    unlock_journal(j);
+    return ret;
+
+failed_cleanup_data:
+    kfree(jb->data);
+failed_cleanup_jb:
+    kfree(jb);
+    goto out_unlock;
+}
@@ -16,7 +16,7 @@ lock_sfs_fs(struct sfs_fs *sfs) {
 /*
  * lock_sfs_io - lock the process of SFS File Rd/Wr Disk Block
  *
- * called by: sfs_rwblock, sfs_clear_block, sfs_sync_super
+ * called by: sfs_rbuf, sfs_wbuf, sfs_clear_block, sfs_sync_super
  */
 void
 lock_sfs_io(struct sfs_fs *sfs) {
@@ -36,9 +36,29 @@ unlock_sfs_fs(struct sfs_fs *sfs) {
 /*
  * unlock_sfs_io - unlock the process of sfs Rd/Wr Disk Block
  *
- * called by: sfs_rwblock sfs_clear_block sfs_sync_super
+ * called by: sfs_rbuf sfs_wbuf sfs_clear_block sfs_sync_super
  */
 void
 unlock_sfs_io(struct sfs_fs *sfs) {
     up(&(sfs->io_sem));
 }
+
+/*
+ * lock_sfs_freemap - lock the freemap for block allocation
+ *
+ * called by: sfs_block_alloc, sfs_block_free, sfs_sync_freemap
+ */
+void
+lock_sfs_freemap(struct sfs_fs *sfs) {
+    down(&(sfs->freemap_sem));
+}
+
+/*
+ * unlock_sfs_freemap - unlock the freemap for block allocation
+ *
+ * called by: sfs_block_alloc, sfs_block_free, sfs_sync_freemap
+ */
+void
+unlock_sfs_freemap(struct sfs_fs *sfs) {
+    up(&(sfs->freemap_sem));
+}
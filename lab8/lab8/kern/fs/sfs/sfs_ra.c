@@ -0,0 +1,230 @@
+#include <defs.h>
+#include <string.h>
+#include <list.h>
+#include <kmalloc.h>
+#include <sem.h>
+#include <vfs.h>
+#include <inode.h>
+#include <sfs.h>
+#include <error.h>
+#include <assert.h>
+
+/*
+ * SFS readahead cache. vop_readahead (sfs_readahead) only queues a request and kicks
+ * the flusher, which maps the file blocks and reads the ones not cached yet into the
+ * least recently used slots (sfs_ra_run). Reads of file data go through sfs_ra_rbuf and
+ * sfs_ra_rblock, which are served from the cache when they can and from disk otherwise.
+ *
+ * Only file data is cached. A cached block is dropped when it is written (sfs_wblock,
+ * sfs_wbuf) or freed, so the cache never holds anything stale.
+ *
+ * Lock order: the inode (in sfs_readahead_load), then racache->sem, then the io lock.
+ */
+
+struct sfs_ra_block {
+    uint32_t blkno;                                 // disk block held, 0 if the slot is empty
+    void *data;
+    list_entry_t lru_link;                          // entry in racache->lru
+};
+
+struct sfs_ra_req {
+    struct inode *node;                             // holds a reference until the request is run
+    uint32_t index, nblks;                          // file blocks to read ahead
+};
+
+struct sfs_racache {
+    semaphore_t sem;
+    struct sfs_ra_block blocks[SFS_RA_NBLKS];
+    list_entry_t lru;                               // slots in reuse order: empty or consumed, then oldest
+    struct sfs_ra_req reqs[SFS_RA_NREQS];
+    int req_head, req_count;
+};
+
+#define le2rablk(le)                                to_struct((le), struct sfs_ra_block, lru_link)
+
+int
+sfs_ra_init(struct sfs_fs *sfs) {
+    struct sfs_racache *racache;
+    if ((racache = kmalloc(sizeof(struct sfs_racache))) == NULL) {
+        return -E_NO_MEM;
+    }
+    sem_init(&(racache->sem), 1);
+    list_init(&(racache->lru));
+    int i;
+    for (i = 0; i < SFS_RA_NBLKS; i ++) {
+        struct sfs_ra_block *rablk = racache->blocks + i;
+        rablk->blkno = 0, rablk->data = NULL;
+        list_add_before(&(racache->lru), &(rablk->lru_link));
+    }
+    racache->req_head = racache->req_count = 0;
+    sfs->racache = racache;
+    return 0;
+}
+
+/* sfs_ra_destroy - free the cache, the requests have been run (sfs_ra_run) */
+void
+sfs_ra_destroy(struct sfs_fs *sfs) {
+    struct sfs_racache *racache = sfs->racache;
+    int i;
+    assert(racache->req_count == 0);
+    for (i = 0; i < SFS_RA_NBLKS; i ++) {
+        if (racache->blocks[i].data != NULL) {
+            kfree(racache->blocks[i].data);
+        }
+    }
+    kfree(racache);
+    sfs->racache = NULL;
+}
+
+// find the slot holding blkno, called with racache->sem held
+static struct sfs_ra_block *
+sfs_ra_lookup(struct sfs_racache *racache, uint32_t blkno) {
+    int i;
+    for (i = 0; i < SFS_RA_NBLKS; i ++) {
+        if (racache->blocks[i].blkno == blkno) {
+            return racache->blocks + i;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * sfs_ra_queue - ask for file blocks [index, index + nblks) of node to be read ahead.
+ *                The request is a hint: it is dropped if the queue is full.
+ */
+void
+sfs_ra_queue(struct sfs_fs *sfs, struct inode *node, uint32_t index, uint32_t nblks) {
+    struct sfs_racache *racache = sfs->racache;
+    bool queued = 0;
+    down(&(racache->sem));
+    {
+        if (racache->req_count < SFS_RA_NREQS) {
+            struct sfs_ra_req *req = racache->reqs + (racache->req_head + racache->req_count) % SFS_RA_NREQS;
+            vop_ref_inc(node);
+            req->node = node, req->index = index, req->nblks = nblks;
+            racache->req_count ++, queued = 1;
+        }
+    }
+    up(&(racache->sem));
+    if (queued) {
+        sfs_kick_flusher();
+    }
+}
+
+/* sfs_ra_run - run the queued requests, called by the flusher */
+void
+sfs_ra_run(struct sfs_fs *sfs) {
+    struct sfs_racache *racache = sfs->racache;
+    while (1) {
+        struct sfs_ra_req req = {NULL};
+        down(&(racache->sem));
+        {
+            if (racache->req_count > 0) {
+                req = racache->reqs[racache->req_head];
+                racache->req_head = (racache->req_head + 1) % SFS_RA_NREQS, racache->req_count --;
+            }
+        }
+        up(&(racache->sem));
+        if (req.node == NULL) {
+            break;
+        }
+        int ret;
+        if ((ret = sfs_readahead_load(sfs, req.node, req.index, req.nblks)) != 0) {
+            warn("sfs: readahead failed: %e.\n", ret);
+        }
+        vop_ref_dec(req.node);
+    }
+}
+
+/* sfs_ra_fill - read disk block blkno into the cache, unless it is there already */
+int
+sfs_ra_fill(struct sfs_fs *sfs, uint32_t blkno) {
+    struct sfs_racache *racache = sfs->racache;
+    int ret = 0;
+    down(&(racache->sem));
+    {
+        struct sfs_ra_block *rablk;
+        if ((rablk = sfs_ra_lookup(racache, blkno)) == NULL) {
+            rablk = le2rablk(list_next(&(racache->lru)));
+            rablk->blkno = 0;
+            if (rablk->data == NULL && (rablk->data = kmalloc(SFS_BLKSIZE)) == NULL) {
+                ret = -E_NO_MEM;
+                goto out;
+            }
+            if ((ret = sfs_rblock(sfs, rablk->data, blkno, 1)) != 0) {
+                goto out;
+            }
+            rablk->blkno = blkno;
+        }
+        list_del(&(rablk->lru_link));
+        list_add_before(&(racache->lru), &(rablk->lru_link));
+    }
+out:
+    up(&(racache->sem));
+    return ret;
+}
+
+/* sfs_ra_drop - forget blkno, which is being written or freed */
+void
+sfs_ra_drop(struct sfs_fs *sfs, uint32_t blkno) {
+    struct sfs_racache *racache = sfs->racache;
+    down(&(racache->sem));
+    {
+        struct sfs_ra_block *rablk;
+        if ((rablk = sfs_ra_lookup(racache, blkno)) != NULL) {
+            rablk->blkno = 0;
+            list_del(&(rablk->lru_link));
+            list_add_after(&(racache->lru), &(rablk->lru_link));
+        }
+    }
+    up(&(racache->sem));
+}
+
+/*
+ * sfs_ra_copy - copy len bytes at offset of blkno into buf if the block is cached.
+ *               A block is read once by a sequential reader, so it is reused first.
+ */
+static bool
+sfs_ra_copy(struct sfs_fs *sfs, void *buf, size_t len, uint32_t blkno, off_t offset) {
+    struct sfs_racache *racache = sfs->racache;
+    struct sfs_ra_block *rablk;
+    down(&(racache->sem));
+    {
+        if ((rablk = sfs_ra_lookup(racache, blkno)) != NULL) {
+            memcpy(buf, rablk->data + offset, len);
+            list_del(&(rablk->lru_link));
+            list_add_after(&(racache->lru), &(rablk->lru_link));
+        }
+    }
+    up(&(racache->sem));
+    return rablk != NULL;
+}
+
+/*
+ * sfs_ra_rbuf - sfs_rbuf, served from the readahead cache if blkno is there; the bytes
+ *               found in the cache are added to *cachedp
+ */
+int
+sfs_ra_rbuf(struct sfs_fs *sfs, void *buf, size_t len, uint32_t blkno, off_t offset, size_t *cachedp) {
+    if (sfs_ra_copy(sfs, buf, len, blkno, offset)) {
+        *cachedp += len;
+        return 0;
+    }
+    return sfs_rbuf(sfs, buf, len, blkno, offset);
+}
+
+/* sfs_ra_rblock - sfs_rblock, served from the readahead cache block by block, counted in *cachedp */
+int
+sfs_ra_rblock(struct sfs_fs *sfs, void *buf, uint32_t blkno, uint32_t nblks, size_t *cachedp) {
+    int ret;
+    for (; nblks != 0; blkno ++, nblks --, buf += SFS_BLKSIZE) {
+        if (sfs_ra_copy(sfs, buf, SFS_BLKSIZE, blkno, 0)) {
+            *cachedp += SFS_BLKSIZE;
+        }
+        else if ((ret = sfs_rblock(sfs, buf, blkno, 1)) != 0) {
+            return ret;
+        }
+    }
+    return 0;
+}
+
@@ -14,6 +14,7 @@
 #include <assert.h>
 
 #define IOBUF_SIZE                          4096
+#define IOVBUF_SIZE                         (4 * IOBUF_SIZE)
 
 /* copy_path - copy path name */
 static int
@@ -56,9 +57,12 @@ sysfile_close(int fd) {
     return file_close(fd);
 }
 
-/* sysfile_read - read file */
-int
-sysfile_read(int fd, void *base, size_t len) {
+/*
+ * sysfile_rdio - read len bytes into user base, at *posp (advanced by the amount read) if
+ *                posp is not NULL, otherwise at the file position
+ */
+static int
+sysfile_rdio(int fd, void *base, size_t len, off_t *posp) {
     struct mm_struct *mm = current->mm;
     if (len == 0) {
         return 0;
@@ -72,12 +76,18 @@ sysfile_read(int fd, void *base, size_t len) {
     }
 
     int ret = 0;
-    size_t copied = 0, alen;
+    size_t copied = 0, alen, blen;
     while (len != 0) {
-        if ((alen = IOBUF_SIZE) > len) {
-            alen = len;
+        if ((blen = IOBUF_SIZE) > len) {
+            blen = len;
+        }
+        if (posp != NULL) {
+            ret = file_pread(fd, buffer, blen, *posp, &alen);
+            *posp += alen;
+        }
+        else {
+            ret = file_read(fd, buffer, blen, &alen);
         }
-        ret = file_read(fd, buffer, alen, &alen);
         if (alen != 0) {
             lock_mm(mm);
             {
@@ -91,7 +101,8 @@ sysfile_read(int fd, void *base, size_t len) {
             }
             unlock_mm(mm);
         }
-        if (ret != 0 || alen == 0) {
+        // a short read is EOF, or a pipe/device that has nothing more for now
+        if (ret != 0 || alen < blen) {
             goto out;
         }
     }
@@ -104,9 +115,12 @@ out:
     return ret;
 }
 
-/* sysfile_write - write file */
-int
-sysfile_write(int fd, void *base, size_t len) {
+/*
+ * sysfile_wrio - write len bytes from user base, at *posp (advanced by the amount written) if
+ *                posp is not NULL, otherwise at the file position
+ */
+static int
+sysfile_wrio(int fd, void *base, size_t len, off_t *posp) {
     struct mm_struct *mm = current->mm;
     if (len == 0) {
         return 0;
@@ -133,7 +147,13 @@ sysfile_write(int fd, void *base, size_t len) {
         }
         unlock_mm(mm);
         if (ret == 0) {
-            ret = file_write(fd, buffer, alen, &alen);
+            if (posp != NULL) {
+                ret = file_pwrite(fd, buffer, alen, *posp, &alen);
+                *posp += alen;
+            }
+            else {
+                ret = file_write(fd, buffer, alen, &alen);
+            }
             if (alen != 0) {
                 assert(len >= alen);
                 base += alen, len -= alen, copied += alen;
@@ -152,6 +172,156 @@ out:
     return ret;
 }
 
+/* sysfile_read - read file */
+int
+sysfile_read(int fd, void *base, size_t len) {
+    return sysfile_rdio(fd, base, len, NULL);
+}
+
+/* sysfile_write - write file */
+int
+sysfile_write(int fd, void *base, size_t len) {
+    return sysfile_wrio(fd, base, len, NULL);
+}
+
+/* sysfile_pread - read file at pos without moving the file position */
+int
+sysfile_pread(int fd, void *base, size_t len, off_t pos) {
+    if (pos < 0) {
+        return -E_INVAL;
+    }
+    return sysfile_rdio(fd, base, len, &pos);
+}
+
+/* sysfile_pwrite - write file at pos without moving the file position */
+int
+sysfile_pwrite(int fd, void *base, size_t len, off_t pos) {
+    if (pos < 0) {
+        return -E_INVAL;
+    }
+    return sysfile_wrio(fd, base, len, &pos);
+}
+
+/*
+ * copy_iov - copy in the user iovec array and check that every segment is user memory
+ *            (writable, for readv). *len_store gets the total length.
+ */
+static int
+copy_iov(struct mm_struct *mm, struct iovec *iov, const struct iovec *uiov, int iovcnt,
+         bool writable, size_t *len_store) {
+    int i, ret = 0;
+    size_t len = 0;
+    lock_mm(mm);
+    {
+        if (!copy_from_user(mm, iov, uiov, sizeof(struct iovec) * iovcnt, 0)) {
+            ret = -E_INVAL;
+        }
+        for (i = 0; ret == 0 && i < iovcnt; i ++) {
+            if (len + iov[i].iov_len < len) {
+                ret = -E_INVAL;
+            }
+            else if (iov[i].iov_len != 0 &&
+                     !user_mem_check(mm, (uintptr_t)iov[i].iov_base, iov[i].iov_len, writable)) {
+                ret = -E_INVAL;
+            }
+            len += iov[i].iov_len;
+        }
+    }
+    unlock_mm(mm);
+    *len_store = len;
+    return ret;
+}
+
+/*
+ * sysfile_readv - read into iovcnt user segments in order. The segments are filled from one
+ *                 kernel buffer, so a record of up to IOVBUF_SIZE bytes costs one file_read.
+ */
+int
+sysfile_readv(int fd, const struct iovec *uiov, int iovcnt) {
+    struct mm_struct *mm = current->mm;
+    if (iovcnt <= 0 || iovcnt > IOV_MAX || !file_testfd(fd, 1, 0)) {
+        return -E_INVAL;
+    }
+    struct iovec iov[IOV_MAX];
+    size_t len;
+    int ret;
+    if ((ret = copy_iov(mm, iov, uiov, iovcnt, 1, &len)) != 0 || len == 0) {
+        return ret;
+    }
+    size_t bsize = (len < IOVBUF_SIZE) ? len : IOVBUF_SIZE;
+    void *buffer;
+    if ((buffer = kmalloc(bsize)) == NULL) {
+        return -E_NO_MEM;
+    }
+
+    struct iobuf __iob, *iob = iobuf_init_iov(&__iob, iov, iovcnt, 0);
+    size_t alen, blen;
+    while (iob->io_resid != 0) {
+        if ((blen = bsize) > iob->io_resid) {
+            blen = iob->io_resid;
+        }
+        ret = file_read(fd, buffer, blen, &alen);
+        if (alen != 0) {
+            lock_mm(mm);
+            {
+                iobuf_move(iob, buffer, alen, 1, NULL);
+            }
+            unlock_mm(mm);
+        }
+        if (ret != 0 || alen < blen) {
+            break;
+        }
+    }
+    kfree(buffer);
+    if (iobuf_used(iob) != 0) {
+        return iobuf_used(iob);
+    }
+    return ret;
+}
+
+/*
+ * sysfile_writev - write iovcnt user segments in order. The segments are gathered into one
+ *                  kernel buffer, so a record of up to IOVBUF_SIZE bytes costs one file_write.
+ */
+int
+sysfile_writev(int fd, const struct iovec *uiov, int iovcnt) {
+    struct mm_struct *mm = current->mm;
+    if (iovcnt <= 0 || iovcnt > IOV_MAX || !file_testfd(fd, 0, 1)) {
+        return -E_INVAL;
+    }
+    struct iovec iov[IOV_MAX];
+    size_t len;
+    int ret;
+    if ((ret = copy_iov(mm, iov, uiov, iovcnt, 0, &len)) != 0 || len == 0) {
+        return ret;
+    }
+    size_t bsize = (len < IOVBUF_SIZE) ? len : IOVBUF_SIZE;
+    void *buffer;
+    if ((buffer = kmalloc(bsize)) == NULL) {
+        return -E_NO_MEM;
+    }
+
+    struct iobuf __iob, *iob = iobuf_init_iov(&__iob, iov, iovcnt, 0);
+    size_t copied = 0, alen, blen;
+    while (iob->io_resid != 0) {
+        lock_mm(mm);
+        {
+            iobuf_move(iob, buffer, bsize, 0, &blen);
+        }
+        unlock_mm(mm);
+        ret = file_write(fd, buffer, blen, &alen);
+        copied += alen;
+        if (ret != 0 || alen < blen) {
+            break;
+        }
+    }
+    kfree(buffer);
+    if (copied != 0) {
+        return copied;
+    }
+    return ret;
+}
+
 /* sysfile_seek - seek file */
 int
 sysfile_seek(int fd, off_t pos, int whence) {
@@ -178,6 +348,26 @@ sysfile_fstat(int fd, struct stat *__stat) {
     return ret;
 }
 
+/* sysfile_rastat - get the readahead counters of an open file */
+int
+sysfile_rastat(int fd, struct rastat *__stat) {
+    struct mm_struct *mm = current->mm;
+    int ret;
+    struct rastat __local_stat, *stat = &__local_stat;
+    if ((ret = file_rastat(fd, stat)) != 0) {
+        return ret;
+    }
+
+    lock_mm(mm);
+    {
+        if (!copy_to_user(mm, __stat, stat, sizeof(struct rastat))) {
+            ret = -E_INVAL;
+        }
+    }
+    unlock_mm(mm);
+    return ret;
+}
+
 /* sysfile_fsync - sync file */
 int
 sysfile_fsync(int fd) {
@@ -231,6 +421,19 @@ sysfile_rename(const char *__path1, const char *__path2) {
     return ret;
 }
 
+/* sysfile_mkdir - create directory */
+int
+sysfile_mkdir(const char *__path) {
+    int ret;
+    char *path;
+    if ((ret = copy_path(&path, __path)) != 0) {
+        return ret;
+    }
+    ret = vfs_mkdir(path);
+    kfree(path);
+    return ret;
+}
+
 /* sysfile_unlink - unlink file */
 int
 sysfile_unlink(const char *__path) {
@@ -244,6 +447,19 @@ sysfile_unlink(const char *__path) {
     return ret;
 }
 
+/* sysfile_rmdir - remove empty directory */
+int
+sysfile_rmdir(const char *__path) {
+    int ret;
+    char *path;
+    if ((ret = copy_path(&path, __path)) != 0) {
+        return ret;
+    }
+    ret = vfs_rmdir(path);
+    kfree(path);
+    return ret;
+}
+
 /* sysfile_get cwd - get current working directory */
 int
 sysfile_getcwd(char *buf, size_t len) {
@@ -299,19 +515,98 @@ out:
     return ret;
 }
 
+/*
+ * sysfile_getdents - fill base with the packed entries of DIR fd that fit in len bytes,
+ *                    from the position of fd on; return the # of bytes filled, 0 at the end
+ */
+int
+sysfile_getdents(int fd, void *base, size_t len) {
+    struct mm_struct *mm = current->mm;
+    if (len == 0) {
+        return -E_INVAL;
+    }
+    if (len > IOBUF_SIZE) {
+        len = IOBUF_SIZE;
+    }
+    void *buffer;
+    if ((buffer = kmalloc(len)) == NULL) {
+        return -E_NO_MEM;
+    }
+
+    int ret;
+    size_t copied;
+    if ((ret = file_getdents(fd, buffer, len, &copied)) == 0 && copied != 0) {
+        lock_mm(mm);
+        {
+            if (!copy_to_user(mm, base, buffer, copied)) {
+                ret = -E_INVAL;
+            }
+        }
+        unlock_mm(mm);
+    }
+    kfree(buffer);
+    return (ret == 0) ? copied : ret;
+}
+
 /* sysfile_dup -  duplicate fd1 to fd2 */
 int
 sysfile_dup(int fd1, int fd2) {
     return file_dup(fd1, fd2);
 }
 
+/* sysfile_pipe - create a pipe, its read and write fds are stored in fd_store[0] and fd_store[1] */
 int
 sysfile_pipe(int *fd_store) {
-    return -E_UNIMP;
+    struct mm_struct *mm = current->mm;
+    int ret, fd[2];
+    if ((ret = file_pipe(fd)) != 0) {
+        return ret;
+    }
+    lock_mm(mm);
+    {
+        if (!copy_to_user(mm, fd_store, fd, sizeof(fd))) {
+            ret = -E_INVAL;
+        }
+    }
+    unlock_mm(mm);
+    if (ret != 0) {
+        file_close(fd[0]), file_close(fd[1]);
+    }
+    return ret;
 }
 
+/* sysfile_mkfifo - open one end of a named pipe, creating it if needed */
 int
 sysfile_mkfifo(const char *__name, uint32_t open_flags) {
-    return -E_UNIMP;
+    int ret;
+    char *name;
+    if ((ret = copy_path(&name, __name)) != 0) {
+        return ret;
+    }
+    ret = file_mkfifo(name, open_flags);
+    kfree(name);
+    return ret;
+}
+
+/* sysfile_sendfile - copy len bytes from in_fd to out_fd inside the kernel */
+int
+sysfile_sendfile(int out_fd, int in_fd, size_t len) {
+    size_t copied;
+    int ret = file_sendfile(out_fd, in_fd, len, &copied);
+    if (copied != 0) {
+        return copied;
+    }
+    return ret;
+}
+
+/* sysfile_splice - move len bytes between a pipe and another file inside the kernel */
+int
+sysfile_splice(int in_fd, int out_fd, size_t len) {
+    size_t copied;
+    int ret = file_splice(in_fd, out_fd, len, &copied);
+    if (copied != 0) {
+        return copied;
+    }
+    return ret;
 }
 
@@ -5,24 +5,35 @@
 
 struct stat;
 struct dirent;
+struct iovec;
+struct rastat;
 
 int sysfile_open(const char *path, uint32_t open_flags);        // Open or create a file. FLAGS/MODE per the syscall.
 int sysfile_close(int fd);                                      // Close a vnode opened  
 int sysfile_read(int fd, void *base, size_t len);               // Read file
 int sysfile_write(int fd, void *base, size_t len);              // Write file
+int sysfile_pread(int fd, void *base, size_t len, off_t pos);   // Read file at pos
+int sysfile_pwrite(int fd, void *base, size_t len, off_t pos);  // Write file at pos
+int sysfile_readv(int fd, const struct iovec *iov, int iovcnt); // Read file into segments
+int sysfile_writev(int fd, const struct iovec *iov, int iovcnt);// Write file from segments
 int sysfile_seek(int fd, off_t pos, int whence);                // Seek file  
 int sysfile_fstat(int fd, struct stat *stat);                   // Stat file 
 int sysfile_fsync(int fd);                                      // Sync file
+int sysfile_rastat(int fd, struct rastat *stat);                // Readahead counters of file
 int sysfile_chdir(const char *path);                            // change DIR  
 int sysfile_mkdir(const char *path);                            // create DIR
 int sysfile_link(const char *path1, const char *path2);         // set a path1's link as path2
 int sysfile_rename(const char *path1, const char *path2);       // rename file
 int sysfile_unlink(const char *path);                           // unlink a path
+int sysfile_rmdir(const char *path);                            // remove empty DIR
 int sysfile_getcwd(char *buf, size_t len);                      // get current working directory
 int sysfile_getdirentry(int fd, struct dirent *direntp);        // get the file entry in DIR 
+int sysfile_getdents(int fd, void *base, size_t len);           // get many file entries in DIR
 int sysfile_dup(int fd1, int fd2);                              // duplicate file
 int sysfile_pipe(int *fd_store);                                // build PIPE   
 int sysfile_mkfifo(const char *name, uint32_t open_flags);      // build named PIPE
+int sysfile_sendfile(int out_fd, int in_fd, size_t len);        // copy between files in kernel
+int sysfile_splice(int in_fd, int out_fd, size_t len);          // move between a pipe and a file
 
 #endif /* !__KERN_FS_SYSFILE_H__ */
 
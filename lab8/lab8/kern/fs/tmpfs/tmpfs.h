@@ -0,0 +1,69 @@
+#ifndef __KERN_FS_TMPFS_TMPFS_H__
+#define __KERN_FS_TMPFS_TMPFS_H__
+
+#include <defs.h>
+#include <mmu.h>
+#include <list.h>
+#include <sem.h>
+#include <unistd.h>
+
+/*
+ * tmpfs keeps everything in memory: file data in pages allocated on first
+ * write (pages never written are holes and read as zeros), and directories
+ * as lists of entries. Nothing survives a reboot.
+ */
+
+#define TMPFS_MAX_PAGES                             2048                    /* max # of data pages, 8M */
+#define TMPFS_MAX_FILE_SIZE                         (TMPFS_MAX_PAGES * PGSIZE)
+#define TMPFS_MAX_FNAME_LEN                         FS_MAX_FNAME_LEN
+
+/* file types */
+#define TMPFS_TYPE_FILE                             1
+#define TMPFS_TYPE_DIR                              2
+
+struct fs;
+struct inode;
+struct Page;
+
+/* entry of a tmpfs directory; it holds a reference on its inode */
+struct tmpfs_dirent {
+    struct inode *node;                             /* inode the name refers to */
+    off_t pos;                                      /* position of the entry in the directory */
+    list_entry_t dirent_link;                       /* entry in the directory's dirent_list */
+    char name[0];                                   /* '\0' terminated name */
+};
+
+#define le2tdirent(le, member)                      \
+    to_struct((le), struct tmpfs_dirent, member)
+
+/* inode for tmpfs */
+struct tmpfs_inode {
+    uint32_t ino;                                   /* inode number, unique in this tmpfs */
+    uint16_t type;                                  /* one of TMPFS_TYPE_* above */
+    uint16_t nlinks;                                /* # of names referring to it */
+    off_t size;                                     /* size of the file (in bytes) */
+    struct Page **pages;                            /* data pages of a file, NULL for a hole */
+    uint32_t npages;                                /* # of slots in pages */
+    list_entry_t dirent_list;                       /* entries of a directory */
+    uint32_t nentries;                              /* # of entries in dirent_list */
+    off_t dir_pos;                                  /* position for the next entry added */
+    struct inode *parent;                           /* directory holding a directory, not referenced */
+    semaphore_t sem;                                /* semaphore for file data */
+};
+
+/* filesystem for tmpfs */
+struct tmpfs_fs {
+    struct inode *root;                             /* root directory, always referenced */
+    uint32_t next_ino;                              /* inode number for the next inode */
+    size_t nr_pages;                                /* # of data pages in use */
+    size_t max_pages;                               /* limit of nr_pages */
+    semaphore_t ns_sem;                             /* semaphore for the namespace (all directories) */
+};
+
+void tmpfs_init(void);
+int tmpfs_mount(const char *devname);
+
+int tmpfs_new_inode(struct fs *fs, uint16_t type, struct inode **node_store);
+
+#endif /* !__KERN_FS_TMPFS_TMPFS_H__ */
+
@@ -0,0 +1,100 @@
+#include <defs.h>
+#include <string.h>
+#include <kmalloc.h>
+#include <sem.h>
+#include <vfs.h>
+#include <inode.h>
+#include <tmpfs.h>
+#include <error.h>
+#include <assert.h>
+
+/*
+ * tmpfs_sync - nothing to flush, file data lives in memory only
+ */
+static int
+tmpfs_sync(struct fs *fs) {
+    return 0;
+}
+
+/*
+ * tmpfs_get_root - get the root directory inode
+ */
+static struct inode *
+tmpfs_get_root(struct fs *fs) {
+    struct tmpfs_fs *tfs = fsop_info(fs, tmpfs);
+    vop_ref_inc(tfs->root);
+    return tfs->root;
+}
+
+/*
+ * tmpfs_unmount - tmpfs is added with vfs_add_fs and stays until shutdown
+ */
+static int
+tmpfs_unmount(struct fs *fs) {
+    return -E_BUSY;
+}
+
+/*
+ * tmpfs_cleanup - nothing to write back at shutdown
+ */
+static void
+tmpfs_cleanup(struct fs *fs) {
+}
+
+/*
+ * tmpfs_mount - create an empty tmpfs and add it to the vfs under DEVNAME
+ */
+int
+tmpfs_mount(const char *devname) {
+    struct fs *fs;
+    if ((fs = alloc_fs(tmpfs)) == NULL) {
+        return -E_NO_MEM;
+    }
+    struct tmpfs_fs *tfs = fsop_info(fs, tmpfs);
+    tfs->next_ino = 1;
+    tfs->nr_pages = 0;
+    tfs->max_pages = TMPFS_MAX_PAGES;
+    sem_init(&(tfs->ns_sem), 1);
+
+    fs->fs_sync = tmpfs_sync;
+    fs->fs_get_root = tmpfs_get_root;
+    fs->fs_unmount = tmpfs_unmount;
+    fs->fs_cleanup = tmpfs_cleanup;
+
+    int ret;
+    struct inode *root;
+    if ((ret = tmpfs_new_inode(fs, TMPFS_TYPE_DIR, &root)) != 0) {
+        goto failed_cleanup_fs;
+    }
+    // the root directory is its own parent, and tfs->root keeps it referenced
+    struct tmpfs_inode *tin = vop_info(root, tmpfs_inode);
+    tin->nlinks = 1, tin->parent = root;
+    tfs->root = root;
+
+    if ((ret = vfs_add_fs(devname, fs)) != 0) {
+        goto failed_cleanup_root;
+    }
+    return 0;
+
+failed_cleanup_root:
+    tin->nlinks = 0;
+    vop_ref_dec(root);
+failed_cleanup_fs:
+    kfree(fs);
+    return ret;
+}
+
+/*
+ * tmpfs_init - add a tmpfs named "tmp", so "tmp:name" is a scratch file in memory
+ *
+ * CALL GRAPH:
+ *   kern_init-->fs_init-->tmpfs_init
+ */
+void
+tmpfs_init(void) {
+    int ret;
+    if ((ret = tmpfs_mount("tmp")) != 0) {
+        panic("failed: tmpfs: tmpfs_mount: %e.\n", ret);
+    }
+}
+
@@ -0,0 +1,931 @@
+#include <defs.h>
+#include <string.h>
+#include <stdio.h>
+#include <list.h>
+#include <kmalloc.h>
+#include <pmm.h>
+#include <sem.h>
+#include <sync.h>
+#include <vfs.h>
+#include <inode.h>
+#include <iobuf.h>
+#include <stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <tmpfs.h>
+#include <error.h>
+#include <assert.h>
+
+/*
+ * tmpfs inodes. A directory entry holds a reference on its inode, so a linked
+ * inode is never reclaimed; once its last name is gone and the last user drops
+ * it, vop_reclaim frees its pages. The root is kept referenced by tmpfs_fs.
+ *
+ * ns_sem of the fs serializes all changes to directories (entries, nlinks and
+ * parent), so rename needs no lock ordering between two directories. The sem
+ * of a file guards its size and pages.
+ *
+ * Positions in a directory: 0 is ".", 1 is "..", and each entry gets the next
+ * value of dir_pos when it is added, so the list is sorted by position and a
+ * reader keeps its place while other entries come and go.
+ */
+
+static const struct inode_ops tmpfs_node_dirops;
+static const struct inode_ops tmpfs_node_fileops;
+
+#define TMPFS_DIRPOS_FIRST                          2
+
+/*
+ * tmpfs_new_inode - alloc a tmpfs inode of TYPE, not linked anywhere yet
+ */
+int
+tmpfs_new_inode(struct fs *fs, uint16_t type, struct inode **node_store) {
+    struct inode *node;
+    if ((node = alloc_inode(tmpfs_inode)) == NULL) {
+        return -E_NO_MEM;
+    }
+    struct tmpfs_fs *tfs = fsop_info(fs, tmpfs);
+    struct tmpfs_inode *tin = vop_info(node, tmpfs_inode);
+    tin->ino = tfs->next_ino ++;
+    tin->type = type, tin->nlinks = 0;
+    tin->size = 0;
+    tin->pages = NULL, tin->npages = 0;
+    list_init(&(tin->dirent_list));
+    tin->nentries = 0, tin->dir_pos = TMPFS_DIRPOS_FIRST;
+    tin->parent = NULL;
+    sem_init(&(tin->sem), 1);
+    vop_init(node, (type == TMPFS_TYPE_DIR) ? &tmpfs_node_dirops : &tmpfs_node_fileops, fs);
+    *node_store = node;
+    return 0;
+}
+
+/* tmpfs_page_alloc - get a zeroed data page, if the fs is below its limit */
+static struct Page *
+tmpfs_page_alloc(struct tmpfs_fs *tfs) {
+    bool intr_flag, ok;
+    local_intr_save(intr_flag);
+    {
+        if ((ok = (tfs->nr_pages < tfs->max_pages))) {
+            tfs->nr_pages ++;
+        }
+    }
+    local_intr_restore(intr_flag);
+
+    struct Page *page = NULL;
+    if (ok && (page = alloc_page()) == NULL) {
+        local_intr_save(intr_flag);
+        tfs->nr_pages --;
+        local_intr_restore(intr_flag);
+    }
+    if (page != NULL) {
+        memset(page2kva(page), 0, PGSIZE);
+    }
+    return page;
+}
+
+static void
+tmpfs_page_free(struct tmpfs_fs *tfs, struct Page *page) {
+    bool intr_flag;
+    free_page(page);
+    local_intr_save(intr_flag);
+    tfs->nr_pages --;
+    local_intr_restore(intr_flag);
+}
+
+/*
+ * tmpfs_pages_expand_nolock - make room for at least NR page slots in the file,
+ *                             doubling the slot array so appends stay cheap
+ */
+static int
+tmpfs_pages_expand_nolock(struct tmpfs_inode *tin, uint32_t nr) {
+    if (nr <= tin->npages) {
+        return 0;
+    }
+    uint32_t npages = (tin->npages != 0) ? tin->npages : 8;
+    while (npages < nr) {
+        npages *= 2;
+    }
+    struct Page **pages;
+    if ((pages = kmalloc(npages * sizeof(struct Page *))) == NULL) {
+        return -E_NO_MEM;
+    }
+    memset(pages, 0, npages * sizeof(struct Page *));
+    if (tin->pages != NULL) {
+        memcpy(pages, tin->pages, tin->npages * sizeof(struct Page *));
+        kfree(tin->pages);
+    }
+    tin->pages = pages, tin->npages = npages;
+    return 0;
+}
+
+/*
+ * tmpfs_pages_trunc_nolock - free the pages past LEN bytes, and zero the tail of the
+ *                            page LEN ends in, so a later extension reads zeros
+ */
+static void
+tmpfs_pages_trunc_nolock(struct tmpfs_fs *tfs, struct tmpfs_inode *tin, off_t len) {
+    uint32_t index = ROUNDUP(len, PGSIZE) / PGSIZE;
+    for (; index < tin->npages; index ++) {
+        if (tin->pages[index] != NULL) {
+            tmpfs_page_free(tfs, tin->pages[index]);
+            tin->pages[index] = NULL;
+        }
+    }
+    size_t off = len % PGSIZE;
+    if (off != 0 && len / PGSIZE < tin->npages) {
+        struct Page *page = tin->pages[len / PGSIZE];
+        if (page != NULL) {
+            memset(page2kva(page) + off, 0, PGSIZE - off);
+        }
+    }
+    if (len == 0 && tin->pages != NULL) {
+        kfree(tin->pages);
+        tin->pages = NULL, tin->npages = 0;
+    }
+}
+
+/* tmpfs_dirent_alloc - alloc an entry named NAME, not in any directory yet */
+static struct tmpfs_dirent *
+tmpfs_dirent_alloc(const char *name) {
+    size_t len = strlen(name);
+    struct tmpfs_dirent *de;
+    if ((de = kmalloc(sizeof(struct tmpfs_dirent) + len + 1)) != NULL) {
+        de->node = NULL;
+        memcpy(de->name, name, len + 1);
+    }
+    return de;
+}
+
+/* tmpfs_dirent_link_nolock - add DE for NODE at the end of DIR; the caller gives DE a reference */
+static void
+tmpfs_dirent_link_nolock(struct tmpfs_inode *din, struct tmpfs_dirent *de, struct inode *node) {
+    de->node = node;
+    de->pos = din->dir_pos ++;
+    list_add_before(&(din->dirent_list), &(de->dirent_link));
+    din->nentries ++;
+}
+
+/* tmpfs_dirent_unlink_nolock - take DE out of DIR; the caller frees DE and drops its reference */
+static void
+tmpfs_dirent_unlink_nolock(struct tmpfs_inode *din, struct tmpfs_dirent *de) {
+    list_del(&(de->dirent_link));
+    din->nentries --;
+}
+
+/* tmpfs_dirent_find_nolock - find the entry named NAME in DIR */
+static struct tmpfs_dirent *
+tmpfs_dirent_find_nolock(struct tmpfs_inode *din, const char *name) {
+    list_entry_t *list = &(din->dirent_list), *le = list;
+    while ((le = list_next(le)) != list) {
+        struct tmpfs_dirent *de = le2tdirent(le, dirent_link);
+        if (strcmp(de->name, name) == 0) {
+            return de;
+        }
+    }
+    return NULL;
+}
+
+/* tmpfs_dirent_findnode_nolock - find an entry referring to NODE in DIR */
+static struct tmpfs_dirent *
+tmpfs_dirent_findnode_nolock(struct tmpfs_inode *din, struct inode *node) {
+    list_entry_t *list = &(din->dirent_list), *le = list;
+    while ((le = list_next(le)) != list) {
+        struct tmpfs_dirent *de = le2tdirent(le, dirent_link);
+        if (de->node == node) {
+            return de;
+        }
+    }
+    return NULL;
+}
+
+/* tmpfs_dirent_seek_nolock - find the first entry of DIR at or after position POS */
+static struct tmpfs_dirent *
+tmpfs_dirent_seek_nolock(struct tmpfs_inode *din, off_t pos) {
+    list_entry_t *list = &(din->dirent_list), *le = list;
+    while ((le = list_next(le)) != list) {
+        struct tmpfs_dirent *de = le2tdirent(le, dirent_link);
+        if (de->pos >= pos) {
+            return de;
+        }
+    }
+    return NULL;
+}
+
+/* tmpfs_dirent_next_nolock - the entry after DE in DIR */
+static struct tmpfs_dirent *
+tmpfs_dirent_next_nolock(struct tmpfs_inode *din, struct tmpfs_dirent *de) {
+    list_entry_t *le = list_next(&(de->dirent_link));
+    return (le != &(din->dirent_list)) ? le2tdirent(le, dirent_link) : NULL;
+}
+
+/* tmpfs_dirent_dropped_nolock - NODE lost the name it had in a directory */
+static void
+tmpfs_dirent_dropped_nolock(struct inode *node) {
+    struct tmpfs_inode *tin = vop_info(node, tmpfs_inode);
+    assert(tin->nlinks > 0);
+    if (tin->type == TMPFS_TYPE_DIR) {
+        // a directory has one name; once it is removed, ".." leads nowhere
+        tin->nlinks = 0, tin->parent = NULL;
+    }
+    else {
+        tin->nlinks --;
+    }
+}
+
+/*
+ * tmpfs_check_name - a name a new entry may get: not empty, "." or "..", and short enough
+ */
+static int
+tmpfs_check_name(const char *name) {
+    if (*name == '\0' || strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+        return -E_INVAL;
+    }
+    if (strlen(name) > TMPFS_MAX_FNAME_LEN) {
+        return -E_TOO_BIG;
+    }
+    return 0;
+}
+
+// tmpfs_opendir - check the open flags for a directory, it can only be read
+static int
+tmpfs_opendir(struct inode *node, uint32_t open_flags) {
+    switch (open_flags & O_ACCMODE) {
+    case O_RDONLY:
+        break;
+    case O_WRONLY:
+    case O_RDWR:
+    default:
+        return -E_ISDIR;
+    }
+    if (open_flags & O_APPEND) {
+        return -E_ISDIR;
+    }
+    return 0;
+}
+
+// tmpfs_openfile - open file (no use)
+static int
+tmpfs_openfile(struct inode *node, uint32_t open_flags) {
+    return 0;
+}
+
+// tmpfs_close - close file, nothing to write back
+static int
+tmpfs_close(struct inode *node) {
+    return 0;
+}
+
+/*
+ * tmpfs_read - copy file data at iob->io_offset into iob, stopping at the end of file;
+ *              a hole reads as zeros
+ */
+static int
+tmpfs_read(struct inode *node, struct iobuf *iob) {
+    struct tmpfs_inode *tin = vop_info(node, tmpfs_inode);
+    off_t pos = iob->io_offset;
+    if (pos < 0) {
+        return -E_INVAL;
+    }
+    down(&(tin->sem));
+    while (iob->io_resid > 0 && pos < tin->size) {
+        uint32_t index = pos / PGSIZE;
+        size_t off = pos % PGSIZE, alen = PGSIZE - off;
+        if (alen > tin->size - pos) {
+            alen = tin->size - pos;
+        }
+        if (alen > iob->io_resid) {
+            alen = iob->io_resid;
+        }
+        struct Page *page = (index < tin->npages) ? tin->pages[index] : NULL;
+        if (page != NULL) {
+            iobuf_move(iob, page2kva(page) + off, alen, 1, NULL);
+        }
+        else {
+            iobuf_move_zeros(iob, alen, NULL);
+        }
+        pos += alen;
+    }
+    up(&(tin->sem));
+    return 0;
+}
+
+/*
+ * tmpfs_write - copy iob into the file at iob->io_offset, allocating pages on the way
+ *               and growing the file if the write ends past it
+ */
+static int
+tmpfs_write(struct inode *node, struct iobuf *iob) {
+    struct tmpfs_fs *tfs = fsop_info(vop_fs(node), tmpfs);
+    struct tmpfs_inode *tin = vop_info(node, tmpfs_inode);
+    off_t pos = iob->io_offset;
+    if (pos < 0 || pos >= TMPFS_MAX_FILE_SIZE) {
+        return -E_INVAL;
+    }
+    int ret = 0;
+    down(&(tin->sem));
+    while (iob->io_resid > 0) {
+        if (pos >= TMPFS_MAX_FILE_SIZE) {
+            ret = -E_TOO_BIG;
+            break;
+        }
+        uint32_t index = pos / PGSIZE;
+        size_t off = pos % PGSIZE, alen = PGSIZE - off;
+        if (alen > iob->io_resid) {
+            alen = iob->io_resid;
+        }
+        if ((ret = tmpfs_pages_expand_nolock(tin, index + 1)) != 0) {
+            break;
+        }
+        struct Page **pagep = tin->pages + index;
+        if (*pagep == NULL && (*pagep = tmpfs_page_alloc(tfs)) == NULL) {
+            ret = -E_NO_MEM;
+            break;
+        }
+        iobuf_move(iob, page2kva(*pagep) + off, alen, 0, NULL);
+        if ((pos += alen) > tin->size) {
+            tin->size = pos;
+        }
+    }
+    up(&(tin->sem));
+    return ret;
+}
+
+/*
+ * tmpfs_fstat - Return nlinks/block/size, etc. info about a file; st_blocks counts data pages
+ */
+static int
+tmpfs_fstat(struct inode *node, struct stat *stat) {
+    int ret;
+    memset(stat, 0, sizeof(struct stat));
+    if ((ret = vop_gettype(node, &(stat->st_mode))) != 0) {
+        return ret;
+    }
+    struct tmpfs_inode *tin = vop_info(node, tmpfs_inode);
+    down(&(tin->sem));
+    {
+        uint32_t index;
+        for (index = 0; index < tin->npages; index ++) {
+            if (tin->pages[index] != NULL) {
+                stat->st_blocks ++;
+            }
+        }
+        stat->st_nlinks = tin->nlinks;
+        stat->st_size = tin->size;
+    }
+    up(&(tin->sem));
+    return 0;
+}
+
+// tmpfs_fsync - nothing is ever dirty
+static int
+tmpfs_fsync(struct inode *node) {
+    return 0;
+}
+
+/*
+ * tmpfs_namefile - Compute pathname relative to filesystem root of the file and copy to the
+ *                  specified io buffer, following the parent of each directory up to the root
+ */
+static int
+tmpfs_namefile(struct inode *node, struct iobuf *iob) {
+    if (iob->io_resid <= 2) {
+        return -E_NO_MEM;
+    }
+    struct tmpfs_fs *tfs = fsop_info(vop_fs(node), tmpfs);
+
+    int ret = 0;
+    char *ptr = iob->io_base + iob->io_resid;
+    size_t alen, resid = iob->io_resid - 2;
+    down(&(tfs->ns_sem));
+    while (node != tfs->root) {
+        struct tmpfs_inode *tin = vop_info(node, tmpfs_inode);
+        struct tmpfs_dirent *de;
+        if (tin->parent == NULL
+                || (de = tmpfs_dirent_findnode_nolock(vop_info(tin->parent, tmpfs_inode), node)) == NULL) {
+            ret = -E_NOENT;
+            goto out;
+        }
+        if ((alen = strlen(de->name) + 1) > resid) {
+            ret = -E_NO_MEM;
+            goto out;
+        }
+        resid -= alen, ptr -= alen;
+        memcpy(ptr, de->name, alen - 1);
+        ptr[alen - 1] = '/';
+        node = tin->parent;
+    }
+    alen = iob->io_resid - resid - 2;
+    ptr = memmove(iob->io_base + 1, ptr, alen);
+    ptr[-1] = '/', ptr[alen] = '\0';
+    iobuf_skip(iob, alen);
+out:
+    up(&(tfs->ns_sem));
+    return ret;
+}
+
+/*
+ * tmpfs_getdirentry_nolock - get the name at or after the DIR position *posp and move *posp
+ *                            past it; copy at most TMPFS_MAX_FNAME_LEN + 1 bytes into name
+ */
+static int
+tmpfs_getdirentry_nolock(struct tmpfs_inode *din, off_t *posp, char *name) {
+    struct tmpfs_dirent *de;
+    if (*posp < TMPFS_DIRPOS_FIRST) {
+        strcpy(name, (*posp == 0) ? "." : "..");
+        *posp += 1;
+        return 0;
+    }
+    if ((de = tmpfs_dirent_seek_nolock(din, *posp)) == NULL) {
+        return -E_NOENT;
+    }
+    strcpy(name, de->name);
+    *posp = de->pos + 1;
+    return 0;
+}
+
+/*
+ * tmpfs_getdirentry - get the dir entry at the position iob->io_offset, and leave the position
+ *                     of the next entry in iob->io_offset
+ */
+static int
+tmpfs_getdirentry(struct inode *node, struct iobuf *iob) {
+    char *name;
+    if ((name = kmalloc(TMPFS_MAX_FNAME_LEN + 1)) == NULL) {
+        return -E_NO_MEM;
+    }
+    struct tmpfs_fs *tfs = fsop_info(vop_fs(node), tmpfs);
+    struct tmpfs_inode *din = vop_info(node, tmpfs_inode);
+
+    int ret;
+    off_t pos = iob->io_offset;
+    if (pos < 0) {
+        ret = -E_INVAL;
+        goto out;
+    }
+    memset(name, 0, TMPFS_MAX_FNAME_LEN + 1);
+    down(&(tfs->ns_sem));
+    ret = tmpfs_getdirentry_nolock(din, &pos, name);
+    up(&(tfs->ns_sem));
+    if (ret == 0 && (ret = iobuf_move(iob, name, TMPFS_MAX_FNAME_LEN + 1, 1, NULL)) == 0) {
+        iob->io_offset = pos;
+    }
+out:
+    kfree(name);
+    return ret;
+}
+
+/*
+ * tmpfs_getdents - fill iob with a dirent_rec for each entry at or after the DIR position
+ *                  iob->io_offset, walking the entry list once, until iob is full; leave the
+ *                  position after the last entry copied in iob->io_offset
+ */
+static int
+tmpfs_getdents(struct inode *node, struct iobuf *iob) {
+    struct tmpfs_fs *tfs = fsop_info(vop_fs(node), tmpfs);
+    struct tmpfs_inode *din = vop_info(node, tmpfs_inode);
+    off_t pos = iob->io_offset;
+    if (pos < 0) {
+        return -E_INVAL;
+    }
+    struct dirent_rec *drec;
+    if ((drec = kmalloc(DIRENT_RECLEN(TMPFS_MAX_FNAME_LEN))) == NULL) {
+        return -E_NO_MEM;
+    }
+
+    int ret = 0, count = 0;
+    struct tmpfs_dirent *de = NULL;
+    down(&(tfs->ns_sem));
+    while (1) {
+        const char *name;
+        off_t next;
+        if (pos < TMPFS_DIRPOS_FIRST) {
+            name = (pos == 0) ? "." : "..", next = pos + 1;
+        }
+        else {
+            de = (de == NULL) ? tmpfs_dirent_seek_nolock(din, pos) : tmpfs_dirent_next_nolock(din, de);
+            if (de == NULL) {
+                break;
+            }
+            name = de->name, next = de->pos + 1;
+        }
+        size_t namlen = strlen(name), reclen = DIRENT_RECLEN(namlen);
+        if (reclen > iob->io_resid) {
+            // full: the next call starts from this entry
+            ret = (count == 0) ? -E_INVAL : 0;
+            break;
+        }
+        memset(drec, 0, reclen);
+        drec->d_off = next;
+        drec->d_reclen = reclen, drec->d_namlen = namlen;
+        memcpy(drec->d_name, name, namlen);
+        iobuf_move(iob, drec, reclen, 1, NULL);
+        pos = next, count ++;
+    }
+    up(&(tfs->ns_sem));
+    iob->io_offset = pos;
+    kfree(drec);
+    return ret;
+}
+
+/*
+ * tmpfs_reclaim - Called when inode is no longer in use. Only an inode without names gets
+ *                 here (every entry holds a reference), so free its pages and itself.
+ */
+static int
+tmpfs_reclaim(struct inode *node) {
+    struct tmpfs_fs *tfs = fsop_info(vop_fs(node), tmpfs);
+    struct tmpfs_inode *tin = vop_info(node, tmpfs_inode);
+    if (inode_ref_count(node) != 0) {
+        return -E_BUSY;
+    }
+    assert(tin->nlinks == 0 && tin->nentries == 0);
+    tmpfs_pages_trunc_nolock(tfs, tin, 0);
+    vop_kill(node);
+    return 0;
+}
+
+/*
+ * tmpfs_gettype - Return type of file. The values for file types are in stat.h.
+ */
+static int
+tmpfs_gettype(struct inode *node, uint32_t *type_store) {
+    struct tmpfs_inode *tin = vop_info(node, tmpfs_inode);
+    switch (tin->type) {
+    case TMPFS_TYPE_DIR:
+        *type_store = S_IFDIR;
+        return 0;
+    case TMPFS_TYPE_FILE:
+        *type_store = S_IFREG;
+        return 0;
+    }
+    panic("invalid file type %d.\n", tin->type);
+}
+
+/*
+ * tmpfs_tryseek - Check if seeking to the specified position within the file is legal.
+ */
+static int
+tmpfs_tryseek(struct inode *node, off_t pos) {
+    if (pos < 0 || pos >= TMPFS_MAX_FILE_SIZE) {
+        return -E_INVAL;
+    }
+    struct tmpfs_inode *tin = vop_info(node, tmpfs_inode);
+    if (pos > tin->size) {
+        return vop_truncate(node, pos);
+    }
+    return 0;
+}
+
+/*
+ * tmpfs_truncfile - resize the file to LEN bytes; growing only moves the size, the new
+ *                   range is a hole until written
+ */
+static int
+tmpfs_truncfile(struct inode *node, off_t len) {
+    if (len < 0 || len > TMPFS_MAX_FILE_SIZE) {
+        return -E_INVAL;
+    }
+    struct tmpfs_fs *tfs = fsop_info(vop_fs(node), tmpfs);
+    struct tmpfs_inode *tin = vop_info(node, tmpfs_inode);
+    down(&(tin->sem));
+    if (len < tin->size) {
+        tmpfs_pages_trunc_nolock(tfs, tin, len);
+    }
+    tin->size = len;
+    up(&(tin->sem));
+    return 0;
+}
+
+/*
+ * tmpfs_create - create a regular file NAME in the directory, or open the one already there
+ *                unless EXCL is set
+ */
+static int
+tmpfs_create(struct inode *node, const char *name, bool excl, struct inode **node_store) {
+    struct tmpfs_fs *tfs = fsop_info(vop_fs(node), tmpfs);
+    struct tmpfs_inode *din = vop_info(node, tmpfs_inode);
+    int ret;
+    if ((ret = tmpfs_check_name(name)) != 0) {
+        return ret;
+    }
+
+    struct tmpfs_dirent *de;
+    struct inode *subnode;
+    down(&(tfs->ns_sem));
+    if (din->nlinks == 0) {
+        ret = -E_NOENT;
+    }
+    else if ((de = tmpfs_dirent_find_nolock(din, name)) != NULL) {
+        if (excl) {
+            ret = -E_EXISTS;
+        }
+        else if (vop_info(de->node, tmpfs_inode)->type == TMPFS_TYPE_DIR) {
+            ret = -E_ISDIR;
+        }
+        else {
+            vop_ref_inc(de->node);
+            *node_store = de->node;
+        }
+    }
+    else if ((de = tmpfs_dirent_alloc(name)) == NULL) {
+        ret = -E_NO_MEM;
+    }
+    else if ((ret = tmpfs_new_inode(vop_fs(node), TMPFS_TYPE_FILE, &subnode)) != 0) {
+        kfree(de);
+    }
+    else {
+        // one reference for the entry, one for the caller
+        vop_ref_inc(subnode);
+        vop_info(subnode, tmpfs_inode)->nlinks = 1;
+        tmpfs_dirent_link_nolock(din, de, subnode);
+        *node_store = subnode;
+    }
+    up(&(tfs->ns_sem));
+    return ret;
+}
+
+/*
+ * tmpfs_mkdir - create an empty directory NAME in the directory
+ */
+static int
+tmpfs_mkdir(struct inode *node, const char *name) {
+    struct tmpfs_fs *tfs = fsop_info(vop_fs(node), tmpfs);
+    struct tmpfs_inode *din = vop_info(node, tmpfs_inode);
+    int ret;
+    if ((ret = tmpfs_check_name(name)) != 0) {
+        return ret;
+    }
+
+    struct tmpfs_dirent *de;
+    struct inode *subnode;
+    down(&(tfs->ns_sem));
+    if (din->nlinks == 0) {
+        ret = -E_NOENT;
+    }
+    else if (tmpfs_dirent_find_nolock(din, name) != NULL) {
+        ret = -E_EXISTS;
+    }
+    else if ((de = tmpfs_dirent_alloc(name)) == NULL) {
+        ret = -E_NO_MEM;
+    }
+    else if ((ret = tmpfs_new_inode(vop_fs(node), TMPFS_TYPE_DIR, &subnode)) != 0) {
+        kfree(de);
+    }
+    else {
+        // the reference of the new inode goes to the entry
+        struct tmpfs_inode *tin = vop_info(subnode, tmpfs_inode);
+        tin->nlinks = 1, tin->parent = node;
+        tmpfs_dirent_link_nolock(din, de, subnode);
+    }
+    up(&(tfs->ns_sem));
+    return ret;
+}
+
+/*
+ * tmpfs_remove - remove the entry NAME of the directory, which must be an empty directory
+ *                if DIR is set and must not be a directory otherwise
+ */
+static int
+tmpfs_remove(struct inode *node, const char *name, bool dir) {
+    struct tmpfs_fs *tfs = fsop_info(vop_fs(node), tmpfs);
+    struct tmpfs_inode *din = vop_info(node, tmpfs_inode);
+    if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+        return -E_INVAL;
+    }
+
+    int ret = 0;
+    struct tmpfs_dirent *de;
+    struct tmpfs_inode *tin;
+    struct inode *subnode = NULL;
+    down(&(tfs->ns_sem));
+    if ((de = tmpfs_dirent_find_nolock(din, name)) == NULL) {
+        ret = -E_NOENT;
+    }
+    else if ((tin = vop_info(de->node, tmpfs_inode))->type == TMPFS_TYPE_DIR && !dir) {
+        ret = -E_ISDIR;
+    }
+    else if (tin->type != TMPFS_TYPE_DIR && dir) {
+        ret = -E_NOTDIR;
+    }
+    else if (tin->nentries != 0) {
+        ret = -E_NOTEMPTY;
+    }
+    else {
+        subnode = de->node;
+        tmpfs_dirent_unlink_nolock(din, de);
+        tmpfs_dirent_dropped_nolock(subnode);
+        kfree(de);
+    }
+    up(&(tfs->ns_sem));
+    if (subnode != NULL) {
+        vop_ref_dec(subnode);
+    }
+    return ret;
+}
+
+/*
+ * tmpfs_unlink - remove the name NAME of a file from the directory
+ */
+static int
+tmpfs_unlink(struct inode *node, const char *name) {
+    return tmpfs_remove(node, name, 0);
+}
+
+/*
+ * tmpfs_rmdir - remove the empty directory NAME from the directory
+ */
+static int
+tmpfs_rmdir(struct inode *node, const char *name) {
+    return tmpfs_remove(node, name, 1);
+}
+
+/*
+ * tmpfs_link - add the name NAME in the directory for the file LINK_NODE
+ */
+static int
+tmpfs_link(struct inode *node, const char *name, struct inode *link_node) {
+    struct tmpfs_fs *tfs = fsop_info(vop_fs(node), tmpfs);
+    struct tmpfs_inode *din = vop_info(node, tmpfs_inode);
+    struct tmpfs_inode *tin = vop_info(link_node, tmpfs_inode);
+    int ret;
+    if ((ret = tmpfs_check_name(name)) != 0) {
+        return ret;
+    }
+    if (tin->type == TMPFS_TYPE_DIR) {
+        return -E_ISDIR;
+    }
+
+    struct tmpfs_dirent *de;
+    down(&(tfs->ns_sem));
+    if (din->nlinks == 0 || tin->nlinks == 0) {
+        ret = -E_NOENT;
+    }
+    else if (tmpfs_dirent_find_nolock(din, name) != NULL) {
+        ret = -E_EXISTS;
+    }
+    else if ((de = tmpfs_dirent_alloc(name)) == NULL) {
+        ret = -E_NO_MEM;
+    }
+    else {
+        vop_ref_inc(link_node);
+        tin->nlinks ++;
+        tmpfs_dirent_link_nolock(din, de, link_node);
+    }
+    up(&(tfs->ns_sem));
+    return ret;
+}
+
+/*
+ * tmpfs_rename - move the entry NAME of the directory to NEW_NAME in NEW_NODE, replacing the
+ *                file there (or an empty directory, if a directory moves)
+ */
+static int
+tmpfs_rename(struct inode *node, const char *name, struct inode *new_node, const char *new_name) {
+    struct tmpfs_fs *tfs = fsop_info(vop_fs(node), tmpfs);
+    struct tmpfs_inode *din = vop_info(node, tmpfs_inode);
+    struct tmpfs_inode *new_din = vop_info(new_node, tmpfs_inode);
+    int ret;
+    if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+        return -E_INVAL;
+    }
+    if ((ret = tmpfs_check_name(new_name)) != 0) {
+        return ret;
+    }
+
+    struct tmpfs_dirent *de, *old_de, *new_de;
+    struct inode *subnode, *victim = NULL;
+    if ((new_de = tmpfs_dirent_alloc(new_name)) == NULL) {
+        return -E_NO_MEM;
+    }
+    down(&(tfs->ns_sem));
+    if ((de = tmpfs_dirent_find_nolock(din, name)) == NULL || new_din->nlinks == 0) {
+        ret = -E_NOENT;
+        goto out;
+    }
+    subnode = de->node;
+    struct tmpfs_inode *tin = vop_info(subnode, tmpfs_inode);
+    if (tin->type == TMPFS_TYPE_DIR) {
+        // a directory can't move below itself
+        struct inode *dir = new_node;
+        while (dir != tfs->root) {
+            if (dir == subnode) {
+                ret = -E_INVAL;
+                goto out;
+            }
+            dir = vop_info(dir, tmpfs_inode)->parent;
+        }
+    }
+    if ((old_de = tmpfs_dirent_find_nolock(new_din, new_name)) != NULL) {
+        if (old_de->node == subnode) {
+            // both names refer to the same file already
+            goto out;
+        }
+        struct tmpfs_inode *old_tin = vop_info(old_de->node, tmpfs_inode);
+        if (old_tin->type == TMPFS_TYPE_DIR) {
+            if (tin->type != TMPFS_TYPE_DIR) {
+                ret = -E_ISDIR;
+                goto out;
+            }
+            if (old_tin->nentries != 0) {
+                ret = -E_NOTEMPTY;
+                goto out;
+            }
+        }
+        else if (tin->type == TMPFS_TYPE_DIR) {
+            ret = -E_NOTDIR;
+            goto out;
+        }
+        victim = old_de->node;
+        tmpfs_dirent_unlink_nolock(new_din, old_de);
+        tmpfs_dirent_dropped_nolock(victim);
+        kfree(old_de);
+    }
+    // the reference of the old entry moves to the new one
+    tmpfs_dirent_unlink_nolock(din, de);
+    kfree(de);
+    tmpfs_dirent_link_nolock(new_din, new_de, subnode);
+    new_de = NULL;
+    if (tin->type == TMPFS_TYPE_DIR) {
+        tin->parent = new_node;
+    }
+
+out:
+    up(&(tfs->ns_sem));
+    if (victim != NULL) {
+        vop_ref_dec(victim);
+    }
+    if (new_de != NULL) {
+        kfree(new_de);
+    }
+    return ret;
+}
+
+/*
+ * tmpfs_lookup - look up the single path component PATH in the directory
+ */
+static int
+tmpfs_lookup(struct inode *node, char *path, struct inode **node_store) {
+    struct tmpfs_fs *tfs = fsop_info(vop_fs(node), tmpfs);
+    struct tmpfs_inode *din = vop_info(node, tmpfs_inode);
+    assert(*path != '\0' && *path != '/');
+
+    int ret = 0;
+    struct tmpfs_dirent *de;
+    struct inode *subnode = NULL;
+    down(&(tfs->ns_sem));
+    if (strcmp(path, ".") == 0) {
+        subnode = node;
+    }
+    else if (strcmp(path, "..") == 0) {
+        subnode = din->parent;
+    }
+    else if ((de = tmpfs_dirent_find_nolock(din, path)) != NULL) {
+        subnode = de->node;
+    }
+    if (subnode != NULL) {
+        vop_ref_inc(subnode);
+        *node_store = subnode;
+    }
+    else {
+        ret = -E_NOENT;
+    }
+    up(&(tfs->ns_sem));
+    return ret;
+}
+
+// The tmpfs specific DIR operations correspond to the abstract operations on a inode.
+static const struct inode_ops tmpfs_node_dirops = {
+    .vop_magic                      = VOP_MAGIC,
+    .vop_open                       = tmpfs_opendir,
+    .vop_close                      = tmpfs_close,
+    .vop_fstat                      = tmpfs_fstat,
+    .vop_fsync                      = tmpfs_fsync,
+    .vop_namefile                   = tmpfs_namefile,
+    .vop_getdirentry                = tmpfs_getdirentry,
+    .vop_getdents                   = tmpfs_getdents,
+    .vop_reclaim                    = tmpfs_reclaim,
+    .vop_gettype                    = tmpfs_gettype,
+    .vop_create                     = tmpfs_create,
+    .vop_mkdir                      = tmpfs_mkdir,
+    .vop_unlink                     = tmpfs_unlink,
+    .vop_rmdir                      = tmpfs_rmdir,
+    .vop_link                       = tmpfs_link,
+    .vop_rename                     = tmpfs_rename,
+    .vop_lookup                     = tmpfs_lookup,
+};
+
+/// The tmpfs specific FILE operations correspond to the abstract operations on a inode.
+static const struct inode_ops tmpfs_node_fileops = {
+    .vop_magic                      = VOP_MAGIC,
+    .vop_open                       = tmpfs_openfile,
+    .vop_close                      = tmpfs_close,
+    .vop_read                       = tmpfs_read,
+    .vop_write                      = tmpfs_write,
+    .vop_fstat                      = tmpfs_fstat,
+    .vop_fsync                      = tmpfs_fsync,
+    .vop_reclaim                    = tmpfs_reclaim,
+    .vop_gettype                    = tmpfs_gettype,
+    .vop_tryseek                    = tmpfs_tryseek,
+    .vop_truncate                   = tmpfs_truncfile,
+};
+
@@ -49,8 +49,7 @@ inode_kill(struct inode *node) {
  * */
 int
 inode_ref_inc(struct inode *node) {
-    node->ref_count += 1;
-    return node->ref_count;
+    return atomic_add_return(&(node->ref_count), 1);
 }
 
 /* *
@@ -62,8 +61,7 @@ int
 inode_ref_dec(struct inode *node) {
     assert(inode_ref_count(node) > 0);
     int ref_count, ret;
-    node->ref_count-= 1;
-    ref_count = node->ref_count;
+    ref_count = atomic_sub_return(&(node->ref_count), 1);
     if (ref_count == 0) {
         if ((ret = vop_reclaim(node)) != 0 && ret != -E_BUSY) {
             cprintf("vfs: warning: vop_reclaim: %e.\n", ret);
@@ -78,8 +76,7 @@ inode_ref_dec(struct inode *node) {
  * */
 int
 inode_open_inc(struct inode *node) {
-    node->open_count += 1;
-    return node->open_count;
+    return atomic_add_return(&(node->open_count), 1);
 }
 
 /* *
@@ -91,8 +88,7 @@ int
 inode_open_dec(struct inode *node) {
     assert(inode_open_count(node) > 0);
     int open_count, ret;
-    node->open_count -= 1;
-    open_count = node->open_count;
+    open_count = atomic_sub_return(&(node->open_count), 1);
     if (open_count == 0) {
         if ((ret = vop_close(node)) != 0) {
             cprintf("vfs: warning: vop_close: %e.\n", ret);
@@ -4,6 +4,8 @@
 #include <defs.h>
 #include <dev.h>
 #include <sfs.h>
+#include <pipe.h>
+#include <tmpfs.h>
 #include <atomic.h>
 #include <assert.h>
 
@@ -30,10 +32,14 @@ struct inode {
     union {
         struct device __device_info;
         struct sfs_inode __sfs_inode_info;
+        struct pipe_inode __pipe_inode_info;
+        struct tmpfs_inode __tmpfs_inode_info;
     } in_info;
     enum {
         inode_type_device_info = 0x1234,
         inode_type_sfs_inode_info,
+        inode_type_pipe_inode_info,
+        inode_type_tmpfs_inode_info,
     } in_type;
     int ref_count;
     int open_count;
@@ -151,6 +157,17 @@ void inode_kill(struct inode *node);
  *                      Need not work on objects that are not
  *                      directories.
  *
+ *    vop_readahead   - Start reading LEN bytes at POS into a cache in
+ *                      the background, for a sequential reader about to
+ *                      get there. Optional; a hint that may be ignored.
+ *
+ *    vop_getdents    - Like vop_getdirentry, but fill the uio with as
+ *                      many struct dirent_rec (see dirent.h) as fit,
+ *                      starting at the offset field, and leave the
+ *                      position after the last one there. Returns
+ *                      EINVAL if not even one entry fits. Optional;
+ *                      directories only.
+ *
  *****************************************
  *
  *    vop_creat       - Create a regular file named NAME in the passed
@@ -159,6 +176,26 @@ void inode_kill(struct inode *node);
  *                      existing file if there is one. Hand back the
  *                      inode for the file as per vop_lookup.
  *
+ *    vop_mkdir       - Create an empty directory named NAME in the
+ *                      passed directory DIR.
+ *
+ *    vop_unlink      - Delete the name NAME from the passed directory DIR.
+ *                      NAME must not be a directory.
+ *
+ *    vop_rmdir       - Delete the empty directory NAME from the passed
+ *                      directory DIR.
+ *
+ *    vop_link        - Create a name NAME in the passed directory DIR
+ *                      that refers to the file FILE. FILE is on the
+ *                      same filesystem as DIR.
+ *
+ *    vop_rename      - Rename NAME in the passed directory DIR to
+ *                      NEWNAME in directory NEWDIR, on the same
+ *                      filesystem, replacing any file already there.
+ *
+ *    Filesystems that can't change their namespace leave these NULL;
+ *    the VFS layer then fails with E_UNIMP.
+ *
  *****************************************
  *
  *    vop_lookup      - Parse PATHNAME relative to the passed directory
@@ -181,8 +218,15 @@ struct inode_ops {
     int (*vop_tryseek)(struct inode *node, off_t pos);
     int (*vop_truncate)(struct inode *node, off_t len);
     int (*vop_create)(struct inode *node, const char *name, bool excl, struct inode **node_store);
+    int (*vop_mkdir)(struct inode *node, const char *name);
+    int (*vop_unlink)(struct inode *node, const char *name);
+    int (*vop_rmdir)(struct inode *node, const char *name);
+    int (*vop_link)(struct inode *node, const char *name, struct inode *link_node);
+    int (*vop_rename)(struct inode *node, const char *name, struct inode *new_node, const char *new_name);
     int (*vop_lookup)(struct inode *node, char *path, struct inode **node_store);
     int (*vop_ioctl)(struct inode *node, int op, void *data);
+    int (*vop_readahead)(struct inode *node, off_t pos, size_t len);
+    int (*vop_getdents)(struct inode *node, struct iobuf *iob);
 };
 
 /*
@@ -213,6 +257,15 @@ void inode_check(struct inode *node, const char *opstr);
 #define vop_truncate(node, len)                                     (__vop_op(node, truncate)(node, len))
 #define vop_create(node, name, excl, node_store)                    (__vop_op(node, create)(node, name, excl, node_store))
 #define vop_lookup(node, path, node_store)                          (__vop_op(node, lookup)(node, path, node_store))
+#define vop_mkdir(node, name)                                       (__vop_op(node, mkdir)(node, name))
+#define vop_unlink(node, name)                                      (__vop_op(node, unlink)(node, name))
+#define vop_rmdir(node, name)                                       (__vop_op(node, rmdir)(node, name))
+#define vop_link(node, name, link_node)                             (__vop_op(node, link)(node, name, link_node))
+#define vop_rename(node, name, new_node, new_name)                  (__vop_op(node, rename)(node, name, new_node, new_name))
+#define vop_readahead(node, pos, len)                               (__vop_op(node, readahead)(node, pos, len))
+#define vop_getdents(node, iob)                                     (__vop_op(node, getdents)(node, iob))
+
+#define vop_has_op(node, sym)                                       ((node)->in_ops->vop_##sym != NULL)
 
 
 #define vop_fs(node)                                                ((node)->in_fs)
@@ -27,6 +27,7 @@ void
 vfs_init(void) {
     sem_init(&bootfs_sem, 1);
     vfs_devlist_init();
+    dcache_init();
 }
 
 // lock_bootfs - lock  for bootfs
@@ -4,6 +4,7 @@
 #include <defs.h>
 #include <fs.h>
 #include <sfs.h>
+#include <tmpfs.h>
 
 struct inode;   // abstract structure for an on-disk file (inode.h)
 struct device;  // abstract structure for a device (dev.h)
@@ -13,7 +14,7 @@ struct iobuf;   // kernel or userspace I/O buffer (iobuf.h)
  * Abstract filesystem. (Or device accessible as a file.)
  *
  * Information:
- *      fs_info   : filesystem-specific data (sfs_fs)
+ *      fs_info   : filesystem-specific data (sfs_fs, tmpfs_fs)
  *      fs_type   : filesystem type
  * Operations:
  *
@@ -35,9 +36,11 @@ struct iobuf;   // kernel or userspace I/O buffer (iobuf.h)
 struct fs {
     union {
         struct sfs_fs __sfs_info;                   
+        struct tmpfs_fs __tmpfs_info;
     } fs_info;                                     // filesystem-specific data 
     enum {
         fs_type_sfs_info,
+        fs_type_tmpfs_info,
     } fs_type;                                     // filesystem type 
     int (*fs_sync)(struct fs *fs);                 // Flush all dirty buffers to disk 
     struct inode *(*fs_get_root)(struct fs *fs);   // Return root inode of filesystem.
@@ -107,7 +110,8 @@ const char *vfs_get_devname(struct fs *fs);
  *    vfs_symlink      - Create a symlink PATH containing contents CONTENTS.
  *    vfs_readlink     - Read contents of a symlink into a uio.
  *    vfs_mkdir        - Create a directory. MODE per the syscall.
- *    vfs_unlink       - Delete a file/directory.
+ *    vfs_unlink       - Delete a file.
+ *    vfs_rmdir        - Delete an empty directory.
  *    vfs_rename       - rename a file.
  *    vfs_chdir  - Change current directory of current thread by name.
  *    vfs_getcwd - Retrieve name of current directory of current thread.
@@ -120,6 +124,7 @@ int vfs_symlink(char *old_path, char *new_path);
 int vfs_readlink(char *path, struct iobuf *iob);
 int vfs_mkdir(char *path);
 int vfs_unlink(char *path);
+int vfs_rmdir(char *path);
 int vfs_rename(char *old_path, char *new_path);
 int vfs_chdir(char *path);
 int vfs_getcwd(struct iobuf *iob);
@@ -138,6 +143,24 @@ int vfs_getcwd(struct iobuf *iob);
 int vfs_lookup(char *path, struct inode **node_store);
 int vfs_lookup_parent(char *path, struct inode **node_store, char **endp);
 
+/*
+ * VFS name cache, see vfsdcache.c.
+ *
+ *    dcache_lookup    - Look up NAME in DIR. True on a hit, with the
+ *                       referenced inode, or NULL for a negative entry.
+ *    dcache_enter     - Record that NAME in DIR refers to NODE (or to
+ *                       nothing if NODE is NULL).
+ *    dcache_purge     - Forget NAME in DIR.
+ *    dcache_purge_dir - Forget every name in DIR, ".." included.
+ *    dcache_purge_fs  - Forget every name on a filesystem.
+ */
+void dcache_init(void);
+bool dcache_lookup(struct inode *dir, const char *name, struct inode **node_store);
+void dcache_enter(struct inode *dir, const char *name, struct inode *node);
+void dcache_purge(struct inode *dir, const char *name);
+void dcache_purge_dir(struct inode *dir);
+void dcache_purge_fs(struct fs *fs);
+
 /*
  * Misc
  *
@@ -0,0 +1,226 @@
+#include <defs.h>
+#include <string.h>
+#include <stdlib.h>
+#include <list.h>
+#include <sem.h>
+#include <kmalloc.h>
+#include <vfs.h>
+#include <inode.h>
+#include <assert.h>
+
+/*
+ * VFS name cache (dcache). It maps (directory inode, name) to the inode the
+ * name refers to, so path walks that were done before don't go down to
+ * vop_lookup again. A negative entry (node == NULL) remembers that the name
+ * does not exist.
+ *
+ * Every entry holds a reference on dir and on node, which keeps the key from
+ * being reused while cached. Entries live on an LRU list bounded by
+ * DCACHE_MAX_ENTRY, and are dropped by the VFS on create/unlink/link/rename
+ * of the name, with every name in a directory that is removed, and before
+ * unmount.
+ */
+
+#define DCACHE_HASH_SHIFT                   7
+#define DCACHE_HASH_SIZE                    (1 << DCACHE_HASH_SHIFT)
+#define DCACHE_MAX_ENTRY                    256
+
+struct dentry {
+    struct inode *dir;                      // directory the name lives in
+    struct inode *node;                     // inode of the name, NULL for a negative entry
+    uint32_t hash;                          // hash of (dir, name)
+    list_entry_t hash_link;                 // entry in dcache_hash
+    list_entry_t lru_link;                  // entry in dcache_lru, most recently used first
+    char name[0];                           // '\0' terminated name
+};
+
+#define le2dentry(le, member)                       \
+    to_struct((le), struct dentry, member)
+
+static list_entry_t dcache_hash[DCACHE_HASH_SIZE];
+static list_entry_t dcache_lru;
+static int dcache_count;
+static semaphore_t dcache_sem;
+
+static void
+lock_dcache(void) {
+    down(&dcache_sem);
+}
+
+static void
+unlock_dcache(void) {
+    up(&dcache_sem);
+}
+
+// dcache_init - initialize the name cache
+void
+dcache_init(void) {
+    int i;
+    for (i = 0; i < DCACHE_HASH_SIZE; i ++) {
+        list_init(dcache_hash + i);
+    }
+    list_init(&dcache_lru);
+    dcache_count = 0;
+    sem_init(&dcache_sem, 1);
+}
+
+// dcache_hashfn - FNV-1a over the name, seeded with the directory address
+static uint32_t
+dcache_hashfn(struct inode *dir, const char *name) {
+    uintptr_t addr = (uintptr_t)dir;
+    uint32_t hash = 2166136261U ^ (uint32_t)(addr ^ (addr >> 32));
+    while (*name != '\0') {
+        hash ^= (uint8_t)(*name ++);
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+static list_entry_t *
+dcache_hash_list(uint32_t hash) {
+    return dcache_hash + hash32(hash, DCACHE_HASH_SHIFT);
+}
+
+static struct dentry *
+dcache_find_nolock(struct inode *dir, const char *name, uint32_t hash) {
+    list_entry_t *list = dcache_hash_list(hash), *le = list;
+    while ((le = list_next(le)) != list) {
+        struct dentry *de = le2dentry(le, hash_link);
+        if (de->hash == hash && de->dir == dir && strcmp(de->name, name) == 0) {
+            return de;
+        }
+    }
+    return NULL;
+}
+
+// dcache_unlink_nolock - take de out of the cache, the caller frees it after unlocking
+static void
+dcache_unlink_nolock(struct dentry *de) {
+    list_del(&(de->hash_link));
+    list_del(&(de->lru_link));
+    dcache_count --;
+}
+
+// dcache_free - drop the references held by de and free it, never called with dcache locked
+static void
+dcache_free(struct dentry *de) {
+    if (de->node != NULL) {
+        vop_ref_dec(de->node);
+    }
+    vop_ref_dec(de->dir);
+    kfree(de);
+}
+
+/*
+ * dcache_lookup - look up name in dir. Return true on a cache hit, with the
+ *                 referenced inode in *node_store, or NULL if the name is known
+ *                 not to exist.
+ */
+bool
+dcache_lookup(struct inode *dir, const char *name, struct inode **node_store) {
+    uint32_t hash = dcache_hashfn(dir, name);
+    struct dentry *de;
+    bool found = 0;
+    lock_dcache();
+    if ((de = dcache_find_nolock(dir, name, hash)) != NULL) {
+        list_del(&(de->lru_link));
+        list_add(&dcache_lru, &(de->lru_link));
+        if ((*node_store = de->node) != NULL) {
+            vop_ref_inc(de->node);
+        }
+        found = 1;
+    }
+    unlock_dcache();
+    return found;
+}
+
+/*
+ * dcache_enter - remember that name in dir refers to node (NULL for a name that
+ *                doesn't exist). The cache is best effort: nothing is recorded
+ *                if memory runs short.
+ */
+void
+dcache_enter(struct inode *dir, const char *name, struct inode *node) {
+    size_t len = strlen(name);
+    struct dentry *de, *old, *victim = NULL;
+    if ((de = kmalloc(sizeof(struct dentry) + len + 1)) == NULL) {
+        return;
+    }
+    de->dir = dir, de->node = node, de->hash = dcache_hashfn(dir, name);
+    memcpy(de->name, name, len + 1);
+    vop_ref_inc(dir);
+    if (node != NULL) {
+        vop_ref_inc(node);
+    }
+
+    lock_dcache();
+    if ((old = dcache_find_nolock(dir, name, de->hash)) != NULL) {
+        dcache_unlink_nolock(old);
+    }
+    else if (dcache_count >= DCACHE_MAX_ENTRY) {
+        victim = le2dentry(list_prev(&dcache_lru), lru_link);
+        dcache_unlink_nolock(victim);
+    }
+    list_add(dcache_hash_list(de->hash), &(de->hash_link));
+    list_add(&dcache_lru, &(de->lru_link));
+    dcache_count ++;
+    unlock_dcache();
+
+    if (old != NULL) {
+        dcache_free(old);
+    }
+    if (victim != NULL) {
+        dcache_free(victim);
+    }
+}
+
+// dcache_purge - forget name in dir
+void
+dcache_purge(struct inode *dir, const char *name) {
+    uint32_t hash = dcache_hashfn(dir, name);
+    struct dentry *de;
+    lock_dcache();
+    if ((de = dcache_find_nolock(dir, name, hash)) != NULL) {
+        dcache_unlink_nolock(de);
+    }
+    unlock_dcache();
+    if (de != NULL) {
+        dcache_free(de);
+    }
+}
+
+// dcache_purge_match - forget every name in dir, or every name of fs if dir is NULL
+static void
+dcache_purge_match(struct fs *fs, struct inode *dir) {
+    list_entry_t free_list, *le;
+    list_init(&free_list);
+    lock_dcache();
+    {
+        le = &dcache_lru;
+        while ((le = list_next(le)) != &dcache_lru) {
+            struct dentry *de = le2dentry(le, lru_link);
+            if (dir != NULL ? de->dir == dir : vop_fs(de->dir) == fs) {
+                le = list_prev(le);
+                dcache_unlink_nolock(de);
+                list_add(&free_list, &(de->lru_link));
+            }
+        }
+    }
+    unlock_dcache();
+    while ((le = list_next(&free_list)) != &free_list) {
+        list_del(le);
+        dcache_free(le2dentry(le, lru_link));
+    }
+}
+
+// dcache_purge_dir - forget every name in dir, which was removed or replaced, so it can be released
+void
+dcache_purge_dir(struct inode *dir) {
+    dcache_purge_match(NULL, dir);
+}
+
+// dcache_purge_fs - forget every name of file system fs, so its inodes can be released
+void
+dcache_purge_fs(struct fs *fs) {
+    dcache_purge_match(fs, NULL);
+}
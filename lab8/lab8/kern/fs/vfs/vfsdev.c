@@ -263,6 +263,7 @@ vfs_unmount(const char *devname) {
     }
     assert(vdev->devname != NULL && vdev->mountable);
 
+    dcache_purge_fs(vdev->fs);
     if ((ret = fsop_sync(vdev->fs)) != 0) {
         goto out;
     }
@@ -289,6 +290,7 @@ vfs_unmount_all(void) {
                 vfs_dev_t *vdev = le2vdev(le, vdev_link);
                 if (vdev->mountable && vdev->fs != NULL) {
                     int ret;
+                    dcache_purge_fs(vdev->fs);
                     if ((ret = fsop_sync(vdev->fs)) != 0) {
                         cprintf("vfs: warning: sync failed for %s: %e.\n", vdev->devname, ret);
                         continue ;
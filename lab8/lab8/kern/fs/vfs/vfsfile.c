@@ -35,13 +35,22 @@ vfs_open(char *path, uint32_t open_flags, struct inode **node_store) {
     ret = vfs_lookup(path, &node);
 
     if (ret != 0) {
-        if (ret == -16 && (create)) {
+        if (ret == -E_NOENT && (create)) {
             char *name;
             struct inode *dir;
             if ((ret = vfs_lookup_parent(path, &dir, &name)) != 0) {
                 return ret;
             }
-            ret = vop_create(dir, name, excl, &node);
+            if (!vop_has_op(dir, create)) {
+                ret = -E_UNIMP;
+            }
+            else if ((ret = vop_create(dir, name, excl, &node)) == 0) {
+                dcache_purge(dir, name);
+            }
+            vop_ref_dec(dir);
+            if (ret != 0) {
+                return ret;
+            }
         } else return ret;
     } else if (excl && create) {
         return -E_EXISTS;
@@ -73,22 +82,128 @@ vfs_close(struct inode *node) {
     return 0;
 }
 
-// unimplement
+// vfs_unlink - delete the name path, and drop it from the name cache
 int
 vfs_unlink(char *path) {
-    return -E_UNIMP;
+    int ret;
+    char *name;
+    struct inode *dir;
+    if ((ret = vfs_lookup_parent(path, &dir, &name)) != 0) {
+        return ret;
+    }
+    if (!vop_has_op(dir, unlink)) {
+        ret = -E_UNIMP;
+    }
+    else if ((ret = vop_unlink(dir, name)) == 0) {
+        dcache_purge(dir, name);
+    }
+    vop_ref_dec(dir);
+    return ret;
 }
 
-// unimplement
+// vfs_rmdir - delete the empty directory path, and drop it and the names in it from the name cache
+int
+vfs_rmdir(char *path) {
+    int ret;
+    char *name;
+    struct inode *dir, *node = NULL;
+    if ((ret = vfs_lookup_parent(path, &dir, &name)) != 0) {
+        return ret;
+    }
+    if (!vop_has_op(dir, rmdir)) {
+        ret = -E_UNIMP;
+    }
+    else if ((ret = vop_lookup(dir, name, &node)) == 0 && (ret = vop_rmdir(dir, name)) == 0) {
+        // the cache may still hold the removed directory's "..", which pins both nodes
+        dcache_purge(dir, name);
+        dcache_purge_dir(node);
+    }
+    if (node != NULL) {
+        vop_ref_dec(node);
+    }
+    vop_ref_dec(dir);
+    return ret;
+}
+
+// vfs_rename - rename old_path to new_path on the same fs, and drop both names from the name cache
 int
 vfs_rename(char *old_path, char *new_path) {
-    return -E_UNIMP;
+    int ret;
+    char *old_name, *new_name;
+    struct inode *old_dir, *new_dir, *node = NULL, *target = NULL;
+    if ((ret = vfs_lookup_parent(old_path, &old_dir, &old_name)) != 0) {
+        return ret;
+    }
+    if ((ret = vfs_lookup_parent(new_path, &new_dir, &new_name)) != 0) {
+        goto out_old_dir;
+    }
+    if (vop_fs(old_dir) != vop_fs(new_dir)) {
+        ret = -E_XDEV;
+        goto out_new_dir;
+    }
+    if (!vop_has_op(old_dir, rename)) {
+        ret = -E_UNIMP;
+        goto out_new_dir;
+    }
+    if (old_dir != new_dir) {
+        // a moved directory gets a new "..", so remember which node moves
+        if ((ret = vop_lookup(old_dir, old_name, &node)) != 0) {
+            goto out_new_dir;
+        }
+    }
+    // an empty directory replaced at new_name is gone, along with its names
+    if ((ret = vop_lookup(new_dir, new_name, &target)) != 0 && ret != -E_NOENT) {
+        goto out_node;
+    }
+    if ((ret = vop_rename(old_dir, old_name, new_dir, new_name)) == 0) {
+        dcache_purge(old_dir, old_name);
+        dcache_purge(new_dir, new_name);
+        if (node != NULL) {
+            dcache_purge(node, "..");
+        }
+        if (target != NULL && target != node) {
+            dcache_purge_dir(target);
+        }
+    }
+    if (target != NULL) {
+        vop_ref_dec(target);
+    }
+out_node:
+    if (node != NULL) {
+        vop_ref_dec(node);
+    }
+out_new_dir:
+    vop_ref_dec(new_dir);
+out_old_dir:
+    vop_ref_dec(old_dir);
+    return ret;
 }
 
-// unimplement
+// vfs_link - create new_path as a hard link to old_path, and drop the new name from the name cache
 int
 vfs_link(char *old_path, char *new_path) {
-    return -E_UNIMP;
+    int ret;
+    char *new_name;
+    struct inode *node, *new_dir;
+    if ((ret = vfs_lookup(old_path, &node)) != 0) {
+        return ret;
+    }
+    if ((ret = vfs_lookup_parent(new_path, &new_dir, &new_name)) != 0) {
+        goto out_node;
+    }
+    if (vop_fs(new_dir) != vop_fs(node)) {
+        ret = -E_XDEV;
+    }
+    else if (!vop_has_op(new_dir, link)) {
+        ret = -E_UNIMP;
+    }
+    else if ((ret = vop_link(new_dir, new_name, node)) == 0) {
+        dcache_purge(new_dir, new_name);
+    }
+    vop_ref_dec(new_dir);
+out_node:
+    vop_ref_dec(node);
+    return ret;
 }
 
 // unimplement
@@ -103,8 +218,21 @@ vfs_readlink(char *path, struct iobuf *iob) {
     return -E_UNIMP;
 }
 
-// unimplement
+// vfs_mkdir - create the directory path, and drop the name from the name cache
 int
-vfs_mkdir(char *path){
-    return -E_UNIMP;
+vfs_mkdir(char *path) {
+    int ret;
+    char *name;
+    struct inode *dir;
+    if ((ret = vfs_lookup_parent(path, &dir, &name)) != 0) {
+        return ret;
+    }
+    if (!vop_has_op(dir, mkdir)) {
+        ret = -E_UNIMP;
+    }
+    else if ((ret = vop_mkdir(dir, name)) == 0) {
+        dcache_purge(dir, name);
+    }
+    vop_ref_dec(dir);
+    return ret;
 }
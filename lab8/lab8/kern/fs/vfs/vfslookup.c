@@ -66,27 +66,89 @@ get_device(char *path, char **subpath, struct inode **node_store) {
 }
 
 /*
- * vfs_lookup - get the inode according to the path filename
+ * vfs_lookup_once - look up the single path component name in directory dir,
+ *                   going to vop_lookup only on a name cache miss
  */
-int
-vfs_lookup(char *path, struct inode **node_store) {
+static int
+vfs_lookup_once(struct inode *dir, char *name, struct inode **node_store) {
     int ret;
     struct inode *node;
-    if ((ret = get_device(path, &path, &node)) != 0) {
-        return ret;
+    if (dcache_lookup(dir, name, &node)) {
+        if (node == NULL) {
+            return -E_NOENT;
+        }
+        *node_store = node;
+        return 0;
+    }
+    if ((ret = vop_lookup(dir, name, &node)) == 0) {
+        dcache_enter(dir, name, node);
+        *node_store = node;
+    }
+    else if (ret == -E_NOENT) {
+        dcache_enter(dir, name, NULL);
     }
-    if (*path != '\0') {
+    return ret;
+}
+
+/*
+ * vfs_lookup_path - walk path one component at a time starting at node.
+ *                   The reference on node is consumed.
+ */
+static int
+vfs_lookup_path(struct inode *node, char *path, struct inode **node_store) {
+    int ret;
+    if (node->in_fs == NULL && *path != '\0') {
+        /* devices interpret the rest of the path themselves */
         ret = vop_lookup(node, path, node_store);
         vop_ref_dec(node);
         return ret;
     }
+    while (*path != '\0') {
+        char *name = path, *sep = NULL;
+        while (*path != '\0' && *path != '/') {
+            path ++;
+        }
+        if (*path == '/') {
+            sep = path, *path ++ = '\0';
+            while (*path == '/') {
+                path ++;
+            }
+        }
+        struct inode *next;
+        ret = vfs_lookup_once(node, name, &next);
+        vop_ref_dec(node);
+        if (sep != NULL) {
+            /* keep path intact for a following vfs_lookup_parent */
+            *sep = '/';
+        }
+        if (ret != 0) {
+            return ret;
+        }
+        node = next;
+    }
     *node_store = node;
     return 0;
 }
 
+/*
+ * vfs_lookup - get the inode according to the path filename
+ */
+int
+vfs_lookup(char *path, struct inode **node_store) {
+    int ret;
+    struct inode *node;
+    if ((ret = get_device(path, &path, &node)) != 0) {
+        return ret;
+    }
+    return vfs_lookup_path(node, path, node_store);
+}
+
 /*
  * vfs_lookup_parent - Name-to-vnode translation.
  *  (In BSD, both of these are subsumed by namei().)
+ *  Return the directory holding the last component of path, and that
+ *  component in *endp. Trailing slashes are dropped, so "dir/" names dir;
+ *  a path with no last component, like "/" or "disk0:", is E_INVAL.
  */
 int
 vfs_lookup_parent(char *path, struct inode **node_store, char **endp){
@@ -95,6 +157,26 @@ vfs_lookup_parent(char *path, struct inode **node_store, char **endp){
     if ((ret = get_device(path, &path, &node)) != 0) {
         return ret;
     }
+    char *name = NULL, *s = path + strlen(path);
+    while (s > path && s[-1] == '/') {
+        *(-- s) = '\0';
+    }
+    if (s == path) {
+        vop_ref_dec(node);
+        return -E_INVAL;
+    }
+    for (s = path; *s != '\0'; s ++) {
+        if (*s == '/') {
+            name = s;
+        }
+    }
+    if (name != NULL) {
+        *name ++ = '\0';
+        if ((ret = vfs_lookup_path(node, path, &node)) != 0) {
+            return ret;
+        }
+        path = name;
+    }
     *endp = path;
     *node_store = node;
     return 0;
@@ -14,14 +14,18 @@
 #include <proc.h>
 #include <kmonitor.h>
 #include <fs.h>
+#include <smp.h>
 
 int kern_init(void) __attribute__((noreturn));
+void kern_init_secondary(void) __attribute__((noreturn));
 void grade_backtrace(void);
 
 int kern_init(void)
 {
     extern char edata[], end[];
     memset(edata, 0, end - edata);
+    extern uint64_t boot_hartid;
+    smp_boot_cpu(boot_hartid); // tp = this hart's struct cpu
     cons_init(); // init the console
 
     const char *message = "(THU.CST) os is loading ...";
@@ -44,10 +48,27 @@ int kern_init(void)
     ide_init(); // init ide devices
     fs_init();
 
-    clock_init();  // init clock interrupt
+    clock_init(); // init clock interrupt, before the other harts read ticks
+
+    smp_init(); // start the other harts
+
     intr_enable(); // enable irq interrupt
 
     cpu_idle(); // run idle process
 }
 
+// kern_init_secondary - the other harts, started by smp_init, come here from kern_entry_secondary
+void kern_init_secondary(void)
+{
+    lsatp(boot_pgdir_pa);
+    flush_tlb();
+
+    idt_init(); // init interrupt descriptor table
 
+    smp_cpu_online();
+
+    clock_init_secondary(); // init clock interrupt
+    intr_enable();          // enable irq interrupt
+
+    cpu_idle(); // run idle process
+}
@@ -4,6 +4,7 @@
 #include <assert.h>
 #include <kmalloc.h>
 #include <sync.h>
+#include <spinlock.h>
 #include <pmm.h>
 #include <stdio.h>
 
@@ -39,8 +40,6 @@
  */
 
 // some helper
-#define spin_lock_irqsave(l, f) local_intr_save(f)
-#define spin_unlock_irqrestore(l, f) local_intr_restore(f)
 typedef unsigned int gfp_t;
 #ifndef PAGE_SIZE
 #define PAGE_SIZE PGSIZE
@@ -77,6 +76,9 @@ static slob_t arena = {.next = &arena, .units = 1};
 static slob_t *slobfree = &arena;
 static bigblock_t *bigblocks;
 
+static spinlock_t slob_lock = SPINLOCK_INIT("slob");
+static spinlock_t block_lock = SPINLOCK_INIT("bigblock");
+
 static void *__slob_get_free_pages(gfp_t gfp, int order)
 {
 	struct Page *page = alloc_pages(1 << order);
@@ -307,7 +309,7 @@ unsigned int ksize(const void *block)
 		for (bb = bigblocks; bb; bb = bb->next)
 			if (bb->pages == block)
 			{
-				spin_unlock_irqrestore(&slob_lock, flags);
+				spin_unlock_irqrestore(&block_lock, flags);
 				return PAGE_SIZE << bb->order;
 			}
 		spin_unlock_irqrestore(&block_lock, flags);
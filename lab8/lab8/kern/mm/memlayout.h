@@ -59,12 +59,16 @@
 
 #define KSTACKPAGE 2                     // # of pages in kernel stack
 #define KSTACKSIZE (KSTACKPAGE * PGSIZE) // sizeof kernel stack
+#define KSTACK_RESERVED 16               // bytes above the trapframe at the top of a kernel stack, see trapentry.S
 
 #define USERTOP 0x80000000
 #define USTACKTOP USERTOP
 #define USTACKPAGE 256                   // # of pages in user stack
 #define USTACKSIZE (USTACKPAGE * PGSIZE) // sizeof user stack
 
+#define URINGBASE (USTACKTOP - USTACKSIZE - 16 * PGSIZE) // the syscall ring, if the process sets one up
+#define UVDSOBASE (URINGBASE - PGSIZE)                   // the read-only pid and time page, see libs/vdso.h
+
 #define USERBASE 0x00200000
 #define UTEXT 0x00800000 // where user programs generally begin
 #define USTAB USERBASE   // the location of the user STABS data structure
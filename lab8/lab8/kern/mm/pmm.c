@@ -12,6 +12,8 @@
 #include <sync.h>
 #include <vmm.h>
 #include <riscv.h>
+#include <spinlock.h>
+#include <smp.h>
 
 // virtual address of physical page array
 struct Page *pages;
@@ -29,6 +31,8 @@ uintptr_t boot_pgdir_pa;
 
 // physical memory management
 const struct pmm_manager *pmm_manager;
+// serializes the pmm_manager between harts
+static spinlock_t pmm_lock = SPINLOCK_INIT("pmm");
 
 static void check_alloc_page(void);
 static void check_pgdir(void);
@@ -54,11 +58,11 @@ struct Page *alloc_pages(size_t n)
 {
     struct Page *page = NULL;
     bool intr_flag;
-    local_intr_save(intr_flag);
+    spin_lock_irqsave(&pmm_lock, intr_flag);
     {
         page = pmm_manager->alloc_pages(n);
     }
-    local_intr_restore(intr_flag);
+    spin_unlock_irqrestore(&pmm_lock, intr_flag);
     return page;
 }
 
@@ -66,11 +70,11 @@ struct Page *alloc_pages(size_t n)
 void free_pages(struct Page *base, size_t n)
 {
     bool intr_flag;
-    local_intr_save(intr_flag);
+    spin_lock_irqsave(&pmm_lock, intr_flag);
     {
         pmm_manager->free_pages(base, n);
     }
-    local_intr_restore(intr_flag);
+    spin_unlock_irqrestore(&pmm_lock, intr_flag);
 }
 
 // nr_free_pages - call pmm->nr_free_pages to get the size (nr*PAGESIZE)
@@ -79,11 +83,11 @@ size_t nr_free_pages(void)
 {
     size_t ret;
     bool intr_flag;
-    local_intr_save(intr_flag);
+    spin_lock_irqsave(&pmm_lock, intr_flag);
     {
         ret = pmm_manager->nr_free_pages();
     }
-    local_intr_restore(intr_flag);
+    spin_unlock_irqrestore(&pmm_lock, intr_flag);
     return ret;
 }
 
@@ -544,6 +548,10 @@ int page_insert(pde_t *pgdir, struct Page *page, uintptr_t la, uint32_t perm)
 void tlb_invalidate(pde_t *pgdir, uintptr_t la)
 {
     asm volatile("sfence.vma %0" : : "r"(la));
+    if (ncpu > 1)
+    {
+        smp_tlb_shootdown(PADDR(pgdir), la);
+    }
 }
 
 // pgdir_alloc_page - call alloc_page & page_insert functions to
@@ -0,0 +1,56 @@
+#include <defs.h>
+#include <string.h>
+#include <pmm.h>
+#include <vmm.h>
+#include <clock.h>
+#include <vdso.h>
+#include <error.h>
+#include <assert.h>
+
+/*
+ * The vdso page: one page per process, mapped read-only for user mode at UVDSOBASE,
+ * with what getpid and the clocks would otherwise need a trap for (see libs/vdso.h).
+ * It is an ordinary page of the mm, so fork copies it like any other and exit frees
+ * it with the rest; the kernel writes it through its own mapping only.
+ */
+
+static struct vdso_data *
+vdso_page(struct mm_struct *mm)
+{
+    struct Page *page = get_page(mm->pgdir, UVDSOBASE, NULL);
+    return page == NULL ? NULL : page2kva(page);
+}
+
+// vdso_map - map the vdso page of the process PID in MM, which load_icode is setting up
+int vdso_map(struct mm_struct *mm, int pid)
+{
+    int ret;
+    struct Page *page;
+    static_assert(VDSO_BASE == UVDSOBASE && sizeof(struct vdso_data) <= PGSIZE);
+    if ((ret = mm_map(mm, UVDSOBASE, PGSIZE, VM_READ, NULL)) != 0)
+    {
+        return ret;
+    }
+    if ((page = pgdir_alloc_page(mm->pgdir, UVDSOBASE, PTE_U | PTE_R)) == NULL)
+    {
+        return -E_NO_MEM;
+    }
+    struct vdso_data *vd = page2kva(page);
+    memset(vd, 0, PGSIZE);
+    vd->vd_flags = clock_user_readable() ? VDSO_TIME : 0;
+    vd->vd_pid = pid;
+    vd->vd_clock_start = clock_start;
+    vd->vd_timebase_freq = TIMEBASE_FREQ;
+    vd->vd_tick_cycles = timebase;
+    return 0;
+}
+
+// vdso_set_pid - a forked child with mm has its own copy of the page, which still says the parent's pid
+void vdso_set_pid(struct mm_struct *mm, int pid)
+{
+    struct vdso_data *vd = vdso_page(mm);
+    if (vd != NULL)
+    {
+        vd->vd_pid = pid;
+    }
+}
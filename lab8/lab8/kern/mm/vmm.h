@@ -4,6 +4,7 @@
 #include <defs.h>
 #include <list.h>
 #include <memlayout.h>
+#include <atomic.h>
 #include <sync.h>
 #include <sem.h>
 #include <proc.h>
@@ -58,6 +59,9 @@ void exit_mmap(struct mm_struct *mm);
 uintptr_t get_unmapped_area(struct mm_struct *mm, size_t len);
 int mm_brk(struct mm_struct *mm, uintptr_t addr, size_t len);
 
+int vdso_map(struct mm_struct *mm, int pid);
+void vdso_set_pid(struct mm_struct *mm, int pid);
+
 // extern volatile unsigned int pgfault_num;
 extern struct mm_struct *check_mm_struct;
 
@@ -81,15 +85,13 @@ set_mm_count(struct mm_struct *mm, int val)
 static inline int
 mm_count_inc(struct mm_struct *mm)
 {
-    mm->mm_count += 1;
-    return mm->mm_count;
+    return atomic_add_return(&(mm->mm_count), 1);
 }
 
 static inline int
 mm_count_dec(struct mm_struct *mm)
 {
-    mm->mm_count -= 1;
-    return mm->mm_count;
+    return atomic_sub_return(&(mm->mm_count), 1);
 }
 
 static inline void
@@ -15,6 +15,11 @@
 #include <fs.h>
 #include <vfs.h>
 #include <sysfile.h>
+#include <ioring.h>
+#include <stat.h>
+#include <default_sched.h>
+#include <hrtimer.h>
+#include <time.h>
 /* ------------- process/thread mechanism design&implementation -------------
 (an simplified Linux process/thread mechanism )
 introduction:
@@ -71,12 +76,8 @@ list_entry_t proc_list;
 // has list for process set based on pid
 static list_entry_t hash_list[HASH_LIST_SIZE];
 
-// idle proc
-struct proc_struct *idleproc = NULL;
-// init proc
+// init proc (the idle and current procs are per hart, in struct cpu)
 struct proc_struct *initproc = NULL;
-// current proc
-struct proc_struct *current = NULL;
 
 static int nr_process = 0;
 
@@ -144,16 +145,33 @@ alloc_proc(void)
         proc->flags = 0;
         memset(proc->name, 0, PROC_NAME_LEN);
         // lab5 add:
-        proc->wait_state = 0;
+        proc->wait_state = proc->wakeup_state = 0;
         proc->cptr = proc->optr = proc->yptr = NULL;
         proc->rq = NULL;              // 初始化运行队列为空
+        proc->cpu = NULL;
         list_init(&(proc->run_link)); // 初始化运行队列的指针
         proc->time_slice = 0;
+        proc->last_ran = 0;
+        proc->wakeup_cycles = 0;
+        proc->preempt_count = 0;
+        proc->kernel_preempted = 0;
         proc->lab6_run_pool.left = proc->lab6_run_pool.right = proc->lab6_run_pool.parent = NULL;
         proc->lab6_stride = 0;
         proc->lab6_priority = 0;
+        proc->nice = 0;
+        proc->cfs_vruntime = proc->cfs_exec_start = 0;
+        proc->cfs_sum_exec = proc->cfs_slice_start = 0;
+        proc->mlfq_level = 0;
+        proc->policy = SCHED_NORMAL;
+        list_init(&(proc->dl_throttled_link));
+        proc->dl_runtime = proc->dl_deadline = proc->dl_period = proc->dl_bw = 0;
+        proc->dl_period_start = proc->dl_abs_deadline = proc->dl_exec_start = 0;
+        proc->dl_budget = 0;
+        proc->dl_throttled = proc->dl_yielded = proc->dl_missed = 0;
+        proc->dl_nr_misses = proc->dl_nr_throttled = 0;
         // lab8 add:
         proc->filesp = NULL;
+        proc->ioring = NULL;
     }
     return proc;
 }
@@ -209,6 +227,21 @@ remove_links(struct proc_struct *proc)
     nr_process--;
 }
 
+// proc_detach - make init the parent of proc, a kernel thread current started on its own
+//             behalf, so that current's waits don't see it and init reaps it
+void proc_detach(struct proc_struct *proc)
+{
+    assert(proc->parent == current);
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        remove_links(proc);
+        proc->parent = initproc;
+        set_links(proc);
+    }
+    local_intr_restore(intr_flag);
+}
+
 // get_pid - alloc a unique pid for process
 static int
 get_pid(void)
@@ -280,6 +313,8 @@ void proc_run(struct proc_struct *proc)
         local_intr_save(intr_flag);
         current = proc;
         lsatp(next->pgdir);
+        // another hart may have changed this page table while it was not loaded here
+        flush_tlb();
         switch_to(&(prev->context), &(next->context));
         local_intr_restore(intr_flag);
     }
@@ -291,6 +326,12 @@ void proc_run(struct proc_struct *proc)
 static void
 forkret(void)
 {
+    schedule_tail();
+    // a kernel thread runs holding the big kernel lock, like the rest of the kernel
+    if (trap_in_kernel(current->tf))
+    {
+        lock_kernel();
+    }
     forkrets(current->tf);
 }
 
@@ -440,7 +481,7 @@ bad_mm:
 static void
 copy_thread(struct proc_struct *proc, uintptr_t esp, struct trapframe *tf)
 {
-    proc->tf = (struct trapframe *)(proc->kstack + KSTACKSIZE) - 1;
+    proc->tf = (struct trapframe *)(proc->kstack + KSTACKSIZE - KSTACK_RESERVED) - 1;
     *(proc->tf) = *tf;
 
     // Set a0 to 0 so a child process knows it's just forked
@@ -553,6 +594,7 @@ int do_fork(uint32_t clone_flags, uintptr_t stack, struct trapframe *tf)
         goto fork_out;
     }
     proc->parent = current;
+    proc->nice = current->nice;
     assert(current->wait_state == 0);
 
     // Step 2: call setup_kstack to allocate a kernel stack for child process
@@ -582,6 +624,10 @@ int do_fork(uint32_t clone_flags, uintptr_t stack, struct trapframe *tf)
         set_links(proc);
     }
     local_intr_restore(intr_flag);
+    if (!(clone_flags & CLONE_VM) && proc->mm != NULL) {
+        // the copy of the vdso page still says the parent's pid
+        vdso_set_pid(proc->mm, proc->pid);
+    }
 
     // Step 6: call wakeup_proc to make the new child process RUNNABLE
     wakeup_proc(proc);
@@ -615,6 +661,12 @@ int do_exit(int error_code)
     {
         panic("initproc exit.\n");
     }
+    ioring_exit(current);
+    // give back the bandwidth it reserved on its hart
+    if (current->policy != SCHED_NORMAL)
+    {
+        sched_setattr(SCHED_NORMAL, 0, 0, 0);
+    }
     struct mm_struct *mm = current->mm;
     if (mm != NULL)
     {
@@ -819,6 +871,11 @@ load_icode(int fd, int argc, char **kargv)
     assert(pgdir_alloc_page(mm->pgdir, USTACKTOP - 3 * PGSIZE, PTE_USER) != NULL);
     assert(pgdir_alloc_page(mm->pgdir, USTACKTOP - 4 * PGSIZE, PTE_USER) != NULL);
 
+    // (4.5) map the vdso page, read-only, for getpid and the clocks without a trap
+    if ((ret = vdso_map(mm, current->pid)) != 0) {
+        goto bad_cleanup_mmap;
+    }
+
     // (5) setup current process's mm, cr3, reset pgidr (using lsatp MARCO)
     mm_count_inc(mm);
     current->mm = mm;
@@ -940,6 +997,7 @@ int do_execve(const char *name, int argc, const char **argv)
     }
     path = argv[0];
     unlock_mm(mm);
+    ioring_exit(current);
     files_closeall(current->filesp);
 
     /* sysfile_open will check the first argument path, thus we have to use a user-space pointer, and argv[0] may be incorrect */
@@ -978,6 +1036,11 @@ execve_exit:
 // do_yield - ask the scheduler to reschedule
 int do_yield(void)
 {
+    // a deadline process is done with its job, and waits for its next period
+    if (current->policy == SCHED_DEADLINE)
+    {
+        dl_yield(current);
+    }
     current->need_resched = 1;
     return 0;
 }
@@ -1042,6 +1105,8 @@ found:
     {
         panic("wait idleproc or initproc.\n");
     }
+    // its kernel stack is in use until it has switched away on its hart
+    sched_wait_off_cpu(proc);
     if (code_store != NULL)
     {
         *code_store = proc->exit_code;
@@ -1086,10 +1151,12 @@ kernel_execve(const char *name, const char **argv)
         argc++;
     }
     struct trapframe *old_tf = current->tf;
-    struct trapframe *new_tf = (struct trapframe *)(current->kstack + KSTACKSIZE - sizeof(struct trapframe));
+    struct trapframe *new_tf = (struct trapframe *)(current->kstack + KSTACKSIZE - KSTACK_RESERVED) - 1;
     memcpy(new_tf, old_tf, sizeof(struct trapframe));
     current->tf = new_tf;
     ret = do_execve(name, argc, argv);
+    // user mode runs without the big kernel lock; __trapret does not pass through trap()
+    unlock_kernel();
     asm volatile(
         "mv sp, %0\n"
         "j __trapret\n"
@@ -1147,6 +1214,7 @@ init_main(void *arg)
     {
         panic("create user_main failed.\n");
     }
+    fs_start_writeback();
     extern void check_sync(void);
     // check_sync();                // check philosopher sync problem
 
@@ -1188,6 +1256,7 @@ void proc_init(void)
     idleproc->state = PROC_RUNNABLE;
     idleproc->kstack = (uintptr_t)bootstack;
     idleproc->need_resched = 1;
+    idleproc->cpu = mycpu();
 
     if ((idleproc->filesp = files_create()) == NULL)
     {
@@ -1213,15 +1282,47 @@ void proc_init(void)
     assert(initproc != NULL && initproc->pid == 1);
 }
 
+// proc_init_cpu - set up the idle process of a secondary hart, running on the stack kstack
+void proc_init_cpu(struct cpu *cpu, uintptr_t kstack)
+{
+    struct proc_struct *idle;
+    if ((idle = alloc_proc()) == NULL)
+    {
+        panic("cannot alloc idleproc of hart %d.\n", cpu->id);
+    }
+
+    idle->pid = 0;
+    idle->state = PROC_RUNNABLE;
+    idle->kstack = kstack;
+    idle->need_resched = 1;
+    idle->cpu = cpu;
+    snprintf(idle->name, sizeof(idle->name), "idle/%d", cpu->id);
+
+    cpu->idle = cpu->proc = idle;
+}
+
 // cpu_idle - at the end of kern_init, the first kernel thread idleproc will do below works
 void cpu_idle(void)
 {
+    struct cpu *cpu = mycpu();
     while (1)
     {
         if (current->need_resched)
         {
             schedule();
+            continue;
         }
+        // interrupts off, so that a wakeup can't slip in between the check and wfi;
+        // wfi still returns on an interrupt that is pending, taken once they are on
+        intr_disable();
+        if (!current->need_resched)
+        {
+            clock_set_next_event();
+            uint64_t start = get_cycles();
+            asm volatile("wfi");
+            cpu->idle_cycles += get_cycles() - start;
+        }
+        intr_enable();
     }
 }
 // FOR LAB6, set the process's priority (bigger value will get more CPU time)
@@ -1233,24 +1334,156 @@ void lab6_set_priority(uint32_t priority)
     else
         current->lab6_priority = priority;
 }
-// do_sleep - set current process state to sleep and add timer with "time"
-//          - then call scheduler. if process run again, delete timer first.
+// do_setnice - set the nice value of current process for the fair class, clamped to -20 .. 19
+int do_setnice(int nice)
+{
+    if (nice < NICE_MIN)
+        nice = NICE_MIN;
+    else if (nice > NICE_MAX)
+        nice = NICE_MAX;
+    current->nice = nice;
+    return 0;
+}
+// do_sleep - sleep for "time" ticks
 int do_sleep(unsigned int time)
 {
-    if (time == 0)
+    return do_nanosleep((uint64_t)time * (NSEC_PER_SEC / TICK_HZ));
+}
+
+// do_nanosleep - set current process state to sleep and start an hrtimer "ns" from now
+//              - then call scheduler. if process run again, cancel the hrtimer first.
+int do_nanosleep(uint64_t ns)
+{
+    if (ns == 0)
     {
         return 0;
     }
     bool intr_flag;
     local_intr_save(intr_flag);
-    timer_t __timer, *timer = timer_init(&__timer, current, time);
+    hrtimer_t __timer, *timer = hrtimer_init(&__timer, current, get_cycles() + NS_TO_CYCLES(ns));
     current->state = PROC_SLEEPING;
     current->wait_state = WT_TIMER;
-    add_timer(timer);
+    hrtimer_start(timer);
     local_intr_restore(intr_flag);
 
     schedule();
 
-    del_timer(timer);
+    hrtimer_cancel(timer);
+    return 0;
+}
+
+// do_clock_gettime - copy the time of clock "clockid" to user's tp
+int do_clock_gettime(int clockid, struct timespec *tp)
+{
+    struct mm_struct *mm = current->mm;
+    struct timespec ts;
+    if (clockid != CLOCK_MONOTONIC)
+    {
+        return -E_INVAL;
+    }
+    uint64_t ns = clock_gettime_ns();
+    ts.tv_sec = ns / NSEC_PER_SEC;
+    ts.tv_nsec = ns % NSEC_PER_SEC;
+
+    lock_mm(mm);
+    if (!copy_to_user(mm, tp, &ts, sizeof(struct timespec)))
+    {
+        unlock_mm(mm);
+        return -E_INVAL;
+    }
+    unlock_mm(mm);
+    return 0;
+}
+
+// do_user_nanosleep - sleep for the time in user's req
+int do_user_nanosleep(const struct timespec *req)
+{
+    struct mm_struct *mm = current->mm;
+    struct timespec ts;
+    lock_mm(mm);
+    if (!copy_from_user(mm, &ts, req, sizeof(struct timespec), 0))
+    {
+        unlock_mm(mm);
+        return -E_INVAL;
+    }
+    unlock_mm(mm);
+    if (ts.tv_sec < 0 || ts.tv_nsec < 0 || ts.tv_nsec >= (long)NSEC_PER_SEC)
+    {
+        return -E_INVAL;
+    }
+    return do_nanosleep((uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec);
+}
+
+// do_schedstat - copy the load and counters of up to n harts to user's stats, return the # of harts
+int do_schedstat(struct schedstat *stats, int n)
+{
+    struct mm_struct *mm = current->mm;
+    struct schedstat local_stats[NCPU];
+    if (n <= 0)
+    {
+        return -E_INVAL;
+    }
+    n = sched_getstat(local_stats, (n < NCPU) ? n : NCPU);
+
+    lock_mm(mm);
+    if (!copy_to_user(mm, stats, local_stats, n * sizeof(struct schedstat)))
+    {
+        unlock_mm(mm);
+        return -E_INVAL;
+    }
+    unlock_mm(mm);
+    return n;
+}
+
+// do_sched_setattr - set the scheduling policy of current process from user's attr, times in usec
+int do_sched_setattr(struct sched_attr *uattr)
+{
+    struct mm_struct *mm = current->mm;
+    struct sched_attr attr;
+    lock_mm(mm);
+    if (!copy_from_user(mm, &attr, uattr, sizeof(struct sched_attr), 0))
+    {
+        unlock_mm(mm);
+        return -E_INVAL;
+    }
+    unlock_mm(mm);
+
+    if (attr.sa_policy == SCHED_NORMAL)
+    {
+        return sched_setattr(SCHED_NORMAL, 0, 0, 0);
+    }
+    if (attr.sa_policy != SCHED_DEADLINE)
+    {
+        return -E_INVAL;
+    }
+    // at least one usec of runtime, and periods of at most DL_PERIOD_MAX_US
+    if (attr.sa_runtime == 0 || attr.sa_runtime > attr.sa_deadline
+            || attr.sa_deadline > attr.sa_period || attr.sa_period > DL_PERIOD_MAX_US)
+    {
+        return -E_INVAL;
+    }
+    return sched_setattr(SCHED_DEADLINE, USEC_TO_CYCLES(attr.sa_runtime),
+                         USEC_TO_CYCLES(attr.sa_deadline), USEC_TO_CYCLES(attr.sa_period));
+}
+
+// do_sched_getattr - copy the scheduling policy and deadline counters of current process to user's attr
+int do_sched_getattr(struct sched_attr *uattr)
+{
+    struct mm_struct *mm = current->mm;
+    struct sched_attr attr;
+    attr.sa_policy = current->policy;
+    attr.sa_runtime = CYCLES_TO_USEC(current->dl_runtime);
+    attr.sa_deadline = CYCLES_TO_USEC(current->dl_deadline);
+    attr.sa_period = CYCLES_TO_USEC(current->dl_period);
+    attr.sa_nr_misses = current->dl_nr_misses;
+    attr.sa_nr_throttled = current->dl_nr_throttled;
+
+    lock_mm(mm);
+    if (!copy_to_user(mm, uattr, &attr, sizeof(struct sched_attr)))
+    {
+        unlock_mm(mm);
+        return -E_INVAL;
+    }
+    unlock_mm(mm);
     return 0;
 }
@@ -6,6 +6,7 @@
 #include <trap.h>
 #include <memlayout.h>
 #include <skew_heap.h>
+#include <smp.h>
 
 // process's state in his life cycle
 enum proc_state
@@ -60,16 +61,48 @@ struct proc_struct
     list_entry_t hash_link;                 // Process hash list
     int exit_code;                          // exit code (be sent to parent proc)
     uint32_t wait_state;                    // waiting state
+    uint32_t wakeup_state;                  // wait_state it was woken from, until it is queued again
     struct proc_struct *cptr, *yptr, *optr; // relations between processes
     struct run_queue *rq;                   // running queue contains Process
+    struct cpu *cpu;                        // hart whose run queue has the process, or it last ran on
     list_entry_t run_link;                  // the entry linked in run queue
     int time_slice;                         // time slice for occupying the CPU
+    uint64_t last_ran;                      // cycles when it last left a hart, for the load balancer
+    uint64_t wakeup_cycles;                 // cycles when it was woken, until it runs; 0 otherwise
+    int preempt_count;                      // preempt_disable nesting, preemptible in the kernel at 0
+    bool kernel_preempted;                  // preempted in the kernel, and kept on its hart until it runs
     skew_heap_entry_t lab6_run_pool;        // FOR LAB6 ONLY: the entry in the run pool
     uint32_t lab6_stride;                   // FOR LAB6 ONLY: the current stride of the process
     uint32_t lab6_priority;                 // FOR LAB6 ONLY: the priority of process, set by lab6_set_priority(uint32_t)
+    int nice;                               // -20 .. 19, the lower the more CPU time the fair class gives
+    rb_node_t cfs_node;                     // FOR CFS: the entry in the run queue's timeline
+    uint64_t cfs_vruntime;                  // FOR CFS: run time (ns) weighted by nice, the key in the timeline
+    uint64_t cfs_exec_start;                // FOR CFS: cycles when its run time was last charged
+    uint64_t cfs_sum_exec;                  // FOR CFS: run time (ns)
+    uint64_t cfs_slice_start;               // FOR CFS: cfs_sum_exec when it was picked
+    int mlfq_level;                         // FOR MLFQ: priority level, 0 is the highest
+    int policy;                             // SCHED_NORMAL, or SCHED_DEADLINE to be served by the deadline class first
+    rb_node_t dl_node;                      // FOR DEADLINE: the entry in the run queue's timeline
+    list_entry_t dl_throttled_link;         // FOR DEADLINE: the entry in the run queue's throttled list
+    uint64_t dl_runtime;                    // FOR DEADLINE: cycles it may run every period
+    uint64_t dl_deadline;                   // FOR DEADLINE: cycles from the start of a period
+    uint64_t dl_period;                     // FOR DEADLINE: cycles
+    uint64_t dl_bw;                         // FOR DEADLINE: runtime / period admitted, in 1/2^DL_BW_SHIFT
+    uint64_t dl_period_start;               // FOR DEADLINE: cycles when the current period started
+    uint64_t dl_abs_deadline;               // FOR DEADLINE: deadline of the current job, the key in the timeline
+    int64_t dl_budget;                      // FOR DEADLINE: cycles left of the runtime of this period
+    uint64_t dl_exec_start;                 // FOR DEADLINE: cycles when its run time was last charged
+    bool dl_throttled, dl_yielded, dl_missed; // FOR DEADLINE: held to the next period / job done / job late
+    size_t dl_nr_misses;                    // FOR DEADLINE: deadlines missed
+    size_t dl_nr_throttled;                 // FOR DEADLINE: runtimes used up before the job was done
     struct files_struct *filesp;            // the file related info(pwd, files_count, files_array, fs_semaphore) of process
+    struct ioring *ioring;                  // the submission/completion ring of process, if it set one up
 };
 
+// range of proc_struct.nice
+#define NICE_MIN -20
+#define NICE_MAX 19
+
 #define PF_EXITING 0x00000001 // getting shutdown
 
 #define WT_CHILD (0x00000001 | WT_INTERRUPTED)
@@ -77,17 +110,29 @@ struct proc_struct
 
 #define WT_CHILD (0x00000001 | WT_INTERRUPTED) // wait child process
 #define WT_KSEM 0x00000100                     // wait kernel semaphore
+#define WT_KRWLOCK 0x00000200                  // wait kernel reader/writer lock
 #define WT_TIMER (0x00000002 | WT_INTERRUPTED) // wait timer
 #define WT_KBD (0x00000004 | WT_INTERRUPTED)   // wait the input of keyboard
+#define WT_PIPE (0x00000008 | WT_INTERRUPTED)  // wait data/room in a pipe, or the other end of a fifo
+#define WT_RING (0x00000010 | WT_INTERRUPTED)  // wait ring submissions, or completions
+
+// waits for input or for another process to do I/O, those of interactive processes
+#define WT_IS_IO(state) (((state) & ~WT_INTERRUPTED & (WT_KBD | WT_PIPE | WT_RING)) != 0)
 
 #define le2proc(le, member) \
     to_struct((le), struct proc_struct, member)
 
-extern struct proc_struct *idleproc, *initproc, *current;
+extern struct proc_struct *initproc;
+
+// the process running on this hart, and the idle process of this hart
+#define current (mycpu()->proc)
+#define idleproc (mycpu()->idle)
 
 void proc_init(void);
+void proc_init_cpu(struct cpu *cpu, uintptr_t kstack);
 void proc_run(struct proc_struct *proc);
 int kernel_thread(int (*fn)(void *), void *arg, uint32_t clone_flags);
+void proc_detach(struct proc_struct *proc);
 
 char *set_proc_name(struct proc_struct *proc, const char *name);
 char *get_proc_name(struct proc_struct *proc);
@@ -104,4 +149,14 @@ int do_execve(const char *name, int argc, const char **argv);
 int do_wait(int pid, int *code_store);
 int do_kill(int pid);
 int do_sleep(unsigned int time);
+int do_nanosleep(uint64_t ns);
+struct timespec;
+int do_clock_gettime(int clockid, struct timespec *tp);
+int do_user_nanosleep(const struct timespec *req);
+int do_setnice(int nice);
+struct sched_attr;
+int do_sched_setattr(struct sched_attr *uattr);
+int do_sched_getattr(struct sched_attr *uattr);
+struct schedstat;
+int do_schedstat(struct schedstat *stats, int n);
 #endif /* !__KERN_PROCESS_PROC_H__ */
@@ -0,0 +1,214 @@
+#include <defs.h>
+#include <riscv.h>
+#include <sbi.h>
+#include <sync.h>
+#include <memlayout.h>
+#include <pmm.h>
+#include <proc.h>
+#include <sched.h>
+#include <spinlock.h>
+#include <smp.h>
+#include <stdio.h>
+#include <kmalloc.h>
+#include <assert.h>
+#include <clock.h>
+
+struct cpu cpus[NCPU];
+struct cpu *boot_cpu;
+int ncpu;
+
+static spinlock_t kernel_lock = SPINLOCK_INIT("kernel");
+
+/*
+ * smp_boot_cpu - make tp point at the struct cpu of the boot hart, before
+ * anything calls mycpu()
+ *
+ * CALL GRAPH:
+ *   kern_init-->smp_boot_cpu
+ */
+void
+smp_boot_cpu(int hartid) {
+    assert(hartid >= 0 && hartid < NCPU);
+    struct cpu *cpu = cpus + hartid;
+    cpu->id = hartid;
+    cpu->started = 1;
+    asm volatile ("mv tp, %0" :: "r" (cpu));
+    boot_cpu = cpu, ncpu = 1;
+}
+
+// lock_kernel - take the big kernel lock, or nest once more if this hart holds it
+void
+lock_kernel(void) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        struct cpu *cpu = mycpu();
+        if (cpu->klock_depth ++ == 0) {
+            spin_lock(&kernel_lock);
+        }
+    }
+    local_intr_restore(intr_flag);
+}
+
+void
+unlock_kernel(void) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        struct cpu *cpu = mycpu();
+        assert(cpu->klock_depth > 0);
+        if (-- cpu->klock_depth == 0) {
+            spin_unlock(&kernel_lock);
+        }
+    }
+    local_intr_restore(intr_flag);
+}
+
+bool
+kernel_locked(void) {
+    return mycpu()->klock_depth != 0;
+}
+
+// kernel_lock_release - drop the big kernel lock whatever the nesting, return the nesting
+int
+kernel_lock_release(void) {
+    int depth;
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        struct cpu *cpu = mycpu();
+        if ((depth = cpu->klock_depth) != 0) {
+            cpu->klock_depth = 0;
+            spin_unlock(&kernel_lock);
+        }
+    }
+    local_intr_restore(intr_flag);
+    return depth;
+}
+
+// kernel_lock_reacquire - take the big kernel lock back with the nesting kernel_lock_release returned
+void
+kernel_lock_reacquire(int depth) {
+    if (depth != 0) {
+        bool intr_flag;
+        local_intr_save(intr_flag);
+        {
+            struct cpu *cpu = mycpu();
+            assert(cpu->klock_depth == 0);
+            spin_lock(&kernel_lock);
+            cpu->klock_depth = depth;
+        }
+        local_intr_restore(intr_flag);
+    }
+}
+
+// smp_send_resched - make CPU call schedule() soon, a process was put on its run queue
+void
+smp_send_resched(struct cpu *cpu) {
+    __sync_fetch_and_or(&(cpu->ipi_pending), IPI_RESCHED);
+    sbi_send_ipi_mask(1UL << cpu->id, 0);
+}
+
+// smp_send_tick - make CPU start its tick again, if it stopped it
+void
+smp_send_tick(struct cpu *cpu) {
+    if (cpu == mycpu()) {
+        clock_start_tick();
+        return;
+    }
+    __sync_fetch_and_or(&(cpu->ipi_pending), IPI_TICK);
+    sbi_send_ipi_mask(1UL << cpu->id, 0);
+}
+
+// smp_ipi_handler - supervisor software interrupt: an IPI from another hart
+void
+smp_ipi_handler(void) {
+    clear_csr(sip, SIP_SSIP);
+    struct cpu *cpu = mycpu();
+    uint32_t pending = __sync_fetch_and_and(&(cpu->ipi_pending), 0);
+    if ((pending & IPI_RESCHED) && cpu->proc != NULL) {
+        cpu->proc->need_resched = 1;
+    }
+    if (pending & IPI_TICK) {
+        clock_start_tick();
+    }
+}
+
+/*
+ * smp_tlb_shootdown - a PTE for LA in the page table at PGDIR_PA changed, so
+ * flush it on the other harts that may have it cached: those running a
+ * process with that page table, or all of them for the boot page table.
+ * The harts switching to it later flush their TLB in proc_run.
+ */
+void
+smp_tlb_shootdown(uintptr_t pgdir_pa, uintptr_t la) {
+    unsigned long mask = 0;
+    struct cpu *cpu;
+    for_each_cpu(cpu) {
+        if (cpu != mycpu() && cpu->proc != NULL
+                && (pgdir_pa == boot_pgdir_pa || cpu->proc->pgdir == pgdir_pa)) {
+            mask |= 1UL << cpu->id;
+        }
+    }
+    if (mask != 0) {
+        sbi_remote_sfence_vma_mask(mask, 0, ROUNDDOWN(la, PGSIZE), PGSIZE);
+    }
+}
+
+/*
+ * smp_init - start the other harts through SBI HSM, each with an idle process
+ * and a boot stack of its own, and wait for them to come online
+ *
+ * CALL GRAPH:
+ *   kern_init-->smp_init
+ */
+void
+smp_init(void) {
+    extern char kern_entry_secondary[];
+    int hartid;
+
+    // IPIs are delivered as supervisor software interrupts
+    set_csr(sie, MIP_SSIP);
+
+    for (hartid = 0; hartid < NCPU; hartid ++) {
+        struct cpu *cpu = cpus + hartid;
+        if (cpu == boot_cpu || sbi_hart_get_status(hartid) != SBI_HSM_STOPPED) {
+            continue;
+        }
+        struct Page *page;
+        if ((page = alloc_pages(KSTACKPAGE)) == NULL) {
+            cprintf("smp: no memory for the stack of hart %d.\n", hartid);
+            break;
+        }
+        uintptr_t kstack = (uintptr_t)page2kva(page);
+        cpu->id = hartid;
+        cpu->boot_stack_top = kstack + KSTACKSIZE;
+        proc_init_cpu(cpu, kstack);
+
+        __sync_synchronize();
+        if (sbi_hart_start(hartid, PADDR(kern_entry_secondary), (uintptr_t)cpu) != SBI_SUCCESS) {
+            kfree(cpu->idle);
+            cpu->idle = cpu->proc = NULL;
+            free_pages(page, KSTACKPAGE);
+            continue;
+        }
+        while (!cpu->started) {
+            /* wait for smp_cpu_online */
+        }
+        ncpu ++;
+    }
+    cprintf("smp: %d harts online\n", ncpu);
+}
+
+/*
+ * smp_cpu_online - a secondary hart is ready to take IPIs and run processes
+ *
+ * CALL GRAPH:
+ *   kern_init_secondary-->smp_cpu_online
+ */
+void
+smp_cpu_online(void) {
+    set_csr(sie, MIP_SSIP);
+    __sync_synchronize();
+    mycpu()->started = 1;
+}
@@ -0,0 +1,82 @@
+#ifndef __KERN_PROCESS_SMP_H__
+#define __KERN_PROCESS_SMP_H__
+
+#include <defs.h>
+#include <sched.h>
+#include <spinlock.h>
+#include <hrtimer.h>
+
+/*
+ * Per-hart state. In the kernel, tp holds the struct cpu of the hart; a trap
+ * from user mode reloads it from the word above the trapframe (see
+ * KSTACK_RESERVED), which is refreshed on every return to user mode.
+ */
+
+#define NCPU                        8               // harts 0 .. NCPU-1 may be started
+
+// reasons for an IPI, bits of struct cpu.ipi_pending
+#define IPI_RESCHED                 0x1             // a process was put on this hart's run queue
+#define IPI_TICK                    0x2             // the hart stopped its tick, but needs it again
+
+struct proc_struct;
+
+struct cpu {
+    uintptr_t boot_stack_top;                       // must stay first: kern_entry_secondary loads sp from it
+    int id;                                         // hart id
+    volatile bool started;                          // set once the hart runs kernel code
+    struct proc_struct *proc;                       // the process running on this hart
+    struct proc_struct *idle;                       // idle process of this hart
+    struct run_queue rq;                            // runnable processes of this hart
+    int klock_depth;                                // nesting of the big kernel lock held by this hart
+    volatile uint32_t ipi_pending;                  // IPI_* reasons not handled yet
+    volatile bool tickless;                         // the next timer interrupt is further than the next tick
+    uint64_t next_event;                            // cycles the timer interrupt is programmed for
+    size_t last_tick;                               // the tick charged to the scheduler last
+    struct hrtimer_queue hrtimers;                  // high-resolution timers started on this hart
+    // counters, see SYS_schedstat
+    size_t nr_ticks;                                // timer interrupts taken
+    size_t nr_tickless;                             // times the tick was stopped
+    uint64_t idle_cycles;                           // cycles spent in wfi
+};
+
+extern struct cpu cpus[NCPU];
+extern struct cpu *boot_cpu;
+extern int ncpu;
+
+static inline struct cpu *
+mycpu(void) {
+    struct cpu *cpu;
+    asm volatile ("mv %0, tp" : "=r" (cpu));
+    return cpu;
+}
+
+#define cpuid()                     (mycpu()->id)
+#define rq2cpu(rq)                  to_struct((rq), struct cpu, rq)
+#define for_each_cpu(cpu)                                       \
+    for ((cpu) = cpus; (cpu) < cpus + NCPU; (cpu) ++)           \
+        if ((cpu)->started)
+
+void smp_boot_cpu(int hartid);
+void smp_init(void);
+void smp_cpu_online(void);
+void smp_send_resched(struct cpu *cpu);
+void smp_send_tick(struct cpu *cpu);
+void smp_ipi_handler(void);
+void smp_tlb_shootdown(uintptr_t pgdir_pa, uintptr_t la);
+
+/*
+ * The big kernel lock serializes the parts of the kernel that still rely on
+ * disabling interrupts for mutual exclusion (wait queues, semaphores, the
+ * process tree, file systems). trap() takes it on the way in, and schedule()
+ * drops it across a switch and takes it back with the same depth, so a
+ * process never holds it while another runs in its place. The scheduler, pmm
+ * and kmalloc have spinlocks of their own.
+ */
+void lock_kernel(void);
+void unlock_kernel(void);
+bool kernel_locked(void);
+int kernel_lock_release(void);
+void kernel_lock_reacquire(int depth);
+
+#endif /* !__KERN_PROCESS_SMP_H__ */
+
@@ -100,6 +100,29 @@ RR_proc_tick(struct run_queue *rq, struct proc_struct *proc)
     }
 }
 
+/*
+ * RR_get_proc detaches processes the load balancer may move to ``dst''
+ * from ``rq'', at most ``max'' of them. It starts from the front of the
+ * queue: those have waited longest, so they are the least likely to
+ * still have their cache on this hart.
+ */
+static int
+RR_get_proc(struct run_queue *rq, struct run_queue *dst,
+            struct proc_struct *procs_moved[], int max)
+{
+    int n = 0;
+    list_entry_t *le = list_next(&(rq->run_list));
+    while (n < max && le != &(rq->run_list)) {
+        struct proc_struct *proc = le2proc(le, run_link);
+        le = list_next(le);
+        if (sched_can_migrate(proc, dst)) {
+            RR_dequeue(rq, proc);
+            procs_moved[n ++] = proc;
+        }
+    }
+    return n;
+}
+
 struct sched_class default_sched_class = {
     .name = "RR_scheduler",
     .init = RR_init,
@@ -107,4 +130,5 @@ struct sched_class default_sched_class = {
     .dequeue = RR_dequeue,
     .pick_next = RR_pick_next,
     .proc_tick = RR_proc_tick,
+    .get_proc = RR_get_proc,
 };
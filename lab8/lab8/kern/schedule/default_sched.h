@@ -4,6 +4,15 @@
 #include <sched.h>
 
 extern struct sched_class default_sched_class;
+extern struct sched_class stride_sched_class;
+extern struct sched_class cfs_sched_class;
+extern struct sched_class mlfq_sched_class;
+extern struct sched_class dl_sched_class;
+
+int dl_admit(struct run_queue *rq, struct proc_struct *proc, int policy, uint64_t runtime, uint64_t period);
+void dl_setattr(struct run_queue *rq, struct proc_struct *proc, int policy,
+                uint64_t runtime, uint64_t deadline, uint64_t period);
+void dl_yield(struct proc_struct *proc);
 
 #endif /* !__KERN_SCHEDULE_SCHED_RR_H__ */
 
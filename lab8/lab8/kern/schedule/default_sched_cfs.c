@@ -0,0 +1,306 @@
+#include <defs.h>
+#include <list.h>
+#include <proc.h>
+#include <assert.h>
+#include <clock.h>
+#include <rbtree.h>
+#include <default_sched.h>
+
+/*
+ * A completely fair scheduler: every process runs for the same virtual
+ * time. Its run time, read off the time CSR, is charged to its vruntime
+ * scaled by NICE_0_LOAD / weight, so a process with twice the weight gets
+ * twice the CPU. The run queue keeps the runnable processes in a red-black
+ * tree by vruntime and always runs the leftmost one.
+ */
+
+#define NICE_0_LOAD 1024
+
+#define CFS_LATENCY_NS 20000000ULL          /* period in which every runnable process runs once */
+#define CFS_MIN_GRANULARITY_NS 4000000ULL   /* shortest slice, however many processes there are */
+#define CFS_WAKEUP_GRANULARITY_NS 2000000ULL /* lead over the current a woken process needs to preempt it */
+
+/*
+ * Weight of each nice level, -20 .. 19: one level more or less is about
+ * 10% of CPU time, each weight is 1.25 times the next one.
+ */
+static const unsigned long cfs_prio_to_weight[NICE_MAX - NICE_MIN + 1] = {
+    /* -20 */ 88761, 71755, 56483, 46273, 36291,
+    /* -15 */ 29154, 23254, 18705, 14949, 11916,
+    /* -10 */ 9548, 7620, 6100, 4904, 3906,
+    /*  -5 */ 3121, 2501, 1991, 1586, 1277,
+    /*   0 */ 1024, 820, 655, 526, 423,
+    /*   5 */ 335, 272, 215, 172, 137,
+    /*  10 */ 110, 87, 70, 56, 45,
+    /*  15 */ 36, 29, 23, 18, 15,
+};
+
+static inline unsigned long
+cfs_weight(struct proc_struct *proc)
+{
+    return cfs_prio_to_weight[proc->nice - NICE_MIN];
+}
+
+// vruntime wraps around: compare the difference
+static inline bool
+cfs_before(uint64_t a, uint64_t b)
+{
+    return (int64_t)(a - b) < 0;
+}
+
+static inline struct proc_struct *
+cfs_entry(rb_node_t *node)
+{
+    return rb_entry(node, struct proc_struct, cfs_node);
+}
+
+/*
+ * cfs_update_min_vruntime moves the queue's min_vruntime up to the smallest
+ * vruntime of the current and the queued processes. It never goes back,
+ * so that woken and moved processes can be placed relative to it.
+ */
+static void
+cfs_update_min_vruntime(struct run_queue *rq)
+{
+    uint64_t vruntime = rq->cfs_min_vruntime;
+    struct proc_struct *curr = rq->cfs_curr;
+    if (curr != NULL)
+    {
+        vruntime = curr->cfs_vruntime;
+    }
+    if (rq->cfs_leftmost != NULL)
+    {
+        uint64_t left = cfs_entry(rq->cfs_leftmost)->cfs_vruntime;
+        if (curr == NULL || cfs_before(left, vruntime))
+        {
+            vruntime = left;
+        }
+    }
+    if (cfs_before(rq->cfs_min_vruntime, vruntime))
+    {
+        rq->cfs_min_vruntime = vruntime;
+    }
+}
+
+/*
+ * cfs_update_curr charges the process picked last for the time it ran
+ * since it was last charged.
+ */
+static void
+cfs_update_curr(struct run_queue *rq)
+{
+    struct proc_struct *curr = rq->cfs_curr;
+    if (curr == NULL)
+    {
+        return;
+    }
+    uint64_t now = get_cycles();
+    uint64_t delta = CYCLES_TO_NS(now - curr->cfs_exec_start);
+    curr->cfs_exec_start = now;
+    curr->cfs_sum_exec += delta;
+    curr->cfs_vruntime += delta * NICE_0_LOAD / cfs_weight(curr);
+    cfs_update_min_vruntime(rq);
+}
+
+/*
+ * cfs_slice is the run time the current process gets before it yields to
+ * the leftmost one: its share of CFS_LATENCY_NS by weight.
+ */
+static uint64_t
+cfs_slice(struct run_queue *rq, struct proc_struct *proc)
+{
+    unsigned long weight = cfs_weight(proc);
+    uint64_t slice = CFS_LATENCY_NS * weight / (rq->cfs_load + weight);
+    return (slice > CFS_MIN_GRANULARITY_NS) ? slice : CFS_MIN_GRANULARITY_NS;
+}
+
+static void
+cfs_init(struct run_queue *rq)
+{
+    list_init(&(rq->run_list));
+    rq->cfs_timeline = RB_ROOT;
+    rq->cfs_leftmost = NULL;
+    rq->cfs_min_vruntime = 0;
+    rq->cfs_load = 0;
+    rq->cfs_curr = NULL;
+    rq->proc_num = 0;
+}
+
+/*
+ * cfs_place sets the vruntime a process joins ``rq'' with. A new process,
+ * or one back from the deadline class, starts at min_vruntime; a woken
+ * one keeps its vruntime, but gets at most half a latency period of credit
+ * for the time it slept, so it runs soon without starving the others. One
+ * moved here by the load balancer keeps its lead or lag over the queue it
+ * comes from, and the current one put back keeps its vruntime.
+ */
+static void
+cfs_place(struct run_queue *rq, struct proc_struct *proc)
+{
+    if (proc->rq == NULL)
+    {
+        proc->cfs_vruntime = rq->cfs_min_vruntime;
+    }
+    else if (proc->rq != rq)
+    {
+        proc->cfs_vruntime += rq->cfs_min_vruntime - proc->rq->cfs_min_vruntime;
+    }
+    else if (proc->wakeup_state != 0)
+    {
+        uint64_t floor = rq->cfs_min_vruntime - CFS_LATENCY_NS / 2;
+        if (cfs_before(proc->cfs_vruntime, floor))
+        {
+            proc->cfs_vruntime = floor;
+        }
+    }
+}
+
+/*
+ * cfs_enqueue inserts ``proc'' into the timeline of ``rq''. A woken
+ * process that is ahead of the current one by more than the wakeup
+ * granularity preempts it.
+ */
+static void
+cfs_enqueue(struct run_queue *rq, struct proc_struct *proc)
+{
+    struct proc_struct *curr = rq->cfs_curr;
+    cfs_update_curr(rq);
+    cfs_place(rq, proc);
+
+    rb_node_t **link = &(rq->cfs_timeline.node), *parent = NULL;
+    bool leftmost = 1;
+    while (*link != NULL)
+    {
+        parent = *link;
+        if (cfs_before(proc->cfs_vruntime, cfs_entry(parent)->cfs_vruntime))
+        {
+            link = &(parent->left);
+        }
+        else
+        {
+            link = &(parent->right);
+            leftmost = 0;
+        }
+    }
+    rb_link_node(&(proc->cfs_node), parent, link);
+    rb_insert_color(&(proc->cfs_node), &(rq->cfs_timeline));
+    if (leftmost)
+    {
+        rq->cfs_leftmost = &(proc->cfs_node);
+    }
+
+    // the balancer walks run_list, the tree is for pick_next
+    list_add_before(&(rq->run_list), &(proc->run_link));
+    proc->rq = rq;
+    rq->cfs_load += cfs_weight(proc);
+    rq->proc_num++;
+
+    if (curr != NULL && cfs_before(proc->cfs_vruntime + CFS_WAKEUP_GRANULARITY_NS, curr->cfs_vruntime))
+    {
+        curr->need_resched = 1;
+    }
+}
+
+static void
+cfs_dequeue(struct run_queue *rq, struct proc_struct *proc)
+{
+    assert(proc->rq == rq && rq->proc_num > 0);
+    if (rq->cfs_leftmost == &(proc->cfs_node))
+    {
+        rq->cfs_leftmost = rb_next(&(proc->cfs_node));
+    }
+    rb_erase(&(proc->cfs_node), &(rq->cfs_timeline));
+    list_del_init(&(proc->run_link));
+    rq->cfs_load -= cfs_weight(proc);
+    rq->proc_num--;
+}
+
+/*
+ * cfs_pick_next returns the process with the smallest vruntime, which is
+ * charged for its run time from now on.
+ */
+static struct proc_struct *
+cfs_pick_next(struct run_queue *rq)
+{
+    if (rq->cfs_leftmost == NULL)
+    {
+        return NULL;
+    }
+    struct proc_struct *proc = cfs_entry(rq->cfs_leftmost);
+    proc->cfs_exec_start = get_cycles();
+    proc->cfs_slice_start = proc->cfs_sum_exec;
+    rq->cfs_curr = proc;
+    return proc;
+}
+
+/*
+ * cfs_proc_tick charges the current process and asks for a reschedule
+ * once it has used its slice, or has got a slice ahead of the leftmost.
+ */
+static void
+cfs_proc_tick(struct run_queue *rq, struct proc_struct *proc)
+{
+    if (proc != rq->cfs_curr)
+    {
+        return;
+    }
+    cfs_update_curr(rq);
+    if (rq->cfs_leftmost == NULL)
+    {
+        return;
+    }
+    uint64_t slice = cfs_slice(rq, proc);
+    if (proc->cfs_sum_exec - proc->cfs_slice_start >= slice
+            || cfs_before(cfs_entry(rq->cfs_leftmost)->cfs_vruntime + slice, proc->cfs_vruntime))
+    {
+        proc->need_resched = 1;
+    }
+}
+
+/*
+ * cfs_put_prev charges the current process, being switched away from or
+ * moved to the deadline class, for the last of its run time.
+ */
+static void
+cfs_put_prev(struct run_queue *rq, struct proc_struct *proc)
+{
+    if (proc == rq->cfs_curr)
+    {
+        cfs_update_curr(rq);
+        rq->cfs_curr = NULL;
+    }
+}
+
+/*
+ * cfs_get_proc detaches processes the load balancer may move to ``dst''
+ * from ``rq'', at most ``max'' of them, in the order they were queued.
+ */
+static int
+cfs_get_proc(struct run_queue *rq, struct run_queue *dst,
+             struct proc_struct *procs_moved[], int max)
+{
+    int n = 0;
+    list_entry_t *le = list_next(&(rq->run_list));
+    while (n < max && le != &(rq->run_list))
+    {
+        struct proc_struct *proc = le2proc(le, run_link);
+        le = list_next(le);
+        if (sched_can_migrate(proc, dst))
+        {
+            cfs_dequeue(rq, proc);
+            procs_moved[n++] = proc;
+        }
+    }
+    return n;
+}
+
+struct sched_class cfs_sched_class = {
+    .name = "cfs_scheduler",
+    .init = cfs_init,
+    .enqueue = cfs_enqueue,
+    .dequeue = cfs_dequeue,
+    .pick_next = cfs_pick_next,
+    .proc_tick = cfs_proc_tick,
+    .put_prev = cfs_put_prev,
+    .get_proc = cfs_get_proc,
+};
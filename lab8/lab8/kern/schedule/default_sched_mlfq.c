@@ -0,0 +1,199 @@
+#include <defs.h>
+#include <list.h>
+#include <proc.h>
+#include <smp.h>
+#include <assert.h>
+#include <stat.h>
+#include <default_sched.h>
+
+/*
+ * Multi-level feedback queue: a process starts at level 0, the highest,
+ * and drops one level each time it uses up the quantum of its level, so
+ * CPU hogs sink to the long quanta at the bottom. A process woken from
+ * input or another process's I/O goes back to level 0, so the shell runs
+ * as soon as a key comes in. The highest non-empty level is found in O(1)
+ * from a bitmap, and every MLFQ_BOOST_INTERVAL ticks everything is moved
+ * back to level 0, so the bottom levels don't starve.
+ */
+
+#define MLFQ_BOOST_INTERVAL 100 /* ticks between two boosts, 1s */
+
+/* quantum of each level, in ticks */
+static const int mlfq_quantum[MLFQ_LEVELS] = {1, 2, 4, 8};
+
+static inline void
+mlfq_queue_add(struct run_queue *rq, struct proc_struct *proc)
+{
+    list_add_before(&(rq->mlfq_queues[proc->mlfq_level]), &(proc->run_link));
+    rq->mlfq_bitmap |= 1 << proc->mlfq_level;
+}
+
+static inline void
+mlfq_queue_del(struct run_queue *rq, struct proc_struct *proc)
+{
+    list_del_init(&(proc->run_link));
+    if (list_empty(&(rq->mlfq_queues[proc->mlfq_level])))
+    {
+        rq->mlfq_bitmap &= ~(1 << proc->mlfq_level);
+    }
+}
+
+static void
+mlfq_init(struct run_queue *rq)
+{
+    int i;
+    list_init(&(rq->run_list));
+    for (i = 0; i < MLFQ_LEVELS; i++)
+    {
+        list_init(&(rq->mlfq_queues[i]));
+    }
+    rq->mlfq_bitmap = 0;
+    rq->mlfq_boost_ticks = MLFQ_BOOST_INTERVAL;
+    rq->proc_num = 0;
+}
+
+/*
+ * mlfq_enqueue puts ``proc'' at the tail of the queue of its level, with
+ * a fresh quantum if it used up the last one. A process woken from I/O
+ * moves up to level 0, and preempts the process running on the hart of
+ * ``rq'' if that one is at a lower level, unless it is a deadline process.
+ */
+static void
+mlfq_enqueue(struct run_queue *rq, struct proc_struct *proc)
+{
+    assert(list_empty(&(proc->run_link)));
+    if (WT_IS_IO(proc->wakeup_state) && proc->mlfq_level != 0)
+    {
+        proc->mlfq_level = 0;
+        proc->time_slice = 0;
+    }
+    if (proc->time_slice == 0)
+    {
+        proc->time_slice = mlfq_quantum[proc->mlfq_level];
+    }
+    mlfq_queue_add(rq, proc);
+    proc->rq = rq;
+    rq->proc_num++;
+
+    struct proc_struct *curr = rq2cpu(rq)->proc;
+    if (curr != NULL && curr != proc && curr->policy == SCHED_NORMAL
+            && curr->mlfq_level > proc->mlfq_level)
+    {
+        curr->need_resched = 1;
+    }
+}
+
+static void
+mlfq_dequeue(struct run_queue *rq, struct proc_struct *proc)
+{
+    assert(!list_empty(&(proc->run_link)) && proc->rq == rq);
+    mlfq_queue_del(rq, proc);
+    rq->proc_num--;
+}
+
+/*
+ * mlfq_pick_next returns the first process of the highest non-empty level.
+ */
+static struct proc_struct *
+mlfq_pick_next(struct run_queue *rq)
+{
+    if (rq->mlfq_bitmap == 0)
+    {
+        return NULL;
+    }
+    int level = __builtin_ctz(rq->mlfq_bitmap);
+    return le2proc(list_next(&(rq->mlfq_queues[level])), run_link);
+}
+
+/*
+ * mlfq_boost moves every process of ``rq'', and ``curr'' running on its
+ * hart, back to level 0 with a fresh quantum.
+ */
+static void
+mlfq_boost(struct run_queue *rq, struct proc_struct *curr)
+{
+    int level;
+    for (level = 1; level < MLFQ_LEVELS; level++)
+    {
+        list_entry_t *list = &(rq->mlfq_queues[level]), *le;
+        while ((le = list_next(list)) != list)
+        {
+            struct proc_struct *proc = le2proc(le, run_link);
+            mlfq_queue_del(rq, proc);
+            proc->mlfq_level = 0;
+            proc->time_slice = mlfq_quantum[0];
+            mlfq_queue_add(rq, proc);
+        }
+    }
+    curr->mlfq_level = 0;
+    curr->time_slice = mlfq_quantum[0];
+}
+
+/*
+ * mlfq_proc_tick charges the tick to ``proc''. Once its quantum is used up
+ * it drops a level and yields; it also yields to a process queued at a
+ * higher level.
+ */
+static void
+mlfq_proc_tick(struct run_queue *rq, struct proc_struct *proc)
+{
+    if (--rq->mlfq_boost_ticks <= 0)
+    {
+        rq->mlfq_boost_ticks = MLFQ_BOOST_INTERVAL;
+        mlfq_boost(rq, proc);
+        return;
+    }
+    if (proc->time_slice > 0)
+    {
+        proc->time_slice--;
+    }
+    if (proc->time_slice == 0)
+    {
+        if (proc->mlfq_level < MLFQ_LEVELS - 1)
+        {
+            proc->mlfq_level++;
+        }
+        proc->need_resched = 1;
+    }
+    else if (rq->mlfq_bitmap & ((1 << proc->mlfq_level) - 1))
+    {
+        proc->need_resched = 1;
+    }
+}
+
+/*
+ * mlfq_get_proc detaches processes the load balancer may move to ``dst''
+ * from ``rq'', at most ``max'' of them, from the lowest level up: the CPU
+ * hogs, which lose least by waiting for their cache to refill.
+ */
+static int
+mlfq_get_proc(struct run_queue *rq, struct run_queue *dst,
+              struct proc_struct *procs_moved[], int max)
+{
+    int level, n = 0;
+    for (level = MLFQ_LEVELS - 1; level >= 0 && n < max; level--)
+    {
+        list_entry_t *list = &(rq->mlfq_queues[level]), *le = list_next(list);
+        while (n < max && le != list)
+        {
+            struct proc_struct *proc = le2proc(le, run_link);
+            le = list_next(le);
+            if (sched_can_migrate(proc, dst))
+            {
+                mlfq_dequeue(rq, proc);
+                procs_moved[n++] = proc;
+            }
+        }
+    }
+    return n;
+}
+
+struct sched_class mlfq_sched_class = {
+    .name = "mlfq_scheduler",
+    .init = mlfq_init,
+    .enqueue = mlfq_enqueue,
+    .dequeue = mlfq_dequeue,
+    .pick_next = mlfq_pick_next,
+    .proc_tick = mlfq_proc_tick,
+    .get_proc = mlfq_get_proc,
+};
@@ -48,6 +48,7 @@ stride_init(struct run_queue *rq)
      */
     list_init(&(rq->run_list));
     rq->lab6_run_pool = NULL;
+    rq->lab6_min_stride = 0;
     rq->proc_num = 0;
 }
 
@@ -76,7 +77,15 @@ stride_enqueue(struct run_queue *rq, struct proc_struct *proc)
      * (3) set proc->rq pointer to rq
      * (4) increase rq->proc_num
      */
+    // strides only compare within a queue: one moved by the load balancer
+    // keeps its lead or lag over the queue it comes from
+    if (proc->rq != NULL && proc->rq != rq)
+    {
+        proc->lab6_stride += rq->lab6_min_stride - proc->rq->lab6_min_stride;
+    }
     rq->lab6_run_pool = skew_heap_insert(rq->lab6_run_pool, &(proc->lab6_run_pool), proc_stride_comp_f);
+    // the balancer walks run_list, the heap is for pick_next
+    list_add_before(&(rq->run_list), &(proc->run_link));
     if (proc->time_slice == 0 || proc->time_slice > rq->max_time_slice)
     {
         proc->time_slice = rq->max_time_slice;
@@ -105,6 +114,7 @@ stride_dequeue(struct run_queue *rq, struct proc_struct *proc)
      */
     assert(proc->rq == rq && rq->proc_num > 0);
     rq->lab6_run_pool = skew_heap_remove(rq->lab6_run_pool, &(proc->lab6_run_pool), proc_stride_comp_f);
+    list_del_init(&(proc->run_link));
     rq->proc_num--;
 }
 /*
@@ -135,7 +145,9 @@ stride_pick_next(struct run_queue *rq)
         return NULL;
     }
     struct proc_struct *proc = le2proc(rq->lab6_run_pool, lab6_run_pool);
-    proc->lab6_stride += BIG_STRIDE / proc->lab6_priority;
+    rq->lab6_min_stride = proc->lab6_stride;
+    // a process that never called lab6_set_priority has priority 0, i.e. 1
+    proc->lab6_stride += BIG_STRIDE / ((proc->lab6_priority != 0) ? proc->lab6_priority : 1);
     return proc;
 }
 
@@ -160,6 +172,30 @@ stride_proc_tick(struct run_queue *rq, struct proc_struct *proc)
     }
 }
 
+/*
+ * stride_get_proc detaches processes the load balancer may move to
+ * ``dst'' from ``rq'', at most ``max'' of them, in the order they were
+ * queued. stride_enqueue carries their stride over to the new queue.
+ */
+static int
+stride_get_proc(struct run_queue *rq, struct run_queue *dst,
+                struct proc_struct *procs_moved[], int max)
+{
+    int n = 0;
+    list_entry_t *le = list_next(&(rq->run_list));
+    while (n < max && le != &(rq->run_list))
+    {
+        struct proc_struct *proc = le2proc(le, run_link);
+        le = list_next(le);
+        if (sched_can_migrate(proc, dst))
+        {
+            stride_dequeue(rq, proc);
+            procs_moved[n++] = proc;
+        }
+    }
+    return n;
+}
+
 struct sched_class stride_sched_class = {
     .name = "stride_scheduler",
     .init = stride_init,
@@ -167,4 +203,5 @@ struct sched_class stride_sched_class = {
     .dequeue = stride_dequeue,
     .pick_next = stride_pick_next,
     .proc_tick = stride_proc_tick,
+    .get_proc = stride_get_proc,
 };
\ No newline at end of file
@@ -0,0 +1,166 @@
+#include <defs.h>
+#include <sync.h>
+#include <sbi.h>
+#include <proc.h>
+#include <smp.h>
+#include <sched.h>
+#include <clock.h>
+#include <assert.h>
+#include <rbtree.h>
+#include <hrtimer.h>
+
+/*
+ * High-resolution timers: a sleeper no longer waits for the tick it falls
+ * in, but for the cycle it asked for. Timers stay on the queue of the hart
+ * they were started on, which programs its timer interrupt for the first
+ * one (see clock_program); they are run from that interrupt, on that hart.
+ * Another hart may cancel one, so each queue has a lock of its own.
+ */
+
+static inline hrtimer_t *
+hrtimer_entry(rb_node_t *node)
+{
+    return rb_entry(node, hrtimer_t, node);
+}
+
+void hrtimer_queue_init(struct hrtimer_queue *queue)
+{
+    spinlock_init(&(queue->lock), "hrtimer");
+    queue->timeline = RB_ROOT;
+    queue->leftmost = NULL;
+}
+
+// hrtimer_dequeue - take TIMER off QUEUE, which is locked; TIMER still belongs to the hart
+static void
+hrtimer_dequeue(struct hrtimer_queue *queue, hrtimer_t *timer)
+{
+    if (queue->leftmost == &(timer->node))
+    {
+        queue->leftmost = rb_next(&(timer->node));
+    }
+    rb_erase(&(timer->node), &(queue->timeline));
+}
+
+/*
+ * hrtimer_start queues ``timer'' on this hart. If it expires before the
+ * timer interrupt the hart programmed, it brings the interrupt forward.
+ */
+void hrtimer_start(hrtimer_t *timer)
+{
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        struct cpu *cpu = mycpu();
+        struct hrtimer_queue *queue = &(cpu->hrtimers);
+        assert(timer->cpu == NULL && !timer->running && timer->proc != NULL);
+        spin_lock(&(queue->lock));
+        {
+            rb_node_t **link = &(queue->timeline.node), *parent = NULL;
+            bool leftmost = 1;
+            while (*link != NULL)
+            {
+                parent = *link;
+                if (timer->expires < hrtimer_entry(parent)->expires)
+                {
+                    link = &(parent->left);
+                }
+                else
+                {
+                    link = &(parent->right);
+                    leftmost = 0;
+                }
+            }
+            rb_link_node(&(timer->node), parent, link);
+            rb_insert_color(&(timer->node), &(queue->timeline));
+            if (leftmost)
+            {
+                queue->leftmost = &(timer->node);
+            }
+            timer->cpu = cpu;
+        }
+        spin_unlock(&(queue->lock));
+
+        if (timer->expires < cpu->next_event)
+        {
+            cpu->next_event = timer->expires;
+            sbi_set_timer(timer->expires);
+        }
+    }
+    local_intr_restore(intr_flag);
+}
+
+/*
+ * hrtimer_cancel takes ``timer'' off the queue it is on, if it has not
+ * expired yet; it may be called on any hart. The interrupt programmed for
+ * it, if any, finds nothing to do. If its hart is running it, this waits
+ * until it is done: the caller may free ``timer'' once this returns.
+ */
+void hrtimer_cancel(hrtimer_t *timer)
+{
+    bool intr_flag, running;
+    struct cpu *cpu = timer->cpu;
+    if (cpu == NULL)
+    {
+        return;
+    }
+    do
+    {
+        spin_lock_irqsave(&(cpu->hrtimers.lock), intr_flag);
+        {
+            if ((running = timer->running) == 0 && timer->cpu == cpu)
+            {
+                hrtimer_dequeue(&(cpu->hrtimers), timer);
+                timer->cpu = NULL;
+            }
+        }
+        spin_unlock_irqrestore(&(cpu->hrtimers.lock), intr_flag);
+    } while (running);
+}
+
+/*
+ * hrtimer_run wakes up the processes whose timers on this hart have
+ * expired. Called from the timer interrupt; the lock is dropped around
+ * wakeup_proc, which may program the timer of the hart again. Meanwhile
+ * the timer is marked running, so that hrtimer_cancel waits for it.
+ */
+void hrtimer_run(void)
+{
+    struct hrtimer_queue *queue = &(mycpu()->hrtimers);
+    spin_lock(&(queue->lock));
+    while (queue->leftmost != NULL)
+    {
+        hrtimer_t *timer = hrtimer_entry(queue->leftmost);
+        if (timer->expires > get_cycles())
+        {
+            break;
+        }
+        struct proc_struct *proc = timer->proc;
+        hrtimer_dequeue(queue, timer);
+        timer->running = 1;
+        spin_unlock(&(queue->lock));
+        // a signal may have woken it first, it waits in hrtimer_cancel then
+        if (proc->wait_state == WT_TIMER)
+        {
+            wakeup_proc(proc);
+        }
+        spin_lock(&(queue->lock));
+        timer->running = 0, timer->cpu = NULL;
+    }
+    spin_unlock(&(queue->lock));
+}
+
+// hrtimer_next_expiry - set *EXPIRES to the cycle the first timer on CPU expires at, return 0 if it has none
+bool hrtimer_next_expiry(struct cpu *cpu, uint64_t *expires)
+{
+    bool intr_flag, found = 0;
+    spin_lock_irqsave(&(cpu->hrtimers.lock), intr_flag);
+    {
+        if (cpu->hrtimers.leftmost != NULL)
+        {
+            *expires = hrtimer_entry(cpu->hrtimers.leftmost)->expires;
+            found = 1;
+        }
+    }
+    spin_unlock_irqrestore(&(cpu->hrtimers.lock), intr_flag);
+    return found;
+}
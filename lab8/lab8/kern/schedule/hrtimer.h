@@ -0,0 +1,47 @@
+#ifndef __KERN_SCHEDULE_HRTIMER_H__
+#define __KERN_SCHEDULE_HRTIMER_H__
+
+#include <defs.h>
+#include <rbtree.h>
+#include <spinlock.h>
+
+struct proc_struct;
+struct cpu;
+
+/*
+ * A one-shot high-resolution timer, keyed on the time CSR rather than on
+ * ticks: it wakes up proc once get_cycles() reaches expires. Each hart
+ * keeps the timers started on it in a red-black tree by expiry, and
+ * programs its timer interrupt for the first one.
+ */
+typedef struct hrtimer {
+    uint64_t expires;           // cycles
+    struct proc_struct *proc;   // the proc woken up when it expires
+    rb_node_t node;             // the entry in the queue of its hart
+    struct cpu *cpu;            // the hart whose queue it is on, NULL once expired or cancelled
+    bool running;               // expired and being run by its hart, which still has it
+} hrtimer_t;
+
+// the hrtimers started on a hart, in struct cpu
+struct hrtimer_queue {
+    spinlock_t lock;
+    rb_root_t timeline;         // pending timers by expiry
+    rb_node_t *leftmost;        // the one that expires first
+};
+
+static inline hrtimer_t *
+hrtimer_init(hrtimer_t *timer, struct proc_struct *proc, uint64_t expires) {
+    timer->expires = expires;
+    timer->proc = proc;
+    timer->cpu = NULL;
+    timer->running = 0;
+    return timer;
+}
+
+void hrtimer_queue_init(struct hrtimer_queue *queue);
+void hrtimer_start(hrtimer_t *timer);           // queue timer on this hart
+void hrtimer_cancel(hrtimer_t *timer);          // take timer off its hart's queue, or wait until it has run
+void hrtimer_run(void);                         // wake up the processes whose timers on this hart expired
+bool hrtimer_next_expiry(struct cpu *cpu, uint64_t *expires);
+
+#endif /* !__KERN_SCHEDULE_HRTIMER_H__ */
@@ -5,76 +5,343 @@
 #include <stdio.h>
 #include <assert.h>
 #include <default_sched.h>
+#include <smp.h>
+#include <stat.h>
 
-// the list of timer
-static list_entry_t timer_list;
+/*
+ * Pending timers live in a hierarchical timing wheel, the way Linux kept
+ * them before 4.8. Level 0 has a slot for each of the next TIMER_LVL0_SIZE
+ * ticks, and each higher level has TIMER_LVL_SIZE slots, each for a span
+ * of ticks as long as all the slots of the level below. A timer goes in
+ * the slot its expiry falls in on the lowest level that reaches it, so
+ * add_timer and del_timer are O(1). When level 0 wraps around, the next
+ * slot of level 1 is cascaded: its timers are added again, which puts
+ * them on level 0 now that they are close, and so on up the levels. A
+ * bitmap of the slots that are not empty lets timer_next_expiry find the
+ * earliest timer without walking them all.
+ */
+#define TIMER_LVL0_BITS 8
+#define TIMER_LVL_BITS 6
+#define TIMER_LEVELS 5                                  // 8 + 4 * 6 bits reach any unsigned int tick
+#define TIMER_LVL0_SIZE (1 << TIMER_LVL0_BITS)
+#define TIMER_LVL_SIZE (1 << TIMER_LVL_BITS)
+#define TIMER_SLOTS (TIMER_LVL0_SIZE + (TIMER_LEVELS - 1) * TIMER_LVL_SIZE)
+
+// lowest tick bit of the slots of level n, their # and where they start in timer_slots
+#define TIMER_LVL_SHIFT(n) ((n) == 0 ? 0 : TIMER_LVL0_BITS + ((n) - 1) * TIMER_LVL_BITS)
+#define TIMER_LVL_SLOTS(n) ((n) == 0 ? TIMER_LVL0_SIZE : TIMER_LVL_SIZE)
+#define TIMER_LVL_OFFS(n) ((n) == 0 ? 0 : TIMER_LVL0_SIZE + ((n) - 1) * TIMER_LVL_SIZE)
+
+static list_entry_t timer_slots[TIMER_SLOTS];
+static uint64_t timer_bitmap[TIMER_SLOTS / 64];        // bit i set if timer_slots[i] is not empty
+static unsigned int timer_jiffies;                      // the next tick run_timer_list has to run
+// guards the wheel: timers are added on every hart, and run on the boot hart
+static spinlock_t timer_lock = SPINLOCK_INIT("timer");
+
+// ticks wrap around: compare the difference
+#define time_before(a, b) ((int)((a) - (b)) < 0)
+
+// the class of all run queues: default_sched_class (RR), stride_sched_class, cfs_sched_class or mlfq_sched_class
+#ifndef SCHED_CLASS
+#define SCHED_CLASS default_sched_class
+#endif
 
 static struct sched_class *sched_class;
 
-static struct run_queue *rq;
+/*
+ * Every hart has a run queue of its own, in struct cpu, guarded by its lock.
+ * schedule() switches with the lock of its hart held, and the process it
+ * switched to releases it, wherever it had called schedule() from (or in
+ * schedule_tail() if it is new). So a process that is being switched away
+ * from can't be run by another hart, or put on a queue, before its context
+ * is saved: a sleeping process is always woken onto the queue of the hart it
+ * last ran on.
+ */
+
+/*
+ * Deadline processes are served by dl_sched_class, the others by the fair
+ * class the kernel was built with, sched_class. Both share each run queue;
+ * a deadline process that is queued always runs before a fair one.
+ */
+static inline struct sched_class *
+proc_sched_class(struct proc_struct *proc)
+{
+    return (proc->policy == SCHED_DEADLINE) ? &dl_sched_class : sched_class;
+}
 
 static inline void
-sched_class_enqueue(struct proc_struct *proc)
+sched_class_enqueue(struct run_queue *rq, struct proc_struct *proc)
 {
     if (proc != idleproc)
     {
-        sched_class->enqueue(rq, proc);
+        proc_sched_class(proc)->enqueue(rq, proc);
+        proc->wakeup_state = 0;
     }
 }
 
 static inline void
-sched_class_dequeue(struct proc_struct *proc)
+sched_class_dequeue(struct run_queue *rq, struct proc_struct *proc)
 {
-    sched_class->dequeue(rq, proc);
+    proc_sched_class(proc)->dequeue(rq, proc);
 }
 
 static inline struct proc_struct *
-sched_class_pick_next(void)
+sched_class_pick_next(struct run_queue *rq)
 {
-    return sched_class->pick_next(rq);
+    struct proc_struct *next;
+    if ((next = dl_sched_class.pick_next(rq)) == NULL)
+    {
+        next = sched_class->pick_next(rq);
+    }
+    return next;
+}
+
+static inline void
+sched_class_put_prev(struct run_queue *rq, struct proc_struct *proc)
+{
+    struct sched_class *class = proc_sched_class(proc);
+    if (proc != idleproc && class->put_prev != NULL)
+    {
+        class->put_prev(rq, proc);
+    }
 }
 
 static void
-sched_class_proc_tick(struct proc_struct *proc)
+sched_class_proc_tick(struct run_queue *rq, struct proc_struct *proc)
 {
-    if (proc != idleproc)
+    // replenishes the throttled deadline processes, whatever is running
+    dl_sched_class.proc_tick(rq, proc);
+    if (proc == idleproc)
+    {
+        proc->need_resched = 1;
+    }
+    else if (proc->policy != SCHED_DEADLINE)
     {
         sched_class->proc_tick(rq, proc);
     }
+}
+
+void sched_init(void)
+{
+    int slot;
+    for (slot = 0; slot < TIMER_SLOTS; slot++)
+    {
+        list_init(&(timer_slots[slot]));
+    }
+    timer_jiffies = ticks + 1;
+
+    sched_class = &SCHED_CLASS;
+
+    int i;
+    for (i = 0; i < NCPU; i++)
+    {
+        struct run_queue *rq = &(cpus[i].rq);
+        spinlock_init(&(rq->lock), "rq");
+        rq->max_time_slice = MAX_TIME_SLICE;
+        rq->balance_ticks = SCHED_BALANCE_INTERVAL;
+        hrtimer_queue_init(&(cpus[i].hrtimers));
+        sched_class->init(rq);
+        dl_sched_class.init(rq);
+    }
+
+    cprintf("sched class: %s\n", sched_class->name);
+}
+
+// cpu_load - # of processes a hart has to run, the running one included
+static inline unsigned int
+cpu_load(struct cpu *cpu)
+{
+    return cpu->rq.proc_num + (cpu->proc != cpu->idle);
+}
+
+// rq_fair_num - # of processes queued in the fair class, the only ones the balancer moves
+static inline unsigned int
+rq_fair_num(struct run_queue *rq)
+{
+    return rq->proc_num - rq->dl_num;
+}
+
+// sched_select_cpu - the hart a process that never ran starts on: the least loaded one
+static struct cpu *
+sched_select_cpu(void)
+{
+    struct cpu *cpu, *best = mycpu();
+    for_each_cpu(cpu)
+    {
+        if (cpu_load(cpu) < cpu_load(best))
+        {
+            best = cpu;
+        }
+    }
+    return best;
+}
+
+/*
+ * sched_can_migrate - may the load balancer move PROC to DST? Not if it left
+ * its hart less than SCHED_MIGRATION_COST ago: its cache is still there, and
+ * refilling it elsewhere costs more than waiting a little. Once balancing
+ * DST failed SCHED_CACHE_NICE_TRIES times in a row, hot processes move too.
+ */
+bool sched_can_migrate(struct proc_struct *proc, struct run_queue *dst)
+{
+    // preempted in the kernel, it may still use what it read off its hart
+    if (proc->kernel_preempted)
+    {
+        return 0;
+    }
+    if (dst->balance_failed >= SCHED_CACHE_NICE_TRIES)
+    {
+        return 1;
+    }
+    return get_cycles() - proc->last_ran >= SCHED_MIGRATION_COST;
+}
+
+// double_rq_lock - lock two run queues, lower hart id first so two balancers can't deadlock
+static void
+double_rq_lock(struct cpu *a, struct cpu *b)
+{
+    if (a->id < b->id)
+    {
+        spin_lock(&(a->rq.lock));
+        spin_lock(&(b->rq.lock));
+    }
     else
     {
-        proc->need_resched = 1;
+        spin_lock(&(b->rq.lock));
+        spin_lock(&(a->rq.lock));
     }
 }
 
-static struct run_queue __rq;
+static void
+double_rq_unlock(struct cpu *a, struct cpu *b)
+{
+    spin_unlock(&(a->rq.lock));
+    spin_unlock(&(b->rq.lock));
+}
 
-void sched_init(void)
+/*
+ * sched_balance - pull runnable processes from the busiest hart to THIS.
+ * An IDLE hart (nothing to run but its idle process) steals as soon as
+ * another one has a process waiting; otherwise processes are only moved
+ * when the busiest hart has at least two more than THIS, so that a move
+ * leaves them closer to even instead of swapping the imbalance. Deadline
+ * processes count in the load but stay on their hart, so only a hart with
+ * fair processes waiting is a source. Called with interrupts disabled and
+ * no run queue locked.
+ */
+static void
+sched_balance(struct cpu *this, bool idle)
 {
-    list_init(&timer_list);
+    struct cpu *cpu, *busiest = NULL;
+    unsigned int this_load = idle ? 0 : cpu_load(this), max_load = 0;
+    for_each_cpu(cpu)
+    {
+        // the loads are read unlocked, and checked again below
+        if (cpu != this && rq_fair_num(&(cpu->rq)) > 0 && cpu_load(cpu) > max_load)
+        {
+            busiest = cpu, max_load = cpu_load(cpu);
+        }
+    }
+    if (busiest == NULL || (!idle && max_load < this_load + 2))
+    {
+        return;
+    }
 
-    sched_class = &default_sched_class;
+    struct run_queue *rq = &(this->rq), *src = &(busiest->rq);
+    struct proc_struct *procs_moved[SCHED_MAX_MOVE];
+    int i, n = 0;
+    double_rq_lock(this, busiest);
+    {
+        max_load = cpu_load(busiest);
+        if (rq_fair_num(src) > 0 && (idle || max_load >= this_load + 2))
+        {
+            int max = (max_load - this_load) / 2;
+            if (max == 0)
+            {
+                max = 1;
+            }
+            if (max > rq_fair_num(src))
+            {
+                max = rq_fair_num(src);
+            }
+            rq->nr_balance++;
+            n = sched_class->get_proc(src, rq, procs_moved, (max < SCHED_MAX_MOVE) ? max : SCHED_MAX_MOVE);
+            for (i = 0; i < n; i++)
+            {
+                procs_moved[i]->cpu = this;
+                sched_class->enqueue(rq, procs_moved[i]);
+            }
+            src->nr_migrations_out += n;
+            rq->nr_migrations_in += n;
+            // all were cache-hot: wait, but not forever
+            rq->balance_failed = (n == 0) ? rq->balance_failed + 1 : 0;
+        }
+    }
+    double_rq_unlock(this, busiest);
 
-    rq = &__rq;
-    rq->max_time_slice = MAX_TIME_SLICE;
-    sched_class->init(rq);
+    if (n != 0 && this->proc == this->idle)
+    {
+        this->idle->need_resched = 1;
+    }
+}
 
-    cprintf("sched class: %s\n", sched_class->name);
+/*
+ * sched_need_tick - does CPU need its periodic tick? Only to share it out:
+ * when processes wait on its run queue, to charge a deadline process for
+ * its budget, or to replenish throttled ones. With one process to run, or
+ * none, it can stop the tick. Read unlocked: whoever queues a process
+ * starts the tick again with sched_restart_tick.
+ */
+bool sched_need_tick(struct cpu *cpu)
+{
+    struct run_queue *rq = &(cpu->rq);
+    struct proc_struct *proc = cpu->proc;
+    return rq->proc_num > 0 || !list_empty(&(rq->dl_throttled))
+           || (proc != NULL && proc->policy == SCHED_DEADLINE);
+}
+
+// sched_restart_tick - start the tick of CPU again if it stopped it but needs it now; no run queue locked
+static void
+sched_restart_tick(struct cpu *cpu)
+{
+    if (cpu->tickless && sched_need_tick(cpu))
+    {
+        smp_send_tick(cpu);
+    }
 }
 
 void wakeup_proc(struct proc_struct *proc)
 {
     assert(proc->state != PROC_ZOMBIE);
     bool intr_flag;
-    local_intr_save(intr_flag);
+    struct cpu *cpu = (proc->cpu != NULL) ? proc->cpu : sched_select_cpu();
+    struct run_queue *rq = &(cpu->rq);
+    spin_lock_irqsave(&(rq->lock), intr_flag);
     {
         if (proc->state != PROC_RUNNABLE)
         {
             proc->state = PROC_RUNNABLE;
+            // what it waited for, for the class; cleared once it is queued
+            proc->wakeup_state = proc->wait_state;
             proc->wait_state = 0;
-            if (proc != current)
+            // a process still running on its hart puts itself back when it calls schedule()
+            if (proc != cpu->proc)
             {
-                sched_class_enqueue(proc);
+                proc->cpu = cpu;
+                proc->wakeup_cycles = get_cycles();
+                sched_class_enqueue(rq, proc);
+                // an idle hart, or one whose process the class asked to give way, switches now
+                if (cpu->proc == cpu->idle || cpu->proc->need_resched)
+                {
+                    if (cpu == mycpu())
+                    {
+                        cpu->proc->need_resched = 1;
+                    }
+                    else
+                    {
+                        smp_send_resched(cpu);
+                    }
+                }
             }
         }
         else
@@ -82,100 +349,410 @@ void wakeup_proc(struct proc_struct *proc)
             warn("wakeup runnable process.\n");
         }
     }
-    local_intr_restore(intr_flag);
+    spin_unlock_irqrestore(&(rq->lock), intr_flag);
+    sched_restart_tick(cpu);
 }
 
 void schedule(void)
 {
     bool intr_flag;
     struct proc_struct *next;
+    // no process holds the big kernel lock while switched out
+    int depth = kernel_lock_release();
     local_intr_save(intr_flag);
     {
+        struct cpu *cpu = mycpu();
+        struct run_queue *rq = &(cpu->rq);
+        // about to go idle: look for work on the other harts first
+        if (ncpu > 1 && rq->proc_num == 0 && (current == idleproc || current->state != PROC_RUNNABLE))
+        {
+            sched_balance(cpu, 1);
+        }
+        spin_lock(&(rq->lock));
         current->need_resched = 0;
+        sched_class_put_prev(rq, current);
         if (current->state == PROC_RUNNABLE)
         {
-            sched_class_enqueue(current);
+            sched_class_enqueue(rq, current);
         }
-        if ((next = sched_class_pick_next()) != NULL)
+        if ((next = sched_class_pick_next(rq)) != NULL)
         {
-            sched_class_dequeue(next);
+            sched_class_dequeue(rq, next);
         }
         if (next == NULL)
         {
             next = idleproc;
         }
         next->runs++;
+        next->cpu = cpu;
         if (next != current)
         {
+            rq->nr_switches++;
+            current->last_ran = get_cycles();
+            if (next->wakeup_cycles != 0)
+            {
+                // the scheduling latency: how long it waited to run since it was woken
+                if (current->last_ran - next->wakeup_cycles > rq->max_latency)
+                {
+                    rq->max_latency = current->last_ran - next->wakeup_cycles;
+                }
+                next->wakeup_cycles = 0;
+            }
             proc_run(next);
         }
+        // back here maybe on another hart: release the queue of the hart that switched to us
+        spin_unlock(&(mycpu()->rq.lock));
+        // the load balancer may have left processes waiting here
+        sched_restart_tick(mycpu());
     }
     local_intr_restore(intr_flag);
+    kernel_lock_reacquire(depth);
 }
 
-// add timer to timer_list
-void add_timer(timer_t *timer)
+/*
+ * preempt_schedule - switch away from the current process in the middle of
+ * kernel code that had interrupts on, if a reschedule is pending. Not the
+ * idle process, which reschedules by itself, nor one that disabled
+ * preemption, nor one already on its way to sleep or exit, which calls
+ * schedule() soon anyway and must not be queued as runnable meanwhile.
+ */
+void preempt_schedule(void)
 {
     bool intr_flag;
     local_intr_save(intr_flag);
     {
-        assert(timer->expires > 0 && timer->proc != NULL);
-        assert(list_empty(&(timer->timer_link)));
-        list_entry_t *le = list_next(&timer_list);
-        while (le != &timer_list)
+        struct proc_struct *proc = current;
+        if (proc != NULL && proc != idleproc && proc->need_resched
+                && proc->preempt_count == 0 && proc->state == PROC_RUNNABLE)
         {
-            timer_t *next = le2timer(le, timer_link);
-            if (timer->expires < next->expires)
-            {
-                next->expires -= timer->expires;
-                break;
-            }
-            timer->expires -= next->expires;
-            le = list_next(le);
+            // kept on this hart until it runs again, see sched_can_migrate
+            proc->kernel_preempted = 1;
+            mycpu()->rq.nr_preemptions++;
+            schedule();
+            proc->kernel_preempted = 0;
         }
-        list_add_before(le, &(timer->timer_link));
     }
     local_intr_restore(intr_flag);
 }
 
-// del timer from timer_list
-void del_timer(timer_t *timer)
+#if KERNEL_PREEMPT
+void preempt_disable(void)
+{
+    struct proc_struct *proc = current;
+    if (proc != NULL)
+    {
+        proc->preempt_count++;
+    }
+}
+
+// preempt_enable - the outermost one switches now if a reschedule came while preemption was disabled
+void preempt_enable(void)
+{
+    struct proc_struct *proc = current;
+    if (proc != NULL && --proc->preempt_count == 0 && (read_csr(sstatus) & SSTATUS_SIE))
+    {
+        preempt_schedule();
+    }
+}
+#endif /* KERNEL_PREEMPT */
+
+// sched_wait_off_cpu - wait until PROC, a zombie, no longer runs on any hart
+void sched_wait_off_cpu(struct proc_struct *proc)
+{
+    struct cpu *cpu = proc->cpu;
+    bool intr_flag, running = (cpu != NULL);
+    while (running)
+    {
+        // a switch away from it holds the run queue lock until it is done
+        spin_lock_irqsave(&(cpu->rq.lock), intr_flag);
+        running = (cpu->proc == proc);
+        spin_unlock_irqrestore(&(cpu->rq.lock), intr_flag);
+    }
+}
+
+// schedule_tail - the first thing a new process does, in place of returning from schedule()
+void schedule_tail(void)
+{
+    spin_unlock(&(mycpu()->rq.lock));
+}
+
+/*
+ * sched_kick_idle - a hart that went idle stopped its tick, so it doesn't
+ * look for work again by itself: if THIS has processes waiting, wake one
+ * such hart up to balance.
+ */
+static void
+sched_kick_idle(struct cpu *this)
+{
+    struct cpu *cpu;
+    if (this->rq.proc_num == 0)
+    {
+        return;
+    }
+    for_each_cpu(cpu)
+    {
+        if (cpu != this && cpu->proc == cpu->idle && cpu->tickless && cpu->rq.proc_num == 0)
+        {
+            smp_send_resched(cpu);
+            return;
+        }
+    }
+}
+
+// sched_tick - charge the tick to the process running on this hart, and balance the load now and then
+void sched_tick(void)
+{
+    bool intr_flag;
+    struct cpu *cpu = mycpu();
+    struct run_queue *rq = &(cpu->rq);
+    spin_lock_irqsave(&(rq->lock), intr_flag);
+    {
+        if (current)
+            sched_class_proc_tick(rq, current);
+    }
+    spin_unlock_irqrestore(&(rq->lock), intr_flag);
+
+    // an idle hart balances from schedule(), its idle process reschedules on every tick it takes
+    if (ncpu > 1 && current != idleproc && --rq->balance_ticks <= 0)
+    {
+        rq->balance_ticks = SCHED_BALANCE_INTERVAL;
+        local_intr_save(intr_flag);
+        sched_balance(cpu, 0);
+        local_intr_restore(intr_flag);
+        sched_kick_idle(cpu);
+    }
+}
+
+// sched_getstat - the load and counters of the first N harts online, return the # filled in
+int sched_getstat(struct schedstat *stats, int n)
+{
+    struct cpu *cpu;
+    int i = 0;
+    for_each_cpu(cpu)
+    {
+        if (i == n)
+        {
+            break;
+        }
+        struct run_queue *rq = &(cpu->rq);
+        stats[i].ss_hartid = cpu->id;
+        stats[i].ss_load = cpu_load(cpu);
+        stats[i].ss_switches = rq->nr_switches;
+        stats[i].ss_balance = rq->nr_balance;
+        stats[i].ss_migrations_in = rq->nr_migrations_in;
+        stats[i].ss_migrations_out = rq->nr_migrations_out;
+        stats[i].ss_ticks = cpu->nr_ticks;
+        stats[i].ss_tickless = cpu->nr_tickless;
+        stats[i].ss_idle_usec = CYCLES_TO_USEC(cpu->idle_cycles);
+        stats[i].ss_preemptions = rq->nr_preemptions;
+        stats[i].ss_max_latency_usec = CYCLES_TO_USEC(rq->max_latency);
+        i++;
+    }
+    return i;
+}
+
+/*
+ * sched_setattr - move current process to POLICY. SCHED_DEADLINE reserves
+ * RUNTIME cycles of every PERIOD, to be run DEADLINE cycles after a period
+ * starts, on the hart it runs on: -E_BUSY if the deadline processes there
+ * would need more than DL_BW_LIMIT of it. SCHED_NORMAL gives back what
+ * it reserved.
+ */
+int sched_setattr(int policy, uint64_t runtime, uint64_t deadline, uint64_t period)
 {
     bool intr_flag;
+    struct run_queue *rq;
+    int ret;
     local_intr_save(intr_flag);
+    {
+        rq = &(mycpu()->rq);
+        spin_lock(&(rq->lock));
+        if ((ret = dl_admit(rq, current, policy, runtime, period)) == 0)
+        {
+            sched_class_put_prev(rq, current);
+            dl_setattr(rq, current, policy, runtime, deadline, period);
+            current->need_resched = 1;
+        }
+        spin_unlock(&(rq->lock));
+    }
+    local_intr_restore(intr_flag);
+    return ret;
+}
+
+// timer_wheel_add - put TIMER, whose expires is a tick, in its slot of the wheel
+static void
+timer_wheel_add(timer_t *timer)
+{
+    unsigned int delta = timer->expires - timer_jiffies;
+    int level = 0;
+    if (time_before(timer->expires, timer_jiffies))
+    {
+        // already due: run on the next tick
+        timer->slot = timer_jiffies & (TIMER_LVL0_SIZE - 1);
+    }
+    else
+    {
+        while (level < TIMER_LEVELS - 1 && delta >= (1U << TIMER_LVL_SHIFT(level + 1)))
+        {
+            level++;
+        }
+        timer->slot = TIMER_LVL_OFFS(level)
+                      + ((timer->expires >> TIMER_LVL_SHIFT(level)) & (TIMER_LVL_SLOTS(level) - 1));
+    }
+    list_add_before(&(timer_slots[timer->slot]), &(timer->timer_link));
+    timer_bitmap[timer->slot / 64] |= 1ULL << (timer->slot % 64);
+}
+
+static void
+timer_wheel_del(timer_t *timer)
+{
+    list_del_init(&(timer->timer_link));
+    if (list_empty(&(timer_slots[timer->slot])))
+    {
+        timer_bitmap[timer->slot / 64] &= ~(1ULL << (timer->slot % 64));
+    }
+}
+
+// timer_find_slot - the first slot in [FIRST, LAST) that is not empty, -1 if there is none
+static int
+timer_find_slot(int first, int last)
+{
+    while (first < last)
+    {
+        uint64_t word = timer_bitmap[first / 64] & (~0ULL << (first % 64));
+        if (word != 0)
+        {
+            int slot = (first & ~63) + __builtin_ctzll(word);
+            return (slot < last) ? slot : -1;
+        }
+        first = (first & ~63) + 64;
+    }
+    return -1;
+}
+
+// timer_cascade - add the timers of SLOT of a higher level again, closer to level 0
+static void
+timer_cascade(int slot)
+{
+    list_entry_t *list = &(timer_slots[slot]), *le;
+    while ((le = list_next(list)) != list)
+    {
+        timer_t *timer = le2timer(le, timer_link);
+        timer_wheel_del(timer);
+        timer_wheel_add(timer);
+    }
+}
+
+// add timer to the wheel, to expire timer->expires ticks from now
+void add_timer(timer_t *timer)
+{
+    bool intr_flag;
+    spin_lock_irqsave(&timer_lock, intr_flag);
+    {
+        assert(timer->expires > 0 && timer->proc != NULL);
+        assert(list_empty(&(timer->timer_link)));
+        // relative to the last tick run, which may be behind ticks
+        timer->expires += timer_jiffies - 1;
+        timer_wheel_add(timer);
+    }
+    spin_unlock_irqrestore(&timer_lock, intr_flag);
+    // a hart without a tick programs its next interrupt for the timers it knows of
+    if (mycpu()->tickless)
+    {
+        clock_start_tick();
+    }
+}
+
+// del timer from the wheel, if it has not expired yet
+void del_timer(timer_t *timer)
+{
+    bool intr_flag;
+    spin_lock_irqsave(&timer_lock, intr_flag);
     {
         if (!list_empty(&(timer->timer_link)))
         {
-            if (timer->expires != 0)
+            timer_wheel_del(timer);
+        }
+    }
+    spin_unlock_irqrestore(&timer_lock, intr_flag);
+}
+
+/*
+ * timer_next_expiry - set *EXPIRES to the tick the earliest pending timer
+ * expires at, return 0 if there is no timer. The first slot that is not
+ * empty on level 0, before it wraps around, holds it, unless a cascade is
+ * due on the next tick; otherwise it is the earliest one of that slot
+ * after the wrap, and of the first such slot of each higher level, from
+ * the slot that level cascades next.
+ */
+bool timer_next_expiry(unsigned int *expires)
+{
+    bool intr_flag, found = 0, earliest = 0;
+    spin_lock_irqsave(&timer_lock, intr_flag);
+    {
+        unsigned int now = timer_jiffies, base = now & ~(TIMER_LVL0_SIZE - 1);
+        int level, slot, index = now & (TIMER_LVL0_SIZE - 1);
+        if ((slot = timer_find_slot(index, TIMER_LVL0_SIZE)) >= 0)
+        {
+            *expires = base + slot, found = 1;
+            earliest = (index != 0);
+        }
+        else if ((slot = timer_find_slot(0, index)) >= 0)
+        {
+            *expires = base + TIMER_LVL0_SIZE + slot, found = 1;
+        }
+        for (level = 1; level < TIMER_LEVELS && !earliest; level++)
+        {
+            int offs = TIMER_LVL_OFFS(level), next = (now >> TIMER_LVL_SHIFT(level)) & (TIMER_LVL_SIZE - 1);
+            // the slot of this span of ticks is cascaded when its first tick is run
+            if ((now & ((1U << TIMER_LVL_SHIFT(level)) - 1)) != 0)
+            {
+                next = (next + 1) & (TIMER_LVL_SIZE - 1);
+            }
+            if ((slot = timer_find_slot(offs + next, offs + TIMER_LVL_SIZE)) < 0
+                    && (slot = timer_find_slot(offs, offs + next)) < 0)
+            {
+                continue;
+            }
+            list_entry_t *list = &(timer_slots[slot]), *le = list;
+            while ((le = list_next(le)) != list)
             {
-                list_entry_t *le = list_next(&(timer->timer_link));
-                if (le != &timer_list)
+                timer_t *timer = le2timer(le, timer_link);
+                if (!found || time_before(timer->expires, *expires))
                 {
-                    timer_t *next = le2timer(le, timer_link);
-                    next->expires += timer->expires;
+                    *expires = timer->expires, found = 1;
                 }
             }
-            list_del_init(&(timer->timer_link));
         }
     }
-    local_intr_restore(intr_flag);
+    spin_unlock_irqrestore(&timer_lock, intr_flag);
+    return found;
 }
 
-// call scheduler to update tick related info, and check the timer is expired? If expired, then wakup proc
+/*
+ * run_timer_list - run the wheel up to the current tick: cascade the
+ * higher levels as level 0 wraps around, and wake up the processes whose
+ * timers expire; then charge the tick to the scheduler.
+ */
 void run_timer_list(void)
 {
     bool intr_flag;
     local_intr_save(intr_flag);
     {
-        list_entry_t *le = list_next(&timer_list);
-        if (le != &timer_list)
+        spin_lock(&timer_lock);
+        while (!time_before(ticks, timer_jiffies))
         {
-            timer_t *timer = le2timer(le, timer_link);
-            assert(timer->expires != 0);
-            timer->expires--;
-            while (timer->expires == 0)
+            int level, index = timer_jiffies & (TIMER_LVL0_SIZE - 1);
+            for (level = 1; index == 0 && level < TIMER_LEVELS; level++)
+            {
+                index = (timer_jiffies >> TIMER_LVL_SHIFT(level)) & (TIMER_LVL_SIZE - 1);
+                timer_cascade(TIMER_LVL_OFFS(level) + index);
+            }
+
+            list_entry_t *list = &(timer_slots[timer_jiffies & (TIMER_LVL0_SIZE - 1)]), *le;
+            while ((le = list_next(list)) != list)
             {
-                le = list_next(le);
+                timer_t *timer = le2timer(le, timer_link);
                 struct proc_struct *proc = timer->proc;
                 if (proc->wait_state != 0)
                 {
@@ -185,17 +762,14 @@ void run_timer_list(void)
                 {
                     warn("process %d's wait_state == 0.\n", proc->pid);
                 }
+                // off the wheel first: the process frees it once it runs
+                timer_wheel_del(timer);
                 wakeup_proc(proc);
-                del_timer(timer);
-                if (le == &timer_list)
-                {
-                    break;
-                }
-                timer = le2timer(le, timer_link);
             }
+            timer_jiffies++;
         }
-        if (current)
-            sched_class_proc_tick(current);
+        spin_unlock(&timer_lock);
+        sched_tick();
     }
     local_intr_restore(intr_flag);
 }
@@ -4,15 +4,32 @@
 #include <defs.h>
 #include <list.h>
 #include <skew_heap.h>
+#include <rbtree.h>
+#include <spinlock.h>
+#include <clock.h>
 
 #define MAX_TIME_SLICE 5
 
+#define MLFQ_LEVELS 4                                   // priority levels of the MLFQ class
+
+// load balancing between the harts' run queues, see sched_balance
+#define SCHED_BALANCE_INTERVAL 4                        // ticks between two periodic balances of a busy hart
+#define SCHED_MIGRATION_COST (TIMEBASE_FREQ / 2000)     // cycles a switched out process stays cache-hot, 0.5ms
+#define SCHED_CACHE_NICE_TRIES 2                        // failed balances before cache-hot processes are moved too
+#define SCHED_MAX_MOVE 4                                // processes moved by one balance at most
+
+// admission control of the deadline class, see sched_deadline.c
+#define DL_BW_SHIFT 20                                  // bandwidth (runtime / period) fixed point
+#define DL_BW_LIMIT ((95 << DL_BW_SHIFT) / 100)         // deadline processes get at most 95% of a hart
+#define DL_PERIOD_MAX_US 10000000                       // longest period, 10s
+
 struct proc_struct;
 
 typedef struct {
-    unsigned int expires;       //the expire time
+    unsigned int expires;       //the expire time: ticks from now, the tick once added
     struct proc_struct *proc;   //the proc wait in this timer. If the expire time is end, then this proc will be scheduled
-    list_entry_t timer_link;    //the timer list
+    list_entry_t timer_link;    //the entry in its slot of the timing wheel
+    int slot;                   //the slot of the timing wheel it is in
 } timer_t;
 
 #define le2timer(le, member)            \
@@ -45,29 +62,67 @@ struct sched_class {
     struct proc_struct *(*pick_next)(struct run_queue *rq);
     // dealer of the time-tick
     void (*proc_tick)(struct run_queue *rq, struct proc_struct *proc);
-    /* for SMP support in the future
-     *  load_balance
-     *     void (*load_balance)(struct rq* rq);
-     *  get some proc from this rq, used in load_balance,
-     *  return value is the num of gotten proc
-     *  int (*get_proc)(struct rq* rq, struct proc* procs_moved[]);
-     */
+    // the running proc is being switched away from, or leaves the class; may be NULL
+    void (*put_prev)(struct run_queue *rq, struct proc_struct *proc);
+    // detach up to max processes that sched_can_migrate lets go to dst from rq,
+    // for the load balancer; return the # of processes stored in procs_moved
+    int (*get_proc)(struct run_queue *rq, struct run_queue *dst,
+                    struct proc_struct *procs_moved[], int max);
 };
 
+// one per hart, in struct cpu
 struct run_queue {
+    spinlock_t lock;
     list_entry_t run_list;
     unsigned int proc_num;
     int max_time_slice;
     // For LAB6 ONLY
     skew_heap_entry_t *lab6_run_pool;
+    uint32_t lab6_min_stride;       // stride of the process picked last, the queue's "now"
+    // For CFS
+    rb_root_t cfs_timeline;         // runnable processes by vruntime
+    rb_node_t *cfs_leftmost;        // the one with the smallest vruntime, next to run
+    uint64_t cfs_min_vruntime;      // never decreases, the queue's "now"
+    unsigned long cfs_load;         // sum of the weights of the processes in cfs_timeline
+    struct proc_struct *cfs_curr;   // process picked last, charged for its run time until the next pick
+    // For MLFQ
+    list_entry_t mlfq_queues[MLFQ_LEVELS];  // runnable processes of each level, in FIFO order
+    uint32_t mlfq_bitmap;           // bit i set if mlfq_queues[i] is not empty
+    int mlfq_boost_ticks;           // ticks until all processes go back to level 0
+    // For DEADLINE, served before the class above
+    rb_root_t dl_timeline;          // queued deadline processes by absolute deadline
+    list_entry_t dl_throttled;      // deadline processes out of budget until their next period
+    uint64_t dl_bw;                 // bandwidth admitted on this hart, in 1/2^DL_BW_SHIFT
+    unsigned int dl_num;            // processes in dl_timeline, counted in proc_num too
+    struct proc_struct *dl_curr;    // deadline process picked last, charged for its run time until it stops
+    // load balancing
+    int balance_ticks;              // ticks until the next periodic balance
+    int balance_failed;             // balances in a row that found only cache-hot processes
+    // counters, see SYS_schedstat
+    size_t nr_switches;
+    size_t nr_balance;
+    size_t nr_migrations_in;
+    size_t nr_migrations_out;
+    size_t nr_preemptions;          // processes switched out in the middle of kernel code
+    uint64_t max_latency;           // longest a woken process waited to run, in cycles
 };
 
 void sched_init(void);
 void wakeup_proc(struct proc_struct *proc);
 void schedule(void);
-void add_timer(timer_t *timer);     // add timer to timer_list
-void del_timer(timer_t *timer);     // del timer from timer_list
+void schedule_tail(void);
+void sched_wait_off_cpu(struct proc_struct *proc);
+void sched_tick(void);
+bool sched_can_migrate(struct proc_struct *proc, struct run_queue *dst);
+struct cpu;
+bool sched_need_tick(struct cpu *cpu);
+struct schedstat;
+int sched_getstat(struct schedstat *stats, int n);
+int sched_setattr(int policy, uint64_t runtime, uint64_t deadline, uint64_t period);
+void add_timer(timer_t *timer);     // add timer to the timing wheel
+void del_timer(timer_t *timer);     // del timer from the timing wheel
 void run_timer_list(void);          // call scheduler to update tick related info, and check the timer is expired? If expired, then wakup proc
+bool timer_next_expiry(unsigned int *expires);  // the tick the earliest timer expires at, if there is one
 
 #endif /* !__KERN_SCHEDULE_SCHED_H__ */
 
@@ -0,0 +1,325 @@
+#include <defs.h>
+#include <list.h>
+#include <sync.h>
+#include <proc.h>
+#include <smp.h>
+#include <error.h>
+#include <stat.h>
+#include <assert.h>
+#include <clock.h>
+#include <rbtree.h>
+#include <default_sched.h>
+
+/*
+ * Earliest deadline first, for periodic processes with a (runtime,
+ * deadline, period) reservation: every period a process gets a new job,
+ * due ``deadline'' after the period starts, and a budget of ``runtime''
+ * cycles to do it in. The queued deadline processes are kept in a
+ * red-black tree by the absolute deadline of their job, and the one due
+ * first runs before any process of the fair class.
+ *
+ * A process that uses up its budget is throttled: it is held off the tree
+ * until its next period, so an overrunning one can't take the time the
+ * others reserved. One that yields is done with its job and waits for the
+ * next period the same way. Admission control keeps the sum of runtime /
+ * period on each hart under DL_BW_LIMIT, so with every process within its
+ * budget EDF meets all the deadlines; a deadline process stays on the hart
+ * it was admitted on, the load balancer only moves fair ones.
+ */
+
+// cycles wrap around: compare the difference
+static inline bool
+dl_before(uint64_t a, uint64_t b)
+{
+    return (int64_t)(a - b) < 0;
+}
+
+static inline struct proc_struct *
+dl_entry(rb_node_t *node)
+{
+    return rb_entry(node, struct proc_struct, dl_node);
+}
+
+static inline uint64_t
+dl_bw(uint64_t runtime, uint64_t period)
+{
+    return (runtime << DL_BW_SHIFT) / period;
+}
+
+// dl_check_miss - count the deadline of the current job of PROC as missed if it passed undone
+static void
+dl_check_miss(struct proc_struct *proc, uint64_t now)
+{
+    if (!proc->dl_yielded && !proc->dl_missed && !dl_before(now, proc->dl_abs_deadline))
+    {
+        proc->dl_missed = 1;
+        proc->dl_nr_misses++;
+    }
+}
+
+// dl_new_job - start the job of the period of PROC that begins at START
+static void
+dl_new_job(struct proc_struct *proc, uint64_t start)
+{
+    proc->dl_period_start = start;
+    proc->dl_abs_deadline = start + proc->dl_deadline;
+    proc->dl_budget = proc->dl_runtime;
+    proc->dl_yielded = proc->dl_missed = 0;
+}
+
+/*
+ * dl_preempt asks the process running on the hart of ``rq'' to give way
+ * to ``proc'', just queued, if it is a fair one or due later.
+ */
+static void
+dl_preempt(struct run_queue *rq, struct proc_struct *proc)
+{
+    struct proc_struct *curr = rq2cpu(rq)->proc;
+    if (curr != NULL && curr != proc
+            && (curr->policy != SCHED_DEADLINE || dl_before(proc->dl_abs_deadline, curr->dl_abs_deadline)))
+    {
+        curr->need_resched = 1;
+    }
+}
+
+static void
+dl_timeline_add(struct run_queue *rq, struct proc_struct *proc)
+{
+    rb_node_t **link = &(rq->dl_timeline.node), *parent = NULL;
+    while (*link != NULL)
+    {
+        parent = *link;
+        if (dl_before(proc->dl_abs_deadline, dl_entry(parent)->dl_abs_deadline))
+        {
+            link = &(parent->left);
+        }
+        else
+        {
+            link = &(parent->right);
+        }
+    }
+    rb_link_node(&(proc->dl_node), parent, link);
+    rb_insert_color(&(proc->dl_node), &(rq->dl_timeline));
+    rq->proc_num++;
+    rq->dl_num++;
+    dl_preempt(rq, proc);
+}
+
+/*
+ * dl_update_curr charges the deadline process picked last for the time it
+ * ran since it was last charged.
+ */
+static void
+dl_update_curr(struct run_queue *rq, uint64_t now)
+{
+    struct proc_struct *curr = rq->dl_curr;
+    if (curr == NULL)
+    {
+        return;
+    }
+    curr->dl_budget -= (int64_t)(now - curr->dl_exec_start);
+    curr->dl_exec_start = now;
+    dl_check_miss(curr, now);
+}
+
+/*
+ * dl_replenish gives the throttled processes of ``rq'' whose next period
+ * has come a new job. One that fell more than a period behind starts its
+ * period now, rather than catching up with jobs that are already late.
+ */
+static void
+dl_replenish(struct run_queue *rq, uint64_t now)
+{
+    list_entry_t *le = list_next(&(rq->dl_throttled));
+    while (le != &(rq->dl_throttled))
+    {
+        struct proc_struct *proc = le2proc(le, dl_throttled_link);
+        uint64_t next = proc->dl_period_start + proc->dl_period;
+        le = list_next(le);
+        if (dl_before(now, next))
+        {
+            continue;
+        }
+        dl_check_miss(proc, now);
+        list_del_init(&(proc->dl_throttled_link));
+        proc->dl_throttled = 0;
+        dl_new_job(proc, dl_before(now, next + proc->dl_period) ? next : now);
+        dl_timeline_add(rq, proc);
+    }
+}
+
+static void
+dl_init(struct run_queue *rq)
+{
+    rq->dl_timeline = RB_ROOT;
+    list_init(&(rq->dl_throttled));
+    rq->dl_bw = 0;
+    rq->dl_num = 0;
+    rq->dl_curr = NULL;
+}
+
+/*
+ * dl_enqueue inserts ``proc'' into the timeline of ``rq'', or throttles it
+ * if its job is done or out of budget. A process woken after sleeping
+ * keeps its job only if the budget left fits before the deadline at its
+ * reserved bandwidth, budget / (deadline - now) <= runtime / deadline;
+ * otherwise it starts a new period now, so one that slept can't run in a
+ * burst that eats into the time of the others.
+ */
+static void
+dl_enqueue(struct run_queue *rq, struct proc_struct *proc)
+{
+    uint64_t now = get_cycles();
+    assert(!proc->dl_throttled);
+    if (proc->wakeup_state != 0)
+    {
+        if (!dl_before(now, proc->dl_abs_deadline)
+                || (uint64_t)proc->dl_budget * proc->dl_deadline > (proc->dl_abs_deadline - now) * proc->dl_runtime)
+        {
+            dl_new_job(proc, now);
+        }
+    }
+    proc->rq = rq;
+    if (proc->dl_yielded || proc->dl_budget <= 0)
+    {
+        if (!proc->dl_yielded)
+        {
+            proc->dl_nr_throttled++;
+        }
+        proc->dl_throttled = 1;
+        list_add_before(&(rq->dl_throttled), &(proc->dl_throttled_link));
+        return;
+    }
+    dl_timeline_add(rq, proc);
+}
+
+static void
+dl_dequeue(struct run_queue *rq, struct proc_struct *proc)
+{
+    assert(proc->rq == rq && rq->dl_num > 0 && !proc->dl_throttled);
+    rb_erase(&(proc->dl_node), &(rq->dl_timeline));
+    rq->proc_num--;
+    rq->dl_num--;
+}
+
+/*
+ * dl_pick_next returns the deadline process due first, which is charged
+ * for its run time from now on, or NULL to leave the hart to the fair class.
+ */
+static struct proc_struct *
+dl_pick_next(struct run_queue *rq)
+{
+    rb_node_t *node = rb_first(&(rq->dl_timeline));
+    if (node == NULL)
+    {
+        return NULL;
+    }
+    struct proc_struct *proc = dl_entry(node);
+    proc->dl_exec_start = get_cycles();
+    dl_check_miss(proc, proc->dl_exec_start);
+    rq->dl_curr = proc;
+    return proc;
+}
+
+/*
+ * dl_proc_tick runs on every tick of the hart of ``rq'', whatever class
+ * ``proc'' is in: it replenishes the throttled processes, and charges
+ * ``proc'' if it is the deadline process picked last, which has to give
+ * way once its budget is used up.
+ */
+static void
+dl_proc_tick(struct run_queue *rq, struct proc_struct *proc)
+{
+    uint64_t now = get_cycles();
+    dl_replenish(rq, now);
+    if (proc == rq->dl_curr)
+    {
+        dl_update_curr(rq, now);
+        if (proc->dl_budget <= 0)
+        {
+            proc->need_resched = 1;
+        }
+    }
+}
+
+static void
+dl_put_prev(struct run_queue *rq, struct proc_struct *proc)
+{
+    if (proc == rq->dl_curr)
+    {
+        dl_update_curr(rq, get_cycles());
+        rq->dl_curr = NULL;
+    }
+}
+
+struct sched_class dl_sched_class = {
+    .name = "deadline_scheduler",
+    .init = dl_init,
+    .enqueue = dl_enqueue,
+    .dequeue = dl_dequeue,
+    .pick_next = dl_pick_next,
+    .proc_tick = dl_proc_tick,
+    .put_prev = dl_put_prev,
+    // deadline processes stay on the hart that admitted them
+    .get_proc = NULL,
+};
+
+/*
+ * dl_admit checks that the hart of ``rq'' can take the bandwidth ``proc''
+ * asks for with ``policy'', less what it already has there: -E_BUSY if the
+ * deadline processes would need more than DL_BW_LIMIT of it.
+ */
+int
+dl_admit(struct run_queue *rq, struct proc_struct *proc, int policy, uint64_t runtime, uint64_t period)
+{
+    uint64_t bw = (policy == SCHED_DEADLINE) ? dl_bw(runtime, period) : 0;
+    if (rq->dl_bw - proc->dl_bw + bw > DL_BW_LIMIT)
+    {
+        return -E_BUSY;
+    }
+    return 0;
+}
+
+/*
+ * dl_setattr moves ``proc'', running on the hart of ``rq'' and admitted
+ * there by dl_admit, to ``policy''. A new deadline process starts its
+ * first period now.
+ */
+void
+dl_setattr(struct run_queue *rq, struct proc_struct *proc, int policy,
+           uint64_t runtime, uint64_t deadline, uint64_t period)
+{
+    if (policy != proc->policy)
+    {
+        // the class it joins places it like a new process
+        proc->rq = NULL;
+    }
+    rq->dl_bw -= proc->dl_bw;
+    proc->policy = policy;
+    if (policy == SCHED_DEADLINE)
+    {
+        proc->dl_runtime = runtime;
+        proc->dl_deadline = deadline;
+        proc->dl_period = period;
+        proc->dl_bw = dl_bw(runtime, period);
+        rq->dl_bw += proc->dl_bw;
+        dl_new_job(proc, get_cycles());
+    }
+    else
+    {
+        proc->dl_bw = 0;
+    }
+}
+
+// dl_yield - PROC, a running deadline process, is done with its job until its next period
+void
+dl_yield(struct proc_struct *proc)
+{
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        dl_check_miss(proc, get_cycles());
+        proc->dl_yielded = 1;
+    }
+    local_intr_restore(intr_flag);
+}
@@ -0,0 +1,44 @@
+#ifndef __KERN_SYNC_PREEMPT_H__
+#define __KERN_SYNC_PREEMPT_H__
+
+#include <defs.h>
+
+/*
+ * Kernel preemption, e.g. make qemu PREEMPT=1: syscalls run with interrupts
+ * on, and an interrupt of kernel code may switch the process out on its way
+ * back, as it may on the way back to user mode, so a long read or fork no
+ * longer holds the hart past its time slice. The process stays on its hart
+ * until it runs again, so what it read off mycpu() still holds.
+ *
+ * Code with interrupts off is never preempted. Code with them on that must
+ * not be switched out in the middle disables preemption: the count is kept
+ * per process and nests, and preempt_enable switches at once if the
+ * outermost one held a reschedule back. spin_lock_irqsave disables it too.
+ * Without PREEMPT, the kernel only switches where it sleeps or leaves.
+ */
+
+#ifndef KERNEL_PREEMPT
+#define KERNEL_PREEMPT 0
+#endif
+
+#if KERNEL_PREEMPT
+
+void preempt_disable(void);
+void preempt_enable(void);
+
+#else
+
+static inline void
+preempt_disable(void) {
+}
+
+static inline void
+preempt_enable(void) {
+}
+
+#endif /* KERNEL_PREEMPT */
+
+void preempt_schedule(void);
+
+#endif /* !__KERN_SYNC_PREEMPT_H__ */
+
@@ -0,0 +1,78 @@
+#include <defs.h>
+#include <wait.h>
+#include <proc.h>
+#include <sync.h>
+#include <rwlock.h>
+#include <assert.h>
+
+void
+rwlock_init(rwlock_t *rwlock) {
+    rwlock->readers = rwlock->writers = 0;
+    wait_queue_init(&(rwlock->read_queue));
+    wait_queue_init(&(rwlock->write_queue));
+}
+
+// rwlock_wait - sleep on queue until woken; called and returns with interrupts disabled
+static void
+rwlock_wait(wait_queue_t *queue, bool *intr_flag) {
+    wait_t __wait, *wait = &__wait;
+    wait_current_set(queue, wait, WT_KRWLOCK);
+    local_intr_restore(*intr_flag);
+
+    schedule();
+
+    local_intr_save(*intr_flag);
+    wait_current_del(queue, wait);
+    assert(wait->wakeup_flags == WT_KRWLOCK);
+}
+
+void
+down_read(rwlock_t *rwlock) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    while (rwlock->readers < 0 || rwlock->writers != 0) {
+        rwlock_wait(&(rwlock->read_queue), &intr_flag);
+    }
+    rwlock->readers ++;
+    local_intr_restore(intr_flag);
+}
+
+void
+up_read(rwlock_t *rwlock) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        assert(rwlock->readers > 0);
+        if (-- rwlock->readers == 0) {
+            wakeup_first(&(rwlock->write_queue), WT_KRWLOCK, 1);
+        }
+    }
+    local_intr_restore(intr_flag);
+}
+
+void
+down_write(rwlock_t *rwlock) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    rwlock->writers ++;
+    while (rwlock->readers != 0) {
+        rwlock_wait(&(rwlock->write_queue), &intr_flag);
+    }
+    rwlock->writers --, rwlock->readers = -1;
+    local_intr_restore(intr_flag);
+}
+
+void
+up_write(rwlock_t *rwlock) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        assert(rwlock->readers == -1);
+        rwlock->readers = 0;
+        // the readers go back to sleep if a writer is still waiting
+        wakeup_first(&(rwlock->write_queue), WT_KRWLOCK, 1);
+        wakeup_queue(&(rwlock->read_queue), WT_KRWLOCK, 1);
+    }
+    local_intr_restore(intr_flag);
+}
+
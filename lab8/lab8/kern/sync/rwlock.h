@@ -0,0 +1,25 @@
+#ifndef __KERN_SYNC_RWLOCK_H__
+#define __KERN_SYNC_RWLOCK_H__
+
+#include <defs.h>
+#include <wait.h>
+
+/*
+ * reader/writer lock: any number of readers, or one writer. A waiting writer
+ * keeps new readers out, so a stream of readers cannot starve it.
+ */
+typedef struct {
+    int readers;                    // # of readers holding the lock, -1 if a writer holds it
+    int writers;                    // # of writers waiting
+    wait_queue_t read_queue;
+    wait_queue_t write_queue;
+} rwlock_t;
+
+void rwlock_init(rwlock_t *rwlock);
+void down_read(rwlock_t *rwlock);
+void up_read(rwlock_t *rwlock);
+void down_write(rwlock_t *rwlock);
+void up_write(rwlock_t *rwlock);
+
+#endif /* !__KERN_SYNC_RWLOCK_H__ */
+
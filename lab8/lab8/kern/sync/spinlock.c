@@ -0,0 +1,45 @@
+#include <defs.h>
+#include <riscv.h>
+#include <smp.h>
+#include <spinlock.h>
+#include <assert.h>
+
+void
+spinlock_init(spinlock_t *lock, const char *name) {
+    lock->locked = 0;
+    lock->cpu = NULL;
+    lock->name = name;
+}
+
+// spin_lock - spin until the lock is ours; the amoswap orders later accesses after it
+void
+spin_lock(spinlock_t *lock) {
+    if (spin_holding(lock)) {
+        panic("spin_lock: %s held by this hart.\n", lock->name);
+    }
+    while (__sync_lock_test_and_set(&(lock->locked), 1) != 0) {
+        while (lock->locked) {
+            /* read-only spin, so the line is not bounced between harts */
+        }
+    }
+    __sync_synchronize();
+    lock->cpu = mycpu();
+}
+
+// spin_unlock - release the lock; accesses before it are visible to the next holder
+void
+spin_unlock(spinlock_t *lock) {
+    if (!spin_holding(lock)) {
+        panic("spin_unlock: %s not held by this hart.\n", lock->name);
+    }
+    lock->cpu = NULL;
+    __sync_synchronize();
+    __sync_lock_release(&(lock->locked));
+}
+
+// spin_holding - whether this hart holds the lock; call it with interrupts disabled
+bool
+spin_holding(spinlock_t *lock) {
+    return lock->locked && lock->cpu == mycpu();
+}
+
@@ -0,0 +1,43 @@
+#ifndef __KERN_SYNC_SPINLOCK_H__
+#define __KERN_SYNC_SPINLOCK_H__
+
+#include <defs.h>
+#include <preempt.h>
+
+struct cpu;
+
+/*
+ * spinlock: mutual exclusion between harts for short critical sections that
+ * never sleep. Take one with spin_lock_irqsave if an interrupt handler may
+ * take it too, or the hart deadlocks against itself.
+ */
+typedef struct {
+    volatile uint32_t locked;       // 1 while held
+    struct cpu *cpu;                // hart holding it, for debugging
+    const char *name;
+} spinlock_t;
+
+#define SPINLOCK_INIT(lockname)                     {.locked = 0, .cpu = NULL, .name = (lockname)}
+
+void spinlock_init(spinlock_t *lock, const char *name);
+void spin_lock(spinlock_t *lock);
+void spin_unlock(spinlock_t *lock);
+bool spin_holding(spinlock_t *lock);
+
+// local_intr_save/restore come from sync.h
+#define spin_lock_irqsave(lock, flag)               \
+    do {                                            \
+        preempt_disable();                          \
+        local_intr_save(flag);                      \
+        spin_lock(lock);                            \
+    } while (0)
+
+#define spin_unlock_irqrestore(lock, flag)          \
+    do {                                            \
+        spin_unlock(lock);                          \
+        local_intr_restore(flag);                   \
+        preempt_enable();                           \
+    } while (0)
+
+#endif /* !__KERN_SYNC_SPINLOCK_H__ */
+
@@ -0,0 +1,311 @@
+#include <defs.h>
+#include <string.h>
+#include <riscv.h>
+#include <sync.h>
+#include <wait.h>
+#include <sem.h>
+#include <pmm.h>
+#include <vmm.h>
+#include <proc.h>
+#include <sched.h>
+#include <kmalloc.h>
+#include <sysfile.h>
+#include <ring.h>
+#include <ioring.h>
+#include <unistd.h>
+#include <error.h>
+#include <assert.h>
+
+/*
+ * Batched asynchronous syscalls through a ring shared with the process (see libs/ring.h).
+ *
+ * SYS_ring_setup maps RING_MAPSIZE bytes at URINGBASE and starts a worker thread for the
+ * process. The worker is a kernel thread created on the process's behalf, so it shares the
+ * process's mm and file table and can run the ops with the plain sysfile_* functions,
+ * the user buffers and fds in the sqes meaning just what they mean to the process.
+ * It is handed over to init, which reaps it; it is stopped when the process exits or execs.
+ *
+ * SYS_ring_enter publishes up to to_submit new sqes to the worker and optionally waits
+ * for min_complete completions, so one trap can carry a whole batch of reads/writes.
+ */
+
+#define RING_PAGES                      (RING_MAPSIZE / PGSIZE)
+
+struct ioring {
+    struct ring_shared *shared;                     // kernel address of the shared pages
+    uint32_t sq_tail;                               // sqes handed to the worker by ring_enter
+    uint32_t sq_head;                               // next sqe the worker takes
+    uint32_t cq_tail;                               // next cqe the worker fills
+    int worker_pid;
+    bool dying;                                     // the process is leaving, the worker stops
+    wait_queue_t work_wait;                         // the worker waits for sqes or cq room
+    wait_queue_t cq_wait;                           // ring_enter waits for completions
+    semaphore_t exit_sem;                           // up'd by the worker when it is done
+};
+
+/*
+ * ioring_wait - sleep on queue. Called and returns with interrupts disabled.
+ *               Returns -E_KILLED if the wait was interrupted.
+ */
+static int
+ioring_wait(wait_queue_t *queue, bool *intr_flag) {
+    wait_t __wait, *wait = &__wait;
+    wait_current_set(queue, wait, WT_RING);
+    local_intr_restore(*intr_flag);
+
+    schedule();
+
+    local_intr_save(*intr_flag);
+    wait_current_del(queue, wait);
+    if (wait->wakeup_flags != WT_RING) {
+        return -E_KILLED;
+    }
+    return 0;
+}
+
+// the process has not yet consumed enough cqes to make room for another one
+static inline bool
+ioring_cq_full(struct ioring *ring) {
+    return ring->cq_tail - ring->shared->cq_head >= RING_CQ_ENTRIES;
+}
+
+/* ioring_do - run one sqe, in the worker, and return what the syscall would have */
+static int64_t
+ioring_do(struct ring_sqe *sqe) {
+    void *base = (void *)(uintptr_t)(sqe->addr);
+    switch (sqe->opcode) {
+    case RING_OP_NOP:
+        return 0;
+    case RING_OP_READ:
+        if (sqe->off < 0) {
+            return sysfile_read(sqe->fd, base, sqe->len);
+        }
+        return sysfile_pread(sqe->fd, base, sqe->len, sqe->off);
+    case RING_OP_WRITE:
+        if (sqe->off < 0) {
+            return sysfile_write(sqe->fd, base, sqe->len);
+        }
+        return sysfile_pwrite(sqe->fd, base, sqe->len, sqe->off);
+    case RING_OP_OPEN:
+        return sysfile_open((const char *)base, sqe->len);
+    case RING_OP_CLOSE:
+        return sysfile_close(sqe->fd);
+    case RING_OP_FSYNC:
+        return sysfile_fsync(sqe->fd);
+    }
+    return -E_INVAL;
+}
+
+/*
+ * ioring_worker - take the submitted sqes in order, run each one and post its result,
+ *                 until the ring is torn down
+ */
+static int
+ioring_worker(void *arg) {
+    struct ioring *ring = (struct ioring *)arg;
+    struct ring_shared *shared = ring->shared;
+    bool intr_flag;
+    while (1) {
+        local_intr_save(intr_flag);
+        {
+            while (!ring->dying && (ring->sq_head == ring->sq_tail || ioring_cq_full(ring))) {
+                ioring_wait(&(ring->work_wait), &intr_flag);
+            }
+        }
+        local_intr_restore(intr_flag);
+        if (ring->dying) {
+            break;
+        }
+
+        // copy the sqe out first: the process may reuse the slot once sq_head moves past it
+        struct ring_sqe sqe = shared->sqes[ring->sq_head % RING_SQ_ENTRIES];
+        barrier();
+        shared->sq_head = ++ ring->sq_head;
+
+        int64_t res = ioring_do(&sqe);
+
+        struct ring_cqe *cqe = &(shared->cqes[ring->cq_tail % RING_CQ_ENTRIES]);
+        cqe->user_data = sqe.user_data, cqe->res = res;
+        barrier();
+        local_intr_save(intr_flag);
+        {
+            shared->cq_tail = ++ ring->cq_tail;
+            if (!wait_queue_empty(&(ring->cq_wait))) {
+                wakeup_queue(&(ring->cq_wait), WT_RING, 1);
+            }
+        }
+        local_intr_restore(intr_flag);
+    }
+    up(&(ring->exit_sem));
+    return 0;
+}
+
+/*
+ * ioring_map - map the ring pages at URINGBASE in mm. A process forked from one with a
+ *              ring inherits a copy of the mapping, which is replaced.
+ */
+static int
+ioring_map(struct mm_struct *mm, struct Page *page) {
+    int ret, i;
+    struct vma_struct *vma;
+    if ((vma = find_vma(mm, URINGBASE)) == NULL) {
+        if ((ret = mm_map(mm, URINGBASE, RING_MAPSIZE, VM_READ | VM_WRITE, NULL)) != 0) {
+            return ret;
+        }
+    }
+    else if (vma->vm_start != URINGBASE || vma->vm_end != URINGBASE + RING_MAPSIZE) {
+        return -E_INVAL;
+    }
+    for (i = 0; i < RING_PAGES; i ++) {
+        if ((ret = page_insert(mm->pgdir, page + i, URINGBASE + i * PGSIZE, PTE_U | PTE_R | PTE_W)) != 0) {
+            return ret;
+        }
+    }
+    return 0;
+}
+
+/*
+ * ioring_setup - set up the ring of current, and store the user address it is mapped at
+ *                in *addr_store. The pages belong to the mapping from then on and are
+ *                freed with the mm.
+ */
+int
+ioring_setup(uintptr_t *addr_store) {
+    struct mm_struct *mm = current->mm;
+    if (mm == NULL) {
+        return -E_INVAL;
+    }
+    if (current->ioring != NULL) {
+        return -E_EXISTS;
+    }
+
+    int ret = -E_NO_MEM;
+    struct ioring *ring;
+    struct Page *page;
+    if ((ring = kmalloc(sizeof(struct ioring))) == NULL) {
+        goto failed;
+    }
+    if ((page = alloc_pages(RING_PAGES)) == NULL) {
+        goto failed_cleanup_ring;
+    }
+
+    struct ring_shared *shared = page2kva(page);
+    static_assert(sizeof(struct ring_shared) <= RING_MAPSIZE);
+    memset(shared, 0, RING_MAPSIZE);
+    shared->sq_entries = RING_SQ_ENTRIES;
+    shared->cq_entries = RING_CQ_ENTRIES;
+
+    ring->shared = shared;
+    ring->sq_tail = ring->sq_head = ring->cq_tail = 0;
+    ring->dying = 0;
+    wait_queue_init(&(ring->work_wait));
+    wait_queue_init(&(ring->cq_wait));
+    sem_init(&(ring->exit_sem), 0);
+
+    uintptr_t addr = URINGBASE;
+    lock_mm(mm);
+    {
+        if ((ret = ioring_map(mm, page)) == 0 && !copy_to_user(mm, addr_store, &addr, sizeof(uintptr_t))) {
+            ret = -E_INVAL;
+        }
+    }
+    unlock_mm(mm);
+    if (ret != 0) {
+        goto failed_cleanup_pages;
+    }
+
+    // shares mm (kernel_thread always does) and the file table with current
+    int pid;
+    if ((ret = pid = kernel_thread(ioring_worker, ring, CLONE_FS)) <= 0) {
+        goto failed_cleanup_pages;
+    }
+    struct proc_struct *worker = find_proc(pid);
+    set_proc_name(worker, "ioring");
+    proc_detach(worker);
+    ring->worker_pid = pid;
+    current->ioring = ring;
+    return 0;
+
+failed_cleanup_pages:
+    // whatever got mapped holds its own reference and goes away with the mm
+    for (int i = 0; i < RING_PAGES; i ++) {
+        if (page_ref(page + i) == 0) {
+            free_page(page + i);
+        }
+    }
+failed_cleanup_ring:
+    kfree(ring);
+failed:
+    return ret;
+}
+
+/*
+ * ioring_enter - hand the next to_submit sqes of current's ring to the worker, then wait
+ *                until at least min_complete cqes are ready. Returns the number submitted.
+ */
+int
+ioring_enter(uint32_t to_submit, uint32_t min_complete) {
+    struct ioring *ring = current->ioring;
+    if (ring == NULL) {
+        return -E_INVAL;
+    }
+    struct ring_shared *shared = ring->shared;
+    uint32_t tail = shared->sq_tail, n = tail - ring->sq_tail;
+    if (tail - ring->sq_head > RING_SQ_ENTRIES) {
+        return -E_INVAL;
+    }
+    if (n > to_submit) {
+        n = to_submit;
+    }
+
+    int ret = 0;
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        ring->sq_tail += n;
+        if (!wait_queue_empty(&(ring->work_wait))) {
+            wakeup_queue(&(ring->work_wait), WT_RING, 1);
+        }
+        // never wait for more than everything submitted and not yet consumed
+        if (min_complete > ring->sq_tail - shared->cq_head) {
+            min_complete = ring->sq_tail - shared->cq_head;
+        }
+        while (ring->cq_tail - shared->cq_head < min_complete) {
+            if ((ret = ioring_wait(&(ring->cq_wait), &intr_flag)) != 0) {
+                break;
+            }
+        }
+    }
+    local_intr_restore(intr_flag);
+    return (ret != 0) ? ret : n;
+}
+
+/*
+ * ioring_exit - tear down the ring of proc (current, exiting or exec'ing): the worker
+ *               abandons what is not yet started, and is waited for.
+ */
+void
+ioring_exit(struct proc_struct *proc) {
+    struct ioring *ring;
+    if ((ring = proc->ioring) == NULL) {
+        return;
+    }
+    assert(proc == current);
+    proc->ioring = NULL;
+
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        // interrupt a read or write the worker is blocked in, e.g. on a pipe only we write to.
+        // The worker only leaves once it sees dying, so its pid can't have been reused yet.
+        do_kill(ring->worker_pid);
+        ring->dying = 1;
+        if (!wait_queue_empty(&(ring->work_wait))) {
+            wakeup_queue(&(ring->work_wait), WT_RING, 1);
+        }
+    }
+    local_intr_restore(intr_flag);
+    down(&(ring->exit_sem));
+    kfree(ring);
+}
+
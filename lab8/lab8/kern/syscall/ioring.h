@@ -0,0 +1,13 @@
+#ifndef __KERN_SYSCALL_IORING_H__
+#define __KERN_SYSCALL_IORING_H__
+
+#include <defs.h>
+
+struct proc_struct;
+
+int ioring_setup(uintptr_t *addr_store);
+int ioring_enter(uint32_t to_submit, uint32_t min_complete);
+void ioring_exit(struct proc_struct *proc);
+
+#endif /* !__KERN_SYSCALL_IORING_H__ */
+
@@ -7,6 +7,7 @@
 #include <assert.h>
 #include <clock.h>
 #include <sysfile.h>
+#include <ioring.h>
 static int
 sys_exit(uint64_t arg[])
 {
@@ -73,7 +74,7 @@ sys_pgdir(uint64_t arg[])
 }
 static int sys_gettime(uint64_t arg[])
 {
-    return (int)ticks * 10;
+    return (int)(clock_gettime_ns() / 1000000);
 }
 static int sys_lab6_set_priority(uint64_t arg[])
 {
@@ -88,6 +89,44 @@ sys_sleep(uint64_t arg[])
     return do_sleep(time);
 }
 static int
+sys_setnice(uint64_t arg[])
+{
+    int nice = (int)arg[0];
+    return do_setnice(nice);
+}
+static int
+sys_schedstat(uint64_t arg[])
+{
+    struct schedstat *stats = (struct schedstat *)arg[0];
+    int n = (int)arg[1];
+    return do_schedstat(stats, n);
+}
+static int
+sys_clock_gettime(uint64_t arg[])
+{
+    int clockid = (int)arg[0];
+    struct timespec *tp = (struct timespec *)arg[1];
+    return do_clock_gettime(clockid, tp);
+}
+static int
+sys_nanosleep(uint64_t arg[])
+{
+    const struct timespec *req = (const struct timespec *)arg[0];
+    return do_user_nanosleep(req);
+}
+static int
+sys_sched_setattr(uint64_t arg[])
+{
+    struct sched_attr *attr = (struct sched_attr *)arg[0];
+    return do_sched_setattr(attr);
+}
+static int
+sys_sched_getattr(uint64_t arg[])
+{
+    struct sched_attr *attr = (struct sched_attr *)arg[0];
+    return do_sched_getattr(attr);
+}
+static int
 sys_open(uint64_t arg[])
 {
     const char *path = (const char *)arg[0];
@@ -120,6 +159,44 @@ sys_write(uint64_t arg[])
     return sysfile_write(fd, base, len);
 }
 
+static int
+sys_readv(uint64_t arg[])
+{
+    int fd = (int)arg[0];
+    const struct iovec *iov = (const struct iovec *)arg[1];
+    int iovcnt = (int)arg[2];
+    return sysfile_readv(fd, iov, iovcnt);
+}
+
+static int
+sys_writev(uint64_t arg[])
+{
+    int fd = (int)arg[0];
+    const struct iovec *iov = (const struct iovec *)arg[1];
+    int iovcnt = (int)arg[2];
+    return sysfile_writev(fd, iov, iovcnt);
+}
+
+static int
+sys_pread(uint64_t arg[])
+{
+    int fd = (int)arg[0];
+    void *base = (void *)arg[1];
+    size_t len = (size_t)arg[2];
+    off_t pos = (off_t)arg[3];
+    return sysfile_pread(fd, base, len, pos);
+}
+
+static int
+sys_pwrite(uint64_t arg[])
+{
+    int fd = (int)arg[0];
+    void *base = (void *)arg[1];
+    size_t len = (size_t)arg[2];
+    off_t pos = (off_t)arg[3];
+    return sysfile_pwrite(fd, base, len, pos);
+}
+
 static int
 sys_seek(uint64_t arg[])
 {
@@ -152,6 +229,27 @@ sys_getcwd(uint64_t arg[])
     return sysfile_getcwd(buf, len);
 }
 
+static int
+sys_mkdir(uint64_t arg[])
+{
+    const char *path = (const char *)arg[0];
+    return sysfile_mkdir(path);
+}
+
+static int
+sys_unlink(uint64_t arg[])
+{
+    const char *path = (const char *)arg[0];
+    return sysfile_unlink(path);
+}
+
+static int
+sys_rmdir(uint64_t arg[])
+{
+    const char *path = (const char *)arg[0];
+    return sysfile_rmdir(path);
+}
+
 static int
 sys_getdirentry(uint64_t arg[])
 {
@@ -167,6 +265,71 @@ sys_dup(uint64_t arg[])
     int fd2 = (int)arg[1];
     return sysfile_dup(fd1, fd2);
 }
+
+static int
+sys_pipe(uint64_t arg[])
+{
+    int *fd_store = (int *)arg[0];
+    return sysfile_pipe(fd_store);
+}
+
+static int
+sys_mkfifo(uint64_t arg[])
+{
+    const char *name = (const char *)arg[0];
+    uint32_t open_flags = (uint32_t)arg[1];
+    return sysfile_mkfifo(name, open_flags);
+}
+
+static int
+sys_sendfile(uint64_t arg[])
+{
+    int out_fd = (int)arg[0];
+    int in_fd = (int)arg[1];
+    size_t len = (size_t)arg[2];
+    return sysfile_sendfile(out_fd, in_fd, len);
+}
+
+static int
+sys_splice(uint64_t arg[])
+{
+    int in_fd = (int)arg[0];
+    int out_fd = (int)arg[1];
+    size_t len = (size_t)arg[2];
+    return sysfile_splice(in_fd, out_fd, len);
+}
+
+static int
+sys_getdents(uint64_t arg[])
+{
+    int fd = (int)arg[0];
+    void *base = (void *)arg[1];
+    size_t len = (size_t)arg[2];
+    return sysfile_getdents(fd, base, len);
+}
+
+static int
+sys_rastat(uint64_t arg[])
+{
+    int fd = (int)arg[0];
+    struct rastat *stat = (struct rastat *)arg[1];
+    return sysfile_rastat(fd, stat);
+}
+
+static int
+sys_ring_setup(uint64_t arg[])
+{
+    uintptr_t *addr_store = (uintptr_t *)arg[0];
+    return ioring_setup(addr_store);
+}
+
+static int
+sys_ring_enter(uint64_t arg[])
+{
+    uint32_t to_submit = (uint32_t)arg[0];
+    uint32_t min_complete = (uint32_t)arg[1];
+    return ioring_enter(to_submit, min_complete);
+}
 static int (*syscalls[])(uint64_t arg[]) = {
     [SYS_exit] sys_exit,
     [SYS_fork] sys_fork,
@@ -188,8 +351,29 @@ static int (*syscalls[])(uint64_t arg[]) = {
     [SYS_fstat] sys_fstat,
     [SYS_fsync] sys_fsync,
     [SYS_getcwd] sys_getcwd,
+    [SYS_mkdir] sys_mkdir,
+    [SYS_unlink] sys_unlink,
     [SYS_getdirentry] sys_getdirentry,
+    [SYS_rmdir] sys_rmdir,
     [SYS_dup] sys_dup,
+    [SYS_pipe] sys_pipe,
+    [SYS_mkfifo] sys_mkfifo,
+    [SYS_sendfile] sys_sendfile,
+    [SYS_splice] sys_splice,
+    [SYS_readv] sys_readv,
+    [SYS_writev] sys_writev,
+    [SYS_pread] sys_pread,
+    [SYS_pwrite] sys_pwrite,
+    [SYS_ring_setup] sys_ring_setup,
+    [SYS_ring_enter] sys_ring_enter,
+    [SYS_rastat] sys_rastat,
+    [SYS_getdents] sys_getdents,
+    [SYS_schedstat] sys_schedstat,
+    [SYS_setnice] sys_setnice,
+    [SYS_sched_setattr] sys_sched_setattr,
+    [SYS_sched_getattr] sys_sched_getattr,
+    [SYS_clock_gettime] sys_clock_gettime,
+    [SYS_nanosleep] sys_nanosleep,
 };
 
 #define NUM_SYSCALLS ((sizeof(syscalls)) / (sizeof(syscalls[0])))
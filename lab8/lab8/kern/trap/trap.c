@@ -16,6 +16,8 @@
 #include <sync.h>
 #include <sbi.h>
 #include <proc.h>
+#include <smp.h>
+#include <dev.h>
 
 #define TICK_NUM 2
 
@@ -104,7 +106,7 @@ void interrupt_handler(struct trapframe *tf)
         cprintf("User software interrupt\n");
         break;
     case IRQ_S_SOFT:
-        cprintf("Supervisor software interrupt\n");
+        smp_ipi_handler();
         break;
     case IRQ_H_SOFT:
         cprintf("Hypervisor software interrupt\n");
@@ -121,10 +123,19 @@ void interrupt_handler(struct trapframe *tf)
         // In fact, Call sbi_set_timer will clear STIP, or you can clear it
         // directly.
         // clear_csr(sip, SIP_STIP);
+        mycpu()->nr_ticks++;
+        hrtimer_run();
+        // a tick, rather than only a high-resolution timer: any hart runs the
+        // timers that are due, the console is polled on the boot hart
+        if (clock_tick_passed())
+        {
+            run_timer_list();
+            if (mycpu() == boot_cpu)
+            {
+                dev_stdin_write(cons_getc());
+            }
+        }
         clock_set_next_event();
-        ++ticks;
-        run_timer_list();
-        dev_stdin_write(cons_getc());
         break;
     case IRQ_H_TIMER:
         cprintf("Hypervisor software interrupt\n");
@@ -182,7 +193,14 @@ void exception_handler(struct trapframe *tf)
     case CAUSE_USER_ECALL:
         // cprintf("Environment call from U-mode\n");
         tf->epc += 4;
+#if KERNEL_PREEMPT
+        // with interrupts on, a long syscall can be preempted; off again before the trap returns
+        intr_enable();
+        syscall();
+        intr_disable();
+#else
         syscall();
+#endif
         break;
     case CAUSE_SUPERVISOR_ECALL:
         cprintf("Environment call from S-mode\n");
@@ -231,6 +249,12 @@ static inline void trap_dispatch(struct trapframe *tf)
  * */
 void trap(struct trapframe *tf)
 {
+    // a trap from user mode or from an unlocked part of the kernel takes the big kernel lock
+    bool klock = !kernel_locked();
+    if (klock)
+    {
+        lock_kernel();
+    }
     // dispatch based on what type of trap occurred
     if (current == NULL)
     {
@@ -257,5 +281,14 @@ void trap(struct trapframe *tf)
                 schedule();
             }
         }
+        else if (KERNEL_PREEMPT && (intptr_t)tf->cause < 0 && (tf->status & SSTATUS_SPIE))
+        {
+            // an interrupt of kernel code running with interrupts on, which may be preempted
+            preempt_schedule();
+        }
+    }
+    if (klock)
+    {
+        unlock_kernel();
     }
 }
@@ -16,6 +16,10 @@ static inline bool test_and_set_bit(int nr, volatile void *addr)
     __attribute__((always_inline));
 static inline bool test_and_clear_bit(int nr, volatile void *addr)
     __attribute__((always_inline));
+static inline int atomic_add_return(volatile int *v, int i)
+    __attribute__((always_inline));
+static inline int atomic_sub_return(volatile int *v, int i)
+    __attribute__((always_inline));
 
 #define BITS_PER_LONG __riscv_xlen
 
@@ -106,4 +110,30 @@ static inline bool test_and_clear_bit(int nr, volatile void *addr) {
     return __test_and_op_bit(and, __NOT, nr, ((volatile unsigned long *)addr));
 }
 
+/* *
+ * atomic_add_return - Atomically add @i to the counter and return its new value
+ * @v:      the counter
+ * @i:      the amount to add
+ *
+ * A plain counter += 1 is a load and a store, and the process doing it may be
+ * switched out between the two with kernel preemption, or race another hart.
+ * */
+static inline int atomic_add_return(volatile int *v, int i) {
+    int __old;
+    __asm__ __volatile__("amoadd.w.aqrl %0, %2, %1"
+                         : "=r"(__old), "+A"(*v)
+                         : "r"(i)
+                         : "memory");
+    return __old + i;
+}
+
+/* *
+ * atomic_sub_return - Atomically subtract @i from the counter and return its new value
+ * @v:      the counter
+ * @i:      the amount to subtract
+ * */
+static inline int atomic_sub_return(volatile int *v, int i) {
+    return atomic_add_return(v, -i);
+}
+
 #endif /* !__LIBS_ATOMIC_H__ */
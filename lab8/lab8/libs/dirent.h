@@ -9,5 +9,19 @@ struct dirent {
     char name[FS_MAX_FNAME_LEN + 1];
 };
 
+/*
+ * getdents fills a buffer with these records packed back to back; each is
+ * d_reclen bytes long, a multiple of 8, and its name is '\0' terminated
+ */
+struct dirent_rec {
+    off_t d_off;                                    // directory position after this entry
+    uint16_t d_reclen;                              // length of the record
+    uint16_t d_namlen;                              // length of d_name, without the '\0'
+    char d_name[0];
+};
+
+#define DIRENT_RECLEN(namlen)                       \
+    ROUNDUP(sizeof(struct dirent_rec) + (namlen) + 1, sizeof(off_t))
+
 #endif /* !__LIBS_DIRENT_H__ */
 
@@ -0,0 +1,232 @@
+#include <defs.h>
+#include <rbtree.h>
+
+/* *
+ * Red-black tree rebalancing, after CLRS chapter 13, with NULL for the
+ * (black) leaves.
+ * */
+
+static inline bool
+rb_is_red(rb_node_t *node) {
+    return node != NULL && node->color == RB_RED;
+}
+
+// rb_replace_child - make NEW take OLD's place under PARENT (or at the root)
+static inline void
+rb_replace_child(rb_node_t *old, rb_node_t *new, rb_node_t *parent, rb_root_t *root) {
+    if (parent == NULL) {
+        root->node = new;
+    }
+    else if (parent->left == old) {
+        parent->left = new;
+    }
+    else {
+        parent->right = new;
+    }
+}
+
+static void
+rb_rotate_left(rb_node_t *node, rb_root_t *root) {
+    rb_node_t *right = node->right;
+    if ((node->right = right->left) != NULL) {
+        right->left->parent = node;
+    }
+    right->parent = node->parent;
+    rb_replace_child(node, right, node->parent, root);
+    right->left = node;
+    node->parent = right;
+}
+
+static void
+rb_rotate_right(rb_node_t *node, rb_root_t *root) {
+    rb_node_t *left = node->left;
+    if ((node->left = left->right) != NULL) {
+        left->right->parent = node;
+    }
+    left->parent = node->parent;
+    rb_replace_child(node, left, node->parent, root);
+    left->right = node;
+    node->parent = left;
+}
+
+/* *
+ * rb_insert_color - restore the red-black properties after rb_link_node
+ * added NODE
+ * */
+void
+rb_insert_color(rb_node_t *node, rb_root_t *root) {
+    rb_node_t *parent, *gparent, *uncle;
+    while (rb_is_red(parent = node->parent)) {
+        // a red parent is never the root, so the grandparent exists
+        gparent = parent->parent;
+        if (parent == gparent->left) {
+            if (rb_is_red(uncle = gparent->right)) {
+                parent->color = uncle->color = RB_BLACK;
+                gparent->color = RB_RED;
+                node = gparent;
+                continue;
+            }
+            if (node == parent->right) {
+                rb_rotate_left(parent, root);
+                node = parent, parent = node->parent;
+            }
+            parent->color = RB_BLACK;
+            gparent->color = RB_RED;
+            rb_rotate_right(gparent, root);
+        }
+        else {
+            if (rb_is_red(uncle = gparent->left)) {
+                parent->color = uncle->color = RB_BLACK;
+                gparent->color = RB_RED;
+                node = gparent;
+                continue;
+            }
+            if (node == parent->left) {
+                rb_rotate_right(parent, root);
+                node = parent, parent = node->parent;
+            }
+            parent->color = RB_BLACK;
+            gparent->color = RB_RED;
+            rb_rotate_left(gparent, root);
+        }
+    }
+    root->node->color = RB_BLACK;
+}
+
+/* *
+ * rb_erase_color - NODE (maybe NULL), a child of PARENT, is one black short
+ * on every path through it; push the deficit up or fix it by rotations
+ * */
+static void
+rb_erase_color(rb_node_t *node, rb_node_t *parent, rb_root_t *root) {
+    rb_node_t *sibling;
+    while (node != root->node && !rb_is_red(node)) {
+        if (node == parent->left) {
+            sibling = parent->right;
+            if (rb_is_red(sibling)) {
+                sibling->color = RB_BLACK;
+                parent->color = RB_RED;
+                rb_rotate_left(parent, root);
+                sibling = parent->right;
+            }
+            if (!rb_is_red(sibling->left) && !rb_is_red(sibling->right)) {
+                sibling->color = RB_RED;
+                node = parent, parent = node->parent;
+                continue;
+            }
+            if (!rb_is_red(sibling->right)) {
+                sibling->left->color = RB_BLACK;
+                sibling->color = RB_RED;
+                rb_rotate_right(sibling, root);
+                sibling = parent->right;
+            }
+            sibling->color = parent->color;
+            parent->color = sibling->right->color = RB_BLACK;
+            rb_rotate_left(parent, root);
+        }
+        else {
+            sibling = parent->left;
+            if (rb_is_red(sibling)) {
+                sibling->color = RB_BLACK;
+                parent->color = RB_RED;
+                rb_rotate_right(parent, root);
+                sibling = parent->left;
+            }
+            if (!rb_is_red(sibling->left) && !rb_is_red(sibling->right)) {
+                sibling->color = RB_RED;
+                node = parent, parent = node->parent;
+                continue;
+            }
+            if (!rb_is_red(sibling->left)) {
+                sibling->right->color = RB_BLACK;
+                sibling->color = RB_RED;
+                rb_rotate_left(sibling, root);
+                sibling = parent->left;
+            }
+            sibling->color = parent->color;
+            parent->color = sibling->left->color = RB_BLACK;
+            rb_rotate_right(parent, root);
+        }
+        node = root->node;
+        break;
+    }
+    if (node != NULL) {
+        node->color = RB_BLACK;
+    }
+}
+
+/* *
+ * rb_erase - remove NODE from the tree
+ * */
+void
+rb_erase(rb_node_t *node, rb_root_t *root) {
+    rb_node_t *child, *parent;
+    int color;
+    if (node->left == NULL || node->right == NULL) {
+        child = (node->left != NULL) ? node->left : node->right;
+        parent = node->parent, color = node->color;
+        if (child != NULL) {
+            child->parent = parent;
+        }
+        rb_replace_child(node, child, parent, root);
+    }
+    else {
+        // two children: the successor, which has no left child, takes NODE's place
+        rb_node_t *next = node->right;
+        while (next->left != NULL) {
+            next = next->left;
+        }
+        child = next->right, color = next->color;
+        if (next->parent == node) {
+            parent = next;
+        }
+        else {
+            parent = next->parent;
+            if ((parent->left = child) != NULL) {
+                child->parent = parent;
+            }
+            next->right = node->right;
+            node->right->parent = next;
+        }
+        next->left = node->left;
+        node->left->parent = next;
+        next->parent = node->parent;
+        next->color = node->color;
+        rb_replace_child(node, next, node->parent, root);
+    }
+    if (color == RB_BLACK) {
+        rb_erase_color(child, parent, root);
+    }
+}
+
+/* *
+ * rb_first - the leftmost (smallest) node, NULL if the tree is empty
+ * */
+rb_node_t *
+rb_first(const rb_root_t *root) {
+    rb_node_t *node = root->node;
+    if (node != NULL) {
+        while (node->left != NULL) {
+            node = node->left;
+        }
+    }
+    return node;
+}
+
+/* *
+ * rb_next - the node after NODE in order, NULL if it is the last one
+ * */
+rb_node_t *
+rb_next(const rb_node_t *node) {
+    if (node->right != NULL) {
+        node = node->right;
+        while (node->left != NULL) {
+            node = node->left;
+        }
+        return (rb_node_t *)node;
+    }
+    while (node->parent != NULL && node == node->parent->right) {
+        node = node->parent;
+    }
+    return node->parent;
+}
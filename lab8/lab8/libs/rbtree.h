@@ -0,0 +1,56 @@
+#ifndef __LIBS_RBTREE_H__
+#define __LIBS_RBTREE_H__
+
+#include <defs.h>
+
+/* *
+ * Intrusive red-black tree: embed an rb_node_t in the struct to be kept in
+ * order. The caller does the search, so no compare function is stored: walk
+ * down from root->node to the NULL link the new node belongs at, then call
+ * rb_link_node and rb_insert_color to rebalance.
+ *
+ *     rb_node_t **link = &(root->node), *parent = NULL;
+ *     while (*link != NULL) {
+ *         parent = *link;
+ *         link = (key < rb_entry(parent, ...)->key) ? &(parent->left) : &(parent->right);
+ *     }
+ *     rb_link_node(node, parent, link);
+ *     rb_insert_color(node, root);
+ * */
+
+#define RB_RED          0
+#define RB_BLACK        1
+
+struct rb_node {
+    struct rb_node *parent, *left, *right;
+    int color;
+};
+
+struct rb_root {
+    struct rb_node *node;
+};
+
+typedef struct rb_node rb_node_t;
+typedef struct rb_root rb_root_t;
+
+#define RB_ROOT                         ((rb_root_t) {NULL})
+#define rb_entry(ptr, type, member)     to_struct((ptr), type, member)
+
+/* *
+ * rb_link_node - hang a new red leaf NODE from PARENT at LINK (&parent->left
+ * or &parent->right, or &root->node for an empty tree)
+ * */
+static inline void
+rb_link_node(rb_node_t *node, rb_node_t *parent, rb_node_t **link) {
+    node->parent = parent;
+    node->left = node->right = NULL;
+    node->color = RB_RED;
+    *link = node;
+}
+
+void rb_insert_color(rb_node_t *node, rb_root_t *root);
+void rb_erase(rb_node_t *node, rb_root_t *root);
+rb_node_t *rb_first(const rb_root_t *root);
+rb_node_t *rb_next(const rb_node_t *node);
+
+#endif /* !__LIBS_RBTREE_H__ */
@@ -0,0 +1,59 @@
+#ifndef __LIBS_RING_H__
+#define __LIBS_RING_H__
+
+#include <defs.h>
+
+/*
+ * Layout of the submission/completion ring a process shares with the kernel (SYS_ring_setup).
+ *
+ * The process fills sqes[sq_tail % RING_SQ_ENTRIES] and bumps sq_tail, then calls
+ * SYS_ring_enter; a kernel worker consumes entries from sq_head, runs them and posts the
+ * results at cqes[cq_tail % RING_CQ_ENTRIES]. The process consumes completions from cq_head.
+ * Each index is only written by one side; the others are read-only to it.
+ */
+
+#define RING_SQ_ENTRIES                 64
+#define RING_CQ_ENTRIES                 (2 * RING_SQ_ENTRIES)
+#define RING_MAPSIZE                    (2 * 4096)              // two pages, mapped at setup
+
+/* ring operations */
+#define RING_OP_NOP                     0
+#define RING_OP_READ                    1                       // read(fd, addr, len), or pread at off
+#define RING_OP_WRITE                   2                       // write(fd, addr, len), or pwrite at off
+#define RING_OP_OPEN                    3                       // open((char *)addr, len as open flags)
+#define RING_OP_CLOSE                   4                       // close(fd)
+#define RING_OP_FSYNC                   5                       // fsync(fd)
+
+/* submission queue entry */
+struct ring_sqe {
+    uint8_t opcode;                                 // RING_OP_*
+    uint8_t flags;
+    uint16_t __pad;
+    int32_t fd;
+    uint64_t addr;                                  // buffer, or path for open
+    uint32_t len;                                   // bytes, or open flags for open
+    uint32_t __pad2;
+    int64_t off;                                    // file offset, -1 for the file position
+    uint64_t user_data;                             // handed back in the completion
+};
+
+/* completion queue entry */
+struct ring_cqe {
+    uint64_t user_data;                             // from the sqe
+    int64_t res;                                    // what the syscall would have returned
+};
+
+struct ring_shared {
+    volatile uint32_t sq_head;                      // written by the kernel
+    volatile uint32_t sq_tail;                      // written by the process
+    volatile uint32_t cq_head;                      // written by the process
+    volatile uint32_t cq_tail;                      // written by the kernel
+    uint32_t sq_entries;                            // RING_SQ_ENTRIES
+    uint32_t cq_entries;                            // RING_CQ_ENTRIES
+    uint32_t __pad[2];
+    struct ring_cqe cqes[RING_CQ_ENTRIES];
+    struct ring_sqe sqes[RING_SQ_ENTRIES];
+};
+
+#endif /* !__LIBS_RING_H__ */
+
@@ -97,4 +97,78 @@ static inline void sbi_remote_sfence_vma_asid(const unsigned long *hart_mask,
 	SBI_CALL_1(SBI_REMOTE_SFENCE_VMA_ASID, hart_mask);
 }
 
+/*
+ * SBI v0.2 extensions: the extension id goes in a7, the function id in a6,
+ * and the call returns an error code in a0 and a value in a1.
+ */
+#define SBI_EXT_IPI 0x735049
+#define SBI_EXT_RFENCE 0x52464E43
+#define SBI_EXT_HSM 0x48534D
+
+#define SBI_EXT_IPI_SEND_IPI 0
+#define SBI_EXT_RFENCE_REMOTE_SFENCE_VMA 1
+#define SBI_EXT_HSM_HART_START 0
+#define SBI_EXT_HSM_HART_GET_STATUS 2
+
+#define SBI_SUCCESS 0
+#define SBI_HSM_STARTED 0
+#define SBI_HSM_STOPPED 1
+
+struct sbiret {
+	long error;
+	long value;
+};
+
+static inline struct sbiret sbi_ecall(int ext, int fid, unsigned long arg0,
+				      unsigned long arg1, unsigned long arg2,
+				      unsigned long arg3)
+{
+	register uintptr_t a0 asm ("a0") = (uintptr_t)(arg0);
+	register uintptr_t a1 asm ("a1") = (uintptr_t)(arg1);
+	register uintptr_t a2 asm ("a2") = (uintptr_t)(arg2);
+	register uintptr_t a3 asm ("a3") = (uintptr_t)(arg3);
+	register uintptr_t a6 asm ("a6") = (uintptr_t)(fid);
+	register uintptr_t a7 asm ("a7") = (uintptr_t)(ext);
+	asm volatile ("ecall"
+		      : "+r" (a0), "+r" (a1)
+		      : "r" (a2), "r" (a3), "r" (a6), "r" (a7)
+		      : "memory");
+	struct sbiret ret = {.error = a0, .value = a1};
+	return ret;
+}
+
+/* start hart HARTID at physical address START in S-mode, with a0 = hartid, a1 = OPAQUE */
+static inline long sbi_hart_start(unsigned long hartid, unsigned long start,
+				  unsigned long opaque)
+{
+	return sbi_ecall(SBI_EXT_HSM, SBI_EXT_HSM_HART_START, hartid, start,
+			 opaque, 0).error;
+}
+
+/* the SBI_HSM_* state of hart HARTID, or a negative error if there is no such hart */
+static inline long sbi_hart_get_status(unsigned long hartid)
+{
+	struct sbiret ret = sbi_ecall(SBI_EXT_HSM, SBI_EXT_HSM_HART_GET_STATUS,
+				      hartid, 0, 0, 0);
+	return (ret.error != SBI_SUCCESS) ? ret.error : ret.value;
+}
+
+/* raise a supervisor software interrupt on the harts HART_MASK << HART_MASK_BASE */
+static inline long sbi_send_ipi_mask(unsigned long hart_mask,
+				     unsigned long hart_mask_base)
+{
+	return sbi_ecall(SBI_EXT_IPI, SBI_EXT_IPI_SEND_IPI, hart_mask,
+			 hart_mask_base, 0, 0).error;
+}
+
+/* sfence.vma START .. START+SIZE on the harts HART_MASK << HART_MASK_BASE */
+static inline long sbi_remote_sfence_vma_mask(unsigned long hart_mask,
+					      unsigned long hart_mask_base,
+					      unsigned long start,
+					      unsigned long size)
+{
+	return sbi_ecall(SBI_EXT_RFENCE, SBI_EXT_RFENCE_REMOTE_SFENCE_VMA,
+			 hart_mask, hart_mask_base, start, size).error;
+}
+
 #endif /* !__SBI_H__ */
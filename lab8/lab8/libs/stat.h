@@ -10,18 +10,58 @@ struct stat {
     size_t st_size;                     // file size (bytes)
 };
 
+/* readahead counters of an open file, see SYS_rastat */
+struct rastat {
+    size_t ra_window;                   // bytes read ahead of the reader, 0 while reads look random
+    size_t ra_reads;                    // reads of the file
+    size_t ra_seqreads;                 // how many of them were sequential
+    size_t ra_bytes;                    // bytes read
+    size_t ra_hits;                     // how many of them were served from the readahead cache
+};
+
+/* load and counters of a hart's run queue, see SYS_schedstat */
+struct schedstat {
+    int ss_hartid;                      // hart id
+    unsigned int ss_load;               // processes running or runnable on the hart
+    size_t ss_switches;                 // context switches
+    size_t ss_balance;                  // load balances that looked for processes to pull
+    size_t ss_migrations_in;            // processes pulled from other harts
+    size_t ss_migrations_out;           // processes pulled by other harts
+    size_t ss_ticks;                    // timer interrupts taken, ticks and high-resolution timers
+    size_t ss_tickless;                 // times the hart stopped its periodic tick
+    uint64_t ss_idle_usec;              // time spent waiting for interrupts with nothing to run
+    size_t ss_preemptions;              // processes preempted in the kernel, see KERNEL_PREEMPT
+    uint64_t ss_max_latency_usec;       // longest a woken process waited to run
+};
+
+/* scheduling policies, see SYS_sched_setattr */
+#define SCHED_NORMAL    0               // the fair class the kernel was built with
+#define SCHED_DEADLINE  6               // earliest deadline first, with a reserved runtime every period
+
+/* scheduling policy and parameters of a process, see SYS_sched_setattr */
+struct sched_attr {
+    uint32_t sa_policy;                 // SCHED_NORMAL or SCHED_DEADLINE
+    uint64_t sa_runtime;                // SCHED_DEADLINE: usec it may run every period
+    uint64_t sa_deadline;               // SCHED_DEADLINE: usec from the start of a period it must have run by
+    uint64_t sa_period;                 // SCHED_DEADLINE: usec
+    size_t sa_nr_misses;                // read only: deadlines missed
+    size_t sa_nr_throttled;             // read only: times it used up its runtime and was held to the next period
+};
+
 #define S_IFMT          070000          // mask for type of file
 #define S_IFREG         010000          // ordinary regular file
 #define S_IFDIR         020000          // directory
 #define S_IFLNK         030000          // symbolic link
 #define S_IFCHR         040000          // character device
 #define S_IFBLK         050000          // block device
+#define S_IFIFO         060000          // pipe or fifo
 
 #define S_ISREG(mode)                   (((mode) & S_IFMT) == S_IFREG)      // regular file
 #define S_ISDIR(mode)                   (((mode) & S_IFMT) == S_IFDIR)      // directory
 #define S_ISLNK(mode)                   (((mode) & S_IFMT) == S_IFLNK)      // symlink
 #define S_ISCHR(mode)                   (((mode) & S_IFMT) == S_IFCHR)      // char device
 #define S_ISBLK(mode)                   (((mode) & S_IFMT) == S_IFBLK)      // block device
+#define S_ISFIFO(mode)                  (((mode) & S_IFMT) == S_IFIFO)      // pipe or fifo
 
 #endif /* !__LIBS_STAT_H__ */
 
@@ -0,0 +1,17 @@
+#ifndef __LIBS_TIME_H__
+#define __LIBS_TIME_H__
+
+#include <defs.h>
+
+/* clocks of SYS_clock_gettime */
+#define CLOCK_MONOTONIC     1           // time since boot, read off the time CSR; never goes back
+
+#define NSEC_PER_USEC       1000L
+#define NSEC_PER_MSEC       1000000L
+
+struct timespec {
+    int64_t tv_sec;                     // seconds
+    long tv_nsec;                       // nanoseconds, 0 .. 999999999
+};
+
+#endif /* !__LIBS_TIME_H__ */
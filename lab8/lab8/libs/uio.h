@@ -0,0 +1,15 @@
+#ifndef __LIBS_UIO_H__
+#define __LIBS_UIO_H__
+
+#include <defs.h>
+
+/* one segment of a scatter/gather list, for readv/writev */
+struct iovec {
+    void *iov_base;                                 // start of the segment
+    size_t iov_len;                                 // its length in bytes
+};
+
+#define IOV_MAX                                     64      // max segments in one readv/writev
+
+#endif /* !__LIBS_UIO_H__ */
+
@@ -27,8 +27,29 @@
 #define SYS_fstat           110
 #define SYS_fsync           111
 #define SYS_getcwd          121
+#define SYS_mkdir           122
+#define SYS_unlink          127
 #define SYS_getdirentry     128
+#define SYS_rmdir           129
 #define SYS_dup             130
+#define SYS_pipe            140
+#define SYS_mkfifo          141
+#define SYS_sendfile        142
+#define SYS_splice          143
+#define SYS_readv           144
+#define SYS_writev          145
+#define SYS_pread           146
+#define SYS_pwrite          147
+#define SYS_ring_setup      148
+#define SYS_ring_enter      149
+#define SYS_rastat          150
+#define SYS_getdents        151
+#define SYS_schedstat       152
+#define SYS_setnice         153
+#define SYS_sched_setattr   154
+#define SYS_sched_getattr   155
+#define SYS_clock_gettime   156
+#define SYS_nanosleep       157
 /* OLNY FOR LAB6 */
 #define SYS_lab6_set_priority 255
 
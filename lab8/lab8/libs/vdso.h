@@ -0,0 +1,30 @@
+#ifndef __LIBS_VDSO_H__
+#define __LIBS_VDSO_H__
+
+#include <defs.h>
+
+/*
+ * Layout of the page the kernel maps read-only at VDSO_BASE in every user process
+ * (see load_icode), so a process can learn its pid and the time without a trap.
+ *
+ * The kernel writes the page when it maps it and, in a forked child's copy, the pid.
+ * The time fields say how to turn the time CSR into time since boot: a process reads
+ * the CSR itself when VDSO_TIME is set, which the kernel does once it lets user mode
+ * read the CSR, and otherwise falls back to SYS_clock_gettime.
+ */
+
+#define VDSO_BASE                       0x7FEEF000      // UVDSOBASE, just below the syscall ring
+
+/* vd_flags */
+#define VDSO_TIME                       0x1             // the time CSR can be read in user mode
+
+struct vdso_data {
+    uint32_t vd_flags;                  // VDSO_*
+    int vd_pid;                         // pid of the process the page is mapped in
+    uint64_t vd_clock_start;            // time CSR at boot, time 0 of CLOCK_MONOTONIC
+    uint64_t vd_timebase_freq;          // counts of the time CSR per second
+    uint64_t vd_tick_cycles;            // counts of the time CSR per tick
+};
+
+#endif /* !__LIBS_VDSO_H__ */
+
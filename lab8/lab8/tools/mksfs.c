@@ -107,7 +107,7 @@ safe_fchdir(int fd) {
     }
 }
 
-#define SFS_MAGIC                               0x2f8dbe2a
+#define SFS_MAGIC                               0x2f8dbe2b
 #define SFS_NDIRECT                             12
 #define SFS_BLKSIZE                             4096                                    // 4K
 #define SFS_MAX_NBLKS                           (1024UL * 512)                          // 4K * 512K
@@ -124,6 +124,9 @@ safe_fchdir(int fd) {
 #define SFS_BLKN_ROOT                           1
 #define SFS_BLKN_FREEMAP                        2
 
+#define SFS_JOURNAL_NBLKS                       64                                      // journal region, after the freemap
+#define SFS_JDESC_MAGIC                         0x6a726e6c                              // 'jrnl'
+
 struct cache_block {
     uint32_t ino;
     struct cache_block *hash_next;
@@ -145,6 +148,12 @@ struct cache_inode {
     uint32_t nblks;
     struct cache_block *l1, *l2;
     struct cache_inode *hash_next;
+    struct dir_entry {
+        uint32_t ino;
+        uint32_t hash;
+        char *name;
+    } *dents;
+    uint32_t ndents, maxdents;
 };
 
 struct sfs_fs {
@@ -153,6 +162,8 @@ struct sfs_fs {
         uint32_t blocks;
         uint32_t unused_blocks;
         char info[SFS_MAX_INFO_LEN + 1];
+        uint32_t journal_start;
+        uint32_t journal_blocks;
     } super;
     struct subpath {
         struct subpath *next, *prev;
@@ -165,11 +176,40 @@ struct sfs_fs {
     struct cache_block *blocks[HASH_LIST_SIZE];
 };
 
-struct sfs_entry {
+#define SFS_DIRBLK_LEAF                         0x6c656166                              // 'leaf'
+#define SFS_DIRBLK_INDEX                        0x696e6478                              // 'indx'
+
+struct sfs_dirblk_head {
+    uint32_t magic;
+    uint32_t count;
+};
+
+struct sfs_dirent_rec {
     uint32_t ino;
-    char name[SFS_MAX_FNAME_LEN + 1];
+    uint16_t rec_len;
+    uint16_t name_len;
+    char name[0];
+};
+
+struct sfs_dirindex {
+    uint32_t hash;
+    uint32_t block;
 };
 
+#define SFS_DIRREC_LEN(namelen)                 ((sizeof(struct sfs_dirent_rec) + (namelen) + 3) & ~3)
+#define SFS_DIRINDEX_NENTRY                     ((SFS_BLKSIZE - sizeof(struct sfs_dirblk_head)) / sizeof(struct sfs_dirindex))
+
+/* must match sfs_name_hash in kern/fs/sfs/sfs.h */
+static uint32_t
+sfs_name_hash(const char *name, size_t len) {
+    uint32_t hash = 2166136261U;
+    while (len -- > 0) {
+        hash ^= (uint8_t)(*name ++);
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
 static uint32_t
 sfs_alloc_ino(struct sfs_fs *sfs) {
     if (sfs->next_ino < sfs->ninos) {
@@ -203,6 +243,7 @@ alloc_cache_inode(struct sfs_fs *sfs, ino_t real, uint32_t ino, uint16_t type) {
     struct cache_inode *ci = safe_malloc(sizeof(struct cache_inode));
     ci->ino = (ino != 0) ? ino : sfs_alloc_ino(sfs);
     ci->real = real, ci->nblks = 0, ci->l1 = ci->l2 = NULL;
+    ci->dents = NULL, ci->ndents = ci->maxdents = 0;
     struct inode *inode = &(ci->inode);
     memset(inode, 0, sizeof(struct inode));
     inode->type = type;
@@ -235,6 +276,12 @@ create_sfs(int imgfd) {
     }
 
     struct sfs_fs *sfs = safe_malloc(sizeof(struct sfs_fs));
+    sfs->super.journal_start = sfs->super.journal_blocks = 0;
+    // small images go without journal
+    if (ninos - next_ino >= SFS_JOURNAL_NBLKS * 8) {
+        sfs->super.journal_start = next_ino, sfs->super.journal_blocks = SFS_JOURNAL_NBLKS;
+        next_ino += SFS_JOURNAL_NBLKS;
+    }
     sfs->super.magic = SFS_MAGIC;
     sfs->super.blocks = ninos, sfs->super.unused_blocks = ninos - next_ino;
     snprintf(sfs->super.info, SFS_MAX_INFO_LEN, "simple file system");
@@ -333,6 +380,11 @@ close_sfs(struct sfs_fs *sfs) {
         write_block(sfs, buffer, sizeof(buffer), ino);
     }
     write_block(sfs, &(sfs->super), sizeof(sfs->super), SFS_BLKN_SUPER);
+    if (sfs->super.journal_blocks != 0) {
+        // a clean journal: descriptor {magic, tid, nblocks = 0}
+        uint32_t desc[3] = {SFS_JDESC_MAGIC, 0, 0};
+        write_block(sfs, desc, sizeof(desc), sfs->super.journal_start);
+    }
 
     for (i = 0; i < HASH_LIST_SIZE; i ++) {
         struct cache_block *cb = sfs->blocks[i];
@@ -427,15 +479,122 @@ append_block(struct sfs_fs *sfs, struct cache_inode *file, size_t size, uint32_t
 
 static void
 add_entry(struct sfs_fs *sfs, struct cache_inode *current, struct cache_inode *file, const char *name) {
-    static struct sfs_entry __entry, *entry = &__entry;
     assert(current->inode.type == SFS_TYPE_DIR && strlen(name) <= SFS_MAX_FNAME_LEN);
-    entry->ino = file->ino, strcpy(entry->name, name);
-    uint32_t entry_ino = sfs_alloc_ino(sfs);
-    write_block(sfs, entry, sizeof(entry->name), entry_ino);
-    append_block(sfs, current, sizeof(entry->name), entry_ino, name);
+    if (current->ndents == current->maxdents) {
+        current->maxdents = (current->maxdents != 0) ? current->maxdents * 2 : 16;
+        struct dir_entry *dents = safe_malloc(sizeof(struct dir_entry) * current->maxdents);
+        if (current->ndents != 0) {
+            memcpy(dents, current->dents, sizeof(struct dir_entry) * current->ndents);
+        }
+        free(current->dents), current->dents = dents;
+    }
+    struct dir_entry *dent = current->dents + current->ndents ++;
+    dent->ino = file->ino, dent->name = safe_strdup(name);
+    dent->hash = sfs_name_hash(name, strlen(name));
     file->inode.nlinks ++;
 }
 
+static int
+dir_entry_cmp(const void *a, const void *b) {
+    const struct dir_entry *x = a, *y = b;
+    if (x->hash != y->hash) {
+        return (x->hash < y->hash) ? -1 : 1;
+    }
+    return strcmp(x->name, y->name);
+}
+
+/* dir_leaf_full - check if a record of dent doesn't fit in a leaf already holding used bytes */
+static bool
+dir_leaf_full(uint32_t used, struct dir_entry *dent) {
+    return used + SFS_DIRREC_LEN(strlen(dent->name)) > SFS_BLKSIZE;
+}
+
+/* pack_leaf - pack dents[0, n) into a leaf block */
+static void
+pack_leaf(void *blk, struct dir_entry *dents, uint32_t n) {
+    memset(blk, 0, SFS_BLKSIZE);
+    struct sfs_dirblk_head *head = blk;
+    head->magic = SFS_DIRBLK_LEAF, head->count = n;
+    uint32_t i, off = sizeof(struct sfs_dirblk_head);
+    for (i = 0; i < n; i ++) {
+        struct sfs_dirent_rec *rec = blk + off;
+        size_t len = strlen(dents[i].name);
+        rec->ino = dents[i].ino, rec->rec_len = SFS_DIRREC_LEN(len), rec->name_len = len;
+        memcpy(rec->name, dents[i].name, len);
+        off += rec->rec_len;
+    }
+    assert(off <= SFS_BLKSIZE);
+}
+
+static void
+add_dir_block(struct sfs_fs *sfs, struct cache_inode *current, void *blk) {
+    uint32_t ino = sfs_alloc_ino(sfs);
+    write_block(sfs, blk, SFS_BLKSIZE, ino);
+    append_block(sfs, current, SFS_BLKSIZE, ino, NULL);
+}
+
+/*
+ * flush_dir - write the entries of a directory as packed leaf blocks. A directory
+ * that needs more than one leaf gets an index block (logical block 0) mapping
+ * name hashes to leaves; a run of equal hashes never straddles two leaves.
+ */
+static void
+flush_dir(struct sfs_fs *sfs, struct cache_inode *current) {
+    static char blk[SFS_BLKSIZE], index_blk[SFS_BLKSIZE];
+    struct dir_entry *dents = current->dents;
+    uint32_t i, n = current->ndents, used = sizeof(struct sfs_dirblk_head);
+    for (i = 0; i < n && !dir_leaf_full(used, dents + i); i ++) {
+        used += SFS_DIRREC_LEN(strlen(dents[i].name));
+    }
+    if (i == n) {
+        pack_leaf(blk, dents, n);
+        add_dir_block(sfs, current, blk);
+        goto out;
+    }
+
+    qsort(dents, n, sizeof(struct dir_entry), dir_entry_cmp);
+    memset(index_blk, 0, sizeof(index_blk));
+    struct sfs_dirblk_head *head = (struct sfs_dirblk_head *)index_blk;
+    struct sfs_dirindex *index = (struct sfs_dirindex *)(head + 1);
+    head->magic = SFS_DIRBLK_INDEX;
+    uint32_t index_ino = sfs_alloc_ino(sfs);
+    append_block(sfs, current, SFS_BLKSIZE, index_ino, NULL);
+
+    uint32_t start = 0;
+    while (start < n) {
+        uint32_t end = start, cut = start;
+        used = sizeof(struct sfs_dirblk_head);
+        while (end < n && !dir_leaf_full(used, dents + end)) {
+            used += SFS_DIRREC_LEN(strlen(dents[end].name));
+            if (++ end == n || dents[end].hash != dents[end - 1].hash) {
+                cut = end;
+            }
+        }
+        if (cut == start) {
+            show_fullpath(sfs, dents[start].name);
+            bug("too many names with hash %08x in one directory.\n", dents[start].hash);
+        }
+        if (head->count == SFS_DIRINDEX_NENTRY) {
+            show_fullpath(sfs, NULL);
+            bug("directory is too big.\n");
+        }
+        index[head->count].hash = (start == 0) ? 0 : dents[start].hash;
+        index[head->count].block = current->nblks;
+        head->count ++;
+        pack_leaf(blk, dents + start, cut - start);
+        add_dir_block(sfs, current, blk);
+        start = cut;
+    }
+    write_block(sfs, index_blk, SFS_BLKSIZE, index_ino);
+
+out:
+    for (i = 0; i < n; i ++) {
+        free(dents[i].name);
+    }
+    free(dents);
+    current->dents = NULL, current->ndents = current->maxdents = 0;
+}
+
 static void
 add_dir(struct sfs_fs *sfs, struct cache_inode *parent, const char *dirname, int curfd, int fd, ino_t real) {
     assert(search_cache_inode(sfs, real) == NULL);
@@ -511,6 +670,7 @@ open_dir(struct sfs_fs *sfs, struct cache_inode *current, struct cache_inode *pa
         }
     }
     closedir(dir);
+    flush_dir(sfs, current);
 }
 
 void
@@ -0,0 +1,41 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <string.h>
+#include <file.h>
+#include <error.h>
+#include <unistd.h>
+
+/* cat - copy files (or stdin) to stdout; file data goes through sendfile, never through user space */
+
+#define CHUNK                           (1024 * 1024)
+
+static int
+cat_fd(int fd) {
+    int ret;
+    while ((ret = sendfile(1, fd, CHUNK)) > 0) {
+        /* do nothing */;
+    }
+    return ret < 0 ? ret : 0;
+}
+
+int
+main(int argc, char **argv) {
+    int i, fd, ret;
+    if (argc == 1) {
+        return cat_fd(0);
+    }
+    for (i = 1; i < argc; i ++) {
+        if ((fd = open(argv[i], O_RDONLY)) < 0) {
+            cprintf("cat: %s: %e\n", argv[i], fd);
+            return fd;
+        }
+        ret = cat_fd(fd);
+        close(fd);
+        if (ret != 0) {
+            cprintf("cat: %s: %e\n", argv[i], ret);
+            return ret;
+        }
+    }
+    return 0;
+}
+
@@ -0,0 +1,82 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <string.h>
+#include <file.h>
+#include <error.h>
+#include <unistd.h>
+
+/*
+ * cp [-r] src dst - copy src to dst with sendfile, or with a read/write loop through
+ * user space if -r is given, and report the throughput so the two can be compared.
+ * SFS can't create files, so dst must be a file that exists there, or be on "tmp:".
+ */
+
+#define BUFSIZE                         4096
+#define CHUNK                           (1024 * 1024)
+
+static char buf[BUFSIZE];
+
+static int
+copy_rw(int in, int out, size_t *total) {
+    int ret;
+    while ((ret = read(in, buf, sizeof(buf))) > 0) {
+        if ((ret = write(out, buf, ret)) < 0) {
+            return ret;
+        }
+        *total += ret;
+    }
+    return ret;
+}
+
+static int
+copy_sendfile(int in, int out, size_t *total) {
+    int ret;
+    while ((ret = sendfile(out, in, CHUNK)) > 0) {
+        *total += ret;
+    }
+    return ret;
+}
+
+int
+main(int argc, char **argv) {
+    bool rw = (argc == 4 && strcmp(argv[1], "-r") == 0);
+    if (argc != 3 && !rw) {
+        cprintf("usage: cp [-r] src dst\n"
+                "  dst is overwritten; a new one can only be created on tmp:\n");
+        return -E_INVAL;
+    }
+    const char *src = argv[argc - 2], *dst = argv[argc - 1];
+    int in, out, ret;
+    if ((in = open(src, O_RDONLY)) < 0) {
+        cprintf("cp: %s: %e\n", src, in);
+        return in;
+    }
+    if ((out = open(dst, O_WRONLY | O_CREAT | O_TRUNC)) < 0) {
+        if (out == -E_UNIMP) {
+            cprintf("cp: %s: can't create files there, copy to tmp: or over an existing file\n", dst);
+        }
+        else {
+            cprintf("cp: %s: %e\n", dst, out);
+        }
+        close(in);
+        return out;
+    }
+
+    size_t total = 0;
+    unsigned int start = gettime_msec();
+    ret = rw ? copy_rw(in, out, &total) : copy_sendfile(in, out, &total);
+    unsigned int msec = gettime_msec() - start;
+    close(in), close(out);
+    if (ret < 0) {
+        cprintf("cp: %e\n", ret);
+        return ret;
+    }
+    if (msec == 0) {
+        msec = 1;
+    }
+    cprintf("cp: %lu bytes by %s in %u msec, %u KB/s.\n", (unsigned long)total,
+            rw ? "read/write" : "sendfile", msec,
+            (unsigned int)((unsigned long long)total * 1000 / 1024 / msec));
+    return 0;
+}
+
@@ -0,0 +1,81 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <stat.h>
+#include <error.h>
+
+/*
+ * Deadline class at work: NSPIN fair spinners keep the harts busy while
+ * periodic deadline tasks each run NJOBS jobs, spinning for the work of a
+ * job and yielding when it is done. The two within their runtime must
+ * meet every deadline; the overrunner asks for less runtime than its jobs
+ * take, so it is throttled and misses. Admission control must turn down a
+ * reservation of more than a hart.
+ */
+
+#define NSPIN                           2
+#define NJOBS                           20
+#define PERIOD                          100000  /* usec */
+
+struct task {
+    unsigned int runtime, work;         // usec reserved, msec of spinning per job
+    int overrun;
+};
+
+static struct task tasks[] = {
+    {30000, 10, 0},
+    {30000, 10, 0},
+    {10000, 20, 1},
+};
+
+#define NTASKS                          (sizeof(tasks) / sizeof(tasks[0]))
+
+static void
+periodic(struct task *t) {
+    struct sched_attr attr = {SCHED_DEADLINE, t->runtime, PERIOD, PERIOD};
+    int i;
+    assert(sched_setattr(&attr) == 0);
+    for (i = 0; i < NJOBS; i ++) {
+        unsigned int start = gettime_msec();
+        while (gettime_msec() - start < t->work);
+        yield();
+    }
+    assert(sched_getattr(&attr) == 0 && attr.sa_policy == SCHED_DEADLINE);
+    cprintf("dlbench: %u/%u usec, %u msec jobs: %d misses, %d throttled.\n",
+            t->runtime, PERIOD, t->work, (int)attr.sa_nr_misses, (int)attr.sa_nr_throttled);
+    if (t->overrun) {
+        exit(attr.sa_nr_throttled > 0 ? 0 : -1);
+    }
+    exit(attr.sa_nr_misses == 0 ? 0 : -1);
+}
+
+int
+main(void) {
+    int i, code, spinners[NSPIN], pids[NTASKS];
+    struct sched_attr attr = {SCHED_DEADLINE, 97000, PERIOD, PERIOD};
+
+    assert(sched_setattr(&attr) == -E_BUSY);
+    attr.sa_runtime = 0;
+    assert(sched_setattr(&attr) == -E_INVAL);
+    assert(sched_getattr(&attr) == 0 && attr.sa_policy == SCHED_NORMAL);
+
+    for (i = 0; i < NSPIN; i ++) {
+        if ((spinners[i] = fork()) == 0) {
+            while (1);
+        }
+        assert(spinners[i] > 0);
+    }
+    for (i = 0; i < NTASKS; i ++) {
+        if ((pids[i] = fork()) == 0) {
+            periodic(&tasks[i]);
+        }
+        assert(pids[i] > 0);
+    }
+    for (i = 0; i < NTASKS; i ++) {
+        assert(waitpid(pids[i], &code) == 0 && code == 0);
+    }
+    for (i = 0; i < NSPIN; i ++) {
+        assert(kill(spinners[i]) == 0 && waitpid(spinners[i], NULL) == 0);
+    }
+    cprintf("dlbench pass.\n");
+    return 0;
+}
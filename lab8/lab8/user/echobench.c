@@ -0,0 +1,81 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <file.h>
+#include <unistd.h>
+#include <time.h>
+
+/*
+ * Keystroke-to-echo latency under load: NSPIN children burn the CPU while
+ * a typist sends NKEYS "keys" one tick apart through a pipe to an echoer,
+ * which writes each one back, the way the shell echoes what it reads from
+ * stdin. The typist times each round trip. Both sleep in a pipe read, an
+ * I/O wait like the shell's, so with SCHED=mlfq they should run ahead of
+ * the spinners instead of waiting out their time slices.
+ */
+
+#define NSPIN                           4
+#define NKEYS                           50
+
+static uint64_t
+now_usec(void) {
+    struct timespec ts;
+    assert(clock_gettime(CLOCK_MONOTONIC, &ts) == 0);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / NSEC_PER_USEC;
+}
+
+static void
+echoer(int in, int out) {
+    char c;
+    while (read(in, &c, 1) == 1) {
+        if (write(out, &c, 1) != 1) {
+            exit(-1);
+        }
+    }
+    exit(0);
+}
+
+int
+main(void) {
+    int i, to_echo[2], from_echo[2], pid, spinners[NSPIN];
+    uint64_t start, usec, sum = 0, max = 0;
+    char c;
+
+    for (i = 0; i < NSPIN; i ++) {
+        if ((spinners[i] = fork()) == 0) {
+            while (1);
+        }
+        assert(spinners[i] > 0);
+    }
+
+    assert(pipe(to_echo) == 0 && pipe(from_echo) == 0);
+    if ((pid = fork()) == 0) {
+        close(to_echo[1]), close(from_echo[0]);
+        echoer(to_echo[0], from_echo[1]);
+    }
+    assert(pid > 0);
+    close(to_echo[0]), close(from_echo[1]);
+
+    for (i = 0; i < NKEYS; i ++) {
+        sleep(1);
+        c = 'a' + i % 26;
+        start = now_usec();
+        assert(write(to_echo[1], &c, 1) == 1);
+        assert(read(from_echo[0], &c, 1) == 1 && c == 'a' + i % 26);
+        usec = now_usec() - start;
+        sum += usec;
+        if (usec > max) {
+            max = usec;
+        }
+    }
+    close(to_echo[1]);
+    assert(waitpid(pid, NULL) == 0);
+    close(from_echo[0]);
+
+    for (i = 0; i < NSPIN; i ++) {
+        assert(kill(spinners[i]) == 0 && waitpid(spinners[i], NULL) == 0);
+    }
+    cprintf("echobench: %d keys under %d spinners, %u usec on average, %u at most.\n",
+            NKEYS, NSPIN, (unsigned int)(sum / NKEYS), (unsigned int)max);
+    cprintf("echobench pass.\n");
+    return 0;
+}
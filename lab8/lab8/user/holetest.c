@@ -0,0 +1,87 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stat.h>
+#include <file.h>
+#include <unistd.h>
+
+/*
+ * SFS sparse files: truncate a file, write past its end and check that the
+ * skipped blocks read as zeros and take no disk block, then truncate it again
+ * and check that the freed blocks don't come back with their old data. SFS
+ * can't create files, so the file comes with the disk image (see fsdata in the
+ * Makefile), chunk i filled with the byte i.
+ */
+
+#define FILE_NAME                       "holetest.dat"
+#define CHUNK                           4096
+#define DIRECT_OFF                      (4 * CHUNK)     // a hole in the direct blocks
+#define INDIRECT_OFF                    (20 * CHUNK)    // a hole behind the indirect block
+
+static char buf[CHUNK];
+
+static void
+check_stat(int fd, off_t size, size_t blocks) {
+    struct stat stat;
+    assert(fstat(fd, &stat) == 0);
+    assert(stat.st_size == size && stat.st_blocks == blocks);
+}
+
+static void
+check_zeros(int fd, off_t pos, size_t len) {
+    int i;
+    assert(pread(fd, buf, len, pos) == len);
+    for (i = 0; i < len; i ++) {
+        assert(buf[i] == 0);
+    }
+}
+
+static int
+truncate_open(void) {
+    struct stat stat;
+    int fd;
+    assert((fd = open(FILE_NAME, O_RDWR | O_TRUNC)) >= 0);
+    // the indirect block stays with the inode, if an earlier run made one
+    assert(fstat(fd, &stat) == 0);
+    assert(stat.st_size == 0 && stat.st_blocks <= 1);
+    return fd;
+}
+
+int
+main(void) {
+    int fd;
+    size_t base;
+    struct stat stat;
+
+    fd = truncate_open();
+    assert(fstat(fd, &stat) == 0);
+    base = stat.st_blocks;
+    memset(buf, 'h', CHUNK);
+    assert(pwrite(fd, buf, CHUNK, DIRECT_OFF) == CHUNK);
+    check_stat(fd, DIRECT_OFF + CHUNK, base + 1);
+    check_zeros(fd, 0, CHUNK);
+    check_zeros(fd, DIRECT_OFF - CHUNK, CHUNK);
+
+    memset(buf, 'h', CHUNK);
+    assert(pwrite(fd, buf, CHUNK, INDIRECT_OFF) == CHUNK);
+    check_stat(fd, INDIRECT_OFF + CHUNK, 3);
+    check_zeros(fd, INDIRECT_OFF - CHUNK, CHUNK);
+    assert(pread(fd, buf, CHUNK, INDIRECT_OFF) == CHUNK);
+    assert(buf[0] == 'h' && buf[CHUNK - 1] == 'h');
+    close(fd);
+    cprintf("hole: %d KB file in 3 blocks ok.\n", (INDIRECT_OFF + CHUNK) / 1024);
+
+    // the blocks go with the truncation, the same offset reads back as a fresh block
+    fd = truncate_open();
+    check_stat(fd, 0, 1);
+    buf[0] = 'x';
+    assert(pwrite(fd, buf, 1, DIRECT_OFF + CHUNK - 1) == 1);
+    check_stat(fd, DIRECT_OFF + CHUNK, 2);
+    check_zeros(fd, DIRECT_OFF, CHUNK - 1);
+    assert(pread(fd, buf, 1, DIRECT_OFF + CHUNK - 1) == 1 && buf[0] == 'x');
+    close(fd);
+    cprintf("truncate: blocks freed ok.\n");
+
+    cprintf("holetest pass.\n");
+    return 0;
+}
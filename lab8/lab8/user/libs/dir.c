@@ -20,6 +20,7 @@ opendir(const char *path) {
         goto failed;
     }
     dirp->dirent.offset = 0;
+    dirp->pos = dirp->end = 0;
     return dirp;
 
 failed:
@@ -28,10 +29,18 @@ failed:
 
 struct dirent *
 readdir(DIR *dirp) {
-    if (sys_getdirentry(dirp->fd, &(dirp->dirent)) == 0) {
-        return &(dirp->dirent);
+    if (dirp->pos == dirp->end) {
+        int ret;
+        if ((ret = sys_getdents(dirp->fd, dirp->buf, DIR_BUFSIZE)) <= 0) {
+            return NULL;
+        }
+        dirp->pos = 0, dirp->end = ret;
     }
-    return NULL;
+    struct dirent_rec *rec = (struct dirent_rec *)(dirp->buf + dirp->pos);
+    dirp->pos += rec->d_reclen;
+    dirp->dirent.offset = rec->d_off;
+    memcpy(dirp->dirent.name, rec->d_name, rec->d_namlen + 1);
+    return &(dirp->dirent);
 }
 
 void
@@ -44,3 +53,13 @@ getcwd(char *buffer, size_t len) {
     return sys_getcwd(buffer, len);
 }
 
+int
+mkdir(const char *path) {
+    return sys_mkdir(path);
+}
+
+int
+rmdir(const char *path) {
+    return sys_rmdir(path);
+}
+
@@ -4,9 +4,14 @@
 #include <defs.h>
 #include <dirent.h>
 
+#define DIR_BUFSIZE                 1024
+
+/* readdir hands out the entries of buf, filled by one getdents call, in turn */
 typedef struct {
     int fd;
     struct dirent dirent;
+    int pos, end;                       // next record in buf, and the end of the records
+    char buf[DIR_BUFSIZE];
 } DIR;
 
 DIR *opendir(const char *path);
@@ -14,6 +19,8 @@ struct dirent *readdir(DIR *dirp);
 void closedir(DIR *dirp);
 int chdir(const char *path);
 int getcwd(char *buffer, size_t len);
+int mkdir(const char *path);
+int rmdir(const char *path);
 
 #endif /* !__USER_LIBS_DIR_H__ */
 
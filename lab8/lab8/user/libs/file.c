@@ -26,6 +26,26 @@ write(int fd, void *base, size_t len) {
     return sys_write(fd, base, len);
 }
 
+int
+readv(int fd, const struct iovec *iov, int iovcnt) {
+    return sys_readv(fd, iov, iovcnt);
+}
+
+int
+writev(int fd, const struct iovec *iov, int iovcnt) {
+    return sys_writev(fd, iov, iovcnt);
+}
+
+int
+pread(int fd, void *base, size_t len, off_t pos) {
+    return sys_pread(fd, base, len, pos);
+}
+
+int
+pwrite(int fd, void *base, size_t len, off_t pos) {
+    return sys_pwrite(fd, base, len, pos);
+}
+
 int
 seek(int fd, off_t pos, int whence) {
     return sys_seek(fd, pos, whence);
@@ -41,11 +61,41 @@ fsync(int fd) {
     return sys_fsync(fd);
 }
 
+int
+rastat(int fd, struct rastat *stat) {
+    return sys_rastat(fd, stat);
+}
+
 int
 dup2(int fd1, int fd2) {
     return sys_dup(fd1, fd2);
 }
 
+int
+pipe(int *fd_store) {
+    return sys_pipe(fd_store);
+}
+
+int
+mkfifo(const char *name, uint32_t open_flags) {
+    return sys_mkfifo(name, open_flags);
+}
+
+int
+unlink(const char *path) {
+    return sys_unlink(path);
+}
+
+int
+sendfile(int out_fd, int in_fd, size_t len) {
+    return sys_sendfile(out_fd, in_fd, len);
+}
+
+int
+splice(int in_fd, int out_fd, size_t len) {
+    return sys_splice(in_fd, out_fd, len);
+}
+
 static char
 transmode(struct stat *stat) {
     uint32_t mode = stat->st_mode;
@@ -54,6 +104,7 @@ transmode(struct stat *stat) {
     if (S_ISLNK(mode)) return 'l';
     if (S_ISCHR(mode)) return 'c';
     if (S_ISBLK(mode)) return 'b';
+    if (S_ISFIFO(mode)) return 'p';
     return '-';
 }
 
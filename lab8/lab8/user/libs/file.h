@@ -2,20 +2,30 @@
 #define __USER_LIBS_FILE_H__
 
 #include <defs.h>
+#include <uio.h>
 
 struct stat;
+struct rastat;
 
 int open(const char *path, uint32_t open_flags);
 int close(int fd);
 int read(int fd, void *base, size_t len);
 int write(int fd, void *base, size_t len);
+int readv(int fd, const struct iovec *iov, int iovcnt);
+int writev(int fd, const struct iovec *iov, int iovcnt);
+int pread(int fd, void *base, size_t len, off_t pos);
+int pwrite(int fd, void *base, size_t len, off_t pos);
 int seek(int fd, off_t pos, int whence);
 int fstat(int fd, struct stat *stat);
 int fsync(int fd);
+int rastat(int fd, struct rastat *stat);
 int dup(int fd);
 int dup2(int fd1, int fd2);
 int pipe(int *fd_store);
 int mkfifo(const char *name, uint32_t open_flags);
+int unlink(const char *path);
+int sendfile(int out_fd, int in_fd, size_t len);
+int splice(int in_fd, int out_fd, size_t len);
 
 void print_stat(const char *name, int fd, struct stat *stat);
 
@@ -91,6 +91,36 @@ sys_sleep(int64_t time) {
     return syscall(SYS_sleep, time);
 }
 
+int
+sys_setnice(int64_t nice) {
+    return syscall(SYS_setnice, nice);
+}
+
+int
+sys_schedstat(struct schedstat *stats, int64_t n) {
+    return syscall(SYS_schedstat, stats, n);
+}
+
+int
+sys_clock_gettime(int64_t clockid, struct timespec *tp) {
+    return syscall(SYS_clock_gettime, clockid, tp);
+}
+
+int
+sys_nanosleep(const struct timespec *req) {
+    return syscall(SYS_nanosleep, req);
+}
+
+int
+sys_sched_setattr(struct sched_attr *attr) {
+    return syscall(SYS_sched_setattr, attr);
+}
+
+int
+sys_sched_getattr(struct sched_attr *attr) {
+    return syscall(SYS_sched_getattr, attr);
+}
+
 int
 sys_gettime(void) {
     return syscall(SYS_gettime);
@@ -121,6 +151,26 @@ sys_write(int64_t fd, void *base, size_t len) {
     return syscall(SYS_write, fd, base, len);
 }
 
+int
+sys_readv(int64_t fd, const struct iovec *iov, int64_t iovcnt) {
+    return syscall(SYS_readv, fd, iov, iovcnt);
+}
+
+int
+sys_writev(int64_t fd, const struct iovec *iov, int64_t iovcnt) {
+    return syscall(SYS_writev, fd, iov, iovcnt);
+}
+
+int
+sys_pread(int64_t fd, void *base, size_t len, int64_t pos) {
+    return syscall(SYS_pread, fd, base, len, pos);
+}
+
+int
+sys_pwrite(int64_t fd, void *base, size_t len, int64_t pos) {
+    return syscall(SYS_pwrite, fd, base, len, pos);
+}
+
 int
 sys_seek(int64_t fd, off_t pos, int64_t whence) {
     return syscall(SYS_seek, fd, pos, whence);
@@ -141,12 +191,67 @@ sys_getcwd(char *buffer, size_t len) {
     return syscall(SYS_getcwd, buffer, len);
 }
 
+int
+sys_mkdir(const char *path) {
+    return syscall(SYS_mkdir, path);
+}
+
+int
+sys_unlink(const char *path) {
+    return syscall(SYS_unlink, path);
+}
+
+int
+sys_rmdir(const char *path) {
+    return syscall(SYS_rmdir, path);
+}
+
 int
 sys_getdirentry(int64_t fd, struct dirent *dirent) {
     return syscall(SYS_getdirentry, fd, dirent);
 }
 
+int
+sys_getdents(int64_t fd, void *base, size_t len) {
+    return syscall(SYS_getdents, fd, base, len);
+}
+
 int
 sys_dup(int64_t fd1, int64_t fd2) {
     return syscall(SYS_dup, fd1, fd2);
 }
+
+int
+sys_pipe(int *fd_store) {
+    return syscall(SYS_pipe, fd_store);
+}
+
+int
+sys_mkfifo(const char *name, uint64_t open_flags) {
+    return syscall(SYS_mkfifo, name, open_flags);
+}
+
+int
+sys_sendfile(int64_t out_fd, int64_t in_fd, size_t len) {
+    return syscall(SYS_sendfile, out_fd, in_fd, len);
+}
+
+int
+sys_splice(int64_t in_fd, int64_t out_fd, size_t len) {
+    return syscall(SYS_splice, in_fd, out_fd, len);
+}
+
+int
+sys_rastat(int64_t fd, struct rastat *stat) {
+    return syscall(SYS_rastat, fd, stat);
+}
+
+int
+sys_ring_setup(uintptr_t *addr_store) {
+    return syscall(SYS_ring_setup, addr_store);
+}
+
+int
+sys_ring_enter(uint64_t to_submit, uint64_t min_complete) {
+    return syscall(SYS_ring_enter, to_submit, min_complete);
+}
@@ -12,20 +12,47 @@ int sys_putc(int64_t c);
 int sys_pgdir(void);
 int sys_sleep(int64_t time);
 int sys_gettime(void);
+int sys_setnice(int64_t nice);
+
+struct schedstat;
+int sys_schedstat(struct schedstat *stats, int64_t n);
+struct timespec;
+int sys_clock_gettime(int64_t clockid, struct timespec *tp);
+int sys_nanosleep(const struct timespec *req);
+struct sched_attr;
+int sys_sched_setattr(struct sched_attr *attr);
+int sys_sched_getattr(struct sched_attr *attr);
 
 struct stat;
 struct dirent;
+struct iovec;
+struct rastat;
 
 int sys_open(const char *path, uint64_t open_flags);
 int sys_close(int64_t fd);
 int sys_read(int64_t fd, void *base, size_t len);
 int sys_write(int64_t fd, void *base, size_t len);
+int sys_readv(int64_t fd, const struct iovec *iov, int64_t iovcnt);
+int sys_writev(int64_t fd, const struct iovec *iov, int64_t iovcnt);
+int sys_pread(int64_t fd, void *base, size_t len, int64_t pos);
+int sys_pwrite(int64_t fd, void *base, size_t len, int64_t pos);
 int sys_seek(int64_t fd, off_t pos, int64_t whence);
 int sys_fstat(int64_t fd, struct stat *stat);
 int sys_fsync(int64_t fd);
 int sys_getcwd(char *buffer, size_t len);
+int sys_mkdir(const char *path);
+int sys_unlink(const char *path);
+int sys_rmdir(const char *path);
 int sys_getdirentry(int64_t fd, struct dirent *dirent);
+int sys_getdents(int64_t fd, void *base, size_t len);
 int sys_dup(int64_t fd1, int64_t fd2);
+int sys_pipe(int *fd_store);
+int sys_mkfifo(const char *name, uint64_t open_flags);
+int sys_sendfile(int64_t out_fd, int64_t in_fd, size_t len);
+int sys_splice(int64_t in_fd, int64_t out_fd, size_t len);
+int sys_rastat(int64_t fd, struct rastat *stat);
+int sys_ring_setup(uintptr_t *addr_store);
+int sys_ring_enter(uint64_t to_submit, uint64_t min_complete);
 void sys_lab6_set_priority(uint64_t priority); //only for lab6
 
 
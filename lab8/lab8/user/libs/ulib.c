@@ -4,6 +4,13 @@
 #include <ulib.h>
 #include <stat.h>
 #include <lock.h>
+#include <riscv.h>
+#include <time.h>
+#include <vdso.h>
+
+// mapped by the kernel in every process, see libs/vdso.h
+static const volatile struct vdso_data *const vdso = (const struct vdso_data *)VDSO_BASE;
+
 void
 exit(int error_code) {
     sys_exit(error_code);
@@ -38,7 +45,7 @@ kill(int pid) {
 
 int
 getpid(void) {
-    return sys_getpid();
+    return vdso->vd_pid;
 }
 
 //print_pgdir - print the PDT&PT
@@ -47,8 +54,18 @@ print_pgdir(void) {
     sys_pgdir();
 }
 
+// vdso_gettime_ns - nanoseconds since boot, read off the time CSR the way the kernel does
+static uint64_t
+vdso_gettime_ns(void) {
+    uint64_t cycles = rdtime() - vdso->vd_clock_start, freq = vdso->vd_timebase_freq;
+    return cycles / freq * (NSEC_PER_MSEC * 1000) + cycles % freq * (NSEC_PER_MSEC * 1000) / freq;
+}
+
 unsigned int
 gettime_msec(void) {
+    if (vdso->vd_flags & VDSO_TIME) {
+        return (unsigned int)(vdso_gettime_ns() / NSEC_PER_MSEC);
+    }
     return (unsigned int)sys_gettime();
 }
 
@@ -62,6 +79,43 @@ int
 sleep(unsigned int time) {
     return sys_sleep(time);
 }
+
+int
+setnice(int nice) {
+    return sys_setnice(nice);
+}
+
+int
+schedstat(struct schedstat *stats, int n) {
+    return sys_schedstat(stats, n);
+}
+
+int
+clock_gettime(int clockid, struct timespec *tp) {
+    if (clockid == CLOCK_MONOTONIC && (vdso->vd_flags & VDSO_TIME)) {
+        uint64_t ns = vdso_gettime_ns();
+        tp->tv_sec = ns / (NSEC_PER_MSEC * 1000);
+        tp->tv_nsec = ns % (NSEC_PER_MSEC * 1000);
+        return 0;
+    }
+    return sys_clock_gettime(clockid, tp);
+}
+
+int
+nanosleep(const struct timespec *req) {
+    return sys_nanosleep(req);
+}
+
+int
+sched_setattr(struct sched_attr *attr) {
+    return sys_sched_setattr(attr);
+}
+
+int
+sched_getattr(struct sched_attr *attr) {
+    return sys_sched_getattr(attr);
+}
+
 int
 __exec(const char *name, const char **argv) {
     int argc = 0;
@@ -34,6 +34,15 @@ void print_pgdir(void);
 unsigned int gettime_msec(void);
 void lab6_set_priority(uint32_t priority);
 int sleep(unsigned int time);
+int setnice(int nice);
+struct schedstat;
+int schedstat(struct schedstat *stats, int n);
+struct timespec;
+int clock_gettime(int clockid, struct timespec *tp);
+int nanosleep(const struct timespec *req);
+struct sched_attr;
+int sched_setattr(struct sched_attr *attr);
+int sched_getattr(struct sched_attr *attr);
 int fprintf(int fd, const char *fmt, ...);
 int __exec(const char *name, const char **argv);
 #endif /* !__USER_LIBS_ULIB_H__ */
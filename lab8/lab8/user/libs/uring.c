@@ -0,0 +1,108 @@
+#include <defs.h>
+#include <string.h>
+#include <riscv.h>
+#include <syscall.h>
+#include <error.h>
+#include <uring.h>
+
+int
+uring_init(struct uring *ring) {
+    uintptr_t addr;
+    int ret;
+    if ((ret = sys_ring_setup(&addr)) != 0) {
+        return ret;
+    }
+    ring->shared = (struct ring_shared *)addr;
+    ring->sq_tail = ring->shared->sq_tail;
+    return 0;
+}
+
+// uring_get_sqe - the next free sqe, cleared, or NULL if the kernel hasn't taken enough yet
+struct ring_sqe *
+uring_get_sqe(struct uring *ring) {
+    struct ring_shared *shared = ring->shared;
+    if (ring->sq_tail - shared->sq_head >= RING_SQ_ENTRIES) {
+        return NULL;
+    }
+    struct ring_sqe *sqe = &(shared->sqes[ring->sq_tail % RING_SQ_ENTRIES]);
+    memset(sqe, 0, sizeof(struct ring_sqe));
+    ring->sq_tail ++;
+    return sqe;
+}
+
+// uring_submit - hand every sqe got so far to the kernel, and wait for wait_nr completions
+int
+uring_submit(struct uring *ring, uint32_t wait_nr) {
+    barrier();
+    ring->shared->sq_tail = ring->sq_tail;
+    return sys_ring_enter(RING_SQ_ENTRIES, wait_nr);
+}
+
+// uring_peek_cqe - the oldest completion not yet seen, or NULL
+struct ring_cqe *
+uring_peek_cqe(struct uring *ring) {
+    struct ring_shared *shared = ring->shared;
+    if (shared->cq_head == shared->cq_tail) {
+        return NULL;
+    }
+    barrier();
+    return &(shared->cqes[shared->cq_head % RING_CQ_ENTRIES]);
+}
+
+// uring_wait_cqe - wait for the oldest completion not yet seen
+int
+uring_wait_cqe(struct uring *ring, struct ring_cqe **cqe_store) {
+    struct ring_cqe *cqe;
+    int ret;
+    while ((cqe = uring_peek_cqe(ring)) == NULL) {
+        if ((ret = sys_ring_enter(0, 1)) < 0) {
+            return ret;
+        }
+    }
+    *cqe_store = cqe;
+    return 0;
+}
+
+// uring_cqe_seen - give the oldest completion's slot back to the kernel
+void
+uring_cqe_seen(struct uring *ring) {
+    barrier();
+    ring->shared->cq_head ++;
+}
+
+static void
+uring_prep(struct ring_sqe *sqe, uint8_t opcode, int fd, void *base, uint32_t len, off_t off) {
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = (uintptr_t)base;
+    sqe->len = len;
+    sqe->off = off;
+}
+
+// off is -1 to read at the file position
+void
+uring_prep_read(struct ring_sqe *sqe, int fd, void *base, size_t len, off_t off) {
+    uring_prep(sqe, RING_OP_READ, fd, base, len, off);
+}
+
+// off is -1 to write at the file position
+void
+uring_prep_write(struct ring_sqe *sqe, int fd, void *base, size_t len, off_t off) {
+    uring_prep(sqe, RING_OP_WRITE, fd, base, len, off);
+}
+
+void
+uring_prep_open(struct ring_sqe *sqe, const char *path, uint32_t open_flags) {
+    uring_prep(sqe, RING_OP_OPEN, -1, (void *)path, open_flags, -1);
+}
+
+void
+uring_prep_close(struct ring_sqe *sqe, int fd) {
+    uring_prep(sqe, RING_OP_CLOSE, fd, NULL, 0, -1);
+}
+
+void
+uring_prep_fsync(struct ring_sqe *sqe, int fd) {
+    uring_prep(sqe, RING_OP_FSYNC, fd, NULL, 0, -1);
+}
+
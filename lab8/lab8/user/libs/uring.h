@@ -0,0 +1,27 @@
+#ifndef __USER_LIBS_URING_H__
+#define __USER_LIBS_URING_H__
+
+#include <defs.h>
+#include <ring.h>
+
+/* the process's side of the syscall ring, see libs/ring.h */
+struct uring {
+    struct ring_shared *shared;
+    uint32_t sq_tail;                               // sqes handed out, published by uring_submit
+};
+
+int uring_init(struct uring *ring);
+struct ring_sqe *uring_get_sqe(struct uring *ring);
+int uring_submit(struct uring *ring, uint32_t wait_nr);
+struct ring_cqe *uring_peek_cqe(struct uring *ring);
+int uring_wait_cqe(struct uring *ring, struct ring_cqe **cqe_store);
+void uring_cqe_seen(struct uring *ring);
+
+void uring_prep_read(struct ring_sqe *sqe, int fd, void *base, size_t len, off_t off);
+void uring_prep_write(struct ring_sqe *sqe, int fd, void *base, size_t len, off_t off);
+void uring_prep_open(struct ring_sqe *sqe, const char *path, uint32_t open_flags);
+void uring_prep_close(struct ring_sqe *sqe, int fd);
+void uring_prep_fsync(struct ring_sqe *sqe, int fd);
+
+#endif /* !__USER_LIBS_URING_H__ */
+
@@ -0,0 +1,46 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <time.h>
+
+/*
+ * High-resolution sleep: nanosleep for times well under a tick, and check
+ * on the monotonic clock that each sleep lasts at least as long as asked,
+ * and how much longer on average.
+ */
+
+#define NROUNDS                         10
+
+static const long sleeps_ns[] = {
+    100 * NSEC_PER_USEC, 1 * NSEC_PER_MSEC, 2500 * NSEC_PER_USEC, 20 * NSEC_PER_MSEC,
+};
+
+static uint64_t
+now_ns(void) {
+    struct timespec ts;
+    assert(clock_gettime(CLOCK_MONOTONIC, &ts) == 0);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int
+main(void) {
+    int i, j;
+    struct timespec ts = {0, -1};
+    assert(nanosleep(&ts) != 0);
+    assert(clock_gettime(0, &ts) != 0);
+
+    for (i = 0; i < sizeof(sleeps_ns) / sizeof(sleeps_ns[0]); i ++) {
+        uint64_t over = 0;
+        ts.tv_sec = 0, ts.tv_nsec = sleeps_ns[i];
+        for (j = 0; j < NROUNDS; j ++) {
+            uint64_t start = now_ns();
+            assert(nanosleep(&ts) == 0);
+            uint64_t slept = now_ns() - start;
+            assert(slept >= sleeps_ns[i]);
+            over += slept - sleeps_ns[i];
+        }
+        cprintf("nanosleep %d usec: %d usec late on average.\n",
+                (int)(sleeps_ns[i] / NSEC_PER_USEC), (int)(over / NROUNDS / NSEC_PER_USEC));
+    }
+    cprintf("nanosleep pass.\n");
+    return 0;
+}
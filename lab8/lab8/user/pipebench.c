@@ -0,0 +1,153 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <string.h>
+#include <file.h>
+#include <unistd.h>
+
+/*
+ * pipe throughput: a child streams TOTAL_BYTES through a pipe in CHUNK sized
+ * writes, the parent reads them back and reports the bandwidth. Then NWRITERS
+ * children write RECORD sized records into one pipe concurrently, and the
+ * parent checks that no record was interleaved with another (writes of at
+ * most PIPE_BUF bytes are atomic). Last, the same stream goes through a fifo.
+ */
+
+#define TOTAL_BYTES                     (4 * 1024 * 1024)
+#define CHUNK                           4096
+#define NWRITERS                        4
+#define NRECORDS                        256
+#define RECORD                          512
+
+static char buf[CHUNK];
+
+static int
+stream_write(int fd) {
+    int i, ret;
+    for (i = 0; i < TOTAL_BYTES; i += CHUNK) {
+        memset(buf, (char)(i / CHUNK), CHUNK);
+        if ((ret = write(fd, buf, CHUNK)) != CHUNK) {
+            cprintf("write returns %d at %d.\n", ret, i);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int
+stream_read(int fd, const char *what, unsigned int start) {
+    int total = 0, ret;
+    while ((ret = read(fd, buf, CHUNK)) > 0) {
+        total += ret;
+    }
+    if (ret < 0 || total != TOTAL_BYTES) {
+        cprintf("%s: read %d bytes, ret %d.\n", what, total, ret);
+        return -1;
+    }
+    unsigned int msec = gettime_msec() - start;
+    if (msec == 0) {
+        msec = 1;
+    }
+    cprintf("%s: %d KB in %u msec, %u KB/s.\n", what, total / 1024, msec,
+            (unsigned int)((unsigned long long)total * 1000 / 1024 / msec));
+    return 0;
+}
+
+static int
+bench_pipe(void) {
+    int fd[2], pid;
+    assert(pipe(fd) == 0);
+    unsigned int start = gettime_msec();
+    if ((pid = fork()) == 0) {
+        close(fd[0]);
+        exit(stream_write(fd[1]));
+    }
+    assert(pid > 0);
+    close(fd[1]);
+    int ret = stream_read(fd[0], "pipe", start);
+    close(fd[0]);
+    int exit_code;
+    assert(waitpid(pid, &exit_code) == 0 && exit_code == 0);
+    return ret;
+}
+
+static int
+check_atomic(void) {
+    int fd[2], pids[NWRITERS], i, j, ret;
+    assert(pipe(fd) == 0);
+    for (i = 0; i < NWRITERS; i ++) {
+        if ((pids[i] = fork()) == 0) {
+            close(fd[0]);
+            memset(buf, 'a' + i, RECORD);
+            for (j = 0; j < NRECORDS; j ++) {
+                if (write(fd[1], buf, RECORD) != RECORD) {
+                    exit(-1);
+                }
+            }
+            exit(0);
+        }
+        assert(pids[i] > 0);
+    }
+    close(fd[1]);
+
+    // records of RECORD bytes come out whole, whatever the read sizes are
+    int count[NWRITERS] = {0}, off = 0;
+    char first = 0;
+    while ((ret = read(fd[0], buf, RECORD / 3)) > 0) {
+        for (j = 0; j < ret; j ++, off ++) {
+            if (off % RECORD == 0) {
+                first = buf[j];
+                if (first < 'a' || first >= 'a' + NWRITERS) {
+                    cprintf("atomic: bad byte %d at %d.\n", first, off);
+                    return -1;
+                }
+                count[first - 'a'] ++;
+            }
+            else if (buf[j] != first) {
+                cprintf("atomic: record at %d interleaved.\n", off - off % RECORD);
+                return -1;
+            }
+        }
+    }
+    close(fd[0]);
+    for (i = 0; i < NWRITERS; i ++) {
+        int exit_code;
+        assert(waitpid(pids[i], &exit_code) == 0 && exit_code == 0);
+        if (count[i] != NRECORDS) {
+            cprintf("atomic: writer %d has %d records.\n", i, count[i]);
+            return -1;
+        }
+    }
+    cprintf("atomic: %d writers x %d records of %d bytes ok.\n", NWRITERS, NRECORDS, RECORD);
+    return 0;
+}
+
+static int
+bench_fifo(void) {
+    int fd, pid;
+    unsigned int start = gettime_msec();
+    if ((pid = fork()) == 0) {
+        if ((fd = mkfifo("pipebench", O_WRONLY)) < 0) {
+            exit(fd);
+        }
+        int ret = stream_write(fd);
+        close(fd);
+        exit(ret);
+    }
+    assert(pid > 0);
+    assert((fd = mkfifo("pipebench", O_RDONLY)) >= 0);
+    int ret = stream_read(fd, "fifo", start);
+    close(fd);
+    int exit_code;
+    assert(waitpid(pid, &exit_code) == 0 && exit_code == 0);
+    return ret;
+}
+
+int
+main(void) {
+    assert(bench_pipe() == 0);
+    assert(check_atomic() == 0);
+    assert(bench_fifo() == 0);
+    cprintf("pipebench pass.\n");
+    return 0;
+}
+
@@ -0,0 +1,88 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <string.h>
+#include <file.h>
+#include <unistd.h>
+#include <stat.h>
+#include <time.h>
+
+/*
+ * Worst-case wakeup latency under long syscalls: NHOGS children read a
+ * FILE_SIZE file on "tmp:" in one read() each, over and over, so the
+ * harts spend most of their time in the kernel, while a sleeper wakes up
+ * every SLEEP_USEC NROUNDS times and times how late it runs. Without kernel
+ * preemption a woken process waits for the read in its way to finish;
+ * with PREEMPT=1 it should run as soon as the scheduler lets it. The
+ * kernel's own figure, the longest any woken process waited to run, is
+ * printed for each hart along with the preemptions in the kernel.
+ */
+
+#define NHOGS                           4
+#define NROUNDS                         100
+#define SLEEP_USEC                      2000
+#define FILE_SIZE                       (128 * 1024)
+#define MAXHARTS                        8
+#define FILE_NAME                       "tmp:preemptbench.dat"
+
+static char buf[FILE_SIZE];
+
+static uint64_t
+now_ns(void) {
+    struct timespec ts;
+    assert(clock_gettime(CLOCK_MONOTONIC, &ts) == 0);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void
+hog(void) {
+    int fd;
+    while (1) {
+        assert((fd = open(FILE_NAME, O_RDONLY)) >= 0);
+        assert(read(fd, buf, FILE_SIZE) == FILE_SIZE);
+        close(fd);
+    }
+}
+
+int
+main(void) {
+    int i, n, fd, hogs[NHOGS];
+    uint64_t over, sum = 0, max = 0;
+    struct timespec ts = {0, SLEEP_USEC * NSEC_PER_USEC};
+    struct schedstat stats[MAXHARTS];
+
+    assert((fd = open(FILE_NAME, O_WRONLY | O_CREAT | O_TRUNC)) >= 0);
+    memset(buf, 'p', FILE_SIZE);
+    assert(write(fd, buf, FILE_SIZE) == FILE_SIZE);
+    close(fd);
+
+    for (i = 0; i < NHOGS; i ++) {
+        if ((hogs[i] = fork()) == 0) {
+            hog();
+        }
+        assert(hogs[i] > 0);
+    }
+
+    for (i = 0; i < NROUNDS; i ++) {
+        uint64_t start = now_ns();
+        assert(nanosleep(&ts) == 0);
+        over = now_ns() - start - SLEEP_USEC * NSEC_PER_USEC;
+        sum += over;
+        if (over > max) {
+            max = over;
+        }
+    }
+
+    for (i = 0; i < NHOGS; i ++) {
+        assert(kill(hogs[i]) == 0 && waitpid(hogs[i], NULL) == 0);
+    }
+    cprintf("preemptbench: %d sleeps of %d usec under %d readers, %d usec late on average, %d at most.\n",
+            NROUNDS, SLEEP_USEC, NHOGS, (int)(sum / NROUNDS / NSEC_PER_USEC), (int)(max / NSEC_PER_USEC));
+    assert((n = schedstat(stats, MAXHARTS)) > 0);
+    for (i = 0; i < n; i ++) {
+        cprintf("  hart %d: %u preemptions in the kernel, %u usec scheduling latency at most\n",
+                stats[i].ss_hartid, (unsigned int)stats[i].ss_preemptions,
+                (unsigned int)stats[i].ss_max_latency_usec);
+    }
+    cprintf("preemptbench pass.\n");
+    return 0;
+}
@@ -3,12 +3,46 @@
 #include <string.h>
 #include <stdlib.h>
 
+/*
+ * Fairness and latency: TOTAL CPU-bound children ask for 1 .. TOTAL shares
+ * of the CPU, through lab6_set_priority for the stride class and through
+ * nice levels whose weights are about 1 .. TOTAL times that of nice 0 for
+ * the fair class. Their loop counts should come out in that ratio. Next
+ * to them a sleeper wakes up every tick and measures how late it runs.
+ */
+
 #define TOTAL 5
 /* to get enough accuracy, MAX_TIME (the running time of each process) should >1000 mseconds. */
 #define MAX_TIME  10000
+/* the sleeper's period, in ticks and in msec */
+#define SLEEP_TICKS 1
+#define SLEEP_MSEC (SLEEP_TICKS * 10)
 unsigned int acc[TOTAL];
 int status[TOTAL];
 int pids[TOTAL];
+/* weights 1024, 1991, 3121, 3906, 4904: about 1 : 2 : 3 : 4 : 5 */
+const int nices[TOTAL] = {0, -3, -5, -6, -7};
+
+/* wake up every SLEEP_TICKS until MAX_TIME, exit with the worst delay in msec */
+static void
+sleeper(void)
+{
+     unsigned int start, late, max = 0, sum = 0, n = 0;
+     while ((start = gettime_msec()) < MAX_TIME) {
+          sleep(SLEEP_TICKS);
+          late = gettime_msec() - start - SLEEP_MSEC;
+          if ((int)late < 0) {
+               late = 0;
+          }
+          sum += late, n ++;
+          if (late > max) {
+               max = late;
+          }
+     }
+     cprintf("sleeper pid %d: %u wakeups, %u msec late on average, %u at most\n",
+             getpid(), n, (n != 0) ? sum / n : 0, max);
+     exit(max);
+}
 
 static void
 spin_delay(void)
@@ -23,14 +57,22 @@ spin_delay(void)
 
 int
 main(void) {
-     int i,time;
+     int i,time,sleeper_pid,latency;
      memset(pids, 0, sizeof(pids));
      lab6_set_priority(TOTAL + 1);
 
+     if ((sleeper_pid = fork()) == 0) {
+          sleeper();
+     }
+     if (sleeper_pid < 0) {
+          panic("FAIL: fork sleeper\n");
+     }
+
      for (i = 0; i < TOTAL; i ++) {
           acc[i]=0;
           if ((pids[i] = fork()) == 0) {
                lab6_set_priority(i + 1);
+               setnice(nices[i]);
                acc[i] = 0;
                while (1) {
                     spin_delay();
@@ -57,7 +99,9 @@ main(void) {
          cprintf("main: pid %d, acc %d, time %d\n",pids[i],status[i],gettime_msec()); 
      }
      cprintf("main: wait pids over\n");
-     cprintf("stride sched correct result:");
+     waitpid(sleeper_pid, &latency);
+     cprintf("main: sleeper woke up at most %d msec late\n", latency);
+     cprintf("sched correct result:");
      for (i = 0; i < TOTAL; i ++)
      {
          cprintf(" %d", (status[i] * 2 / status[0] + 1) / 2);
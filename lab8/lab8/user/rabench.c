@@ -0,0 +1,73 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <file.h>
+#include <stat.h>
+#include <unistd.h>
+
+/*
+ * readahead: a FILE_SIZE file is read front to back in CHUNK sized reads, then at
+ * scattered offsets with pread. The sequential pass must find most of its bytes in the
+ * readahead cache; the scattered pass must keep the window closed (it may still find
+ * blocks the first pass left in the cache). SFS can't create files, so
+ * the file comes with the disk image (see fsdata in the Makefile), chunk i filled
+ * with the byte i.
+ */
+
+#define FILE_NAME                       "rabench.dat"
+#define FILE_SIZE                       (256 * 1024)
+#define CHUNK                           1024
+#define NRANDOM                         64
+
+static char buf[CHUNK];
+
+static void
+print_rastat(const char *what, struct rastat *stat, unsigned int msec) {
+    cprintf("%s: %d reads (%d sequential), %d KB, %d KB from readahead, window %d, %u msec.\n", what,
+            stat->ra_reads, stat->ra_seqreads, stat->ra_bytes / 1024, stat->ra_hits / 1024,
+            stat->ra_window, msec);
+}
+
+static void
+seq_read(void) {
+    struct rastat stat;
+    unsigned int start = gettime_msec();
+    int fd, i, ret;
+    assert((fd = open(FILE_NAME, O_RDONLY)) >= 0);
+    for (i = 0; (ret = read(fd, buf, CHUNK)) > 0; i += ret) {
+        assert(ret == CHUNK && buf[0] == (char)(i / CHUNK) && buf[CHUNK - 1] == buf[0]);
+        // give the flusher a chance to run the readahead before we get there
+        if (i % (16 * CHUNK) == 0) {
+            yield();
+        }
+    }
+    assert(i == FILE_SIZE);
+    assert(rastat(fd, &stat) == 0);
+    print_rastat("sequential", &stat, gettime_msec() - start);
+    assert(stat.ra_seqreads == stat.ra_reads && stat.ra_hits >= FILE_SIZE / 2);
+    close(fd);
+}
+
+static void
+random_read(void) {
+    struct rastat stat;
+    unsigned int start = gettime_msec();
+    int fd, i;
+    assert((fd = open(FILE_NAME, O_RDONLY)) >= 0);
+    for (i = 0; i < NRANDOM; i ++) {
+        int blk = (i * 37 + 11) % (FILE_SIZE / CHUNK);
+        assert(pread(fd, buf, CHUNK, blk * CHUNK) == CHUNK && buf[0] == (char)blk);
+    }
+    assert(rastat(fd, &stat) == 0);
+    print_rastat("random", &stat, gettime_msec() - start);
+    assert(stat.ra_window == 0);
+    close(fd);
+}
+
+int
+main(void) {
+    seq_read();
+    random_read();
+    cprintf("rabench pass.\n");
+    return 0;
+}
+
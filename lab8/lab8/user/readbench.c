@@ -0,0 +1,79 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <file.h>
+#include <unistd.h>
+
+/*
+ * concurrent file reads: NPROCS children each read FILE_SIZE bytes NPASSES times,
+ * first every child from a file of its own, then all of them from one shared file.
+ * Readers of different files take no common lock, and readers of one file share
+ * its inode lock, so neither run should serialize the children. SFS can't create
+ * files, so the NPROCS files come with the disk image (see fsdata in the Makefile),
+ * chunk i of each filled with the byte i.
+ */
+
+#define NPROCS                          4
+#define NPASSES                         4
+#define FILE_SIZE                       (128 * 1024)
+#define CHUNK                           4096
+
+static char buf[CHUNK];
+
+static void
+file_name(char *name, int i) {
+    snprintf(name, 16, "readbench.%d", i);
+}
+
+static int
+read_file(const char *name) {
+    int pass, fd, i, ret;
+    for (pass = 0; pass < NPASSES; pass ++) {
+        if ((fd = open(name, O_RDONLY)) < 0) {
+            return fd;
+        }
+        for (i = 0; (ret = read(fd, buf, CHUNK)) > 0; i += ret) {
+            if (ret != CHUNK || buf[0] != (char)(i / CHUNK)) {
+                close(fd);
+                return -1;
+            }
+        }
+        close(fd);
+        if (ret < 0 || i != FILE_SIZE) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void
+bench(const char *what, bool shared) {
+    char name[16];
+    int pids[NPROCS], i;
+    unsigned int start = gettime_msec();
+    for (i = 0; i < NPROCS; i ++) {
+        file_name(name, shared ? 0 : i);
+        if ((pids[i] = fork()) == 0) {
+            exit(read_file(name));
+        }
+        assert(pids[i] > 0);
+    }
+    for (i = 0; i < NPROCS; i ++) {
+        int exit_code;
+        assert(waitpid(pids[i], &exit_code) == 0 && exit_code == 0);
+    }
+    unsigned int msec = gettime_msec() - start;
+    if (msec == 0) {
+        msec = 1;
+    }
+    unsigned int total = NPROCS * NPASSES * FILE_SIZE;
+    cprintf("%s: %d readers, %u KB in %u msec, %u KB/s.\n", what, NPROCS, total / 1024, msec,
+            (unsigned int)((unsigned long long)total * 1000 / 1024 / msec));
+}
+
+int
+main(void) {
+    bench("own files", 0);
+    bench("one file", 1);
+    cprintf("readbench pass.\n");
+    return 0;
+}
@@ -0,0 +1,148 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <string.h>
+#include <file.h>
+#include <uring.h>
+#include <unistd.h>
+
+/*
+ * syscall ring against plain syscalls: a FILE_SIZE file is read back in SMALL sized pieces,
+ * first by one read() trap per piece, then through the ring BATCH preads per ring_enter.
+ * Both passes checksum what they read. Last, a file is opened, written, synced and closed
+ * through the ring alone, and read back with plain syscalls. The files are on "tmp:",
+ * as SFS can't create files.
+ */
+
+#define FILE_NAME                       "tmp:ringbench.dat"
+#define OPS_NAME                        "tmp:ringbench.ops"
+#define FILE_SIZE                       (256 * 1024)
+#define SMALL                           256
+#define BATCH                           32
+
+static char buf[BATCH][SMALL];
+
+static unsigned int
+checksum(unsigned int sum, const char *data, size_t len) {
+    while (len -- > 0) {
+        sum = sum * 31 + (unsigned char)(*data ++);
+    }
+    return sum;
+}
+
+static void
+report(const char *what, unsigned int start, int traps) {
+    unsigned int msec = gettime_msec() - start;
+    if (msec == 0) {
+        msec = 1;
+    }
+    cprintf("%s: %d KB in %d traps, %u msec, %u KB/s.\n", what, FILE_SIZE / 1024, traps, msec,
+            (unsigned int)((unsigned long long)FILE_SIZE * 1000 / 1024 / msec));
+}
+
+static void
+make_file(void) {
+    int fd, i;
+    assert((fd = open(FILE_NAME, O_WRONLY | O_CREAT | O_TRUNC)) >= 0);
+    for (i = 0; i < FILE_SIZE; i += SMALL) {
+        memset(buf[0], (char)(i / SMALL * 7), SMALL);
+        assert(write(fd, buf[0], SMALL) == SMALL);
+    }
+    close(fd);
+}
+
+static unsigned int
+bench_read(void) {
+    unsigned int sum = 0, start = gettime_msec();
+    int fd, i, traps = 0;
+    assert((fd = open(FILE_NAME, O_RDONLY)) >= 0);
+    for (i = 0; i < FILE_SIZE; i += SMALL) {
+        assert(read(fd, buf[0], SMALL) == SMALL);
+        sum = checksum(sum, buf[0], SMALL);
+        traps ++;
+    }
+    close(fd);
+    report("read", start, traps);
+    return sum;
+}
+
+static unsigned int
+bench_ring(struct uring *ring) {
+    unsigned int sum = 0, start = gettime_msec();
+    int fd, i, j, traps = 0;
+    assert((fd = open(FILE_NAME, O_RDONLY)) >= 0);
+    for (i = 0; i < FILE_SIZE; i += BATCH * SMALL) {
+        for (j = 0; j < BATCH; j ++) {
+            struct ring_sqe *sqe = uring_get_sqe(ring);
+            assert(sqe != NULL);
+            uring_prep_read(sqe, fd, buf[j], SMALL, i + j * SMALL);
+            sqe->user_data = j;
+        }
+        assert(uring_submit(ring, BATCH) == BATCH);
+        traps ++;
+        // completions come back in submission order, the worker runs them one by one
+        for (j = 0; j < BATCH; j ++) {
+            struct ring_cqe *cqe;
+            assert(uring_wait_cqe(ring, &cqe) == 0);
+            assert(cqe->user_data == j && cqe->res == SMALL);
+            uring_cqe_seen(ring);
+            sum = checksum(sum, buf[j], SMALL);
+        }
+    }
+    close(fd);
+    report("ring", start, traps);
+    return sum;
+}
+
+static struct ring_cqe *
+ring_call(struct uring *ring, struct ring_sqe *sqe) {
+    struct ring_cqe *cqe;
+    assert(uring_submit(ring, 1) == 1 && uring_wait_cqe(ring, &cqe) == 0);
+    return cqe;
+}
+
+static void
+check_ring_ops(struct uring *ring) {
+    static const char msg[] = "written through the ring";
+    static char rbuf[sizeof(msg)];
+    struct ring_sqe *sqe;
+    struct ring_cqe *cqe;
+    int fd;
+
+    uring_prep_open(sqe = uring_get_sqe(ring), OPS_NAME, O_RDWR | O_CREAT | O_TRUNC);
+    cqe = ring_call(ring, sqe);
+    assert((fd = cqe->res) >= 0);
+    uring_cqe_seen(ring);
+
+    uring_prep_write(sqe = uring_get_sqe(ring), fd, (void *)msg, sizeof(msg), -1);
+    cqe = ring_call(ring, sqe);
+    assert(cqe->res == sizeof(msg));
+    uring_cqe_seen(ring);
+
+    uring_prep_fsync(sqe = uring_get_sqe(ring), fd);
+    cqe = ring_call(ring, sqe);
+    assert(cqe->res == 0);
+    uring_cqe_seen(ring);
+
+    uring_prep_close(sqe = uring_get_sqe(ring), fd);
+    cqe = ring_call(ring, sqe);
+    assert(cqe->res == 0);
+    uring_cqe_seen(ring);
+
+    assert((fd = open(OPS_NAME, O_RDONLY)) >= 0);
+    assert(read(fd, rbuf, sizeof(rbuf)) == sizeof(msg) && memcmp(rbuf, msg, sizeof(msg)) == 0);
+    close(fd);
+    cprintf("ring ops ok.\n");
+}
+
+int
+main(void) {
+    struct uring ring;
+    assert(uring_init(&ring) == 0);
+    make_file();
+    unsigned int sum1 = bench_read(), sum2 = bench_ring(&ring);
+    assert(sum1 == sum2);
+    check_ring_ops(&ring);
+    cprintf("ringbench pass.\n");
+    return 0;
+}
+
@@ -0,0 +1,59 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <stat.h>
+
+/*
+ * Harts at work: fork NWORKERS CPU-bound children, more than there are
+ * harts, and time how long they take together. Then print the load,
+ * context switches and migrations of each hart: the load balancer moves
+ * the workers left waiting to harts that ran out of work. Run it with
+ * "make qemu SMP=4" to compare with a single hart.
+ */
+
+#define NWORKERS                        8
+#define NLOOPS                          (4 * 1024 * 1024)
+#define MAXHARTS                        8
+
+static volatile unsigned int sink;
+
+static unsigned int
+spin(unsigned int seed) {
+    unsigned int i, x = seed;
+    for (i = 0; i < NLOOPS; i ++) {
+        x = x * 1103515245 + 12345;
+    }
+    return x;
+}
+
+int
+main(void) {
+    int i, n, pids[NWORKERS];
+    struct schedstat stats[MAXHARTS];
+
+    unsigned int start = gettime_msec();
+    for (i = 0; i < NWORKERS; i ++) {
+        if ((pids[i] = fork()) == 0) {
+            sink = spin(i);
+            exit(0);
+        }
+        assert(pids[i] > 0);
+    }
+    for (i = 0; i < NWORKERS; i ++) {
+        assert(waitpid(pids[i], NULL) == 0);
+    }
+    unsigned int msec = gettime_msec() - start;
+    cprintf("smpbench: %d workers in %u msec.\n", NWORKERS, msec);
+
+    assert((n = schedstat(stats, MAXHARTS)) > 0);
+    for (i = 0; i < n; i ++) {
+        cprintf("hart %d: load %u, %u switches, %u balances, %u migrations in, %u out.\n",
+                stats[i].ss_hartid, stats[i].ss_load, (unsigned int)stats[i].ss_switches,
+                (unsigned int)stats[i].ss_balance, (unsigned int)stats[i].ss_migrations_in,
+                (unsigned int)stats[i].ss_migrations_out);
+        cprintf("hart %d: %u ticks, stopped %u times, idle %u msec.\n",
+                stats[i].ss_hartid, (unsigned int)stats[i].ss_ticks,
+                (unsigned int)stats[i].ss_tickless, (unsigned int)(stats[i].ss_idle_usec / 1000));
+    }
+    cprintf("smpbench pass.\n");
+    return 0;
+}
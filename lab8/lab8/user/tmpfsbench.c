@@ -0,0 +1,150 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stat.h>
+#include <file.h>
+#include <dir.h>
+#include <unistd.h>
+#include <error.h>
+
+/*
+ * tmpfs scratch files: stream FILE_SIZE bytes into a file on "tmp:" and read
+ * them back NPASSES times, reporting the bandwidth. Then check that a write
+ * past the end leaves a hole that reads as zeros and takes no page, that a
+ * file written by a child is seen by its parent, that a directory is made
+ * and removed with mkdir and rmdir but never by unlink, and that the files
+ * show up when the directory is listed.
+ */
+
+#define FILE_SIZE                       (1024 * 1024)
+#define NPASSES                         8
+#define CHUNK                           4096
+#define HOLE_OFF                        (16 * CHUNK)
+
+static char buf[CHUNK];
+
+static int
+stream(const char *name) {
+    int fd, i, pass, ret;
+    unsigned int start = gettime_msec();
+    if ((fd = open(name, O_RDWR | O_CREAT | O_TRUNC)) < 0) {
+        return fd;
+    }
+    for (i = 0; i < FILE_SIZE; i += CHUNK) {
+        memset(buf, (char)(i / CHUNK), CHUNK);
+        if (write(fd, buf, CHUNK) != CHUNK) {
+            goto failed;
+        }
+    }
+    for (pass = 0; pass < NPASSES; pass ++) {
+        assert(seek(fd, 0, LSEEK_SET) == 0);
+        for (i = 0; (ret = read(fd, buf, CHUNK)) > 0; i += ret) {
+            if (ret != CHUNK || buf[0] != (char)(i / CHUNK) || buf[CHUNK - 1] != buf[0]) {
+                goto failed;
+            }
+        }
+        if (ret < 0 || i != FILE_SIZE) {
+            goto failed;
+        }
+    }
+    close(fd);
+
+    unsigned int msec = gettime_msec() - start;
+    if (msec == 0) {
+        msec = 1;
+    }
+    unsigned int total = (NPASSES + 1) * FILE_SIZE;
+    cprintf("%s: %u KB in %u msec, %u KB/s.\n", name, total / 1024, msec,
+            (unsigned int)((unsigned long long)total * 1000 / 1024 / msec));
+    return 0;
+
+failed:
+    close(fd);
+    return -1;
+}
+
+static int
+check_hole(const char *name) {
+    int fd, i;
+    struct stat stat;
+    assert((fd = open(name, O_RDWR | O_CREAT | O_TRUNC)) >= 0);
+    memset(buf, 'h', CHUNK);
+    assert(pwrite(fd, buf, CHUNK, HOLE_OFF) == CHUNK);
+    assert(fstat(fd, &stat) == 0);
+    assert(stat.st_size == HOLE_OFF + CHUNK && stat.st_blocks == 1);
+    assert(pread(fd, buf, CHUNK, HOLE_OFF / 2) == CHUNK);
+    for (i = 0; i < CHUNK; i ++) {
+        assert(buf[i] == 0);
+    }
+    close(fd);
+    cprintf("hole: %d KB file in %d page ok.\n", (int)(stat.st_size / 1024), (int)stat.st_blocks);
+    return 0;
+}
+
+static int
+check_shared(const char *name) {
+    int fd, pid, exit_code;
+    if ((pid = fork()) == 0) {
+        if ((fd = open(name, O_WRONLY | O_CREAT | O_TRUNC)) < 0) {
+            exit(fd);
+        }
+        memset(buf, 'c', CHUNK);
+        exit(write(fd, buf, CHUNK) == CHUNK ? 0 : -1);
+    }
+    assert(pid > 0);
+    assert(waitpid(pid, &exit_code) == 0 && exit_code == 0);
+    assert((fd = open(name, O_RDONLY)) >= 0);
+    assert(read(fd, buf, CHUNK) == CHUNK && buf[0] == 'c' && buf[CHUNK - 1] == 'c');
+    assert(read(fd, buf, CHUNK) == 0);
+    close(fd);
+    cprintf("shared: child's file read back ok.\n");
+    return 0;
+}
+
+static int
+check_dirs(const char *name, const char *file) {
+    int fd;
+    assert(mkdir(name) == 0);
+    assert(mkdir(name) == -E_EXISTS);
+    assert((fd = open(file, O_WRONLY | O_CREAT)) >= 0);
+    close(fd);
+    assert(unlink(name) == -E_ISDIR);
+    assert(rmdir(name) == -E_NOTEMPTY);
+    assert(rmdir(file) == -E_NOTDIR);
+    assert(unlink(file) == 0);
+    assert(open(file, O_RDONLY) == -E_NOENT);
+    assert(rmdir(name) == 0);
+    assert(open(name, O_RDONLY) == -E_NOENT);
+    cprintf("dirs: mkdir, unlink and rmdir ok.\n");
+    return 0;
+}
+
+static int
+check_list(void) {
+    DIR *dirp;
+    struct dirent *direntp;
+    int found = 0;
+    assert((dirp = opendir("tmp:")) != NULL);
+    while ((direntp = readdir(dirp)) != NULL) {
+        if (strcmp(direntp->name, "scratch") == 0 || strcmp(direntp->name, "hole") == 0
+                || strcmp(direntp->name, "shared") == 0) {
+            found ++;
+        }
+    }
+    closedir(dirp);
+    assert(found == 3);
+    cprintf("list: 3 files found.\n");
+    return 0;
+}
+
+int
+main(void) {
+    assert(stream("tmp:scratch") == 0);
+    assert(check_hole("tmp:hole") == 0);
+    assert(check_shared("tmp:shared") == 0);
+    assert(check_dirs("tmp:dir", "tmp:dir/file") == 0);
+    assert(check_list() == 0);
+    cprintf("tmpfsbench pass.\n");
+    return 0;
+}
+
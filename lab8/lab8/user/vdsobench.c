@@ -0,0 +1,72 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <syscall.h>
+#include <time.h>
+
+/*
+ * getpid and the clocks off the vdso page: they must agree with the
+ * syscalls, in a forked child too, and cost a load or two instead of a trap.
+ * NCALLS of each are timed both ways.
+ */
+
+#define NCALLS                          10000
+
+static uint64_t
+now_ns(void) {
+    struct timespec ts;
+    assert(clock_gettime(CLOCK_MONOTONIC, &ts) == 0);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void
+check(void) {
+    struct timespec ts;
+    uint64_t ns;
+    assert(getpid() == sys_getpid());
+    ns = now_ns();
+    assert(sys_clock_gettime(CLOCK_MONOTONIC, &ts) == 0);
+    assert((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec >= ns);
+    assert(gettime_msec() >= ns / NSEC_PER_MSEC);
+}
+
+int
+main(void) {
+    int i, pid, code;
+    uint64_t start, vdso_ns, trap_ns;
+    struct timespec ts;
+
+    check();
+    if ((pid = fork()) == 0) {
+        check();
+        exit(getpid());
+    }
+    assert(pid > 0 && waitpid(pid, &code) == 0 && code == pid);
+
+    start = now_ns();
+    for (i = 0; i < NCALLS; i ++) {
+        getpid();
+    }
+    vdso_ns = now_ns() - start;
+    start = now_ns();
+    for (i = 0; i < NCALLS; i ++) {
+        sys_getpid();
+    }
+    trap_ns = now_ns() - start;
+    cprintf("vdsobench: getpid %d ns, with a trap %d ns.\n",
+            (int)(vdso_ns / NCALLS), (int)(trap_ns / NCALLS));
+
+    start = now_ns();
+    for (i = 0; i < NCALLS; i ++) {
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+    }
+    vdso_ns = now_ns() - start;
+    start = now_ns();
+    for (i = 0; i < NCALLS; i ++) {
+        sys_clock_gettime(CLOCK_MONOTONIC, &ts);
+    }
+    trap_ns = now_ns() - start;
+    cprintf("vdsobench: clock_gettime %d ns, with a trap %d ns.\n",
+            (int)(vdso_ns / NCALLS), (int)(trap_ns / NCALLS));
+    cprintf("vdsobench pass.\n");
+    return 0;
+}